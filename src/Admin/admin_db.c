@@ -1,7 +1,10 @@
 #include "admin_db.h"
 #include "../utils/logger.h"
 #include "../utils/hash_utils.h"
+#include "../utils/clock_utils.h"
 #include "../common/paths.h"
+#include "../database/database.h"
+#include "../database/id_allocator.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -243,48 +246,36 @@ int createNewAccount(const char *accountHolderName, int cardNumber, int pin) {
         return 0;
     }
     
-    // Get next available IDs
-    int nextCustomerID = 10001; // Default start value
-    int nextAccountID = 10001; // Default start value
-    int nextCardID = 10001; // Default start value
+    // Get next available IDs from the shared sequences
+    long long nextCustomerID = allocateId(ID_SEQUENCE_CUSTOMER);
+    long long nextAccountID = allocateId(ID_SEQUENCE_ACCOUNT);
+    long long nextCardID = allocateId(ID_SEQUENCE_CARD);
+    if (nextCustomerID == 0 || nextAccountID == 0 || nextCardID == 0) {
+        writeErrorLog("Failed to allocate IDs while creating new account");
+        free(pinHash);
+        return 0;
+    }
     
     // Generate unique IDs
-    char customerID[10], accountID[10], cardID[10];
-    sprintf(customerID, "C%d", nextCustomerID);
-    sprintf(accountID, "A%d", nextAccountID);
-    sprintf(cardID, "D%d", nextCardID);
+    char customerID[24], accountID[24], cardID[24];
+    sprintf(customerID, "C%lld", nextCustomerID);
+    sprintf(accountID, "A%lld", nextAccountID);
+    sprintf(cardID, "D%lld", nextCardID);
     
     // Generate expiry date (2 years from now)
-    time_t now = time(NULL);
-    struct tm* tm_now = localtime(&now);
-    tm_now->tm_year += 2;
+    ClockReading now;
+    clockRead(&now);
+    now.local.tm_year += 2;
     char expiryDate[11];
-    strftime(expiryDate, sizeof(expiryDate), "%Y-%m-%d", tm_now);
+    strftime(expiryDate, sizeof(expiryDate), "%Y-%m-%d", &now.local);
     
-    // Update customer.txt
-    FILE *customerFile = fopen(getCustomerFilePath(), "a");
-    if (customerFile == NULL) {
-        writeErrorLog("Failed to open customer.txt while creating new account");
+    // Add the account and card through the storage engine so every engine serves them
+    if (!addAccountWithCard(customerID, accountID, cardID, accountHolderName, cardNumber, pinHash, expiryDate)) {
+        writeErrorLog("Failed to add the new account to storage");
         free(pinHash);
         return 0;
     }
     
-    fprintf(customerFile, "%s | %s | %-20s | Regular | Active | 0.00\n", 
-            customerID, accountID, accountHolderName);
-    fclose(customerFile);
-    
-    // Update card.txt
-    FILE *cardFile = fopen(getCardFilePath(), "a");
-    if (cardFile == NULL) {
-        writeErrorLog("Failed to open card.txt while creating new account");
-        free(pinHash);
-        return 0;
-    }
-    
-    fprintf(cardFile, "%s | %s | %-16d | Debit     | %s | Active  | %s\n", 
-            cardID, accountID, cardNumber, expiryDate, pinHash);
-    fclose(cardFile);
-    
     // Clean up allocated memory
     free(pinHash);
     
@@ -318,133 +309,40 @@ int generateRandomPin() {
 
 // Check if a card number is unique
 int isCardNumberUnique(int cardNumber) {
-    FILE *file = fopen(getCardFilePath(), "r");
-    if (file == NULL) {
-        writeErrorLog("Failed to open card.txt while checking card number uniqueness");
-        return 1; // Assume it's unique if we can't check
-    }
-    
-    char line[256];
-    bool found = false;
-    
-    // Skip header lines
-    fgets(line, sizeof(line), file);
-    fgets(line, sizeof(line), file);
-    
-    // Format: Card ID | Account ID | Card Number | Card Type | Expiry Date | Status | PIN Hash
-    char cardID[10], accountID[10], cardNumberStr[20], cardType[10], expiryDate[15], status[10], pinHash[65];
-    
-    while (fgets(line, sizeof(line), file) != NULL && !found) {
-        if (sscanf(line, "%s | %s | %s | %s | %s | %s | %s", 
-                   cardID, accountID, cardNumberStr, cardType, expiryDate, status, pinHash) >= 7) {
-            int storedCardNumber = atoi(cardNumberStr);
-            if (storedCardNumber == cardNumber) {
-                found = true;
-                break;
-            }
-        }
-    }
-
-    fclose(file);
-    return !found; // Return true if card number is unique (not found)
+    return !doesCardExist(cardNumber);
 }
 
-// Update card details (PIN and/or status)
+// Update card details (PIN and/or status) through the storage engine
 int updateCardDetails(int cardNumber, int newPIN, const char *newStatus) {
-    FILE *file = fopen(getCardFilePath(), "r");
-    if (file == NULL) {
-        writeErrorLog("Failed to open card.txt while updating card details");
+    char status[20];
+    if (!getCardStatus(cardNumber, status, sizeof(status))) {
+        writeErrorLog("Card not found while updating card details");
         return 0;
     }
 
-    char tempFileName[100];
-    sprintf(tempFileName, "%s/temp/temp_card.txt", isTestingMode() ? TEST_DATA_DIR : PROD_DATA_DIR);
-    
-    FILE *tempFile = fopen(tempFileName, "w");
-    if (tempFile == NULL) {
-        fclose(file);
-        writeErrorLog("Failed to create temporary file while updating card details");
+    if (newPIN != -1 && !updatePIN(cardNumber, newPIN)) {
+        writeErrorLog("Failed to update PIN while updating card details");
         return 0;
     }
 
-    char line[256];
-    bool found = false;
-
-    // Copy header lines
-    if (fgets(line, sizeof(line), file))
-        fprintf(tempFile, "%s", line);
-    if (fgets(line, sizeof(line), file))
-        fprintf(tempFile, "%s", line);
-
-    // Process each card line
-    char cardID[10], accountID[10], cardNumberStr[20], cardType[10], expiryDate[15], status[10], storedPinHash[65];
-    
-    while (fgets(line, sizeof(line), file) != NULL) {
-        char lineCopy[256];
-        strcpy(lineCopy, line);
-        
-        if (sscanf(lineCopy, "%s | %s | %s | %s | %s | %s | %s", 
-                   cardID, accountID, cardNumberStr, cardType, expiryDate, status, storedPinHash) >= 7) {
-            int storedCardNumber = atoi(cardNumberStr);
-            if (storedCardNumber == cardNumber) {
-                found = true;
-                // Generate new PIN hash if needed
-                char* finalPinHash = storedPinHash;
-                char newPinHash[65];
-                bool freePinHash = false;
-                
-                if (newPIN != -1) {
-                    char pinStr[10];
-                    sprintf(pinStr, "%d", newPIN);
-                    char* tempPinHash = sha256_hash(pinStr);
-                    if (tempPinHash != NULL) {
-                        strcpy(newPinHash, tempPinHash);
-                        finalPinHash = newPinHash;
-                        free(tempPinHash);
-                    }
-                }
-                
-                // Update status if specified
-                const char* finalStatus = (newStatus != NULL) ? newStatus : status;
-                
-                fprintf(tempFile, "%s | %s | %s | %s | %s | %-7s | %s\n", 
-                        cardID, accountID, cardNumberStr, cardType, expiryDate, finalStatus, finalPinHash);
-                
-                // Log the update
-                char logMsg[200];
-                if (newPIN != -1 && newStatus != NULL) {
-                    sprintf(logMsg, "Updated PIN and status to '%s' for card %d", 
-                            finalStatus, cardNumber);
-                } else if (newPIN != -1) {
-                    sprintf(logMsg, "Updated PIN for card %d", cardNumber);
-                } else {
-                    sprintf(logMsg, "Updated status to '%s' for card %d", 
-                            finalStatus, cardNumber);
-                }
-                writeAuditLog("ADMIN", logMsg);
-            } else {
-                fprintf(tempFile, "%s", line);
-            }
-        } else {
-            fprintf(tempFile, "%s", line);
+    if (newStatus != NULL) {
+        bool updated = strcmp(newStatus, "Active") == 0 ? unblockCard(cardNumber) : blockCard(cardNumber);
+        if (!updated) {
+            writeErrorLog("Failed to update status while updating card details");
+            return 0;
         }
     }
 
-    fclose(file);
-    fclose(tempFile);
-
-    // Replace original file with updated file
-    if (!found) {
-        remove(tempFileName);
-        writeErrorLog("Card not found while updating card details");
-        return 0;
-    }
-
-    if (remove(getCardFilePath()) != 0 || 
-        rename(tempFileName, getCardFilePath()) != 0) {
-        writeErrorLog("Failed to replace card.txt with updated file");
-        return 0;
+    // Log the update
+    char logMsg[200];
+    if (newPIN != -1 && newStatus != NULL) {
+        sprintf(logMsg, "Updated PIN and status to '%s' for card %d", newStatus, cardNumber);
+    } else if (newPIN != -1) {
+        sprintf(logMsg, "Updated PIN for card %d", cardNumber);
+    } else {
+        sprintf(logMsg, "Updated status to '%s' for card %d", newStatus != NULL ? newStatus : status, cardNumber);
     }
+    writeAuditLog("ADMIN", logMsg);
 
     return 1; // Card details updated successfully
 }
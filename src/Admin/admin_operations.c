@@ -51,40 +51,8 @@ void blockCustomerCard(int cardNumber) {
     }
     
     // Check if card is already blocked
-    FILE* file = fopen(getCardFilePath(), "r");
-    if (file == NULL) {
-        printf("\nError: Could not open card file for reading.\n");
-        writeErrorLog("Failed to open card file while blocking card");
-        return;
-    }
-    
-    char line[256];
-    int storedCardNumber;
-    char status[10];
-    int found = 0;
-    
-    // Skip header lines
-    fgets(line, sizeof(line), file);
-    fgets(line, sizeof(line), file);
-    
-    // Format: Card ID | Account ID | Card Number | Card Type | Expiry Date | Status | PIN Hash
-    char cardID[10], accountID[10], cardNumberStr[20], cardType[10], expiryDate[15], cardStatus[10], pinHash[65];
-    
-    while (fgets(line, sizeof(line), file) != NULL) {
-        if (sscanf(line, "%s | %s | %s | %s | %s | %s | %s", 
-                   cardID, accountID, cardNumberStr, cardType, expiryDate, cardStatus, pinHash) >= 7) {
-            storedCardNumber = atoi(cardNumberStr);
-            if (storedCardNumber == cardNumber) {
-                found = 1;
-                strcpy(status, cardStatus);
-                break;
-            }
-        }
-    }
-    
-    fclose(file);
-    
-    if (!found) {
+    char status[20];
+    if (!getCardStatus(cardNumber, status, sizeof(status))) {
         printf("\nError: Card not found in the database.\n");
         return;
     }
@@ -117,40 +85,8 @@ void unblockCustomerCard(int cardNumber) {
     }
     
     // Check if card is already active
-    FILE* file = fopen(getCardFilePath(), "r");
-    if (file == NULL) {
-        printf("\nError: Could not open card file for reading.\n");
-        writeErrorLog("Failed to open card file while unblocking card");
-        return;
-    }
-    
-    char line[256];
-    int storedCardNumber;
-    char status[10];
-    int found = 0;
-    
-    // Skip header lines
-    fgets(line, sizeof(line), file);
-    fgets(line, sizeof(line), file);
-    
-    // Format: Card ID | Account ID | Card Number | Card Type | Expiry Date | Status | PIN Hash
-    char cardID[10], accountID[10], cardNumberStr[20], cardType[10], expiryDate[15], cardStatus[10], pinHash[65];
-    
-    while (fgets(line, sizeof(line), file) != NULL) {
-        if (sscanf(line, "%s | %s | %s | %s | %s | %s | %s", 
-                   cardID, accountID, cardNumberStr, cardType, expiryDate, cardStatus, pinHash) >= 7) {
-            storedCardNumber = atoi(cardNumberStr);
-            if (storedCardNumber == cardNumber) {
-                found = 1;
-                strcpy(status, cardStatus);
-                break;
-            }
-        }
-    }
-    
-    fclose(file);
-    
-    if (!found) {
+    char status[20];
+    if (!getCardStatus(cardNumber, status, sizeof(status))) {
         printf("\nError: Card not found in the database.\n");
         return;
     }
@@ -183,38 +119,8 @@ void changeCardStatus(int cardNumber) {
     }
     
     // Check card's current status
-    FILE* file = fopen(getCardFilePath(), "r");
-    if (file == NULL) {
-        printf("\nError: Could not open card file.\n");
-        return;
-    }
-    
-    char line[256];
-    int storedCardNumber;
-    char storedUsername[50], storedStatus[10];
-    int found = 0;
-    
-    // Skip header lines
-    fgets(line, sizeof(line), file);
-    fgets(line, sizeof(line), file);
-    
-    // Format: Card ID | Account ID | Card Number | Card Type | Expiry Date | Status | PIN Hash
-    char cardID[10], accountID[10], cardNumberStr[20], cardType[10], expiryDate[15], status[10], pinHash[65];
-    
-    while (fgets(line, sizeof(line), file) != NULL) {
-        if (sscanf(line, "%s | %s | %s | %s | %s | %s | %s", 
-                   cardID, accountID, cardNumberStr, cardType, expiryDate, status, pinHash) >= 7) {
-            storedCardNumber = atoi(cardNumberStr);
-            if (storedCardNumber == cardNumber) {
-                found = 1;
-                break;
-            }
-        }
-    }
-    
-    fclose(file);
-    
-    if (!found) {
+    char status[20];
+    if (!getCardStatus(cardNumber, status, sizeof(status))) {
         printf("\nError: Card number %d does not exist.\n", cardNumber);
         return;
     }
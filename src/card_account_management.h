@@ -1,9 +1,15 @@
 #ifndef CARD_ACCOUNT_MANAGEMENT_H
 #define CARD_ACCOUNT_MANAGEMENT_H
 
-// Card operations
-int blockCard(int cardNumber);
-int unblockCard(int cardNumber);
-float getDailyWithdrawals(int cardNumber);
+#include "database/id_allocator.h"
 
-#endif // CARD_ACCOUNT_MANAGEMENT_H
\ No newline at end of file
+// Card and balance operations live in database.c, behind the storage engine
+
+// ID and expiry helpers; the returned strings must be freed by the caller
+char* generateUniqueID(const char* prefix, IdSequence sequence);
+char* generateExpiryDate();
+
+// Append a new customer and card to the text data files
+int appendCardAccount(const char* accountHolderName, int cardNumber, int pin);
+
+#endif // CARD_ACCOUNT_MANAGEMENT_H
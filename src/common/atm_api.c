@@ -317,6 +317,114 @@ AtmApiResult atm_api_check_balance(int card_number, const char* auth_token) {
     return result;
 }
 
+// Get mini statement with the last `count` transactions
+AtmApiResult atm_api_get_mini_statement(int card_number, const char* auth_token, int count) {
+    AtmApiResult result = create_api_result();
+    
+    // Verify session
+    AtmApiResult session_result = atm_api_verify_session(auth_token);
+    if (!session_result.success) {
+        // Copy error from session verification
+        result.success = session_result.success;
+        result.error_code = session_result.error_code;
+        strncpy(result.message, session_result.message, sizeof(result.message));
+        return result;
+    }
+    
+    // Verify card number matches session
+    SessionInfo* session = find_session(auth_token);
+    if (session->card_number != card_number && !session->is_admin) {
+        set_error_result(&result, ERR_AUTHENTICATION, "Card number does not match authenticated session");
+        return result;
+    }
+    
+    // Served from the per-account history index, so `count` costs one read per row
+    TransactionResult statement_result = getMiniStatementWithCount(card_number, "API", count);
+    
+    if (statement_result.success) {
+        set_success_result(&result, "Mini statement retrieved successfully");
+        
+        size_t statement_size = strlen(statement_result.message) + 1;
+        char* statement = (char*)MALLOC(statement_size, "Mini statement text");
+        if (!statement) {
+            set_error_result(&result, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for mini statement");
+            return result;
+        }
+        
+        memcpy(statement, statement_result.message, statement_size);
+        result.data = statement;
+        result.data_size = statement_size;
+    } else {
+        set_error_result(&result, ERR_TRANSACTION_FAILED, statement_result.message);
+    }
+    
+    return result;
+}
+
+// Run a deposit, withdrawal or transfer for an authenticated session
+static AtmApiResult perform_api_transaction(const TransactionData* transaction, TransactionType type,
+                                            const char* success_message) {
+    AtmApiResult result = create_api_result();
+    
+    if (!transaction || transaction->type != type) {
+        set_error_result(&result, ERR_INVALID_INPUT, "Invalid transaction data");
+        return result;
+    }
+    
+    // Verify session
+    AtmApiResult session_result = atm_api_verify_session(transaction->auth_token);
+    if (!session_result.success) {
+        // Copy error from session verification
+        result.success = session_result.success;
+        result.error_code = session_result.error_code;
+        strncpy(result.message, session_result.message, sizeof(result.message));
+        return result;
+    }
+    
+    // Verify card number matches session
+    SessionInfo* session = find_session(transaction->auth_token);
+    if (session->card_number != transaction->card_number && !session->is_admin) {
+        set_error_result(&result, ERR_AUTHENTICATION, "Card number does not match authenticated session");
+        return result;
+    }
+    
+    // A retry with the same request_id gets the first attempt's result
+    TransactionResult transaction_result = performTransactionRequest(transaction, "API");
+    
+    if (transaction_result.success) {
+        set_success_result(&result, success_message);
+        
+        float* balance_ptr = (float*)MALLOC(sizeof(float), "Balance data");
+        if (!balance_ptr) {
+            set_error_result(&result, ERR_MEMORY_ALLOCATION, "Failed to allocate memory for balance data");
+            return result;
+        }
+        
+        *balance_ptr = transaction_result.newBalance;
+        result.data = balance_ptr;
+        result.data_size = sizeof(float);
+    } else {
+        set_error_result(&result, ERR_TRANSACTION_FAILED, transaction_result.message);
+    }
+    
+    return result;
+}
+
+// Perform a cash deposit
+AtmApiResult atm_api_deposit(const TransactionData* transaction) {
+    return perform_api_transaction(transaction, TRANSACTION_DEPOSIT, "Deposit successful");
+}
+
+// Perform a cash withdrawal
+AtmApiResult atm_api_withdraw(const TransactionData* transaction) {
+    return perform_api_transaction(transaction, TRANSACTION_WITHDRAWAL, "Withdrawal successful");
+}
+
+// Transfer money between accounts
+AtmApiResult atm_api_transfer(const TransactionData* transaction) {
+    return perform_api_transaction(transaction, TRANSACTION_MONEY_TRANSFER, "Transfer successful");
+}
+
 // Implement other API functions similarly...
 
 // Cleanup
@@ -1,6 +1,7 @@
 #ifndef ATM_API_H
 #define ATM_API_H
 
+#include <stddef.h>
 #include "../transaction/transaction_types.h"
 
 /**
@@ -25,6 +26,8 @@ typedef struct {
     int target_card_number;       // Target card for transfers
     char description[100];        // Transaction description
     char auth_token[64];          // Authentication token for the session
+    char request_id[40];          // Optional client request ID; a retry with the same ID
+                                  // gets the first attempt's result instead of running again
 } TransactionData;
 
 /**
@@ -63,6 +63,7 @@ const char* error_code_to_string(ErrorCode code) {
         case ERR_SYSTEM: return "System Error";
         case ERR_NETWORK: return "Network Error";
         case ERR_TIMEOUT: return "Timeout";
+        case ERR_LIMIT_EXCEEDED: return "Limit Exceeded";
         case ERR_UNKNOWN:
         default: return "Unknown Error";
     }
@@ -97,6 +98,7 @@ void error_handle(ErrorCode code, const char* message) {
         case ERR_INSUFFICIENT_FUNDS:
         case ERR_AUTHENTICATION:
         case ERR_MAINTENANCE_MODE:
+        case ERR_LIMIT_EXCEEDED:
             // User-facing errors, just log them
             break;
             
@@ -1,6 +1,7 @@
 #include "paths.h"
 #include "../utils/memory_utils.h"
 #include "../common/error_handler.h"
+#include "../utils/hash_utils.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -29,6 +30,10 @@ const char* getCustomerFilePath() {
     return testMode ? TEST_CUSTOMER_FILE : PROD_CUSTOMER_FILE;
 }
 
+const char* getCustomerProfilesFilePath() {
+    return testMode ? TEST_CUSTOMER_PROFILES_FILE : PROD_CUSTOMER_PROFILES_FILE;
+}
+
 const char* getAccountingFilePath() {
     return testMode ? TEST_ACCOUNTING_FILE : PROD_ACCOUNTING_FILE;
 }
@@ -74,6 +79,168 @@ const char* getWithdrawalsLogFilePath() {
     return testMode ? TEST_WITHDRAWALS_LOG_FILE : PROD_WITHDRAWALS_LOG_FILE;
 }
 
+const char* getTransactionsIndexFilePath() {
+    return testMode ? TEST_TRANSACTIONS_INDEX_FILE : PROD_TRANSACTIONS_INDEX_FILE;
+}
+
+// Get the file holding log lines that did not fit in the log queue based on testing mode
+const char* getLogSpillFilePath() {
+    return testMode ? TEST_LOG_SPILL_FILE : PROD_LOG_SPILL_FILE;
+}
+
+// Get the directory holding rotated log segments based on testing mode
+const char* getLogArchiveDirPath() {
+    return testMode ? TEST_LOG_ARCHIVE_DIR : PROD_LOG_ARCHIVE_DIR;
+}
+
+// Get the manifest listing the rotated log segments based on testing mode
+const char* getLogManifestFilePath() {
+    return testMode ? TEST_LOG_MANIFEST_FILE : PROD_LOG_MANIFEST_FILE;
+}
+
+// Get balance journal paths based on testing mode
+const char* getJournalFilePath() {
+    return testMode ? TEST_JOURNAL_FILE : PROD_JOURNAL_FILE;
+}
+
+const char* getJournalCheckpointFilePath() {
+    return testMode ? TEST_JOURNAL_CHECKPOINT_FILE : PROD_JOURNAL_CHECKPOINT_FILE;
+}
+
+// Get the completed API request results kept next to the journal based on testing mode
+const char* getRequestCacheFilePath() {
+    return testMode ? TEST_REQUEST_CACHE_FILE : PROD_REQUEST_CACHE_FILE;
+}
+
+// Get the binary storage engine's page file based on testing mode
+const char* getStoragePageFilePath() {
+    return testMode ? TEST_STORAGE_PAGE_FILE : PROD_STORAGE_PAGE_FILE;
+}
+
+// Get the binary storage engine's batch intent file based on testing mode
+const char* getStorageBatchFilePath() {
+    return testMode ? TEST_STORAGE_BATCH_FILE : PROD_STORAGE_BATCH_FILE;
+}
+
+// Get the startup snapshot file based on testing mode
+const char* getSnapshotFilePath() {
+    return testMode ? TEST_SNAPSHOT_FILE : PROD_SNAPSHOT_FILE;
+}
+
+// Get the account lock file shared by every ATM process based on testing mode
+const char* getAccountLockFilePath() {
+    return testMode ? TEST_ACCOUNT_LOCK_FILE : PROD_ACCOUNT_LOCK_FILE;
+}
+
+// Get the file holding the next free ID of each sequence based on testing mode
+const char* getIdSequenceFilePath() {
+    return testMode ? TEST_ID_SEQUENCE_FILE : PROD_ID_SEQUENCE_FILE;
+}
+
+// Shard layout per mode, read from the layout file on first use
+static int shardCounts[2] = { -1, -1 };
+
+// Per-shard paths are built once so each shard keeps a stable path pointer
+static char cardShardPaths[2][MAX_DATA_SHARDS][64];
+static char customerShardPaths[2][MAX_DATA_SHARDS][64];
+
+const char* getShardDirectory() {
+    return testMode ? TEST_SHARD_DIR : PROD_SHARD_DIR;
+}
+
+const char* getShardLayoutFilePath() {
+    return testMode ? TEST_SHARD_LAYOUT_FILE : PROD_SHARD_LAYOUT_FILE;
+}
+
+// Shard directories are numbered 00, 01, ...
+void formatShardFilePath(char* buffer, size_t size, int shard, const char* fileName) {
+    if (fileName == NULL) {
+        snprintf(buffer, size, "%s/%02d", getShardDirectory(), shard);
+    } else {
+        snprintf(buffer, size, "%s/%02d/%s", getShardDirectory(), shard, fileName);
+    }
+}
+
+int getShardCount() {
+    int mode = testMode ? 1 : 0;
+    if (shardCounts[mode] >= 0) {
+        return shardCounts[mode];
+    }
+
+    int count = 0;
+    FILE* file = fopen(getShardLayoutFilePath(), "r");
+    if (file != NULL) {
+        if (fscanf(file, "%d", &count) != 1 || count < 1 || count > MAX_DATA_SHARDS) {
+            count = 0;
+        }
+        fclose(file);
+    }
+
+    for (int i = 0; i < count; i++) {
+        formatShardFilePath(cardShardPaths[mode][i], sizeof(cardShardPaths[mode][i]), i, SHARD_CARD_FILE_NAME);
+        formatShardFilePath(customerShardPaths[mode][i], sizeof(customerShardPaths[mode][i]), i, SHARD_CUSTOMER_FILE_NAME);
+    }
+    shardCounts[mode] = count;
+    return count;
+}
+
+// Number of card (and customer) files: one per shard, or the single file
+int getShardFileCount() {
+    int count = getShardCount();
+    return count > 0 ? count : 1;
+}
+
+// Forget the cached layout so the next call re-reads the layout file
+void reloadShardLayout() {
+    shardCounts[0] = -1;
+    shardCounts[1] = -1;
+}
+
+int getCardShard(int cardNumber) {
+    return getCardShardIn(cardNumber, getShardCount());
+}
+
+int getAccountShard(const char* accountID) {
+    return getAccountShardIn(accountID, getShardCount());
+}
+
+int getCardShardIn(int cardNumber, int count) {
+    return count > 0 ? (int)((unsigned int)cardNumber % (unsigned int)count) : 0;
+}
+
+// FNV-1a over the account ID
+int getAccountShardIn(const char* accountID, int count) {
+    if (count <= 0 || accountID == NULL) {
+        return 0;
+    }
+
+    return (int)(fnv1a_hash(accountID) % (unsigned int)count);
+}
+
+const char* getCardShardFilePath(int shard) {
+    int count = getShardCount();
+    if (count == 0 || shard < 0 || shard >= count) {
+        return getCardFilePath();
+    }
+    return cardShardPaths[testMode ? 1 : 0][shard];
+}
+
+const char* getCustomerShardFilePath(int shard) {
+    int count = getShardCount();
+    if (count == 0 || shard < 0 || shard >= count) {
+        return getCustomerFilePath();
+    }
+    return customerShardPaths[testMode ? 1 : 0][shard];
+}
+
+const char* getCardFilePathFor(int cardNumber) {
+    return getCardShardFilePath(getCardShard(cardNumber));
+}
+
+const char* getCustomerFilePathFor(const char* accountID) {
+    return getCustomerShardFilePath(getAccountShard(accountID));
+}
+
 // Create a temporary file path
 char* createTempFilePath(const char* baseFilePath) {
     size_t len = strlen(baseFilePath);
@@ -183,6 +350,10 @@ int initializeDataFiles() {
     if (!ensureDirectoryExists(PROD_LOG_DIR)) return 0;
     if (!ensureDirectoryExists(TEST_DATA_DIR)) return 0;
     if (!ensureDirectoryExists("data/temp")) return 0;
+    if (!ensureDirectoryExists(PROD_JOURNAL_DIR)) return 0;
+    if (!ensureDirectoryExists(TEST_JOURNAL_DIR)) return 0;
+    if (!ensureDirectoryExists(PROD_LOG_ARCHIVE_DIR)) return 0;
+    if (!ensureDirectoryExists(TEST_LOG_ARCHIVE_DIR)) return 0;
     
     // Ensure essential files exist
     const char* essentialFiles[] = {
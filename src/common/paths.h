@@ -1,6 +1,8 @@
 #ifndef PATHS_H
 #define PATHS_H
 
+#include <stddef.h>
+
 // Test mode flag
 int isTestingMode();
 void setTestingMode(int isTest);
@@ -16,6 +18,7 @@ void setTestingMode(int isTest);
 // File paths for production mode
 #define PROD_CARD_FILE "data/card.txt"
 #define PROD_CUSTOMER_FILE "data/customer.txt"
+#define PROD_CUSTOMER_PROFILES_FILE "data/customer_profiles.txt"
 #define PROD_ACCOUNTING_FILE "data/accounting.txt"
 #define PROD_VIRTUAL_WALLET_FILE "data/virtual_wallet.txt"
 #define PROD_ADMIN_CREDENTIALS_FILE "data/admin_credentials.txt"
@@ -28,12 +31,33 @@ void setTestingMode(int isTest);
 // Log file paths for production mode
 #define PROD_AUDIT_LOG_FILE "logs/audit.log"
 #define PROD_ERROR_LOG_FILE "logs/error.log"
-#define PROD_TRANSACTIONS_LOG_FILE "logs/transactions.log"
+#define PROD_TRANSACTIONS_LOG_FILE "logs/transactions.dat"
 #define PROD_WITHDRAWALS_LOG_FILE "logs/withdrawals.log"
+#define PROD_TRANSACTIONS_INDEX_FILE "logs/transactions.idx"
+#define PROD_LOG_SPILL_FILE "logs/log_spill.dat"
+#define PROD_LOG_ARCHIVE_DIR "logs/archive"
+#define PROD_LOG_MANIFEST_FILE "logs/archive/manifest.txt"
+
+// Balance journal paths for production mode
+#define PROD_JOURNAL_DIR "data/journal"
+#define PROD_JOURNAL_FILE "data/journal/balance.journal"
+#define PROD_JOURNAL_CHECKPOINT_FILE "data/journal/checkpoint"
+#define PROD_REQUEST_CACHE_FILE "data/journal/requests.log"
+#define PROD_STORAGE_PAGE_FILE "data/storage.db"
+#define PROD_STORAGE_BATCH_FILE "data/storage.batch"
+#define PROD_SNAPSHOT_FILE "data/atm.snapshot"
+#define PROD_ACCOUNT_LOCK_FILE "data/temp/account.lock"
+#define PROD_ID_SEQUENCE_FILE "data/id_sequences.txt"
+
+// Optional sharded layout: <shard dir>/NN/card.txt and <shard dir>/NN/customer.txt.
+// The layout file records the shard count; without it the single files above are used.
+#define PROD_SHARD_DIR "data/shards"
+#define PROD_SHARD_LAYOUT_FILE "data/shards/layout"
 
 // File paths for test mode
 #define TEST_CARD_FILE "testing/test_card.txt"
 #define TEST_CUSTOMER_FILE "testing/test_customer.txt"
+#define TEST_CUSTOMER_PROFILES_FILE "testing/test_customer_profiles.txt"
 #define TEST_ACCOUNTING_FILE "testing/test_account.txt"
 #define TEST_VIRTUAL_WALLET_FILE "testing/test_virtual_wallet.txt"
 #define TEST_ADMIN_CREDENTIALS_FILE "testing/test_admin_credentials.txt"
@@ -45,8 +69,34 @@ void setTestingMode(int isTest);
 // Log file paths for test mode
 #define TEST_AUDIT_LOG_FILE "testing/test_audit_log.txt"
 #define TEST_ERROR_LOG_FILE "testing/test_error_log.txt"
-#define TEST_TRANSACTIONS_LOG_FILE "testing/test_transaction.txt"
+#define TEST_TRANSACTIONS_LOG_FILE "testing/test_transactions.dat"
 #define TEST_WITHDRAWALS_LOG_FILE "testing/test_withdrawals.log"
+#define TEST_TRANSACTIONS_INDEX_FILE "testing/test_transaction.idx"
+#define TEST_LOG_SPILL_FILE "testing/test_log_spill.dat"
+#define TEST_LOG_ARCHIVE_DIR "testing/archive"
+#define TEST_LOG_MANIFEST_FILE "testing/archive/test_manifest.txt"
+
+// Balance journal paths for test mode
+#define TEST_JOURNAL_DIR "testing/journal"
+#define TEST_JOURNAL_FILE "testing/journal/test_balance.journal"
+#define TEST_JOURNAL_CHECKPOINT_FILE "testing/journal/test_checkpoint"
+#define TEST_REQUEST_CACHE_FILE "testing/journal/test_requests.log"
+#define TEST_STORAGE_PAGE_FILE "testing/test_storage.db"
+#define TEST_STORAGE_BATCH_FILE "testing/test_storage.batch"
+#define TEST_SNAPSHOT_FILE "testing/test_atm.snapshot"
+#define TEST_ACCOUNT_LOCK_FILE "testing/test_account.lock"
+#define TEST_ID_SEQUENCE_FILE "testing/test_id_sequences.txt"
+
+// Sharded layout paths for test mode
+#define TEST_SHARD_DIR "testing/shards"
+#define TEST_SHARD_LAYOUT_FILE "testing/shards/layout"
+
+// Most shards a layout may have
+#define MAX_DATA_SHARDS 64
+
+// File names inside each shard directory
+#define SHARD_CARD_FILE_NAME "card.txt"
+#define SHARD_CUSTOMER_FILE_NAME "customer.txt"
 
 // Configuration keys
 #define CONFIG_MAX_WRONG_PIN_ATTEMPTS "max_wrong_pin_attempts"
@@ -56,6 +106,7 @@ void setTestingMode(int isTest);
 // Get file paths with mode detection
 const char* getCardFilePath();
 const char* getCustomerFilePath();
+const char* getCustomerProfilesFilePath();
 const char* getAccountingFilePath();
 const char* getVirtualWalletFilePath();
 const char* getAdminCredentialsFilePath();
@@ -69,6 +120,38 @@ const char* getAuditLogFilePath();
 const char* getErrorLogFilePath();
 const char* getTransactionsLogFilePath();
 const char* getWithdrawalsLogFilePath();
+const char* getTransactionsIndexFilePath();
+const char* getLogSpillFilePath();
+const char* getLogArchiveDirPath();
+const char* getLogManifestFilePath();
+
+// Get balance journal paths with mode detection
+const char* getJournalFilePath();
+const char* getJournalCheckpointFilePath();
+const char* getRequestCacheFilePath();
+const char* getStoragePageFilePath();
+const char* getStorageBatchFilePath();
+const char* getSnapshotFilePath();
+const char* getAccountLockFilePath();
+const char* getIdSequenceFilePath();
+
+// Sharded layout: shard count (0 for the single-file layout), shard
+// selection, and per-shard paths. The *For functions return the file
+// holding a given card or account in either layout.
+int getShardCount();
+int getShardFileCount();
+void reloadShardLayout();
+const char* getShardDirectory();
+const char* getShardLayoutFilePath();
+int getCardShard(int cardNumber);
+int getAccountShard(const char* accountID);
+int getCardShardIn(int cardNumber, int shardCount);
+int getAccountShardIn(const char* accountID, int shardCount);
+void formatShardFilePath(char* buffer, size_t size, int shard, const char* fileName);
+const char* getCardShardFilePath(int shard);
+const char* getCustomerShardFilePath(int shard);
+const char* getCardFilePathFor(int cardNumber);
+const char* getCustomerFilePathFor(const char* accountID);
 
 // Create a temporary file path
 char* createTempFilePath(const char* baseFilePath);
@@ -0,0 +1,79 @@
+#include "account_view.h"
+#include "database.h"
+#include "storage_engine.h"
+#include "../common/paths.h"
+#include "../utils/logger.h"
+#include "../utils/table_reader.h"
+#include <stdio.h>
+#include <string.h>
+
+// Copy a NUL-terminated string into a fixed-size field
+static void copyField(char* dest, size_t destSize, const char* src) {
+    strncpy(dest, src, destSize - 1);
+    dest[destSize - 1] = '\0';
+}
+
+// Fill account type and branch from accounting.txt
+static bool loadAccountingDetails(AccountView* view) {
+    TableReader reader;
+    if (!tableReaderOpen(&reader, getAccountingFilePath(), '|')) {
+        writeErrorLog("Failed to open accounting.txt file");
+        return false;
+    }
+
+    // Skip header lines
+    tableReaderSkipLines(&reader, 2);
+
+    // Format: Account ID | Customer ID | Account Type | Balance | Branch Code | Account Status | ...
+    TableRow row;
+    bool found = false;
+    while (tableReaderNext(&reader, &row)) {
+        if (row.fieldCount >= 6 && tableFieldEquals(&row.fields[0], view->accountID)) {
+            tableFieldCopy(&row.fields[2], view->accountType, sizeof(view->accountType));
+            tableFieldCopy(&row.fields[4], view->branchCode, sizeof(view->branchCode));
+            found = true;
+            break;
+        }
+    }
+
+    tableReaderClose(&reader);
+    return found;
+}
+
+bool loadAccountView(int cardNumber, AccountView* view) {
+    if (view == NULL || cardNumber <= 0) {
+        return false;
+    }
+    memset(view, 0, sizeof(*view));
+
+    const StorageEngine* engine = storageEngine();
+    StorageCard card;
+    if (!engine->get_card(cardNumber, &card)) {
+        return false;
+    }
+
+    StorageAccount account;
+    if (!engine->get_account(card.accountID, &account)) {
+        char errorMsg[100];
+        sprintf(errorMsg, "Account ID %s not found in customer database", card.accountID);
+        writeErrorLog(errorMsg);
+        return false;
+    }
+
+    view->cardNumber = cardNumber;
+    copyField(view->cardID, sizeof(view->cardID), card.cardID);
+    copyField(view->cardStatus, sizeof(view->cardStatus), card.status);
+    copyField(view->accountID, sizeof(view->accountID), card.accountID);
+    copyField(view->customerID, sizeof(view->customerID), account.customerID);
+    copyField(view->holderName, sizeof(view->holderName), account.holderName);
+    copyField(view->accountType, sizeof(view->accountType), account.type);
+    copyField(view->accountStatus, sizeof(view->accountStatus), account.status);
+    view->balance = account.balance;
+
+    // Phone numbers are not stored yet; use whatever the database layer reports
+    getCardHolderPhone(cardNumber, view->phone, sizeof(view->phone));
+
+    // Branch lives only in accounting.txt; a missing row is not fatal for the view
+    loadAccountingDetails(view);
+    return true;
+}
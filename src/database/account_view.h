@@ -0,0 +1,35 @@
+#ifndef ACCOUNT_VIEW_H
+#define ACCOUNT_VIEW_H
+
+#include <stdbool.h>
+
+// Everything the customer-facing screens need about a card, resolved once
+typedef struct {
+    int cardNumber;
+    char cardID[12];
+    char cardStatus[12];
+    char accountID[20];
+    char customerID[20];
+    char holderName[100];
+    char phone[16];
+    char accountType[20];
+    char accountStatus[20];
+    char branchCode[12];
+    float balance;
+} AccountView;
+
+/**
+ * Resolve a card to its account and customer in one call
+ *
+ * The card and account come from the storage engine's indexed lookups;
+ * account type and branch come from a scan of accounting.txt. Fields the
+ * data files do not carry (branch for accounts missing from accounting.txt)
+ * are left empty.
+ *
+ * @param cardNumber The card to resolve
+ * @param view Receives the populated view
+ * @return true if the card and its customer record were found
+ */
+bool loadAccountView(int cardNumber, AccountView* view);
+
+#endif // ACCOUNT_VIEW_H
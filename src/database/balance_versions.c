@@ -0,0 +1,329 @@
+#include "balance_versions.h"
+#include "../utils/logger.h"
+#include "../utils/hash_utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#define VERSION_TABLE_INITIAL_CAPACITY 1024
+
+typedef struct BalanceVersion {
+    float balance;
+    unsigned long seq;                  // Commit that wrote it; 0 for a balance read from storage
+    unsigned long generation;           // Customer file generation the balance belongs to
+    struct BalanceVersion* older;       // Trimmed by writers once no snapshot needs it
+} BalanceVersion;
+
+typedef struct {
+    char accountID[20];                 // Written before `newest` is first set
+    _Atomic(BalanceVersion*) newest;    // NULL while the slot is free
+} VersionSlot;
+
+// Open-addressed table; slots are never freed, so a grown table replaces it
+typedef struct VersionTable {
+    VersionSlot* slots;
+    size_t capacity;                    // Power of two
+    size_t count;
+    struct VersionTable* retired;       // Smaller tables readers may still be using
+} VersionTable;
+
+// A reader's announced snapshot, seq + 1; 0 while the slot is free
+typedef struct {
+    atomic_ulong seq;
+    char pad[64 - sizeof(atomic_ulong)];
+} ReaderSlot;
+
+// Stands in for the versions of an account whose commit could not be recorded
+static BalanceVersion droppedVersion;
+
+static _Atomic(VersionTable*) currentTable = NULL;
+static atomic_ulong committedSeq = 0;
+static ReaderSlot readers[BALANCE_READER_SLOTS];
+static atomic_uint readerCursor = 0;
+
+// Serialises changes to the table and to version chains
+static pthread_mutex_t versionLock = PTHREAD_MUTEX_INITIALIZER;
+
+// The account's slot, or the free slot where it belongs
+static VersionSlot* findSlot(VersionTable* table, const char* accountID) {
+    size_t mask = table->capacity - 1;
+    for (size_t i = (size_t)fnv1a_hash(accountID) & mask;; i = (i + 1) & mask) {
+        VersionSlot* slot = &table->slots[i];
+        if (atomic_load_explicit(&slot->newest, memory_order_acquire) == NULL ||
+            strcmp(slot->accountID, accountID) == 0) {
+            return slot;
+        }
+    }
+}
+
+static VersionTable* createTable(size_t capacity) {
+    VersionTable* table = (VersionTable*)calloc(1, sizeof(VersionTable));
+    if (table == NULL) {
+        return NULL;
+    }
+    table->slots = (VersionSlot*)calloc(capacity, sizeof(VersionSlot));
+    if (table->slots == NULL) {
+        free(table);
+        return NULL;
+    }
+    table->capacity = capacity;
+    return table;
+}
+
+// Make room for one more account; needs versionLock
+static VersionTable* reserveSlotLocked(void) {
+    VersionTable* table = atomic_load_explicit(&currentTable, memory_order_relaxed);
+    if (table != NULL && (table->count + 1) * 2 <= table->capacity) {
+        return table;
+    }
+
+    VersionTable* grown = createTable(table != NULL ? table->capacity * 2 : VERSION_TABLE_INITIAL_CAPACITY);
+    if (grown == NULL) {
+        // A table at most three quarters full still works, only slower
+        return table != NULL && (table->count + 1) * 4 <= table->capacity * 3 ? table : NULL;
+    }
+
+    if (table != NULL) {
+        for (size_t i = 0; i < table->capacity; i++) {
+            BalanceVersion* newest = atomic_load_explicit(&table->slots[i].newest, memory_order_relaxed);
+            if (newest != NULL) {
+                VersionSlot* slot = findSlot(grown, table->slots[i].accountID);
+                memcpy(slot->accountID, table->slots[i].accountID, sizeof(slot->accountID));
+                atomic_store_explicit(&slot->newest, newest, memory_order_relaxed);
+            }
+        }
+        grown->count = table->count;
+        grown->retired = table;
+    }
+    atomic_store_explicit(&currentTable, grown, memory_order_release);
+    return grown;
+}
+
+static BalanceVersion* newVersion(float balance, unsigned long seq, unsigned long generation,
+                                  BalanceVersion* older) {
+    BalanceVersion* version = (BalanceVersion*)malloc(sizeof(BalanceVersion));
+    if (version != NULL) {
+        version->balance = balance;
+        version->seq = seq;
+        version->generation = generation;
+        version->older = older;
+    }
+    return version;
+}
+
+static void freeChain(BalanceVersion* version) {
+    while (version != NULL && version != &droppedVersion) {
+        BalanceVersion* older = version->older;
+        free(version);
+        version = older;
+    }
+}
+
+// Oldest commit any open snapshot, or one about to open, can still ask for
+static unsigned long oldestVisibleSeq(unsigned long latest) {
+    unsigned long oldest = latest;
+    for (int i = 0; i < BALANCE_READER_SLOTS; i++) {
+        unsigned long announced = atomic_load(&readers[i].seq);
+        if (announced != 0 && announced - 1 < oldest) {
+            oldest = announced - 1;
+        }
+    }
+    return oldest;
+}
+
+// Free the versions behind the newest one at or before `oldest`; needs versionLock
+static void trimSlot(VersionSlot* slot, unsigned long oldest) {
+    BalanceVersion* version = atomic_load_explicit(&slot->newest, memory_order_relaxed);
+    while (version != NULL && version != &droppedVersion && version->seq > oldest) {
+        version = version->older;
+    }
+    if (version != NULL && version != &droppedVersion) {
+        freeChain(version->older);
+        version->older = NULL;
+    }
+}
+
+bool balanceSnapshotBegin(BalanceSnapshot* snapshot) {
+    unsigned long seq = atomic_load(&committedSeq);
+    unsigned int start = atomic_fetch_add_explicit(&readerCursor, 1, memory_order_relaxed);
+
+    int slot = -1;
+    for (int i = 0; i < BALANCE_READER_SLOTS && slot < 0; i++) {
+        int candidate = (int)((start + (unsigned int)i) % BALANCE_READER_SLOTS);
+        unsigned long expected = 0;
+        if (atomic_compare_exchange_strong(&readers[candidate].seq, &expected, seq + 1)) {
+            slot = candidate;
+        }
+    }
+    if (slot < 0) {
+        return false;
+    }
+
+    // A commit that finished before the announcement was visible may have
+    // freed versions of `seq`; move to the newer commit until none slips in
+    for (;;) {
+        unsigned long latest = atomic_load(&committedSeq);
+        if (latest == seq) {
+            break;
+        }
+        seq = latest;
+        atomic_store(&readers[slot].seq, seq + 1);
+    }
+
+    snapshot->seq = seq;
+    snapshot->slot = slot;
+    return true;
+}
+
+bool balanceSnapshotRead(const BalanceSnapshot* snapshot, const char* accountID, unsigned long generation,
+                         float* balance) {
+    VersionTable* table = atomic_load_explicit(&currentTable, memory_order_acquire);
+    if (table == NULL || accountID == NULL) {
+        return false;
+    }
+
+    BalanceVersion* version = atomic_load_explicit(&findSlot(table, accountID)->newest, memory_order_acquire);
+    while (version != NULL && version != &droppedVersion && version->seq > snapshot->seq) {
+        version = version->older;
+    }
+    if (version == NULL || version == &droppedVersion || version->generation != generation) {
+        return false;
+    }
+    *balance = version->balance;
+    return true;
+}
+
+void balanceSnapshotEnd(BalanceSnapshot* snapshot) {
+    if (snapshot->slot >= 0) {
+        atomic_store(&readers[snapshot->slot].seq, 0);
+        snapshot->slot = -1;
+    }
+}
+
+bool balanceVersionRead(const char* accountID, unsigned long generation, float* balance) {
+    BalanceSnapshot snapshot;
+    if (!balanceSnapshotBegin(&snapshot)) {
+        return false;
+    }
+    bool found = balanceSnapshotRead(&snapshot, accountID, generation, balance);
+    balanceSnapshotEnd(&snapshot);
+    return found;
+}
+
+void balanceVersionSeed(const char* accountID, float balance, unsigned long generation) {
+    if (accountID == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&versionLock);
+    VersionTable* table = reserveSlotLocked();
+    VersionSlot* slot = table != NULL ? findSlot(table, accountID) : NULL;
+    BalanceVersion* newest = slot != NULL ? atomic_load_explicit(&slot->newest, memory_order_relaxed) : NULL;
+
+    if (slot != NULL && (newest == NULL || newest == &droppedVersion || newest->generation != generation)) {
+        // Unversioned until now, so every snapshot may see it; after a dropped
+        // commit or a change to the file only snapshots from here on can. Open
+        // snapshots may still be walking a stale chain, so it is kept until
+        // the next commit of the account trims it.
+        unsigned long seq = newest == NULL ? 0 : atomic_load(&committedSeq);
+        BalanceVersion* older = newest == &droppedVersion ? NULL : newest;
+        BalanceVersion* version = newVersion(balance, seq, generation, older);
+        if (version != NULL) {
+            if (newest == NULL) {
+                snprintf(slot->accountID, sizeof(slot->accountID), "%s", accountID);
+                table->count++;
+            }
+            atomic_store_explicit(&slot->newest, version, memory_order_release);
+        }
+    }
+    pthread_mutex_unlock(&versionLock);
+}
+
+bool balanceVersionPublish(const StorageDelta* deltas, const float* oldBalances,
+                           const unsigned long* generations, int count) {
+    if (deltas == NULL || oldBalances == NULL || generations == NULL || count <= 0) {
+        return false;
+    }
+
+    pthread_mutex_lock(&versionLock);
+    unsigned long seq = atomic_load(&committedSeq) + 1;
+    bool ok = true;
+
+    for (int i = 0; i < count; i++) {
+        VersionTable* table = reserveSlotLocked();
+        if (table == NULL) {
+            ok = false;
+            continue;
+        }
+
+        VersionSlot* slot = findSlot(table, deltas[i].accountID);
+        BalanceVersion* newest = atomic_load_explicit(&slot->newest, memory_order_relaxed);
+        bool fresh = newest == NULL;
+        bool stale = !fresh && newest != &droppedVersion && newest->generation != generations[i];
+
+        // First change of the account: snapshots older than this commit see the old balance.
+        // The same goes for an account whose file changed since its versions were written.
+        BalanceVersion* base = newest;
+        if (fresh || stale) {
+            base = newVersion(oldBalances[i], fresh ? 0 : seq - 1, generations[i], newest);
+        }
+        BalanceVersion* version = base != NULL ? newVersion(deltas[i].newBalance, seq, generations[i], base) : NULL;
+        if (version == NULL) {
+            if (fresh || (stale && base != NULL)) {
+                free(base);
+            } else {
+                // The old chain stays reachable by open snapshots and is not freed
+                atomic_store_explicit(&slot->newest, &droppedVersion, memory_order_release);
+            }
+            ok = false;
+            continue;
+        }
+
+        if (fresh) {
+            snprintf(slot->accountID, sizeof(slot->accountID), "%s", deltas[i].accountID);
+            table->count++;
+        }
+        atomic_store_explicit(&slot->newest, version, memory_order_release);
+    }
+
+    // Snapshots from here on see the whole commit
+    atomic_store(&committedSeq, seq);
+
+    VersionTable* table = atomic_load_explicit(&currentTable, memory_order_relaxed);
+    if (table != NULL) {
+        unsigned long oldest = oldestVisibleSeq(seq);
+        for (int i = 0; i < count; i++) {
+            VersionSlot* slot = findSlot(table, deltas[i].accountID);
+            trimSlot(slot, oldest);
+        }
+    }
+    pthread_mutex_unlock(&versionLock);
+
+    if (!ok) {
+        writeErrorLog("Out of memory recording balance versions; affected balances are read from storage");
+    }
+    return ok;
+}
+
+void balanceVersionsReset(void) {
+    pthread_mutex_lock(&versionLock);
+    VersionTable* table = atomic_load_explicit(&currentTable, memory_order_relaxed);
+    atomic_store(&currentTable, NULL);
+
+    if (table != NULL) {
+        // Retired tables share the current table's versions
+        for (size_t i = 0; i < table->capacity; i++) {
+            freeChain(atomic_load_explicit(&table->slots[i].newest, memory_order_relaxed));
+        }
+    }
+    while (table != NULL) {
+        VersionTable* retired = table->retired;
+        free(table->slots);
+        free(table);
+        table = retired;
+    }
+    pthread_mutex_unlock(&versionLock);
+}
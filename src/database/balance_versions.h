@@ -0,0 +1,100 @@
+#ifndef BALANCE_VERSIONS_H
+#define BALANCE_VERSIONS_H
+
+#include <stdbool.h>
+#include "storage_engine.h"
+
+/**
+ * Multi-version account balances for lock-free reads
+ *
+ * Every balance commit of the text engine publishes a new version of each
+ * account it changed, stamped with one commit sequence number for the
+ * whole commit. A reader takes a snapshot (the last committed sequence)
+ * and sees, for every account, the newest version at or before it, so
+ * the two sides of a transfer are seen together or not at all. Readers
+ * take no lock and never wait for a commit; writers free old versions
+ * once no snapshot can see them.
+ *
+ * Only commits made through this process are versioned, like the
+ * journal's balance overlay. Every version carries the generation of the
+ * customer file it was read or written against (customerIndexGeneration),
+ * and a reader passing a newer generation gets no version, so a balance
+ * changed in the file by another writer is read from storage again.
+ */
+
+// Concurrent snapshots; a reader finding none free falls back to a locked read
+#define BALANCE_READER_SLOTS 64
+
+// A consistent view of all versioned balances
+typedef struct {
+    unsigned long seq;      // Last commit visible to the snapshot
+    int slot;               // Reader slot that keeps its versions alive
+} BalanceSnapshot;
+
+/**
+ * Take a snapshot of the last committed balances
+ *
+ * @param snapshot Receives the snapshot; release it with balanceSnapshotEnd
+ * @return false if every reader slot is taken
+ */
+bool balanceSnapshotBegin(BalanceSnapshot* snapshot);
+
+/**
+ * Read an account's balance as of a snapshot
+ *
+ * @param snapshot A snapshot from balanceSnapshotBegin
+ * @param accountID The account
+ * @param generation Current generation of the account's customer file
+ * @param balance Receives the balance
+ * @return false if the account has no version of that generation; the
+ *         caller reads it from storage instead
+ */
+bool balanceSnapshotRead(const BalanceSnapshot* snapshot, const char* accountID, unsigned long generation,
+                         float* balance);
+
+/**
+ * Release a snapshot
+ */
+void balanceSnapshotEnd(BalanceSnapshot* snapshot);
+
+/**
+ * Read an account's last committed balance with a snapshot of its own
+ *
+ * @return false if the account has no version of `generation` or no reader
+ *         slot was free
+ */
+bool balanceVersionRead(const char* accountID, unsigned long generation, float* balance);
+
+/**
+ * Record the balance of an account that has no version yet
+ *
+ * The caller must hold the lock that serialises commits, so no commit
+ * can change the balance between reading it from storage and seeding it.
+ * Does nothing if the account already has a version of `generation`.
+ */
+void balanceVersionSeed(const char* accountID, float balance, unsigned long generation);
+
+/**
+ * Publish the new balances of one commit
+ *
+ * Call with the balances already durable, under the lock that serialises
+ * commits. Snapshots taken afterwards see all of them; older snapshots
+ * keep seeing `oldBalances`.
+ *
+ * @param deltas The committed changes, with newBalance filled in
+ * @param oldBalances Balances of the same accounts before the commit
+ * @param generations Customer file generation of each account after the commit
+ * @param count Number of changes
+ * @return false if memory ran out; the accounts are then read from storage
+ *         until they are seeded again
+ */
+bool balanceVersionPublish(const StorageDelta* deltas, const float* oldBalances,
+                           const unsigned long* generations, int count);
+
+/**
+ * Drop every version
+ * Only when no snapshot is open, e.g. when the storage engine closes.
+ */
+void balanceVersionsReset(void);
+
+#endif // BALANCE_VERSIONS_H
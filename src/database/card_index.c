@@ -0,0 +1,268 @@
+#include "card_index.h"
+#include "../common/paths.h"
+#include "../utils/logger.h"
+#include "../utils/file_utils.h"
+#include "../utils/hash_utils.h"
+#include "../utils/table_reader.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+
+// One shard's index: entries in file order plus an open-addressing table of entry positions
+typedef struct {
+    CardIndexEntry* entries;
+    size_t entryCount;
+    size_t entryCapacity;
+    SlotTable table;
+    bool loaded;
+    bool borrowed;                // entries and slots point into a snapshot mapping
+    FileSignature signature;
+} ShardIndex;
+
+// One index per card file; the single-file layout uses the first
+static ShardIndex shards[MAX_DATA_SHARDS];
+
+// The snapshot writer exports the index from its own thread
+static pthread_mutex_t indexLock = PTHREAD_MUTEX_INITIALIZER;
+
+// Fibonacci hashing spreads sequential card numbers across the table
+static size_t hashCardNumber(int cardNumber) {
+    return (size_t)(((uint32_t)cardNumber * 2654435769u) >> 7);
+}
+
+// Slot table callbacks; entries are keyed by card number
+static bool entryHasKey(const void* entries, int position, const void* key) {
+    return ((const CardIndexEntry*)entries)[position].cardNumber == *(const int*)key;
+}
+
+static size_t entryHash(const void* entries, int position) {
+    return hashCardNumber(((const CardIndexEntry*)entries)[position].cardNumber);
+}
+
+// Find the slot holding a card number, or the empty slot where it would go
+static size_t findSlot(const ShardIndex* index, int cardNumber) {
+    return slot_table_find(&index->table, hashCardNumber(cardNumber), index->entries, &cardNumber, entryHasKey);
+}
+
+// Stop using arrays adopted from a snapshot; the next load allocates its own
+static void dropBorrowed(ShardIndex* index) {
+    if (index->borrowed) {
+        index->entries = NULL;
+        index->table.slots = NULL;
+        index->entryCapacity = 0;
+        index->table.slotCount = 0;
+        index->borrowed = false;
+    }
+}
+
+static void resetIndex(ShardIndex* index) {
+    dropBorrowed(index);
+    index->entryCount = 0;
+    index->loaded = false;
+    slot_table_clear(&index->table);
+}
+
+static bool appendEntry(ShardIndex* index, const CardIndexEntry* entry) {
+    if (index->entryCount == index->entryCapacity) {
+        size_t newCapacity = index->entryCapacity == 0 ? 256 : index->entryCapacity * 2;
+        CardIndexEntry* grown = (CardIndexEntry*)realloc(index->entries, newCapacity * sizeof(CardIndexEntry));
+        if (grown == NULL) {
+            return false;
+        }
+        index->entries = grown;
+        index->entryCapacity = newCapacity;
+    }
+
+    if (!slot_table_reserve(&index->table, index->entryCount + 1, index->entries, index->entryCount, entryHash)) {
+        return false;
+    }
+
+    // Keep the first row for a card number, matching the old first-match scans
+    size_t slot = findSlot(index, entry->cardNumber);
+    if (index->table.slots[slot] != SLOT_EMPTY) {
+        return true;
+    }
+
+    index->entries[index->entryCount] = *entry;
+    index->table.slots[slot] = (int)index->entryCount;
+    index->entryCount++;
+    return true;
+}
+
+// Build a shard's index from its card file in a single pass
+static bool loadIndex(ShardIndex* index, int shard) {
+    TableReader reader;
+
+    resetIndex(index);
+
+    // The reader takes the signature from the open file so a concurrent rename is noticed next time
+    if (!tableReaderOpen(&reader, getCardShardFilePath(shard), '|')) {
+        writeErrorLog("Failed to open card.txt file");
+        return false;
+    }
+
+    // Skip header lines
+    tableReaderSkipLines(&reader, 2);
+
+    // Format: Card ID | Account ID | Card Number | Card Type | Expiry Date | Status | PIN Hash
+    TableRow row;
+    while (tableReaderNext(&reader, &row)) {
+        long cardNumber;
+        if (row.fieldCount < 7 || row.fields[6].len == 0 || !tableFieldToLong(&row.fields[2], &cardNumber)) {
+            continue;
+        }
+
+        CardIndexEntry entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.cardNumber = (int)cardNumber;
+        tableFieldCopy(&row.fields[0], entry.cardID, sizeof(entry.cardID));
+        tableFieldCopy(&row.fields[1], entry.accountID, sizeof(entry.accountID));
+        tableFieldCopy(&row.fields[5], entry.status, sizeof(entry.status));
+        tableFieldCopy(&row.fields[4], entry.expiryDate, sizeof(entry.expiryDate));
+        tableFieldCopy(&row.fields[6], entry.pinHash, sizeof(entry.pinHash));
+        entry.offset = row.offset;
+
+        if (!appendEntry(index, &entry)) {
+            writeErrorLog("Out of memory while building card index");
+            tableReaderClose(&reader);
+            resetIndex(index);
+            return false;
+        }
+    }
+
+    index->signature = reader.signature;
+    tableReaderClose(&reader);
+    index->loaded = true;
+
+    char logMsg[100];
+    if (getShardCount() > 0) {
+        sprintf(logMsg, "Card index for shard %02d loaded with %zu cards", shard, index->entryCount);
+    } else {
+        sprintf(logMsg, "Card index loaded with %zu cards", index->entryCount);
+    }
+    writeInfoLog(logMsg);
+    return true;
+}
+
+// Make sure a shard's index reflects its current card file
+static bool ensureFresh(int shard) {
+    ShardIndex* index = &shards[shard];
+    FileSignature current;
+
+    if (index->loaded && readFileSignature(getCardShardFilePath(shard), &current) &&
+        fileSignatureMatches(&current, &index->signature)) {
+        return true;
+    }
+    return loadIndex(index, shard);
+}
+
+static bool validShard(int shard) {
+    return shard >= 0 && shard < getShardFileCount();
+}
+
+bool cardIndexLookup(int cardNumber, CardIndexEntry* entry) {
+    int shard = getCardShard(cardNumber);
+    ShardIndex* index = &shards[shard];
+
+    pthread_mutex_lock(&indexLock);
+    if (!ensureFresh(shard) || index->entryCount == 0) {
+        pthread_mutex_unlock(&indexLock);
+        return false;
+    }
+
+    size_t slot = findSlot(index, cardNumber);
+    bool found = index->table.slots[slot] != SLOT_EMPTY;
+    if (found && entry != NULL) {
+        *entry = index->entries[index->table.slots[slot]];
+    }
+    pthread_mutex_unlock(&indexLock);
+    return found;
+}
+
+void cardIndexInvalidate(void) {
+    pthread_mutex_lock(&indexLock);
+    for (int i = 0; i < MAX_DATA_SHARDS; i++) {
+        shards[i].loaded = false;
+    }
+    pthread_mutex_unlock(&indexLock);
+}
+
+void cardIndexInvalidateCard(int cardNumber) {
+    pthread_mutex_lock(&indexLock);
+    shards[getCardShard(cardNumber)].loaded = false;
+    pthread_mutex_unlock(&indexLock);
+}
+
+size_t cardIndexCount(void) {
+    size_t count = 0;
+
+    pthread_mutex_lock(&indexLock);
+    for (int i = 0; i < getShardFileCount(); i++) {
+        if (ensureFresh(i)) {
+            count += shards[i].entryCount;
+        }
+    }
+    pthread_mutex_unlock(&indexLock);
+    return count;
+}
+
+bool cardIndexExport(int shard, CardIndexExportFn fn, void* context) {
+    if (!validShard(shard)) {
+        return false;
+    }
+
+    pthread_mutex_lock(&indexLock);
+    ShardIndex* index = &shards[shard];
+    bool ok = ensureFresh(shard) &&
+              fn(index->entries, index->entryCount, index->table.slots, index->table.slotCount, &index->signature, context);
+    pthread_mutex_unlock(&indexLock);
+    return ok;
+}
+
+bool cardIndexAdopt(int shard, CardIndexEntry* snapshotEntries, size_t count,
+                    int* snapshotSlots, size_t snapshotSlotCount,
+                    const FileSignature* fileSignature) {
+    // The table must be a power of two with room left for probes to terminate
+    if (!validShard(shard) || snapshotSlotCount == 0 || (snapshotSlotCount & (snapshotSlotCount - 1)) != 0 ||
+        count >= snapshotSlotCount || count > (size_t)INT32_MAX) {
+        return false;
+    }
+    for (size_t i = 0; i < snapshotSlotCount; i++) {
+        if (snapshotSlots[i] != SLOT_EMPTY && (snapshotSlots[i] < 0 || (size_t)snapshotSlots[i] >= count)) {
+            return false;
+        }
+    }
+
+    pthread_mutex_lock(&indexLock);
+    ShardIndex* index = &shards[shard];
+    if (!index->borrowed) {
+        free(index->entries);
+        free(index->table.slots);
+    }
+    index->entries = snapshotEntries;
+    index->entryCount = count;
+    index->entryCapacity = count;
+    index->table.slots = snapshotSlots;
+    index->table.slotCount = snapshotSlotCount;
+    index->signature = *fileSignature;
+    index->borrowed = true;
+    index->loaded = true;
+    pthread_mutex_unlock(&indexLock);
+    return true;
+}
+
+void cardIndexFree(void) {
+    pthread_mutex_lock(&indexLock);
+    for (int i = 0; i < MAX_DATA_SHARDS; i++) {
+        ShardIndex* index = &shards[i];
+        if (!index->borrowed) {
+            free(index->entries);
+            free(index->table.slots);
+        }
+        memset(index, 0, sizeof(*index));
+    }
+    pthread_mutex_unlock(&indexLock);
+}
@@ -0,0 +1,84 @@
+#ifndef CARD_INDEX_H
+#define CARD_INDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "../utils/file_utils.h"
+
+// Compact in-memory copy of one card.txt row
+typedef struct {
+    int cardNumber;
+    char cardID[12];
+    char accountID[20];
+    char status[12];
+    char expiryDate[16];
+    char pinHash[65];
+    long offset;              // Byte offset of the row in card.txt
+} CardIndexEntry;
+
+/**
+ * Look up a card by card number
+ *
+ * The index is built from card.txt on first use and rebuilt whenever the
+ * file's inode, size or modification time changes. With the sharded
+ * layout each shard's file is indexed separately, and only the shard
+ * holding the card is loaded.
+ *
+ * @param cardNumber The card number to look up
+ * @param entry Receives a copy of the indexed row (may be NULL for existence checks)
+ * @return true if the card exists, false otherwise
+ */
+bool cardIndexLookup(int cardNumber, CardIndexEntry* entry);
+
+/**
+ * Drop the current index so the next lookup reloads card.txt
+ * Call after rewriting or appending to card.txt.
+ */
+void cardIndexInvalidate(void);
+
+/**
+ * Drop only the index of the shard holding `cardNumber`
+ * Call after rewriting or appending to that card's file.
+ */
+void cardIndexInvalidateCard(int cardNumber);
+
+/**
+ * Number of cards currently indexed (loads every shard if needed)
+ */
+size_t cardIndexCount(void);
+
+// Receives one shard's index arrays and the signature of the file they were built from
+typedef bool (*CardIndexExportFn)(const CardIndexEntry* entries, size_t count,
+                                  const int* slots, size_t slotCount,
+                                  const FileSignature* signature, void* context);
+
+/**
+ * Hand a shard's index to `fn` while it is locked, loading it first if needed
+ *
+ * @param shard Shard number, 0 for the single-file layout
+ * @return false if the index could not be loaded or `fn` failed
+ */
+bool cardIndexExport(int shard, CardIndexExportFn fn, void* context);
+
+/**
+ * Use index arrays saved by cardIndexExport instead of parsing a card file
+ *
+ * The arrays are used in place and must stay mapped for the life of the
+ * process; the shard switches to its own copy the next time its file
+ * changes.
+ *
+ * @param shard Shard number, 0 for the single-file layout
+ * @param fileSignature Signature of the shard's current file, which the
+ *                      caller has checked against the one the arrays were built from
+ * @return false if the slot table is malformed
+ */
+bool cardIndexAdopt(int shard, CardIndexEntry* entries, size_t count,
+                    int* slots, size_t slotCount,
+                    const FileSignature* fileSignature);
+
+/**
+ * Release all memory held by the index
+ */
+void cardIndexFree(void);
+
+#endif // CARD_INDEX_H
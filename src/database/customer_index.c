@@ -0,0 +1,489 @@
+#include "customer_index.h"
+#include "../common/paths.h"
+#include "../utils/logger.h"
+#include "../utils/file_utils.h"
+#include "../utils/hash_utils.h"
+#include "../utils/table_reader.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define CUSTOMER_FIELD_COUNT 6
+
+// One shard's index: entries in file order plus an open-addressing table of entry positions
+typedef struct {
+    CustomerIndexEntry* entries;
+    size_t entryCount;
+    size_t entryCapacity;
+    SlotTable table;
+    bool loaded;
+    bool borrowed;                // entries and slots point into a snapshot mapping
+    FileSignature signature;
+    unsigned long generation;     // Changes whenever the index is loaded from a different file
+} ShardIndex;
+
+// One index per customer file; the single-file layout uses the first
+static ShardIndex shards[MAX_DATA_SHARDS];
+
+// The journal checkpointer writes balances from its own thread
+static pthread_mutex_t indexLock = PTHREAD_MUTEX_INITIALIZER;
+
+// Source of shard generations; never reset, so a freed index cannot reuse one
+static unsigned long lastGeneration = 0;
+
+// Slot table callbacks; entries are keyed by account ID
+static bool entryHasKey(const void* entries, int position, const void* key) {
+    return strcmp(((const CustomerIndexEntry*)entries)[position].accountID, (const char*)key) == 0;
+}
+
+static size_t entryHash(const void* entries, int position) {
+    return (size_t)fnv1a_hash(((const CustomerIndexEntry*)entries)[position].accountID);
+}
+
+// Find the slot holding an account ID, or the empty slot where it would go
+static size_t findSlot(const ShardIndex* index, const char* accountID) {
+    return slot_table_find(&index->table, (size_t)fnv1a_hash(accountID), index->entries, accountID, entryHasKey);
+}
+
+// Stop using arrays adopted from a snapshot; the next load allocates its own
+static void dropBorrowed(ShardIndex* index) {
+    if (index->borrowed) {
+        index->entries = NULL;
+        index->table.slots = NULL;
+        index->entryCapacity = 0;
+        index->table.slotCount = 0;
+        index->borrowed = false;
+    }
+}
+
+static void resetIndex(ShardIndex* index) {
+    dropBorrowed(index);
+    index->entryCount = 0;
+    index->loaded = false;
+    slot_table_clear(&index->table);
+}
+
+static bool appendEntry(ShardIndex* index, const CustomerIndexEntry* entry) {
+    if (index->entryCount == index->entryCapacity) {
+        size_t newCapacity = index->entryCapacity == 0 ? 256 : index->entryCapacity * 2;
+        CustomerIndexEntry* grown = (CustomerIndexEntry*)realloc(index->entries, newCapacity * sizeof(CustomerIndexEntry));
+        if (grown == NULL) {
+            return false;
+        }
+        index->entries = grown;
+        index->entryCapacity = newCapacity;
+    }
+
+    if (!slot_table_reserve(&index->table, index->entryCount + 1, index->entries, index->entryCount, entryHash)) {
+        return false;
+    }
+
+    // Keep the first row for an account, matching the old first-match scans
+    size_t slot = findSlot(index, entry->accountID);
+    if (index->table.slots[slot] != SLOT_EMPTY) {
+        return true;
+    }
+
+    index->entries[index->entryCount] = *entry;
+    index->table.slots[slot] = (int)index->entryCount;
+    index->entryCount++;
+    return true;
+}
+
+// Fill an index entry from one data row
+static bool entryFromRow(const TableRow* row, CustomerIndexEntry* entry) {
+    // Format: Customer ID | Account ID | Account Holder Name | Type | Status | Balance
+    if (row->fieldCount < CUSTOMER_FIELD_COUNT) {
+        return false;
+    }
+
+    const FieldSlice* balanceField = &row->fields[5];
+    double balance;
+    if (row->fields[1].len == 0 || !tableFieldToDouble(balanceField, &balance)) {
+        return false;
+    }
+
+    memset(entry, 0, sizeof(*entry));
+    tableFieldCopy(&row->fields[0], entry->customerID, sizeof(entry->customerID));
+    tableFieldCopy(&row->fields[1], entry->accountID, sizeof(entry->accountID));
+    tableFieldCopy(&row->fields[2], entry->holderName, sizeof(entry->holderName));
+    tableFieldCopy(&row->fields[3], entry->type, sizeof(entry->type));
+    tableFieldCopy(&row->fields[4], entry->status, sizeof(entry->status));
+    entry->balance = (float)balance;
+    entry->offset = row->offset;
+
+    // The writable slot is the whole column: from just after its '|' up to the
+    // next '|' or the end of the line, padding included
+    const char* slotStart = balanceField->ptr;
+    const char* slotEnd = balanceField->ptr + balanceField->len;
+    const char* lineEnd = row->line + row->lineLen;
+    while (slotStart > row->line && slotStart[-1] != '|') {
+        slotStart--;
+    }
+    while (slotEnd < lineEnd && *slotEnd != '|') {
+        slotEnd++;
+    }
+    entry->balanceOffset = row->offset + (long)(slotStart - row->line);
+    entry->balanceWidth = (int)(slotEnd - slotStart);
+    return true;
+}
+
+// Build a shard's index from its customer file in a single pass
+static bool loadIndex(ShardIndex* index, int shard) {
+    TableReader reader;
+
+    resetIndex(index);
+
+    // The reader takes the signature from the open file so a concurrent rename is noticed next time
+    if (!tableReaderOpen(&reader, getCustomerShardFilePath(shard), '|')) {
+        writeErrorLog("Failed to open customer.txt file");
+        return false;
+    }
+
+    // Skip header lines
+    tableReaderSkipLines(&reader, 2);
+
+    TableRow row;
+    while (tableReaderNext(&reader, &row)) {
+        CustomerIndexEntry entry;
+        if (entryFromRow(&row, &entry) && !appendEntry(index, &entry)) {
+            writeErrorLog("Out of memory while building customer index");
+            tableReaderClose(&reader);
+            resetIndex(index);
+            return false;
+        }
+    }
+
+    index->signature = reader.signature;
+    tableReaderClose(&reader);
+    index->generation = ++lastGeneration;
+    index->loaded = true;
+
+    char logMsg[100];
+    if (getShardCount() > 0) {
+        sprintf(logMsg, "Customer index for shard %02d loaded with %zu accounts", shard, index->entryCount);
+    } else {
+        sprintf(logMsg, "Customer index loaded with %zu accounts", index->entryCount);
+    }
+    writeInfoLog(logMsg);
+    return true;
+}
+
+// Make sure a shard's index reflects its current customer file
+static bool ensureFresh(int shard) {
+    ShardIndex* index = &shards[shard];
+    FileSignature current;
+
+    if (index->loaded && readFileSignature(getCustomerShardFilePath(shard), &current) &&
+        fileSignatureMatches(&current, &index->signature)) {
+        return true;
+    }
+    return loadIndex(index, shard);
+}
+
+static bool validShard(int shard) {
+    return shard >= 0 && shard < getShardFileCount();
+}
+
+// Locate an account's entry in its shard, loading the shard if needed
+static CustomerIndexEntry* findEntry(const char* accountID, int* shardOut) {
+    if (accountID == NULL) {
+        return NULL;
+    }
+
+    int shard = getAccountShard(accountID);
+    ShardIndex* index = &shards[shard];
+    if (!ensureFresh(shard) || index->entryCount == 0) {
+        return NULL;
+    }
+
+    size_t slot = findSlot(index, accountID);
+    if (index->table.slots[slot] == SLOT_EMPTY) {
+        return NULL;
+    }
+    if (shardOut != NULL) {
+        *shardOut = shard;
+    }
+    return &index->entries[index->table.slots[slot]];
+}
+
+static bool writeBalanceInPlace(const char* accountID, float newBalance) {
+    int shard;
+    CustomerIndexEntry* entry = findEntry(accountID, &shard);
+    if (entry == NULL) {
+        return false;
+    }
+    ShardIndex* index = &shards[shard];
+
+    // Keep at least one space after the '|' so the row stays readable
+    char formatted[64];
+    int len = snprintf(formatted, sizeof(formatted), "%.2f", newBalance);
+    if (len < 0 || len + 1 > entry->balanceWidth || entry->balanceWidth >= (int)sizeof(formatted)) {
+        return false;
+    }
+
+    // Right-align the value in the existing slot
+    char slotText[64];
+    int pad = entry->balanceWidth - len;
+    memset(slotText, ' ', (size_t)pad);
+    memcpy(slotText + pad, formatted, (size_t)len);
+
+    const char* path = getCustomerShardFilePath(shard);
+    int fd = open(path, O_WRONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    // Offsets are only valid for the file the index was built from
+    FileSignature current;
+    if (!readFdSignature(fd, path, &current) || !fileSignatureMatches(&current, &index->signature)) {
+        close(fd);
+        index->loaded = false;
+        return false;
+    }
+
+    ssize_t written = pwrite(fd, slotText, (size_t)entry->balanceWidth, (off_t)entry->balanceOffset);
+    if (written != entry->balanceWidth) {
+        close(fd);
+        index->loaded = false;
+        writeErrorLog("Failed to write balance in place to customer file");
+        return false;
+    }
+
+    // Our own write changed the modification time; adopt it so the index stays valid
+    if (!readFdSignature(fd, path, &index->signature)) {
+        index->loaded = false;
+    }
+    close(fd);
+
+    entry->balance = newBalance;
+    return true;
+}
+
+bool customerIndexLookup(const char* accountID, CustomerIndexEntry* entry) {
+    pthread_mutex_lock(&indexLock);
+    const CustomerIndexEntry* found = findEntry(accountID, NULL);
+    if (found != NULL && entry != NULL) {
+        *entry = *found;
+    }
+    pthread_mutex_unlock(&indexLock);
+    return found != NULL;
+}
+
+bool customerIndexWriteBalance(const char* accountID, float newBalance) {
+    pthread_mutex_lock(&indexLock);
+    bool written = writeBalanceInPlace(accountID, newBalance);
+    pthread_mutex_unlock(&indexLock);
+    return written;
+}
+
+unsigned long customerIndexGeneration(int shard) {
+    if (!validShard(shard)) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&indexLock);
+    unsigned long generation = ensureFresh(shard) ? shards[shard].generation : 0;
+    pthread_mutex_unlock(&indexLock);
+    return generation;
+}
+
+void customerIndexInvalidate(void) {
+    pthread_mutex_lock(&indexLock);
+    for (int i = 0; i < MAX_DATA_SHARDS; i++) {
+        shards[i].loaded = false;
+    }
+    pthread_mutex_unlock(&indexLock);
+}
+
+void customerIndexInvalidateAccount(const char* accountID) {
+    if (accountID == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&indexLock);
+    shards[getAccountShard(accountID)].loaded = false;
+    pthread_mutex_unlock(&indexLock);
+}
+
+bool customerIndexExport(int shard, CustomerIndexExportFn fn, void* context) {
+    if (!validShard(shard)) {
+        return false;
+    }
+
+    pthread_mutex_lock(&indexLock);
+    ShardIndex* index = &shards[shard];
+    bool ok = ensureFresh(shard) &&
+              fn(index->entries, index->entryCount, index->table.slots, index->table.slotCount, &index->signature, context);
+    pthread_mutex_unlock(&indexLock);
+    return ok;
+}
+
+bool customerIndexAdopt(int shard, CustomerIndexEntry* snapshotEntries, size_t count,
+                        int* snapshotSlots, size_t snapshotSlotCount,
+                        const FileSignature* fileSignature) {
+    // The table must be a power of two with room left for probes to terminate
+    if (!validShard(shard) || snapshotSlotCount == 0 || (snapshotSlotCount & (snapshotSlotCount - 1)) != 0 ||
+        count >= snapshotSlotCount || count > (size_t)INT32_MAX) {
+        return false;
+    }
+    for (size_t i = 0; i < snapshotSlotCount; i++) {
+        if (snapshotSlots[i] != SLOT_EMPTY && (snapshotSlots[i] < 0 || (size_t)snapshotSlots[i] >= count)) {
+            return false;
+        }
+    }
+
+    pthread_mutex_lock(&indexLock);
+    ShardIndex* index = &shards[shard];
+    if (!index->borrowed) {
+        free(index->entries);
+        free(index->table.slots);
+    }
+    index->entries = snapshotEntries;
+    index->entryCount = count;
+    index->entryCapacity = count;
+    index->table.slots = snapshotSlots;
+    index->table.slotCount = snapshotSlotCount;
+    index->signature = *fileSignature;
+    index->generation = ++lastGeneration;
+    index->borrowed = true;
+    index->loaded = true;
+    pthread_mutex_unlock(&indexLock);
+    return true;
+}
+
+// Append `count` copies of `c` to a stream
+static void writeRepeated(FILE* file, char c, int count) {
+    for (int i = 0; i < count; i++) {
+        fputc(c, file);
+    }
+}
+
+int convertCustomerFileToFixedWidth(const char* filePath) {
+    TableReader reader;
+    if (!tableReaderOpen(&reader, filePath, '|')) {
+        char errorMsg[300];
+        sprintf(errorMsg, "Failed to open customer file at %s for conversion", filePath);
+        writeErrorLog(errorMsg);
+        return -1;
+    }
+
+    // Read every row first so the text columns can be sized to their widest value
+    CustomerIndexEntry* rows = NULL;
+    size_t rowCount = 0, rowCapacity = 0;
+    char header[CUSTOMER_FIELD_COUNT][100];
+    int widths[CUSTOMER_FIELD_COUNT - 1] = {0};
+    TableRow row;
+
+    if (!tableReaderNext(&reader, &row) || row.fieldCount < CUSTOMER_FIELD_COUNT) {
+        writeErrorLog("Customer file format error: unexpected header");
+        tableReaderClose(&reader);
+        return -1;
+    }
+    for (int i = 0; i < CUSTOMER_FIELD_COUNT; i++) {
+        tableFieldCopy(&row.fields[i], header[i], sizeof(header[i]));
+        if (i < CUSTOMER_FIELD_COUNT - 1) {
+            widths[i] = (int)strlen(header[i]);
+        }
+    }
+
+    // Skip the separator line; it is regenerated below
+    tableReaderSkipLines(&reader, 1);
+
+    while (tableReaderNext(&reader, &row)) {
+        CustomerIndexEntry entry;
+        if (!entryFromRow(&row, &entry)) {
+            // Refuse to convert rather than silently drop a row we cannot parse
+            writeErrorLog("Customer file format error: unparseable row, conversion aborted");
+            free(rows);
+            tableReaderClose(&reader);
+            return -1;
+        }
+
+        if (rowCount == rowCapacity) {
+            size_t newCapacity = rowCapacity == 0 ? 256 : rowCapacity * 2;
+            CustomerIndexEntry* grown = (CustomerIndexEntry*)realloc(rows, newCapacity * sizeof(CustomerIndexEntry));
+            if (grown == NULL) {
+                writeErrorLog("Out of memory while converting customer file");
+                free(rows);
+                tableReaderClose(&reader);
+                return -1;
+            }
+            rows = grown;
+            rowCapacity = newCapacity;
+        }
+        rows[rowCount++] = entry;
+
+        const char* fields[CUSTOMER_FIELD_COUNT - 1] = { entry.customerID, entry.accountID, entry.holderName, entry.type, entry.status };
+        for (int i = 0; i < CUSTOMER_FIELD_COUNT - 1; i++) {
+            int len = (int)strlen(fields[i]);
+            if (len > widths[i]) {
+                widths[i] = len;
+            }
+        }
+    }
+    tableReaderClose(&reader);
+
+    char tempFileName[300];
+    snprintf(tempFileName, sizeof(tempFileName), "%s.tmp", filePath);
+    FILE* out = fopen(tempFileName, "w");
+    if (out == NULL) {
+        char errorMsg[350];
+        sprintf(errorMsg, "Failed to create temporary customer file at %s", tempFileName);
+        writeErrorLog(errorMsg);
+        free(rows);
+        return -1;
+    }
+
+    // Header and separator
+    for (int i = 0; i < CUSTOMER_FIELD_COUNT - 1; i++) {
+        fprintf(out, "%-*s | ", widths[i], header[i]);
+    }
+    fprintf(out, "%*s\n", CUSTOMER_BALANCE_WIDTH, header[CUSTOMER_FIELD_COUNT - 1]);
+
+    for (int i = 0; i < CUSTOMER_FIELD_COUNT - 1; i++) {
+        writeRepeated(out, '-', widths[i] + (i == 0 ? 1 : 2));
+        fputc('|', out);
+    }
+    writeRepeated(out, '-', CUSTOMER_BALANCE_WIDTH + 1);
+    fputc('\n', out);
+
+    // Rows, with the balance right-aligned in its reserved column
+    for (size_t r = 0; r < rowCount; r++) {
+        fprintf(out, "%-*s | %-*s | %-*s | %-*s | %-*s | %*.2f\n",
+                widths[0], rows[r].customerID, widths[1], rows[r].accountID,
+                widths[2], rows[r].holderName, widths[3], rows[r].type,
+                widths[4], rows[r].status, CUSTOMER_BALANCE_WIDTH, rows[r].balance);
+    }
+
+    free(rows);
+
+    if (fclose(out) != 0 || rename(tempFileName, filePath) != 0) {
+        writeErrorLog("Failed to replace customer file during fixed-width conversion");
+        remove(tempFileName);
+        return -1;
+    }
+
+    customerIndexInvalidate();
+
+    char logMsg[350];
+    sprintf(logMsg, "Converted %zu customer rows in %s to fixed-width layout", rowCount, filePath);
+    writeAuditLog("ACCOUNT", logMsg);
+    return (int)rowCount;
+}
+
+void customerIndexFree(void) {
+    pthread_mutex_lock(&indexLock);
+    for (int i = 0; i < MAX_DATA_SHARDS; i++) {
+        ShardIndex* index = &shards[i];
+        if (!index->borrowed) {
+            free(index->entries);
+            free(index->table.slots);
+        }
+        memset(index, 0, sizeof(*index));
+    }
+    pthread_mutex_unlock(&indexLock);
+}
@@ -0,0 +1,121 @@
+#ifndef CUSTOMER_INDEX_H
+#define CUSTOMER_INDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "../utils/file_utils.h"
+
+// Reserved width of the balance column in the fixed-width customer.txt layout
+#define CUSTOMER_BALANCE_WIDTH 15
+
+// One customer.txt row, located by account ID
+typedef struct {
+    char customerID[20];
+    char accountID[20];
+    char holderName[100];
+    char type[20];
+    char status[20];
+    float balance;
+    long offset;              // Byte offset of the row in customer.txt
+    long balanceOffset;       // Byte offset of the balance column (just after its '|')
+    int balanceWidth;         // Bytes available for the balance column
+} CustomerIndexEntry;
+
+/**
+ * Look up a customer row by account ID
+ *
+ * The offset index is built from customer.txt on first use and rebuilt
+ * whenever the file is replaced or modified by another writer. With the
+ * sharded layout each shard's file is indexed separately, and only the
+ * shard holding the account is loaded.
+ *
+ * @param accountID The account ID to look up
+ * @param entry Receives a copy of the indexed row (may be NULL)
+ * @return true if the account exists, false otherwise
+ */
+bool customerIndexLookup(const char* accountID, CustomerIndexEntry* entry);
+
+/**
+ * Overwrite an account's balance in place with a single pwrite
+ *
+ * Only possible when the row's balance column is wide enough for the new
+ * value, which the fixed-width layout guarantees for every row.
+ *
+ * @param accountID The account whose balance changes
+ * @param newBalance The new balance
+ * @return true if the balance was written in place, false if the caller
+ *         must fall back to rewriting the file
+ */
+bool customerIndexWriteBalance(const char* accountID, float newBalance);
+
+/**
+ * Current generation of a shard's customer file
+ *
+ * The generation changes whenever the shard is reloaded because its file
+ * was replaced, modified by another writer or invalidated; balance writes
+ * made through this index keep it. Balances cached elsewhere are only
+ * valid while the generation they were read at is current.
+ *
+ * @param shard Shard number, 0 for the single-file layout
+ * @return The generation, or 0 if the file cannot be read
+ */
+unsigned long customerIndexGeneration(int shard);
+
+/**
+ * Drop the current index so the next lookup reloads customer.txt
+ * Call after rewriting customer.txt.
+ */
+void customerIndexInvalidate(void);
+
+/**
+ * Drop only the index of the shard holding `accountID`
+ * Call after rewriting or appending to that account's file.
+ */
+void customerIndexInvalidateAccount(const char* accountID);
+
+/**
+ * Rewrite a customer file into the fixed-width layout, reserving
+ * CUSTOMER_BALANCE_WIDTH characters for every balance
+ *
+ * @param filePath The customer file to convert
+ * @return Number of rows converted, or -1 on failure
+ */
+int convertCustomerFileToFixedWidth(const char* filePath);
+
+// Receives one shard's index arrays and the signature of the file they match
+typedef bool (*CustomerIndexExportFn)(const CustomerIndexEntry* entries, size_t count,
+                                      const int* slots, size_t slotCount,
+                                      const FileSignature* signature, void* context);
+
+/**
+ * Hand a shard's index to `fn` while it is locked, loading it first if needed
+ *
+ * Balance writes wait until `fn` returns, so the balances it sees match
+ * the signature it is given.
+ *
+ * @param shard Shard number, 0 for the single-file layout
+ * @return false if the index could not be loaded or `fn` failed
+ */
+bool customerIndexExport(int shard, CustomerIndexExportFn fn, void* context);
+
+/**
+ * Use index arrays saved by customerIndexExport instead of parsing a customer file
+ *
+ * The arrays are used in place (balances are updated copy-on-write) and
+ * must stay mapped for the life of the process; the shard switches to its
+ * own copy the next time its file is replaced.
+ *
+ * @param shard Shard number, 0 for the single-file layout
+ * @param fileSignature Signature of the shard's current file
+ * @return false if the slot table is malformed
+ */
+bool customerIndexAdopt(int shard, CustomerIndexEntry* entries, size_t count,
+                        int* slots, size_t slotCount,
+                        const FileSignature* fileSignature);
+
+/**
+ * Release all memory held by the index
+ */
+void customerIndexFree(void);
+
+#endif // CUSTOMER_INDEX_H
@@ -1,10 +1,18 @@
 #include "customer_profile.h"
 #include "../common/paths.h"
 #include "../utils/logger.h"
+#include "profile_store.h"
+#include "storage_engine.h"
+#include "history_index.h"
+#include "transaction_log.h"
+#include "id_allocator.h"
+#include "../utils/table_reader.h"
+#include "../utils/clock_utils.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>  // Added for isspace()
+#include <strings.h>
+#include <ctype.h>
 #include <time.h>
 
 // Helper function to parse a time string into a time_t value
@@ -30,276 +38,295 @@ static time_t parseTimeString(const char* timeString) {
     return time(NULL);
 }
 
-// Helper function to format a time_t value into a date string
-static void formatDateString(time_t timestamp, char* buffer, size_t bufferSize) {
-    struct tm* tm = localtime(&timestamp);
-    strftime(buffer, bufferSize, "%Y-%m-%d", tm);
+// Parse a time field; fields are copied to a stack buffer so nothing is allocated
+static time_t parseTimeField(const FieldSlice* field) {
+    char buffer[32];
+    tableFieldCopy(field, buffer, sizeof(buffer));
+    return parseTimeString(buffer);
 }
 
-// Helper function to format a time_t value into a date time string
-static void formatDateTimeString(time_t timestamp, char* buffer, size_t bufferSize) {
-    struct tm* tm = localtime(&timestamp);
-    strftime(buffer, bufferSize, "%Y-%m-%d %H:%M:%S", tm);
+// Case-insensitive comparison of a field with a NUL-terminated string
+static bool fieldEqualsIgnoreCase(const FieldSlice* field, const char* text) {
+    size_t len = strlen(text);
+    return field->len == len && strncasecmp(field->ptr, text, len) == 0;
 }
 
-// Helper function to trim whitespace
-static char* trim(const char* str) {
-    static char buffer[256];
-    if (str == NULL) return NULL;
-    
-    strncpy(buffer, str, sizeof(buffer) - 1);
-    buffer[sizeof(buffer) - 1] = '\0';
-    
-    char* result = buffer;
-    
-    // Remove leading spaces
-    while (*result != '\0' && isspace(*result)) {
-        result++;
+// Copy `src` into `dest` without surrounding whitespace
+static void copyTrimmed(const char* src, char* dest, size_t destSize) {
+    const char* end = src + strlen(src);
+    while (src < end && isspace((unsigned char)*src)) {
+        src++;
     }
-    
-    // Remove trailing spaces
-    if (*result != '\0') {
-        char* end = result + strlen(result) - 1;
-        while (end > result && isspace(*end)) {
-            *end = '\0';
-            end--;
-        }
+    while (end > src && isspace((unsigned char)end[-1])) {
+        end--;
     }
-    
-    return result;
+
+    FieldSlice trimmed = { src, (size_t)(end - src) };
+    tableFieldCopy(&trimmed, dest, destSize);
 }
 
 // Helper function to parse customer status string
-static CustomerStatus parseCustomerStatus(const char* statusStr) {
-    char* trimmed = trim(strdup(statusStr));
-    CustomerStatus status;
-    
-    if (strcasecmp(trimmed, "Active") == 0) {
-        status = CUSTOMER_ACTIVE;
-    } else if (strcasecmp(trimmed, "Inactive") == 0) {
-        status = CUSTOMER_INACTIVE;
-    } else {
-        status = CUSTOMER_SUSPENDED;
+static CustomerStatus parseCustomerStatus(const FieldSlice* field) {
+    if (fieldEqualsIgnoreCase(field, "Active")) {
+        return CUSTOMER_ACTIVE;
+    } else if (fieldEqualsIgnoreCase(field, "Inactive")) {
+        return CUSTOMER_INACTIVE;
     }
-    
-    free(trimmed);
-    return status;
+    return CUSTOMER_SUSPENDED;
 }
 
 // Helper function to parse KYC status string
-static KYCStatus parseKYCStatus(const char* statusStr) {
-    char* trimmed = trim(strdup(statusStr));
-    KYCStatus status;
-    
-    if (strcasecmp(trimmed, "Completed") == 0) {
-        status = KYC_COMPLETED;
-    } else {
-        status = KYC_PENDING;
-    }
-    
-    free(trimmed);
-    return status;
+static KYCStatus parseKYCStatus(const FieldSlice* field) {
+    return fieldEqualsIgnoreCase(field, "Completed") ? KYC_COMPLETED : KYC_PENDING;
 }
 
 // Helper function to parse card status string
-static CardStatus parseCardStatus(const char* statusStr) {
-    char* trimmed = trim(strdup(statusStr));
-    CardStatus status;
-    
-    if (strcasecmp(trimmed, "Active") == 0) {
-        status = CARD_ACTIVE;
-    } else if (strcasecmp(trimmed, "Expired") == 0) {
-        status = CARD_EXPIRED;
-    } else {
-        status = CARD_BLOCKED;
+static CardStatus parseCardStatus(const FieldSlice* field) {
+    if (fieldEqualsIgnoreCase(field, "Active")) {
+        return CARD_ACTIVE;
+    } else if (fieldEqualsIgnoreCase(field, "Expired")) {
+        return CARD_EXPIRED;
     }
-    
-    free(trimmed);
-    return status;
+    return CARD_BLOCKED;
 }
 
 // Helper function to parse account status string
-static AccountStatus parseAccountStatus(const char* statusStr) {
-    char* trimmed = trim(strdup(statusStr));
-    AccountStatus status;
-    
-    if (strcasecmp(trimmed, "Active") == 0) {
-        status = ACCOUNT_ACTIVE;
-    } else if (strcasecmp(trimmed, "Closed") == 0) {
-        status = ACCOUNT_CLOSED;
-    } else {
-        status = ACCOUNT_INACTIVE;
+static AccountStatus parseAccountStatus(const FieldSlice* field) {
+    if (fieldEqualsIgnoreCase(field, "Active")) {
+        return ACCOUNT_ACTIVE;
+    } else if (fieldEqualsIgnoreCase(field, "Closed")) {
+        return ACCOUNT_CLOSED;
     }
-    
-    free(trimmed);
-    return status;
+    return ACCOUNT_INACTIVE;
 }
 
 // Helper function to parse account type string
-static AccountType parseAccountType(const char* typeStr) {
-    char* trimmed = trim(strdup(typeStr));
-    AccountType type;
-    
-    if (strcasecmp(trimmed, "Current") == 0) {
-        type = ACCOUNT_CURRENT;
-    } else if (strcasecmp(trimmed, "FD") == 0) {
-        type = ACCOUNT_FD;
-    } else {
-        type = ACCOUNT_SAVINGS;
+static AccountType parseAccountType(const FieldSlice* field) {
+    if (fieldEqualsIgnoreCase(field, "Current")) {
+        return ACCOUNT_CURRENT;
+    } else if (fieldEqualsIgnoreCase(field, "FD")) {
+        return ACCOUNT_FD;
     }
-    
-    free(trimmed);
-    return type;
+    return ACCOUNT_SAVINGS;
 }
 
 // Helper function to parse card type string
-static CardType parseCardType(const char* typeStr) {
-    char* trimmed = trim(strdup(typeStr));
-    CardType type;
-    
-    if (strcasecmp(trimmed, "Credit") == 0) {
-        type = CARD_CREDIT;
-    } else {
-        type = CARD_DEBIT;
+static CardType parseCardType(const FieldSlice* field) {
+    return fieldEqualsIgnoreCase(field, "Credit") ? CARD_CREDIT : CARD_DEBIT;
+}
+
+// Status and type names as they appear in the data files
+static const char* customerStatusToString(CustomerStatus status) {
+    switch (status) {
+        case CUSTOMER_ACTIVE: return "Active";
+        case CUSTOMER_INACTIVE: return "Inactive";
+        default: return "Suspended";
     }
-    
-    free(trimmed);
-    return type;
+}
+
+static const char* kycStatusToString(KYCStatus status) {
+    return status == KYC_COMPLETED ? "Completed" : "Pending";
+}
+
+static const char* cardStatusToString(CardStatus status) {
+    switch (status) {
+        case CARD_ACTIVE: return "Active";
+        case CARD_EXPIRED: return "Expired";
+        default: return "Blocked";
+    }
+}
+
+static const char* accountStatusToString(AccountStatus status) {
+    switch (status) {
+        case ACCOUNT_ACTIVE: return "Active";
+        case ACCOUNT_CLOSED: return "Closed";
+        default: return "Inactive";
+    }
+}
+
+static const char* accountTypeToString(AccountType type) {
+    switch (type) {
+        case ACCOUNT_CURRENT: return "Current";
+        case ACCOUNT_FD: return "FD";
+        default: return "Savings";
+    }
+}
+
+// Fill a card from a card.txt row
+// Format: Card ID | Account ID | Card Number | Card Type | Expiry Date | Status | PIN Hash
+static bool parseCardRow(const TableRow* row, Card* card) {
+    long cardNumber;
+    if (row->fieldCount < 7 || !tableFieldToLong(&row->fields[2], &cardNumber)) {
+        return false;
+    }
+
+    memset(card, 0, sizeof(*card));
+    tableFieldCopy(&row->fields[0], card->cardId, sizeof(card->cardId));
+    tableFieldCopy(&row->fields[1], card->accountId, sizeof(card->accountId));
+    card->cardNumber = (int)cardNumber;
+    card->cardType = parseCardType(&row->fields[3]);
+    tableFieldCopy(&row->fields[4], card->expiryDate, sizeof(card->expiryDate));
+    card->status = parseCardStatus(&row->fields[5]);
+    tableFieldCopy(&row->fields[6], card->pinHash, sizeof(card->pinHash));
+    return true;
+}
+
+// Fill an account from an accounting.txt row
+// Format: Account ID | Customer ID | Account Type | Balance | Branch Code | Account Status | Created At | Last Transaction
+static bool parseAccountRow(const TableRow* row, Account* account) {
+    double balance;
+    if (row->fieldCount < 8 || !tableFieldToDouble(&row->fields[3], &balance)) {
+        return false;
+    }
+
+    memset(account, 0, sizeof(*account));
+    tableFieldCopy(&row->fields[0], account->accountId, sizeof(account->accountId));
+    tableFieldCopy(&row->fields[1], account->customerId, sizeof(account->customerId));
+    account->accountType = parseAccountType(&row->fields[2]);
+    account->balance = (float)balance;
+    tableFieldCopy(&row->fields[4], account->branchCode, sizeof(account->branchCode));
+    account->accountStatus = parseAccountStatus(&row->fields[5]);
+    account->createdAt = parseTimeField(&row->fields[6]);
+    account->lastTransaction = parseTimeField(&row->fields[7]);
+    return true;
+}
+
+// Fill a profile from a customer_profiles.txt row
+// Format: Customer ID | Name | DOB | Address | Email | Mobile Number | KYC Status | Status | Created At | Last Login
+static bool parseCustomerRow(const TableRow* row, CustomerProfile* profile) {
+    if (row->fieldCount < 10) {
+        return false;
+    }
+
+    memset(profile, 0, sizeof(*profile));
+    tableFieldCopy(&row->fields[0], profile->customerId, sizeof(profile->customerId));
+    tableFieldCopy(&row->fields[1], profile->name, sizeof(profile->name));
+    tableFieldCopy(&row->fields[2], profile->dob, sizeof(profile->dob));
+    tableFieldCopy(&row->fields[3], profile->address, sizeof(profile->address));
+    tableFieldCopy(&row->fields[4], profile->email, sizeof(profile->email));
+    tableFieldCopy(&row->fields[5], profile->mobileNumber, sizeof(profile->mobileNumber));
+    profile->kycStatus = parseKYCStatus(&row->fields[6]);
+    profile->status = parseCustomerStatus(&row->fields[7]);
+    profile->createdAt = parseTimeField(&row->fields[8]);
+    profile->lastLogin = parseTimeField(&row->fields[9]);
+    return true;
+}
+
+// Fill a wallet from a virtual_wallet.txt row
+// Format: Wallet ID | User ID | Balance | Last Refill Time | Refill Amount
+static bool parseWalletRow(const TableRow* row, VirtualWallet* wallet) {
+    double balance, refillAmount;
+    if (row->fieldCount < 5 ||
+        !tableFieldToDouble(&row->fields[2], &balance) ||
+        !tableFieldToDouble(&row->fields[4], &refillAmount)) {
+        return false;
+    }
+
+    memset(wallet, 0, sizeof(*wallet));
+    tableFieldCopy(&row->fields[0], wallet->walletId, sizeof(wallet->walletId));
+    tableFieldCopy(&row->fields[1], wallet->userId, sizeof(wallet->userId));
+    wallet->balance = (float)balance;
+    wallet->lastRefillTime = parseTimeField(&row->fields[3]);
+    wallet->refillAmount = (float)refillAmount;
+    return true;
+}
+
+// Split a row returned by profile_store_lookup
+static bool splitPendingRow(const char* line, TableRow* row) {
+    return tableSplitLine(line, strlen(line), '|', row);
 }
 
 // Find a card by card number
 static bool findCardByCardNumber(int cardNumber, Card* card) {
-    FILE* file = fopen(getCardFilePath(), "r");
-    if (file == NULL) {
+    char cardNumberStr[20];
+    TableRow row;
+    sprintf(cardNumberStr, "%d", cardNumber);
+
+    TableReader reader;
+    if (!tableReaderOpen(&reader, getCardFilePathFor(cardNumber), '|')) {
         writeErrorLog("Failed to open card file");
         return false;
     }
-    
-    char line[512];
-    bool found = false;
-    
+
     // Skip header lines
-    fgets(line, sizeof(line), file);
-    fgets(line, sizeof(line), file);
-    
-    // Format: Card ID | Account ID | Card Number | Card Type | Expiry Date | Status | PIN Hash
-    while (fgets(line, sizeof(line), file) != NULL && !found) {
-        char cardId[11], accountId[11], expiryDate[11], status[20], pinHash[65], cardType[20];
-        int storedCardNumber;
-        
-        if (sscanf(line, "%10[^|] | %10[^|] | %d | %19[^|] | %10[^|] | %19[^|] | %64s",
-                  cardId, accountId, &storedCardNumber, cardType, expiryDate, status, pinHash) == 7) {
-            
-            if (storedCardNumber == cardNumber) {
-                // Found matching card
-                strncpy(card->cardId, trim(cardId), sizeof(card->cardId) - 1);
-                strncpy(card->accountId, trim(accountId), sizeof(card->accountId) - 1);
-                card->cardNumber = storedCardNumber;
-                card->cardType = parseCardType(cardType);
-                strncpy(card->expiryDate, trim(expiryDate), sizeof(card->expiryDate) - 1);
-                card->status = parseCardStatus(status);
-                strncpy(card->pinHash, trim(pinHash), sizeof(card->pinHash) - 1);
-                
-                found = true;
-                break;
-            }
+    tableReaderSkipLines(&reader, 2);
+
+    // Only the matching row is parsed
+    bool found = false;
+    while (tableReaderNext(&reader, &row)) {
+        if (row.fieldCount >= 7 && tableFieldEquals(&row.fields[2], cardNumberStr)) {
+            found = parseCardRow(&row, card);
+            break;
         }
     }
-    
-    fclose(file);
+
+    tableReaderClose(&reader);
     return found;
 }
 
 // Find an account by account ID
 static bool findAccountById(const char* accountId, Account* account) {
-    FILE* file = fopen(getCustomerFilePath(), "r");
-    if (file == NULL) {
+    char pending[512];
+    char wantedId[20];
+    TableRow row;
+    copyTrimmed(accountId, wantedId, sizeof(wantedId));
+
+    if (profile_store_lookup(PROFILE_TABLE_ACCOUNTS, 0, wantedId, pending, sizeof(pending)) &&
+        splitPendingRow(pending, &row) && parseAccountRow(&row, account)) {
+        return true;
+    }
+
+    TableReader reader;
+    if (!tableReaderOpen(&reader, getAccountingFilePath(), '|')) {
         writeErrorLog("Failed to open account file");
         return false;
     }
-    
-    char line[512];
-    bool found = false;
-    
+
     // Skip header lines
-    fgets(line, sizeof(line), file);
-    fgets(line, sizeof(line), file);
-    
-    // Format: Account ID | Customer ID | Account Type | Balance | Branch Code | Account Status | Created At | Last Transaction
-    while (fgets(line, sizeof(line), file) != NULL && !found) {
-        char storedAccountId[11], customerId[11], accountType[20], branchCode[10], accountStatus[20];
-        char createdAtStr[30], lastTransactionStr[30];
-        float balance;
-        
-        if (sscanf(line, "%10[^|] | %10[^|] | %19[^|] | %f | %9[^|] | %19[^|] | %29[^|] | %29[^\n]",
-                  storedAccountId, customerId, accountType, &balance, branchCode, 
-                  accountStatus, createdAtStr, lastTransactionStr) == 8) {
-            
-            if (strcmp(trim(storedAccountId), trim(accountId)) == 0) {
-                // Found matching account
-                strncpy(account->accountId, trim(storedAccountId), sizeof(account->accountId) - 1);
-                strncpy(account->customerId, trim(customerId), sizeof(account->customerId) - 1);
-                account->accountType = parseAccountType(accountType);
-                account->balance = balance;
-                strncpy(account->branchCode, trim(branchCode), sizeof(account->branchCode) - 1);
-                account->accountStatus = parseAccountStatus(accountStatus);
-                account->createdAt = parseTimeString(trim(createdAtStr));
-                account->lastTransaction = parseTimeString(trim(lastTransactionStr));
-                
-                found = true;
-                break;
-            }
+    tableReaderSkipLines(&reader, 2);
+
+    bool found = false;
+    while (tableReaderNext(&reader, &row)) {
+        if (row.fieldCount >= 8 && tableFieldEquals(&row.fields[0], wantedId)) {
+            found = parseAccountRow(&row, account);
+            break;
         }
     }
-    
-    fclose(file);
+
+    tableReaderClose(&reader);
     return found;
 }
 
 // Find a customer by customer ID
 static bool findCustomerById(const char* customerId, CustomerProfile* profile) {
-    FILE* file = fopen(getCustomerFilePath(), "r");
-    if (file == NULL) {
-        writeErrorLog("Failed to open customer file");
+    char pending[1024];
+    char wantedId[20];
+    TableRow row;
+    copyTrimmed(customerId, wantedId, sizeof(wantedId));
+
+    if (profile_store_lookup(PROFILE_TABLE_CUSTOMERS, 0, wantedId, pending, sizeof(pending)) &&
+        splitPendingRow(pending, &row) && parseCustomerRow(&row, profile)) {
+        return true;
+    }
+
+    TableReader reader;
+    if (!tableReaderOpen(&reader, getCustomerProfilesFilePath(), '|')) {
+        writeErrorLog("Failed to open customer profiles file");
         return false;
     }
-    
-    char line[512];
-    bool found = false;
-    
+
     // Skip header lines
-    fgets(line, sizeof(line), file);
-    fgets(line, sizeof(line), file);
-    
-    // Format: Customer ID | Name | DOB | Address | Email | Mobile Number | KYC Status | Status | Created At | Last Login
-    while (fgets(line, sizeof(line), file) != NULL && !found) {
-        char storedCustomerId[11], name[100], dob[11], address[200], email[100], mobileNumber[15];
-        char kycStatus[20], status[20], createdAtStr[30], lastLoginStr[30];
-        
-        if (sscanf(line, "%10[^|] | %99[^|] | %10[^|] | %199[^|] | %99[^|] | %14[^|] | %19[^|] | %19[^|] | %29[^|] | %29[^\n]",
-                  storedCustomerId, name, dob, address, email, mobileNumber, 
-                  kycStatus, status, createdAtStr, lastLoginStr) == 10) {
-            
-            if (strcmp(trim(storedCustomerId), trim(customerId)) == 0) {
-                // Found matching customer
-                strncpy(profile->customerId, trim(storedCustomerId), sizeof(profile->customerId) - 1);
-                strncpy(profile->name, trim(name), sizeof(profile->name) - 1);
-                strncpy(profile->dob, trim(dob), sizeof(profile->dob) - 1);
-                strncpy(profile->address, trim(address), sizeof(profile->address) - 1);
-                strncpy(profile->email, trim(email), sizeof(profile->email) - 1);
-                strncpy(profile->mobileNumber, trim(mobileNumber), sizeof(profile->mobileNumber) - 1);
-                profile->kycStatus = parseKYCStatus(kycStatus);
-                profile->status = parseCustomerStatus(status);
-                profile->createdAt = parseTimeString(trim(createdAtStr));
-                profile->lastLogin = parseTimeString(trim(lastLoginStr));
-                
-                found = true;
-                break;
-            }
+    tableReaderSkipLines(&reader, 2);
+
+    bool found = false;
+    while (tableReaderNext(&reader, &row)) {
+        if (row.fieldCount >= 10 && tableFieldEquals(&row.fields[0], wantedId)) {
+            found = parseCustomerRow(&row, profile);
+            break;
         }
     }
-    
-    fclose(file);
+
+    tableReaderClose(&reader);
     return found;
 }
 
@@ -376,151 +403,215 @@ bool loadCardByCardNumber(int cardNumber, Card* card) {
     return findCardByCardNumber(cardNumber, card);
 }
 
-// Get recent transactions for an account
+// Copy a row of the transactions log returned by the history index
+static void copyHistoryRecord(const HistoryRecord* record, Transaction* transaction) {
+    memset(transaction, 0, sizeof(*transaction));
+    strncpy(transaction->transactionId, record->transactionID, sizeof(transaction->transactionId) - 1);
+    strncpy(transaction->accountId, record->accountID, sizeof(transaction->accountId) - 1);
+    snprintf(transaction->transactionType, sizeof(transaction->transactionType), "%s", record->type);
+    transaction->amount = record->amount;
+    transaction->transactionTime = parseTimeString(record->timestamp);
+    transaction->transactionStatus = strcasecmp(record->status, "Success") == 0;
+    snprintf(transaction->transactionRemarks, sizeof(transaction->transactionRemarks), "%s", record->remarks);
+}
+
+// Copy `count` rows from the history index into `transactions`
+static void copyHistoryRecords(const HistoryRecord* records, int count, Transaction* transactions) {
+    for (int i = 0; i < count; i++) {
+        copyHistoryRecord(&records[i], &transactions[i]);
+    }
+}
+
+// Get the most recent transactions for an account, oldest first
 int getRecentTransactions(const char* accountId, Transaction* transactions, int maxTransactions) {
-    const char* transactionFilePath = isTestingMode() ? 
-        TEST_TRANSACTIONS_LOG_FILE : PROD_TRANSACTIONS_LOG_FILE;
-    
-    FILE* file = fopen(transactionFilePath, "r");
-    if (file == NULL) {
-        writeErrorLog("Failed to open transaction file");
+    if (accountId == NULL || transactions == NULL || maxTransactions <= 0) {
         return 0;
     }
-    
-    char line[512];
-    int count = 0;
-    
-    // Skip header lines
-    fgets(line, sizeof(line), file);
-    fgets(line, sizeof(line), file);
-    
-    // Format: Transaction ID | Account ID | Transaction Type | Amount | Transaction Time | Transaction Status | Transaction Remarks
-    while (fgets(line, sizeof(line), file) != NULL && count < maxTransactions) {
-        char transactionId[11], storedAccountId[11], transactionType[20], transactionTimeStr[30];
-        char statusStr[20], remarks[200];
-        float amount;
-        
-        if (sscanf(line, "%10[^|] | %10[^|] | %19[^|] | %f | %29[^|] | %19[^|] | %199[^\n]",
-                  transactionId, storedAccountId, transactionType, &amount, 
-                  transactionTimeStr, statusStr, remarks) == 7) {
-            
-            if (strcmp(trim(storedAccountId), trim(accountId)) == 0) {
-                // This transaction is for the requested account
-                strncpy(transactions[count].transactionId, trim(transactionId), sizeof(transactions[count].transactionId) - 1);
-                strncpy(transactions[count].accountId, trim(storedAccountId), sizeof(transactions[count].accountId) - 1);
-                strncpy(transactions[count].transactionType, trim(transactionType), sizeof(transactions[count].transactionType) - 1);
-                transactions[count].amount = amount;
-                transactions[count].transactionTime = parseTimeString(trim(transactionTimeStr));
-                transactions[count].transactionStatus = (strcasecmp(trim(statusStr), "Success") == 0);
-                strncpy(transactions[count].transactionRemarks, trim(remarks), sizeof(transactions[count].transactionRemarks) - 1);
-                
-                count++;
-            }
-        }
+
+    char wantedId[20];
+    copyTrimmed(accountId, wantedId, sizeof(wantedId));
+
+    HistoryRecord* records = (HistoryRecord*)malloc((size_t)maxTransactions * sizeof(HistoryRecord));
+    if (records == NULL) {
+        writeErrorLog("Out of memory while reading recent transactions");
+        return 0;
     }
-    
-    fclose(file);
+    int count = historyIndexRecent(wantedId, records, maxTransactions);
+    copyHistoryRecords(records, count, transactions);
+    free(records);
+    return count;
+}
+
+// Get one page of an account's transactions within a time range, oldest first
+int queryTransactions(const char* accountId, time_t from, time_t to, HistoryCursor* cursor,
+                      Transaction* transactions, int limit) {
+    if (accountId == NULL || cursor == NULL || transactions == NULL || limit <= 0) {
+        return 0;
+    }
+
+    char wantedId[20];
+    copyTrimmed(accountId, wantedId, sizeof(wantedId));
+
+    HistoryRecord* records = (HistoryRecord*)malloc((size_t)limit * sizeof(HistoryRecord));
+    if (records == NULL) {
+        writeErrorLog("Out of memory while querying transactions");
+        return 0;
+    }
+    int count = historyIndexQuery(wantedId, from, to, cursor, records, limit);
+    copyHistoryRecords(records, count, transactions);
+    free(records);
     return count;
 }
 
 // Load virtual wallet for a user
 bool loadVirtualWallet(const char* userId, VirtualWallet* wallet) {
-    FILE* file = fopen(TEST_DATA_DIR "/test_virtual_wallet.txt", "r");
-    if (file == NULL) {
+    char pending[512];
+    char wantedId[20];
+    TableRow row;
+    copyTrimmed(userId, wantedId, sizeof(wantedId));
+
+    if (profile_store_lookup(PROFILE_TABLE_WALLETS, 1, wantedId, pending, sizeof(pending)) &&
+        splitPendingRow(pending, &row) && parseWalletRow(&row, wallet)) {
+        return true;
+    }
+
+    TableReader reader;
+    if (!tableReaderOpen(&reader, getVirtualWalletFilePath(), '|')) {
         writeErrorLog("Failed to open virtual wallet file");
         return false;
     }
-    
-    char line[512];
-    bool found = false;
-    
+
     // Skip header lines
-    fgets(line, sizeof(line), file);
-    fgets(line, sizeof(line), file);
-    
-    // Format: Wallet ID | User ID | Balance | Last Refill Time | Refill Amount
-    while (fgets(line, sizeof(line), file) != NULL && !found) {
-        char walletId[11], storedUserId[11], lastRefillTimeStr[30];
-        float balance, refillAmount;
-        
-        if (sscanf(line, "%10[^|] | %10[^|] | %f | %29[^|] | %f",
-                  walletId, storedUserId, &balance, lastRefillTimeStr, &refillAmount) == 5) {
-            
-            if (strcmp(trim(storedUserId), trim(userId)) == 0) {
-                // Found matching wallet
-                strncpy(wallet->walletId, trim(walletId), sizeof(wallet->walletId) - 1);
-                strncpy(wallet->userId, trim(storedUserId), sizeof(wallet->userId) - 1);
-                wallet->balance = balance;
-                wallet->lastRefillTime = parseTimeString(trim(lastRefillTimeStr));
-                wallet->refillAmount = refillAmount;
-                
-                found = true;
-                break;
-            }
+    tableReaderSkipLines(&reader, 2);
+
+    bool found = false;
+    while (tableReaderNext(&reader, &row)) {
+        if (row.fieldCount >= 5 && tableFieldEquals(&row.fields[1], wantedId)) {
+            found = parseWalletRow(&row, wallet);
+            break;
         }
     }
-    
-    fclose(file);
+
+    tableReaderClose(&reader);
     return found;
 }
 
 // Save updated customer profile
 bool saveCustomerProfile(const CustomerProfile* profile) {
-    // In a real implementation, this would update the customer file
-    // For the test version, we'll just log it
+    char createdAt[20], lastLogin[20];
+    clockFormatTimestamp(profile->createdAt, createdAt, sizeof(createdAt));
+    clockFormatTimestamp(profile->lastLogin, lastLogin, sizeof(lastLogin));
+
+    char row[700];
+    snprintf(row, sizeof(row), "%-11s | %s | %s | %s | %s | %s | %s | %s | %s | %s",
+             profile->customerId, profile->name, profile->dob, profile->address,
+             profile->email, profile->mobileNumber, kycStatusToString(profile->kycStatus),
+             customerStatusToString(profile->status), createdAt, lastLogin);
+
+    if (!profile_store_put(PROFILE_TABLE_CUSTOMERS, profile->customerId, row)) {
+        return false;
+    }
+
     char logMessage[256];
     sprintf(logMessage, "Saving customer profile for %s: %s (Status: %d)",
             profile->customerId, profile->name, profile->status);
     writeAuditLog("PROFILE", logMessage);
-    
-    return true; // Simulated success
+    return true;
 }
 
 // Save updated account
 bool saveAccount(const Account* account) {
-    // In a real implementation, this would update the account file
-    // For the test version, we'll just log it
+    char createdAt[20], lastTransaction[20];
+    clockFormatTimestamp(account->createdAt, createdAt, sizeof(createdAt));
+    clockFormatTimestamp(account->lastTransaction, lastTransaction, sizeof(lastTransaction));
+
+    char row[256];
+    snprintf(row, sizeof(row), "%-10s | %-11s | %-12s | %-9.2f | %-10s | %-13s | %-19s | %s",
+             account->accountId, account->customerId, accountTypeToString(account->accountType),
+             account->balance, account->branchCode, accountStatusToString(account->accountStatus),
+             createdAt, lastTransaction);
+
+    if (!profile_store_put(PROFILE_TABLE_ACCOUNTS, account->accountId, row)) {
+        return false;
+    }
+
     char logMessage[256];
     sprintf(logMessage, "Saving account %s with balance %.2f (Status: %d)",
             account->accountId, account->balance, account->accountStatus);
     writeAuditLog("ACCOUNT", logMessage);
-    
-    return true; // Simulated success
+    return true;
 }
 
 // Save updated card
 bool saveCard(const Card* card) {
-    // In a real implementation, this would update the card file
-    // For the test version, we'll just log it
+    // Cards belong to the storage engine, which owns every write to the card files
+    const StorageEngine* engine = storageEngine();
+    StorageCard stored;
+    if (card == NULL || !engine->get_card(card->cardNumber, &stored)) {
+        writeErrorLog("Cannot save a card that does not exist");
+        return false;
+    }
+
+    const char* status = cardStatusToString(card->status);
+    if (strcasecmp(stored.status, status) != 0 && !engine->set_card_status(card->cardNumber, status)) {
+        return false;
+    }
+    if (strcmp(stored.pinHash, card->pinHash) != 0 && !engine->set_card_pin_hash(card->cardNumber, card->pinHash)) {
+        return false;
+    }
+
     char logMessage[256];
     sprintf(logMessage, "Saving card %s with card number %d (Status: %d)",
             card->cardId, card->cardNumber, card->status);
     writeAuditLog("CARD", logMessage);
-    
-    return true; // Simulated success
+    return true;
 }
 
 // Record a new transaction
 bool recordTransaction(const Transaction* transaction) {
-    // In a real implementation, this would append to the transaction file
-    // For the test version, we'll just log it
+    // "T40001" is stored as 40001; IDs without a number get a fresh one
+    const char* digits = transaction->transactionId;
+    while (*digits != '\0' && !isdigit((unsigned char)*digits)) {
+        digits++;
+    }
+    long long id = atoll(digits);
+    if (id <= 0) {
+        id = allocateId(ID_SEQUENCE_TRANSACTION);
+    }
+
+    TransactionLogRecord record;
+    transactionLogInitRecord(&record, id, transaction->accountId,
+                             transactionLogTypeFromName(transaction->transactionType), transaction->amount,
+                             transaction->transactionTime, transaction->transactionStatus);
+    record.remark = (uint16_t)transactionLogRemarkFromText(transaction->transactionRemarks);
+    if (!transactionLogAppend(&record, 1)) {
+        return false;
+    }
+
     char logMessage[256];
     sprintf(logMessage, "Recording %s transaction of %.2f for account %s: %s",
             transaction->transactionType, transaction->amount,
             transaction->accountId, transaction->transactionRemarks);
     writeAuditLog("TRANSACTION", logMessage);
-    
-    return true; // Simulated success
+    return true;
 }
 
 // Update virtual wallet balance
 bool updateVirtualWallet(const VirtualWallet* wallet) {
-    // In a real implementation, this would update the wallet file
-    // For the test version, we'll just log it
+    char lastRefill[20];
+    clockFormatTimestamp(wallet->lastRefillTime, lastRefill, sizeof(lastRefill));
+
+    char row[200];
+    snprintf(row, sizeof(row), "%-9s | %-8s | %-8.2f | %-19s | %.2f",
+             wallet->walletId, wallet->userId, wallet->balance, lastRefill, wallet->refillAmount);
+
+    if (!profile_store_put(PROFILE_TABLE_WALLETS, wallet->walletId, row)) {
+        return false;
+    }
+
     char logMessage[256];
     sprintf(logMessage, "Updating wallet %s for user %s with new balance %.2f",
             wallet->walletId, wallet->userId, wallet->balance);
     writeAuditLog("WALLET", logMessage);
-    
-    return true; // Simulated success
-}
\ No newline at end of file
+    return true;
+}
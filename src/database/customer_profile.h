@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <time.h>
+#include "history_index.h"
 
 // Customer status enumeration
 typedef enum {
@@ -110,9 +111,15 @@ bool loadAccountByCardNumber(int cardNumber, Account *account);
 // Load card by card number
 bool loadCardByCardNumber(int cardNumber, Card *card);
 
-// Get recent transactions for an account
+// Get the most recent transactions for an account, oldest first
 int getRecentTransactions(const char *accountId, Transaction *transactions, int maxTransactions);
 
+// Get the next page of an account's transactions with from <= time <= to, oldest first.
+// 0 for `from` or `to` leaves that end open; zero-initialise `cursor` for the first page.
+// Returns the number stored, 0 once the range is exhausted.
+int queryTransactions(const char *accountId, time_t from, time_t to, HistoryCursor *cursor,
+                      Transaction *transactions, int limit);
+
 // Load virtual wallet for a user
 bool loadVirtualWallet(const char *userId, VirtualWallet *wallet);
 
@@ -122,7 +129,8 @@ bool saveCustomerProfile(const CustomerProfile *profile);
 // Save updated account
 bool saveAccount(const Account *account);
 
-// Save updated card
+// Save an updated card's status and PIN hash through the storage engine;
+// the other fields are fixed when the card is created
 bool saveCard(const Card *card);
 
 // Record a new transaction
@@ -2,91 +2,33 @@
 #include "../utils/logger.h"
 #include "../common/paths.h"
 #include "../utils/hash_utils.h"
+#include "../utils/table_reader.h"
+#include "../utils/clock_utils.h"
+#include "customer_index.h"
+#include "storage_engine.h"
+#include "withdrawal_tracker.h"
+#include "id_allocator.h"
+#include "transaction_log.h"
+#include "../transaction/lock_manager.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
-#include <limits.h> // Added for INT_MAX
-
-// Helper function to get current date as a string (YYYY-MM-DD)
-static void getCurrentDate(char *buffer, size_t size) {
-    time_t now = time(NULL);
-    struct tm *t = localtime(&now);
-    strftime(buffer, size, "%Y-%m-%d", t);
-}
-
-// Helper function to get current timestamp as a string (YYYY-MM-DD HH:MM:SS)
-static void getCurrentTimestamp(char *buffer, size_t size) {
-    time_t now = time(NULL);
-    struct tm *t = localtime(&now);
-    strftime(buffer, size, "%Y-%m-%d %H:%M:%S", t);
-}
 
 // Check if a card number exists in the database
 bool doesCardExist(int cardNumber) {
-    FILE* file = fopen(getCardFilePath(), "r");
-    if (file == NULL) {
-        writeErrorLog("Failed to open card.txt file");
-        return false;
-    }
-    
-    char line[256];
-    bool found = false;
-    
-    // Skip header lines
-    fgets(line, sizeof(line), file);
-    fgets(line, sizeof(line), file);
-    
-    char cardID[10], accountID[10], cardNumberStr[20], cardType[10], expiryDate[15], status[10], pinHash[65];
-    
-    while (fgets(line, sizeof(line), file) != NULL) {
-        if (sscanf(line, "%s | %s | %s | %s | %s | %s | %s", 
-                   cardID, accountID, cardNumberStr, cardType, expiryDate, status, pinHash) >= 7) {
-            int storedCardNumber = atoi(cardNumberStr);
-            if (storedCardNumber == cardNumber) {
-                found = true;
-                break;
-            }
-        }
-    }
-    
-    fclose(file);
-    return found;
+    return storageEngine()->get_card(cardNumber, NULL);
 }
 
 // Check if a card is active
 bool isCardActive(int cardNumber) {
-    FILE* file = fopen(getCardFilePath(), "r");
-    if (file == NULL) {
-        writeErrorLog("Failed to open card.txt file");
+    StorageCard card;
+    if (!storageEngine()->get_card(cardNumber, &card)) {
         return false;
     }
     
-    char line[256];
-    bool active = false;
-    
-    // Skip header lines
-    fgets(line, sizeof(line), file);
-    fgets(line, sizeof(line), file);
-    
-    char cardID[10], accountID[10], cardNumberStr[20], cardType[10], expiryDate[15], status[10], pinHash[65];
-    
-    while (fgets(line, sizeof(line), file) != NULL) {
-        if (sscanf(line, "%s | %s | %s | %s | %s | %s | %s", 
-                   cardID, accountID, cardNumberStr, cardType, expiryDate, status, pinHash) >= 7) {
-            int storedCardNumber = atoi(cardNumberStr);
-            if (storedCardNumber == cardNumber) {
-                // Check if status is "Active"
-                if (strstr(status, "Active") != NULL) {
-                    active = true;
-                }
-                break;
-            }
-        }
-    }
-    
-    fclose(file);
-    return active;
+    // Check if status is "Active"
+    return strcmp(card.status, "Active") == 0;
 }
 
 // Validate card with PIN (legacy method, for backward compatibility)
@@ -106,37 +48,13 @@ bool validateCardWithHash(int cardNumber, const char* pinHash) {
         return false;
     }
     
-    FILE* file = fopen(getCardFilePath(), "r");
-    if (file == NULL) {
-        writeErrorLog("Failed to open card.txt file");
+    StorageCard card;
+    if (!storageEngine()->get_card(cardNumber, &card)) {
         return false;
     }
     
-    char line[256];
-    bool valid = false;
-    
-    // Skip header lines
-    fgets(line, sizeof(line), file);
-    fgets(line, sizeof(line), file);
-    
-    char cardID[10], accountID[10], cardNumberStr[20], cardType[10], expiryDate[15], status[10], storedPinHash[65];
-    
-    while (fgets(line, sizeof(line), file) != NULL) {
-        if (sscanf(line, "%s | %s | %s | %s | %s | %s | %s", 
-                   cardID, accountID, cardNumberStr, cardType, expiryDate, status, storedPinHash) >= 7) {
-            int storedCardNumber = atoi(cardNumberStr);
-            if (storedCardNumber == cardNumber) {
-                // Use secure hash comparison instead of strcmp
-                if (secure_hash_compare(storedPinHash, pinHash)) {
-                    valid = true;
-                }
-                break;
-            }
-        }
-    }
-    
-    fclose(file);
-    return valid;
+    // Use secure hash comparison instead of strcmp
+    return secure_hash_compare(card.pinHash, pinHash) != 0;
 }
 
 // Update PIN for a card (legacy method)
@@ -156,71 +74,15 @@ bool updatePINHash(int cardNumber, const char* pinHash) {
         return false;
     }
     
-    FILE* file = fopen(getCardFilePath(), "r");
-    if (file == NULL) {
-        writeErrorLog("Failed to open card.txt file");
+    if (!storageEngine()->set_card_pin_hash(cardNumber, pinHash)) {
+        writeErrorLog("Failed to update PIN hash");
         return false;
     }
     
-    char tempFileName[100];
-    sprintf(tempFileName, "%s/temp/temp_card.txt", isTestingMode() ? TEST_DATA_DIR : PROD_DATA_DIR);
-    
-    FILE* tempFile = fopen(tempFileName, "w");
-    if (tempFile == NULL) {
-        fclose(file);
-        writeErrorLog("Failed to create temporary card file");
-        return false;
-    }
-    
-    char line[256];
-    bool updated = false;
-    
-    // Copy header lines
-    fgets(line, sizeof(line), file);
-    fputs(line, tempFile);
-    fgets(line, sizeof(line), file);
-    fputs(line, tempFile);
-    
-    char cardID[10], accountID[10], cardNumberStr[20], cardType[10], expiryDate[15], status[10], oldPinHash[65];
-    
-    while (fgets(line, sizeof(line), file) != NULL) {
-        char lineCopy[256];
-        strcpy(lineCopy, line);
-        
-        if (sscanf(lineCopy, "%s | %s | %s | %s | %s | %s | %s", 
-                   cardID, accountID, cardNumberStr, cardType, expiryDate, status, oldPinHash) >= 7) {
-            int storedCardNumber = atoi(cardNumberStr);
-            if (storedCardNumber == cardNumber) {
-                // Update the PIN with hash
-                fprintf(tempFile, "%s | %s | %s | %s | %s | %s | %s\n", 
-                        cardID, accountID, cardNumberStr, cardType, expiryDate, status, pinHash);
-                updated = true;
-            } else {
-                fputs(line, tempFile);
-            }
-        } else {
-            fputs(line, tempFile);
-        }
-    }
-    
-    fclose(file);
-    fclose(tempFile);
-    
-    if (updated) {
-        // Replace original file with updated one
-        if (remove(getCardFilePath()) == 0 && 
-            rename(tempFileName, getCardFilePath()) == 0) {
-            
-            char logMsg[100];
-            sprintf(logMsg, "PIN hash updated for card %d", cardNumber);
-            writeAuditLog("SECURITY", logMsg);
-            return true;
-        }
-    }
-    
-    // Remove temp file if update was not successful
-    remove(tempFileName);
-    return false;
+    char logMsg[100];
+    sprintf(logMsg, "PIN hash updated for card %d", cardNumber);
+    writeAuditLogSync("SECURITY", logMsg);
+    return true;
 }
 
 // Get card holder's name by looking up customer info by card number
@@ -230,74 +92,19 @@ bool getCardHolderName(int cardNumber, char* name, size_t nameSize) {
     }
     
     // First, find the account ID from the card number
-    FILE* cardFile = fopen(getCardFilePath(), "r");
-    if (cardFile == NULL) {
-        writeErrorLog("Failed to open card.txt file");
-        return false;
-    }
-    
-    char line[256];
-    char accountID[10] = "";
-    
-    // Skip header lines
-    fgets(line, sizeof(line), cardFile);
-    fgets(line, sizeof(line), cardFile);
-    
-    char cardID[10], accID[10], cardNumberStr[20], cardType[10], expiryDate[15], status[10], pinHash[65];
-    
-    while (fgets(line, sizeof(line), cardFile) != NULL) {
-        if (sscanf(line, "%s | %s | %s | %s | %s | %s | %s", 
-                   cardID, accID, cardNumberStr, cardType, expiryDate, status, pinHash) >= 7) {
-            int storedCardNumber = atoi(cardNumberStr);
-            if (storedCardNumber == cardNumber) {
-                strcpy(accountID, accID);
-                break;
-            }
-        }
-    }
-    
-    fclose(cardFile);
-    
-    if (strlen(accountID) == 0) {
+    StorageCard card;
+    if (!storageEngine()->get_card(cardNumber, &card)) {
         return false; // Card number not found
     }
     
-    // Get customer name directly from customer.txt using the account ID
-    FILE* customerFile = fopen(getCustomerFilePath(), "r");
-    if (customerFile == NULL) {
-        writeErrorLog("Failed to open customer.txt file");
+    StorageAccount account;
+    if (!storageEngine()->get_account(card.accountID, &account)) {
         return false;
     }
     
-    bool found = false;
-    
-    // Skip header lines
-    fgets(line, sizeof(line), customerFile);
-    fgets(line, sizeof(line), customerFile);
-    
-    // Format: Customer ID | Account ID | Account Holder Name | Type | Status | Balance
-    char customerID[15], accIDFromFile[15], holderName[100], type[20], accountStatus[20], balance[20];
-    
-    while (fgets(line, sizeof(line), customerFile) != NULL) {
-        if (sscanf(line, "%s | %s | %[^|] | %s | %s | %s", 
-                   customerID, accIDFromFile, holderName, type, accountStatus, balance) >= 6) {
-            if (strcmp(accIDFromFile, accountID) == 0) {
-                // Trim any leading/trailing spaces from holder name
-                int start = 0, end = strlen(holderName) - 1;
-                while (holderName[start] == ' ') start++;
-                while (end > start && holderName[end] == ' ') end--;
-                holderName[end + 1] = '\0';
-                
-                strncpy(name, &holderName[start], nameSize - 1);
-                name[nameSize - 1] = '\0';
-                found = true;
-                break;
-            }
-        }
-    }
-    
-    fclose(customerFile);
-    return found;
+    strncpy(name, account.holderName, nameSize - 1);
+    name[nameSize - 1] = '\0';
+    return true;
 }
 
 // Get card holder's phone number by looking up customer info
@@ -318,6 +125,16 @@ bool getCardHolderPhone(int cardNumber, char* phone, size_t phoneSize) {
     return false;
 }
 
+// Get the current balance of an account from the storage engine
+bool fetchAccountBalance(const char* accountID, float* balance) {
+    if (accountID == NULL || balance == NULL) {
+        return false;
+    }
+    
+    // Served from a committed snapshot; never waits for a balance update
+    return storageEngine()->get_balance(accountID, balance);
+}
+
 // Fetch account balance for a card
 float fetchBalance(int cardNumber) {
     if (cardNumber <= 0) {
@@ -325,185 +142,37 @@ float fetchBalance(int cardNumber) {
         return -1.0f;
     }
     
-    const char* cardFilePath = getCardFilePath();
-    FILE* cardFile = fopen(cardFilePath, "r");
-    if (cardFile == NULL) {
-        char errorMsg[100];
-        sprintf(errorMsg, "Failed to open card file at %s", cardFilePath);
-        writeErrorLog(errorMsg);
-        return -1.0f;
-    }
-    
-    char line[256] = {0};
-    char accountID[20] = {0};  // Increased size for safety
-    bool found = false;
-    
-    // Skip header lines
-    if (fgets(line, sizeof(line), cardFile) == NULL || fgets(line, sizeof(line), cardFile) == NULL) {
-        writeErrorLog("Card file format error: missing header lines");
-        fclose(cardFile);
-        return -1.0f;
-    }
-    
-    // Format: Card ID | Account ID | Card Number | Card Type | Expiry Date | Status | PIN Hash
-    char cardID[20] = {0}, accID[20] = {0}, cardNumberStr[30] = {0};
-    char cardType[20] = {0}, expiryDate[30] = {0}, status[20] = {0}, pinHash[70] = {0};
-    
-    while (fgets(line, sizeof(line), cardFile) != NULL) {
-        // Reset variables to avoid data leakage between iterations
-        memset(cardID, 0, sizeof(cardID));
-        memset(accID, 0, sizeof(accID));
-        memset(cardNumberStr, 0, sizeof(cardNumberStr));
-        memset(cardType, 0, sizeof(cardType));
-        memset(expiryDate, 0, sizeof(expiryDate));
-        memset(status, 0, sizeof(status));
-        memset(pinHash, 0, sizeof(pinHash));
-        
-        if (sscanf(line, "%19s | %19s | %29s | %19s | %29s | %19s | %69s", 
-                  cardID, accID, cardNumberStr, cardType, expiryDate, status, pinHash) >= 7) {
-            int storedCardNumber = atoi(cardNumberStr);
-            if (storedCardNumber == cardNumber) {
-                strncpy(accountID, accID, sizeof(accountID) - 1);
-                found = true;
-                break;
-            }
-        }
-    }
-    
-    fclose(cardFile);
-    
-    if (!found || strlen(accountID) == 0) {
+    StorageCard card;
+    if (!storageEngine()->get_card(cardNumber, &card)) {
         char errorMsg[100];
         sprintf(errorMsg, "Card number %d not found in database", cardNumber);
         writeErrorLog(errorMsg);
         return -1.0f; // Card number not found
     }
+    const char* accountID = card.accountID;
     
-    // Now get the balance from customer.txt using the account ID
-    const char* customerFilePath = getCustomerFilePath();
-    FILE* customerFile = fopen(customerFilePath, "r");
-    if (customerFile == NULL) {
-        char errorMsg[100];
-        sprintf(errorMsg, "Failed to open customer file at %s", customerFilePath);
-        writeErrorLog(errorMsg);
-        return -1.0f;
-    }
-    
-    float balance = -1.0f;
-    found = false;
-    
-    // Skip header lines
-    if (fgets(line, sizeof(line), customerFile) == NULL || fgets(line, sizeof(line), customerFile) == NULL) {
-        writeErrorLog("Customer file format error: missing header lines");
-        fclose(customerFile);
-        return -1.0f;
-    }
-    
-    // Format: Customer ID | Account ID | Account Holder Name | Type | Status | Balance
-    char customerID[20] = {0}, accIDFromFile[20] = {0}, holderName[100] = {0};
-    char type[30] = {0}, accountStatus[30] = {0}, balanceStr[30] = {0};
-    
-    while (fgets(line, sizeof(line), customerFile) != NULL) {
-        // Reset variables
-        memset(customerID, 0, sizeof(customerID));
-        memset(accIDFromFile, 0, sizeof(accIDFromFile));
-        memset(holderName, 0, sizeof(holderName));
-        memset(type, 0, sizeof(type));
-        memset(accountStatus, 0, sizeof(accountStatus));
-        memset(balanceStr, 0, sizeof(balanceStr));
-        
-        if (sscanf(line, "%19s | %19s | %99[^|] | %29s | %29s | %29s", 
-                   customerID, accIDFromFile, holderName, type, accountStatus, balanceStr) >= 6) {
-            if (strcmp(accIDFromFile, accountID) == 0) {
-                balance = atof(balanceStr);
-                found = true;
-                break;
-            }
-        }
-    }
-    
-    fclose(customerFile);
-    
-    if (!found) {
+    float balance;
+    if (!fetchAccountBalance(accountID, &balance)) {
         char errorMsg[100];
         sprintf(errorMsg, "Account ID %s not found in customer database", accountID);
         writeErrorLog(errorMsg);
+        return -1.0f;
     }
     
     return balance;
 }
 
-// Update account balance for a card
-bool updateBalance(int cardNumber, float newBalance) {
-    if (cardNumber <= 0) {
-        writeErrorLog("Invalid card number provided to updateBalance");
-        return false;
-    }
-    
-    if (newBalance < 0) {
-        char errorMsg[100];
-        sprintf(errorMsg, "Attempted to set negative balance (%.2f) for card %d", newBalance, cardNumber);
-        writeErrorLog(errorMsg);
-        return false;
-    }
-    
-    // First, find the account ID from the card number
-    const char* cardFilePath = getCardFilePath();
-    FILE* cardFile = fopen(cardFilePath, "r");
-    if (cardFile == NULL) {
-        char errorMsg[100];
-        sprintf(errorMsg, "Failed to open card file at %s", cardFilePath);
-        writeErrorLog(errorMsg);
-        return false;
+// Write an account's balance into customer.txt
+bool writeAccountBalance(const char* accountID, float newBalance) {
+    // Fixed-width rows have room for any balance, so overwrite just that column
+    if (customerIndexWriteBalance(accountID, newBalance)) {
+        return true;
     }
     
     char line[256] = {0};
-    char accountID[20] = {0};  // Increased size for safety
-    bool found = false;
-    
-    // Skip header lines
-    if (fgets(line, sizeof(line), cardFile) == NULL || fgets(line, sizeof(line), cardFile) == NULL) {
-        writeErrorLog("Card file format error: missing header lines");
-        fclose(cardFile);
-        return false;
-    }
-    
-    // Format: Card ID | Account ID | Card Number | Card Type | Expiry Date | Status | PIN Hash
-    char cardID[20] = {0}, accID[20] = {0}, cardNumberStr[30] = {0};
-    char cardType[20] = {0}, expiryDate[30] = {0}, status[20] = {0}, pinHash[70] = {0};
-    
-    while (fgets(line, sizeof(line), cardFile) != NULL) {
-        // Reset variables to avoid data leakage between iterations
-        memset(cardID, 0, sizeof(cardID));
-        memset(accID, 0, sizeof(accID));
-        memset(cardNumberStr, 0, sizeof(cardNumberStr));
-        memset(cardType, 0, sizeof(cardType));
-        memset(expiryDate, 0, sizeof(expiryDate));
-        memset(status, 0, sizeof(status));
-        memset(pinHash, 0, sizeof(pinHash));
-        
-        if (sscanf(line, "%19s | %19s | %29s | %19s | %29s | %19s | %69s", 
-                  cardID, accID, cardNumberStr, cardType, expiryDate, status, pinHash) >= 7) {
-            int storedCardNumber = atoi(cardNumberStr);
-            if (storedCardNumber == cardNumber) {
-                strncpy(accountID, accID, sizeof(accountID) - 1);
-                found = true;
-                break;
-            }
-        }
-    }
-    
-    fclose(cardFile);
-    
-    if (!found || strlen(accountID) == 0) {
-        char errorMsg[100];
-        sprintf(errorMsg, "Card number %d not found in database", cardNumber);
-        writeErrorLog(errorMsg);
-        return false;
-    }
     
-    // Now update the balance in the customer.txt file
-    const char* customerFilePath = getCustomerFilePath();
+    // Otherwise rewrite the customer file holding the account
+    const char* customerFilePath = getCustomerFilePathFor(accountID);
     FILE* customerFile = fopen(customerFilePath, "r");
     if (customerFile == NULL) {
         char errorMsg[100];
@@ -585,179 +254,331 @@ bool updateBalance(int cardNumber, float newBalance) {
         return false;
     }
     
-    // Replace original file with updated one
-    if (remove(customerFilePath) != 0) {
-        char errorMsg[100];
-        sprintf(errorMsg, "Failed to remove original customer file during balance update");
-        writeErrorLog(errorMsg);
-        remove(tempFileName);
-        return false;
-    }
-    
+    // Replace original file with updated one; rename is atomic, so readers
+    // (including the journal checkpointer) never see the file missing
     if (rename(tempFileName, customerFilePath) != 0) {
         char errorMsg[100];
         sprintf(errorMsg, "Failed to rename temporary customer file during balance update");
         writeErrorLog(errorMsg);
+        remove(tempFileName);
         return false;
     }
-    
-    char logMsg[100];
-    sprintf(logMsg, "Balance updated to %.2f for card %d (account %s)", newBalance, cardNumber, accountID);
-    writeAuditLog("ACCOUNT", logMsg);
+    customerIndexInvalidateAccount(accountID);
     
     return true;
 }
 
-// Log a transaction to the transactions log
-void logTransaction(int cardNumber, TransactionType type, float amount, bool success) {
-    if (cardNumber <= 0) {
-        writeErrorLog("Invalid card number provided to logTransaction");
-        return;
-    }
+// Update account balance for a card
+bool updateBalance(int cardNumber, float newBalance) {
+    return updateBalances(&cardNumber, &newBalance, 1);
+}
+
+// Update the balances of several cards atomically
+bool updateBalances(const int* cardNumbers, const float* newBalances, int count) {
+    StorageDelta deltas[STORAGE_MAX_DELTAS];
     
-    // Get account ID from card number
-    char accountID[20] = {0};  // Increased size for safety
+    if (cardNumbers == NULL || newBalances == NULL || count <= 0 || count > STORAGE_MAX_DELTAS) {
+        writeErrorLog("Invalid arguments provided to updateBalances");
+        return false;
+    }
     
-    const char* cardFilePath = getCardFilePath();
-    FILE* cardFile = fopen(cardFilePath, "r");
-    if (cardFile == NULL) {
-        char errorMsg[100];
-        sprintf(errorMsg, "Failed to open card file at %s for transaction logging", cardFilePath);
-        writeErrorLog(errorMsg);
-        
-        // Use fallback account ID based on card number
-        sprintf(accountID, "C%d", cardNumber);
-    } else {
-        char line[256] = {0};
-        bool found = false;
+    memset(deltas, 0, sizeof(deltas));
+    for (int i = 0; i < count; i++) {
+        if (cardNumbers[i] <= 0) {
+            writeErrorLog("Invalid card number provided to updateBalance");
+            return false;
+        }
         
-        // Skip header lines
-        if (fgets(line, sizeof(line), cardFile) != NULL && fgets(line, sizeof(line), cardFile) != NULL) {
-            char cardID[20] = {0}, accID[20] = {0}, cardNumberStr[30] = {0};
-            char cardType[20] = {0}, expiryDate[30] = {0}, status[20] = {0}, pinHash[70] = {0};
-            
-            while (fgets(line, sizeof(line), cardFile) != NULL) {
-                // Reset variables to avoid data leakage between iterations
-                memset(cardID, 0, sizeof(cardID));
-                memset(accID, 0, sizeof(accID));
-                memset(cardNumberStr, 0, sizeof(cardNumberStr));
-                memset(cardType, 0, sizeof(cardType));
-                memset(expiryDate, 0, sizeof(expiryDate));
-                memset(status, 0, sizeof(status));
-                memset(pinHash, 0, sizeof(pinHash));
-                
-                if (sscanf(line, "%19s | %19s | %29s | %19s | %29s | %19s | %69s", 
-                           cardID, accID, cardNumberStr, cardType, expiryDate, status, pinHash) >= 7) {
-                    int storedCardNumber = atoi(cardNumberStr);
-                    if (storedCardNumber == cardNumber) {
-                        strncpy(accountID, accID, sizeof(accountID) - 1);
-                        found = true;
-                        break;
-                    }
-                }
-            }
+        if (newBalances[i] < 0) {
+            char errorMsg[100];
+            sprintf(errorMsg, "Attempted to set negative balance (%.2f) for card %d", newBalances[i], cardNumbers[i]);
+            writeErrorLog(errorMsg);
+            return false;
         }
         
-        fclose(cardFile);
+        // Find the account ID from the card number
+        StorageCard card;
+        if (!storageEngine()->get_card(cardNumbers[i], &card)) {
+            char errorMsg[100];
+            sprintf(errorMsg, "Card number %d not found in database", cardNumbers[i]);
+            writeErrorLog(errorMsg);
+            return false;
+        }
+        strncpy(deltas[i].accountID, card.accountID, sizeof(deltas[i].accountID) - 1);
         
-        // If account ID not found, use card number as a fallback
-        if (!found || strlen(accountID) == 0) {
-            sprintf(accountID, "C%d", cardNumber);
+        float currentBalance;
+        if (!fetchAccountBalance(card.accountID, &currentBalance)) {
+            char errorMsg[100];
+            sprintf(errorMsg, "Account ID %s not found in customer database", card.accountID);
+            writeErrorLog(errorMsg);
+            return false;
         }
+        deltas[i].delta = newBalances[i] - currentBalance;
     }
     
-    // Generate transaction ID with safety against overflow
-    static int transactionCount = 0;
-    if (transactionCount >= INT_MAX - 60000) {
-        transactionCount = 0;  // Reset to avoid overflow
+    if (!storageEngine()->apply_delta(deltas, count)) {
+        writeErrorLog("Failed to update account balance");
+        return false;
     }
-    char transactionID[20] = {0};
-    sprintf(transactionID, "T%d", 60000 + (++transactionCount));
     
-    // Get current timestamp
-    char timestamp[30] = {0};
-    getCurrentTimestamp(timestamp, sizeof(timestamp));
+    for (int i = 0; i < count; i++) {
+        char logMsg[100];
+        sprintf(logMsg, "Balance updated to %.2f for card %d (account %s)", deltas[i].newBalance, cardNumbers[i], deltas[i].accountID);
+        writeAuditLog("ACCOUNT", logMsg);
+    }
     
-    // Get transaction type string
-    char transactionTypeStr[30] = {0};
-    switch (type) {
-        case TRANSACTION_BALANCE_CHECK:
-            strncpy(transactionTypeStr, "Balance Check", sizeof(transactionTypeStr) - 1);
-            break;
-        case TRANSACTION_DEPOSIT:
-            strncpy(transactionTypeStr, "Deposit", sizeof(transactionTypeStr) - 1);
-            break;
-        case TRANSACTION_WITHDRAWAL:
-            strncpy(transactionTypeStr, "Withdrawal", sizeof(transactionTypeStr) - 1);
-            break;
-        case TRANSACTION_PIN_CHANGE:
-            strncpy(transactionTypeStr, "PIN Change", sizeof(transactionTypeStr) - 1);
-            break;
-        case TRANSACTION_MINI_STATEMENT:
-            strncpy(transactionTypeStr, "Mini Statement", sizeof(transactionTypeStr) - 1);
-            break;
-        case TRANSACTION_MONEY_TRANSFER:
-            strncpy(transactionTypeStr, "Transfer", sizeof(transactionTypeStr) - 1);
-            break;
-        case TRANSACTION_CARD_REQUEST:
-            strncpy(transactionTypeStr, "Card Request", sizeof(transactionTypeStr) - 1);
-            break;
-        default:
-            strncpy(transactionTypeStr, "Other", sizeof(transactionTypeStr) - 1);
+    return true;
+}
+
+// Transfer between two cards with one lookup per card and account and a single commit
+TransferStatus transferBetweenCards(int senderCardNumber, int receiverCardNumber, float amount,
+                                    TransferOutcome* outcome) {
+    TransferOutcome local;
+    if (outcome == NULL) {
+        outcome = &local;
     }
+    memset(outcome, 0, sizeof(*outcome));
     
-    // Format transaction remarks
-    char remarks[50] = {0};
-    switch (type) {
-        case TRANSACTION_BALANCE_CHECK:
-        case TRANSACTION_MINI_STATEMENT:
-            strncpy(remarks, "Information Request", sizeof(remarks) - 1);
-            break;
-        case TRANSACTION_DEPOSIT:
-            strncpy(remarks, "Cash Deposit", sizeof(remarks) - 1);
-            break;
-        case TRANSACTION_WITHDRAWAL:
-            strncpy(remarks, "ATM Withdrawal", sizeof(remarks) - 1);
-            break;
-        case TRANSACTION_PIN_CHANGE:
-            strncpy(remarks, "Security Update", sizeof(remarks) - 1);
-            break;
-        case TRANSACTION_MONEY_TRANSFER:
-            strncpy(remarks, "Fund Transfer", sizeof(remarks) - 1);
-            break;
-        default:
-            strncpy(remarks, "General Transaction", sizeof(remarks) - 1);
+    if (amount <= 0) {
+        return TRANSFER_INVALID_AMOUNT;
     }
     
-    // Build consistent path for transactions log
-    char transactionsLogPath[256] = {0};
-    if (isTestingMode()) {
-        sprintf(transactionsLogPath, "%s/test_transaction.txt", TEST_DATA_DIR);
-    } else {
-        // Ensure consistent path handling for production
-        sprintf(transactionsLogPath, "%s/../logs/transactions.log", PROD_DATA_DIR);
+    StorageCard sender, receiver;
+    if (!storageEngine()->get_card(senderCardNumber, &sender)) {
+        return TRANSFER_SENDER_NOT_FOUND;
+    }
+    if (!storageEngine()->get_card(receiverCardNumber, &receiver)) {
+        return TRANSFER_RECEIVER_NOT_FOUND;
+    }
+    if (strcmp(receiver.status, "Active") != 0) {
+        return TRANSFER_RECEIVER_INACTIVE;
+    }
+    // Two deltas on one account would each be applied to the same old balance
+    if (strcmp(sender.accountID, receiver.accountID) == 0) {
+        return TRANSFER_SAME_ACCOUNT;
+    }
+    strcpy(outcome->senderAccountID, sender.accountID);
+    strcpy(outcome->receiverAccountID, receiver.accountID);
+    
+    AccountLockSet locks;
+    const char* accountIDs[2] = { sender.accountID, receiver.accountID };
+    if (!lockAccounts(&locks, accountIDs, 2)) {
+        return TRANSFER_BUSY;
+    }
+    
+    // Both balances are read under the locks, so nothing changes them before the commit
+    StorageAccount senderAccount, receiverAccount;
+    if (!storageEngine()->get_account(sender.accountID, &senderAccount)) {
+        unlockAccounts(&locks);
+        return TRANSFER_SENDER_NOT_FOUND;
+    }
+    if (!storageEngine()->get_account(receiver.accountID, &receiverAccount)) {
+        unlockAccounts(&locks);
+        return TRANSFER_RECEIVER_NOT_FOUND;
+    }
+    outcome->senderOldBalance = senderAccount.balance;
+    if (senderAccount.balance < amount) {
+        unlockAccounts(&locks);
+        return TRANSFER_INSUFFICIENT_FUNDS;
+    }
+    
+    // One journal record (or one undoable pair of writes) for both sides
+    StorageDelta deltas[2];
+    memset(deltas, 0, sizeof(deltas));
+    strcpy(deltas[0].accountID, sender.accountID);
+    deltas[0].delta = -amount;
+    strcpy(deltas[1].accountID, receiver.accountID);
+    deltas[1].delta = amount;
+    
+    bool committed = storageEngine()->apply_delta(deltas, 2);
+    unlockAccounts(&locks);
+    if (!committed) {
+        writeErrorLog("Failed to commit transfer");
+        return TRANSFER_FAILED;
     }
     
-    FILE* file = fopen(transactionsLogPath, "a");
-    if (file == NULL) {
+    outcome->senderNewBalance = deltas[0].newBalance;
+    outcome->receiverNewBalance = deltas[1].newBalance;
+    
+    char logMsg[150];
+    sprintf(logMsg, "Transferred %.2f from account %s (card %d) to account %s (card %d)",
+            amount, sender.accountID, senderCardNumber, receiver.accountID, receiverCardNumber);
+    writeAuditLog("ACCOUNT", logMsg);
+    return TRANSFER_OK;
+}
+
+// Append a withdrawal to the daily limit log; `held` drops a tracker hold
+static void appendWithdrawal(int cardNumber, float amount, bool held) {
+    ClockReading now;
+    clockRead(&now);
+    
+    // Format: cardNumber,date,amount,timestamp
+    // Written through at once: the tracker reads the line back below
+    char line[100];
+    snprintf(line, sizeof(line), "%d,%s,%.2f,%s\n", cardNumber, now.date, amount, now.timestamp);
+    bool logged = logWriteDirect(LOG_STREAM_WITHDRAWALS, line);
+    if (!logged) {
+        // If withdrawal log cannot be written, fall back to error log
+        writeErrorLog("Failed to write to withdrawal log");
+    }
+    
+    withdrawalTrackerRecord(cardNumber, amount, logged, held);
+}
+
+// Log withdrawal for daily limit tracking
+void logWithdrawal(int cardNumber, float amount) {
+    appendWithdrawal(cardNumber, amount, false);
+}
+
+// Log a withdrawal already held in the daily total with withdrawalTrackerHold
+void logHeldWithdrawal(int cardNumber, float amount) {
+    appendWithdrawal(cardNumber, amount, true);
+}
+
+// Get total daily withdrawals for a card
+float getDailyWithdrawals(int cardNumber) {
+    return withdrawalTrackerTotal(cardNumber);
+}
+
+// Set a card's status through the storage engine and audit the change
+static bool setCardStatus(int cardNumber, const char* status, const char* action) {
+    if (!storageEngine()->set_card_status(cardNumber, status)) {
         char errorMsg[100];
-        sprintf(errorMsg, "Failed to open transactions log file at %s", transactionsLogPath);
+        sprintf(errorMsg, "Card number %d not found for %s", cardNumber, action);
         writeErrorLog(errorMsg);
-        return;
+        return false;
     }
     
-    // Log the transaction
-    if (fprintf(file, "%-14s | %-10s | %-15s | %-8.2f | %-19s | %-17s | %s\n", 
-            transactionID, accountID, transactionTypeStr, amount, timestamp, 
-            success ? "Success" : "Failed", remarks) < 0) {
-        writeErrorLog("Failed to write to transactions log file");
+    char logMsg[100];
+    sprintf(logMsg, "Card %d %s", cardNumber, strcmp(status, "Active") == 0 ? "unblocked" : "blocked");
+    writeAuditLogSync("SECURITY", logMsg);
+    return true;
+}
+
+// Block a card by setting its status to "Blocked"
+bool blockCard(int cardNumber) {
+    return setCardStatus(cardNumber, "Blocked", "blocking");
+}
+
+// Unblock a card by setting its status to "Active"
+bool unblockCard(int cardNumber) {
+    return setCardStatus(cardNumber, "Active", "unblocking");
+}
+
+// A card's status, e.g. "Active" or "Blocked"
+bool getCardStatus(int cardNumber, char* status, size_t statusSize) {
+    StorageCard card;
+    if (status == NULL || statusSize == 0 || !storageEngine()->get_card(cardNumber, &card)) {
+        return false;
+    }
+    snprintf(status, statusSize, "%s", card.status);
+    return true;
+}
+
+// Add a Regular account with a zero balance and its first, active card
+bool addAccountWithCard(const char* customerID, const char* accountID, const char* cardID, const char* holderName,
+                        int cardNumber, const char* pinHash, const char* expiryDate) {
+    if (customerID == NULL || accountID == NULL || cardID == NULL || holderName == NULL || pinHash == NULL) {
+        return false;
+    }
+
+    StorageAccount account;
+    memset(&account, 0, sizeof(account));
+    snprintf(account.accountID, sizeof(account.accountID), "%s", accountID);
+    snprintf(account.customerID, sizeof(account.customerID), "%s", customerID);
+    snprintf(account.holderName, sizeof(account.holderName), "%s", holderName);
+    strcpy(account.type, "Regular");
+    strcpy(account.status, "Active");
+    account.balance = 0.0f;
+
+    StorageCard card;
+    memset(&card, 0, sizeof(card));
+    card.cardNumber = cardNumber;
+    snprintf(card.cardID, sizeof(card.cardID), "%s", cardID);
+    snprintf(card.accountID, sizeof(card.accountID), "%s", accountID);
+    strcpy(card.status, "Active");
+    snprintf(card.pinHash, sizeof(card.pinHash), "%s", pinHash);
+
+    if (!storageEngine()->add_account(&account, &card, expiryDate)) {
+        char errorMsg[150];
+        snprintf(errorMsg, sizeof(errorMsg), "Failed to add account %s with card %d", accountID, cardNumber);
+        writeErrorLog(errorMsg);
+        return false;
+    }
+    return true;
+}
+
+// Account ID for a card's log rows, or the card number if it has none
+static void transactionAccountID(int cardNumber, char* accountID, size_t size) {
+    StorageCard card;
+    if (storageEngine()->get_card(cardNumber, &card) && strlen(card.accountID) > 0) {
+        snprintf(accountID, size, "%s", card.accountID);
+    } else {
+        // If account ID not found, use card number as a fallback
+        snprintf(accountID, size, "C%d", cardNumber);
     }
+}
+
+// Log a transaction to the transactions log
+void logTransaction(int cardNumber, TransactionType type, float amount, bool success) {
+    if (cardNumber <= 0) {
+        writeErrorLog("Invalid card number provided to logTransaction");
+        return;
+    }
+    
+    char accountID[20] = {0};
+    transactionAccountID(cardNumber, accountID, sizeof(accountID));
+    
+    ClockReading now;
+    clockRead(&now);
     
-    fclose(file);
+    TransactionLogRecord record;
+    transactionLogInitRecord(&record, allocateId(ID_SEQUENCE_TRANSACTION), accountID, type, amount,
+                             now.second, success);
+    transactionLogAppend(&record, 1);
     
     char logMsg[150];
     sprintf(logMsg, "Transaction logged: %s %s for card %d, amount: %.2f, status: %s", 
-           transactionTypeStr, remarks, cardNumber, amount, success ? "Success" : "Failed");
+           transactionLogTypeName(type), transactionLogRemarkText(record.remark), cardNumber, amount,
+           success ? "Success" : "Failed");
+    writeInfoLog(logMsg);
+}
+
+// Log many transactions with one write to the transactions log
+void logTransactions(const TransactionLogEntry* entries, size_t count) {
+    if (entries == NULL || count == 0) {
+        return;
+    }
+    
+    TransactionLogRecord* records = (TransactionLogRecord*)malloc(count * sizeof(TransactionLogRecord));
+    if (records == NULL) {
+        writeErrorLog("Out of memory logging transactions");
+        return;
+    }
+    
+    ClockReading now;
+    clockRead(&now);
+    size_t succeeded = 0;
+    for (size_t i = 0; i < count; i++) {
+        char accountID[20] = {0};
+        if (entries[i].accountID != NULL && entries[i].accountID[0] != '\0') {
+            snprintf(accountID, sizeof(accountID), "%s", entries[i].accountID);
+        } else {
+            transactionAccountID(entries[i].cardNumber, accountID, sizeof(accountID));
+        }
+        if (entries[i].details != NULL) {
+            writeAuditLog("TRANSACTION", entries[i].details);
+        }
+        long long id = entries[i].transactionID != 0 ? entries[i].transactionID : allocateId(ID_SEQUENCE_TRANSACTION);
+        transactionLogInitRecord(&records[i], id, accountID, entries[i].type, entries[i].amount,
+                                 entries[i].time != 0 ? entries[i].time : now.second, entries[i].success);
+        succeeded += entries[i].success ? 1 : 0;
+    }
+    transactionLogAppend(records, count);
+    free(records);
+    
+    char logMsg[150];
+    sprintf(logMsg, "Transactions logged: %zu rows, %zu successful", count, succeeded);
     writeInfoLog(logMsg);
 }
 
@@ -779,59 +600,14 @@ bool validateRecipientAccount(int cardNumber, const char* accountID, const char*
     }
     
     // First, find the account ID associated with the card number
-    const char* cardFilePath = getCardFilePath();
-    FILE* cardFile = fopen(cardFilePath, "r");
-    if (cardFile == NULL) {
-        char errorMsg[100];
-        sprintf(errorMsg, "Failed to open card file at %s for recipient validation", cardFilePath);
-        writeErrorLog(errorMsg);
-        return false;
-    }
-    
-    char line[256] = {0};
-    char cardAccountID[20] = {0};  // Increased size for safety
-    bool found = false;
-    
-    // Skip header lines
-    if (fgets(line, sizeof(line), cardFile) == NULL || fgets(line, sizeof(line), cardFile) == NULL) {
-        writeErrorLog("Card file format error: missing header lines");
-        fclose(cardFile);
-        return false;
-    }
-    
-    // Format: Card ID | Account ID | Card Number | Card Type | Expiry Date | Status | PIN Hash
-    char cardID[20] = {0}, storedAccountID[20] = {0}, cardNumberStr[30] = {0};
-    char cardType[20] = {0}, expiryDate[30] = {0}, status[20] = {0}, pinHash[70] = {0};
-    
-    while (fgets(line, sizeof(line), cardFile) != NULL) {
-        // Reset variables to avoid data leakage
-        memset(cardID, 0, sizeof(cardID));
-        memset(storedAccountID, 0, sizeof(storedAccountID));
-        memset(cardNumberStr, 0, sizeof(cardNumberStr));
-        memset(cardType, 0, sizeof(cardType));
-        memset(expiryDate, 0, sizeof(expiryDate));
-        memset(status, 0, sizeof(status));
-        memset(pinHash, 0, sizeof(pinHash));
-        
-        int storedCardNumber;
-        if (sscanf(line, "%19s | %19s | %d | %19s | %29s | %19s | %69s",
-                  cardID, storedAccountID, &storedCardNumber, cardType, expiryDate, status, pinHash) >= 7) {
-            if (storedCardNumber == cardNumber) {
-                strncpy(cardAccountID, storedAccountID, sizeof(cardAccountID) - 1);
-                found = true;
-                break;
-            }
-        }
-    }
-    
-    fclose(cardFile);
-    
-    if (!found || strlen(cardAccountID) == 0) {
+    StorageCard card;
+    if (!storageEngine()->get_card(cardNumber, &card) || strlen(card.accountID) == 0) {
         char errorMsg[100];
         sprintf(errorMsg, "Card number %d not found during recipient account validation", cardNumber);
         writeErrorLog(errorMsg);
         return false;
     }
+    const char* cardAccountID = card.accountID;
     
     // Now check if the provided account ID matches the account ID associated with the card
     if (strcmp(cardAccountID, accountID) != 0) {
@@ -841,12 +617,12 @@ bool validateRecipientAccount(int cardNumber, const char* accountID, const char*
         return false;
     }
     
-    // Finally, check if the branch code matches
-    const char* customerFilePath = getCustomerFilePath();
-    FILE* customerFile = fopen(customerFilePath, "r");
-    if (customerFile == NULL) {
+    // Finally, check the branch code, which lives in accounting.txt
+    const char* accountingFilePath = getAccountingFilePath();
+    TableReader reader;
+    if (!tableReaderOpen(&reader, accountingFilePath, '|')) {
         char errorMsg[100];
-        sprintf(errorMsg, "Failed to open customer file at %s for branch validation", customerFilePath);
+        sprintf(errorMsg, "Failed to open accounting file at %s for branch validation", accountingFilePath);
         writeErrorLog(errorMsg);
         return false;
     }
@@ -854,44 +630,31 @@ bool validateRecipientAccount(int cardNumber, const char* accountID, const char*
     bool branchMatches = false;
     
     // Skip header lines
-    if (fgets(line, sizeof(line), customerFile) == NULL || fgets(line, sizeof(line), customerFile) == NULL) {
-        writeErrorLog("Customer file format error: missing header lines");
-        fclose(customerFile);
+    if (!tableReaderSkipLines(&reader, 2)) {
+        writeErrorLog("Accounting file format error: missing header lines");
+        tableReaderClose(&reader);
         return false;
     }
     
-    // Format (for Customer file): Customer ID | Account ID | Account Holder Name | Type | Status | Balance | Branch Code
-    char customerID[20] = {0}, accIDFromFile[20] = {0}, holderName[100] = {0};
-    char type[20] = {0}, accountStatus[20] = {0}, balanceStr[30] = {0}, branchCodeFromFile[20] = {0};
-    
-    while (fgets(line, sizeof(line), customerFile) != NULL) {
-        // Reset variables
-        memset(customerID, 0, sizeof(customerID));
-        memset(accIDFromFile, 0, sizeof(accIDFromFile));
-        memset(holderName, 0, sizeof(holderName));
-        memset(type, 0, sizeof(type));
-        memset(accountStatus, 0, sizeof(accountStatus));
-        memset(balanceStr, 0, sizeof(balanceStr));
-        memset(branchCodeFromFile, 0, sizeof(branchCodeFromFile));
-        
-        // Try to parse the branch code if it's included in the file format
-        if (sscanf(line, "%19s | %19s | %99[^|] | %19s | %19s | %29s | %19s",
-                   customerID, accIDFromFile, holderName, type, accountStatus, balanceStr, branchCodeFromFile) >= 7) {
-            if (strcmp(accIDFromFile, accountID) == 0) {
-                if (strcmp(branchCodeFromFile, branchCode) == 0) {
-                    branchMatches = true;
-                } else {
-                    char errorMsg[150];
-                    sprintf(errorMsg, "Branch code mismatch: provided %s, actual %s for account %s", 
-                           branchCode, branchCodeFromFile, accountID);
-                    writeErrorLog(errorMsg);
-                }
-                break;
+    // Format: Account ID | Customer ID | Account Type | Balance | Branch Code | Account Status | ...
+    TableRow row;
+    while (tableReaderNext(&reader, &row)) {
+        if (row.fieldCount >= 5 && tableFieldEquals(&row.fields[0], accountID)) {
+            if (tableFieldEquals(&row.fields[4], branchCode)) {
+                branchMatches = true;
+            } else {
+                char branchCodeFromFile[20];
+                tableFieldCopy(&row.fields[4], branchCodeFromFile, sizeof(branchCodeFromFile));
+                char errorMsg[150];
+                sprintf(errorMsg, "Branch code mismatch: provided %s, actual %s for account %s", 
+                       branchCode, branchCodeFromFile, accountID);
+                writeErrorLog(errorMsg);
             }
+            break;
         }
     }
     
-    fclose(customerFile);
+    tableReaderClose(&reader);
     
     // Log successful validation
     if (branchMatches) {
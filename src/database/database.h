@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <time.h>
 #include "../transaction/transaction_types.h"  // Include shared TransactionType definition
 
 // Card and account validation functions
@@ -23,17 +24,67 @@ bool getCardHolderPhone(int cardNumber, char* phone, size_t phoneSize);
 // Account balance functions
 float fetchBalance(int cardNumber);
 bool updateBalance(int cardNumber, float newBalance);
+bool updateBalances(const int* cardNumbers, const float* newBalances, int count);  // All or nothing
+bool fetchAccountBalance(const char* accountID, float* balance);
+bool writeAccountBalance(const char* accountID, float newBalance);  // Direct customer.txt write, bypasses the journal
+
+// Outcome of transferBetweenCards
+typedef enum {
+    TRANSFER_OK,
+    TRANSFER_INVALID_AMOUNT,
+    TRANSFER_SENDER_NOT_FOUND,
+    TRANSFER_RECEIVER_NOT_FOUND,
+    TRANSFER_RECEIVER_INACTIVE,
+    TRANSFER_SAME_ACCOUNT,
+    TRANSFER_INSUFFICIENT_FUNDS,
+    TRANSFER_BUSY,              // The account locks could not be taken
+    TRANSFER_FAILED             // The commit failed; neither balance changed
+} TransferStatus;
+
+typedef struct {
+    char senderAccountID[20];
+    char receiverAccountID[20];
+    float senderOldBalance;
+    float senderNewBalance;
+    float receiverNewBalance;
+} TransferOutcome;
+
+// Move money between two cards' accounts: both are read and validated under
+// their account locks, then both deltas are committed as one unit
+TransferStatus transferBetweenCards(int senderCardNumber, int receiverCardNumber, float amount,
+                                    TransferOutcome* outcome);
 
 // Withdrawal tracking functions
 void logWithdrawal(int cardNumber, float amount);
+void logHeldWithdrawal(int cardNumber, float amount);
 void logWithdrawalForLimit(int cardNumber, float amount, const char* date);
 float getDailyWithdrawals(int cardNumber);
 
 // Card status management functions
 bool blockCard(int cardNumber);
 bool unblockCard(int cardNumber);
+bool getCardStatus(int cardNumber, char* status, size_t statusSize);
+
+// Account creation through the storage engine; fails if the card or account exists
+bool addAccountWithCard(const char* customerID, const char* accountID, const char* cardID, const char* holderName,
+                        int cardNumber, const char* pinHash, const char* expiryDate);
 
 // Transaction logging function
 void logTransaction(int cardNumber, TransactionType type, float amount, bool success);
 
+// One row for logTransactions
+typedef struct {
+    int cardNumber;
+    const char* accountID;      // NULL to look it up from the card
+    TransactionType type;
+    float amount;
+    bool success;
+    long long transactionID;    // 0 to allocate one
+    time_t time;                // 0 for the current time
+    const char* details;        // Optional narrative for the audit log
+} TransactionLogEntry;
+
+// Log many transactions with a single write to the transactions log
+void logTransactions(const TransactionLogEntry* entries, size_t count);
+
 #endif // DATABASE_H
\ No newline at end of file
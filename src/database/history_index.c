@@ -0,0 +1,620 @@
+#include "history_index.h"
+#include "../common/paths.h"
+#include "../utils/logger.h"
+#include "../utils/log_archive.h"
+#include "../utils/clock_utils.h"
+#include "../utils/hash_utils.h"
+#include "transaction_log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#define HISTORY_INDEX_MAGIC "ATMHIST4"
+#define HISTORY_INDEX_VERSION 4
+
+// Records read from the log at a time
+#define HISTORY_READ_RECORDS 256
+
+// Save the index once this many bytes of the log were read since the last save
+#define HISTORY_SAVE_BYTES (1L << 20)
+
+// A record's sort key and where it is; the live log sorts after every
+// archived segment because it holds the latest records
+typedef struct {
+    int64_t time;                           // Transaction time, seconds since the epoch
+    int64_t offset;                         // In the uncompressed segment
+    uint32_t segment;                       // LOG_ACTIVE_SEGMENT for the live log
+    uint32_t reserved;
+} HistoryPosting;
+
+typedef struct {
+    char accountID[20];
+    bool used;
+    uint32_t count;
+    uint32_t capacity;
+    HistoryPosting* postings;               // Sorted by time, segment, then offset
+} HistoryEntry;
+
+// Saved index file: header, then for each of `entryCount` accounts a
+// PersistedEntry followed by its `count` postings
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t indexedSegment;                // Newest archived segment in the entries
+    uint64_t device;                        // Identity of the live log
+    uint64_t inode;
+    int64_t coveredSize;                    // Live log bytes reflected in the entries
+    uint64_t entryCount;
+} PersistedHeader;
+
+typedef struct {
+    char accountID[20];
+    uint32_t count;
+} PersistedEntry;
+
+// Index state, guarded by historyLock
+static pthread_mutex_t historyLock = PTHREAD_MUTEX_INITIALIZER;
+static HistoryEntry* entries = NULL;
+static size_t entrySize = 0;                // Always a power of two
+static size_t entryUsed = 0;
+static bool loaded = false;
+static char indexedPath[100] = "";
+static dev_t indexedDevice = 0;
+static ino_t indexedInode = 0;
+static uint32_t indexedSegment = 0;         // Newest archived segment indexed
+static long readOffset = 0;                 // End of the last complete record indexed
+static long savedOffset = 0;                // readOffset when the index was last saved; -1 to save on the next refresh
+
+static size_t entryFind(const HistoryEntry* table, size_t size, const char* accountID) {
+    size_t mask = size - 1;
+    size_t i = (size_t)fnv1a_hash(accountID) & mask;
+
+    while (table[i].used && strcmp(table[i].accountID, accountID) != 0) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+static bool entryGrow(void) {
+    size_t newSize = entrySize == 0 ? 256 : entrySize * 2;
+    HistoryEntry* table = (HistoryEntry*)calloc(newSize, sizeof(HistoryEntry));
+    if (table == NULL) {
+        return false;
+    }
+    for (size_t i = 0; i < entrySize; i++) {
+        if (entries[i].used) {
+            table[entryFind(table, newSize, entries[i].accountID)] = entries[i];
+        }
+    }
+    free(entries);
+    entries = table;
+    entrySize = newSize;
+    return true;
+}
+
+// The account's entry, created if missing; NULL when out of memory
+static HistoryEntry* entryGet(const char* accountID) {
+    if ((entryUsed + 1) * 2 > entrySize && !entryGrow()) {
+        return NULL;
+    }
+    HistoryEntry* entry = &entries[entryFind(entries, entrySize, accountID)];
+    if (!entry->used) {
+        memset(entry, 0, sizeof(*entry));
+        strncpy(entry->accountID, accountID, sizeof(entry->accountID) - 1);
+        entry->used = true;
+        entryUsed++;
+    }
+    return entry;
+}
+
+// The account's entry, or NULL if it has no rows
+static HistoryEntry* entryLookup(const char* accountID) {
+    if (entryUsed == 0) {
+        return NULL;
+    }
+    HistoryEntry* entry = &entries[entryFind(entries, entrySize, accountID)];
+    return entry->used ? entry : NULL;
+}
+
+static void entryClear(void) {
+    for (size_t i = 0; i < entrySize; i++) {
+        free(entries[i].postings);
+    }
+    free(entries);
+    entries = NULL;
+    entrySize = 0;
+    entryUsed = 0;
+}
+
+static bool entryReserve(HistoryEntry* entry, uint32_t count) {
+    if (count <= entry->capacity) {
+        return true;
+    }
+    uint32_t capacity = entry->capacity == 0 ? 16 : entry->capacity;
+    while (capacity < count) {
+        capacity *= 2;
+    }
+    HistoryPosting* postings = (HistoryPosting*)realloc(entry->postings, capacity * sizeof(HistoryPosting));
+    if (postings == NULL) {
+        return false;
+    }
+    entry->postings = postings;
+    entry->capacity = capacity;
+    return true;
+}
+
+static bool postingBefore(const HistoryPosting* posting, int64_t time, uint32_t segment, int64_t offset) {
+    if (posting->time != time) {
+        return posting->time < time;
+    }
+    if (posting->segment != segment) {
+        return posting->segment < segment;
+    }
+    return posting->offset < offset;
+}
+
+// Index of the first posting at or after (time, segment, offset)
+static uint32_t postingSearch(const HistoryEntry* entry, int64_t time, uint32_t segment, int64_t offset) {
+    uint32_t lo = 0;
+    uint32_t hi = entry->count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (postingBefore(&entry->postings[mid], time, segment, offset)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// Rows are normally appended in time order, so this is almost always an append
+static bool postingAdd(HistoryEntry* entry, int64_t time, uint32_t segment, int64_t offset) {
+    if (!entryReserve(entry, entry->count + 1)) {
+        return false;
+    }
+    uint32_t pos = entry->count;
+    if (pos > 0 && !postingBefore(&entry->postings[pos - 1], time, segment, offset)) {
+        pos = postingSearch(entry, time, segment, offset);
+        memmove(&entry->postings[pos + 1], &entry->postings[pos],
+                (entry->count - pos) * sizeof(HistoryPosting));
+    }
+    entry->postings[pos].time = time;
+    entry->postings[pos].offset = offset;
+    entry->postings[pos].segment = segment;
+    entry->postings[pos].reserved = 0;
+    entry->count++;
+    return true;
+}
+
+// Point the live log's postings at the segment it was rotated into; the
+// order is unchanged because that segment is newer than all the others
+static void postingsRotated(uint32_t segment) {
+    for (size_t i = 0; i < entrySize; i++) {
+        for (uint32_t j = 0; entries[i].used && j < entries[i].count; j++) {
+            if (entries[i].postings[j].segment == LOG_ACTIVE_SEGMENT) {
+                entries[i].postings[j].segment = segment;
+            }
+        }
+    }
+}
+
+// A record as the row of the transactions table it stands for
+static void recordToHistory(const TransactionLogRecord* record, HistoryRecord* history) {
+    transactionLogFormatID(record, history->transactionID, sizeof(history->transactionID));
+    memcpy(history->accountID, record->accountID, sizeof(history->accountID));
+    history->accountID[sizeof(history->accountID) - 1] = '\0';
+    snprintf(history->type, sizeof(history->type), "%s", transactionLogTypeName(record->type));
+    history->amount = (float)((double)record->amount / 100.0);
+    clockFormatTimestamp((time_t)record->time, history->timestamp, sizeof(history->timestamp));
+    snprintf(history->status, sizeof(history->status), "%s", record->success ? "Success" : "Failed");
+    snprintf(history->remarks, sizeof(history->remarks), "%s", transactionLogRemarkText(record->remark));
+}
+
+// Index one record of the log; padding that older versions wrote after a torn write has ID 0
+static bool indexRecord(const TransactionLogRecord* record, uint32_t segment, int64_t offset) {
+    char accountID[sizeof(record->accountID) + 1];
+    memcpy(accountID, record->accountID, sizeof(record->accountID));
+    accountID[sizeof(record->accountID)] = '\0';
+    if (record->id == 0 || accountID[0] == '\0') {
+        return true;
+    }
+    HistoryEntry* entry = entryGet(accountID);
+    if (entry == NULL || !postingAdd(entry, record->time, segment, offset)) {
+        writeErrorLog("Out of memory while indexing the transactions log");
+        return false;
+    }
+    return true;
+}
+
+// Index a segment from an offset to its end; needs historyLock
+static bool indexSegment(const LogSegment* segment, uint64_t start) {
+    LogSegmentReader* reader = logSegmentOpen(segment);
+    char header[TRANSACTION_LOG_HEADER_SIZE];
+    if (reader == NULL || logSegmentRead(reader, 0, header, sizeof(header)) != sizeof(header) ||
+        !transactionLogValidHeader(header)) {
+        logSegmentClose(reader);
+        writeErrorLog("Failed to read an archived transactions log segment");
+        return false;
+    }
+
+    TransactionLogRecord records[HISTORY_READ_RECORDS];
+    uint64_t offset = start > TRANSACTION_LOG_HEADER_SIZE ? start : TRANSACTION_LOG_HEADER_SIZE;
+    bool ok = true;
+    size_t got;
+    while (ok && (got = logSegmentRead(reader, offset, records, sizeof(records)) / sizeof(TransactionLogRecord)) > 0) {
+        for (size_t i = 0; ok && i < got; i++) {
+            ok = indexRecord(&records[i], segment->id, (int64_t)(offset + i * sizeof(TransactionLogRecord)));
+        }
+        offset += got * sizeof(TransactionLogRecord);
+    }
+    // Only a torn record may be left over
+    ok = ok && logSegmentSize(reader) - offset < sizeof(TransactionLogRecord);
+    logSegmentClose(reader);
+    if (!ok) {
+        writeErrorLog("Failed to read an archived transactions log segment");
+        return false;
+    }
+    if (segment->id > indexedSegment) {
+        indexedSegment = segment->id;
+    }
+    return true;
+}
+
+// Index every archived segment newer than indexedSegment; needs historyLock
+static void indexNewSegments(void) {
+    int count;
+    LogSegment* segments = logArchiveList(LOG_ARCHIVE_TRANSACTIONS, NULL, NULL, &count);
+    for (int i = 0; i < count; i++) {
+        if (segments[i].id > indexedSegment) {
+            indexSegment(&segments[i], 0);
+        }
+    }
+    free(segments);
+}
+
+// Index complete records from readOffset to the end of the live log
+static void indexFrom(FILE* file) {
+    if (readOffset < TRANSACTION_LOG_HEADER_SIZE) {
+        // The writer reports a log it cannot read
+        char header[TRANSACTION_LOG_HEADER_SIZE];
+        if (fread(header, sizeof(header), 1, file) != 1 || !transactionLogValidHeader(header)) {
+            return;
+        }
+        readOffset = TRANSACTION_LOG_HEADER_SIZE;
+    }
+
+    TransactionLogRecord records[HISTORY_READ_RECORDS];
+    size_t got;
+    fseek(file, readOffset, SEEK_SET);
+    // A record still being written is read whole next time
+    while ((got = fread(records, sizeof(TransactionLogRecord), HISTORY_READ_RECORDS, file)) > 0) {
+        for (size_t i = 0; i < got; i++) {
+            if (!indexRecord(&records[i], LOG_ACTIVE_SEGMENT, readOffset)) {
+                return;
+            }
+            readOffset += (long)sizeof(TransactionLogRecord);
+        }
+    }
+}
+
+// Load the saved index; if the live log was rotated since, refreshLocked
+// finishes it from the archive
+static bool loadSaved(const struct stat* logStat) {
+    FILE* file = fopen(getTransactionsIndexFilePath(), "rb");
+    if (file == NULL) {
+        return false;
+    }
+
+    PersistedHeader header;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 &&
+              memcmp(header.magic, HISTORY_INDEX_MAGIC, sizeof(header.magic)) == 0 &&
+              header.version == HISTORY_INDEX_VERSION && header.coveredSize >= 0;
+    bool sameLog = header.device == (uint64_t)logStat->st_dev && header.inode == (uint64_t)logStat->st_ino;
+    if (ok && sameLog) {
+        ok = header.coveredSize <= (int64_t)logStat->st_size;
+    }
+
+    // The covered part must end on a record boundary
+    if (ok && header.coveredSize > 0) {
+        ok = header.coveredSize >= TRANSACTION_LOG_HEADER_SIZE &&
+             (header.coveredSize - TRANSACTION_LOG_HEADER_SIZE) % (int64_t)sizeof(TransactionLogRecord) == 0;
+    }
+
+    PersistedEntry saved;
+    for (uint64_t i = 0; ok && i < header.entryCount; i++) {
+        HistoryEntry* entry;
+        ok = fread(&saved, sizeof(saved), 1, file) == 1 &&
+             memchr(saved.accountID, '\0', sizeof(saved.accountID)) != NULL &&
+             (entry = entryGet(saved.accountID)) != NULL && entry->count == 0 &&
+             entryReserve(entry, saved.count) &&
+             fread(entry->postings, sizeof(HistoryPosting), saved.count, file) == saved.count;
+        if (ok) {
+            entry->count = saved.count;
+        }
+    }
+    fclose(file);
+
+    if (!ok) {
+        entryClear();
+        return false;
+    }
+    indexedDevice = (dev_t)header.device;
+    indexedInode = (ino_t)header.inode;
+    indexedSegment = header.indexedSegment;
+    readOffset = (long)header.coveredSize;
+    savedOffset = readOffset;
+    return true;
+}
+
+// Write the index to a temporary file and move it into place; needs historyLock
+static bool saveLocked(void) {
+    if (!loaded) {
+        return false;
+    }
+
+    const char* path = getTransactionsIndexFilePath();
+    char tempPath[128];
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+
+    FILE* file = fopen(tempPath, "wb");
+    if (file == NULL) {
+        return false;
+    }
+
+    PersistedHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, HISTORY_INDEX_MAGIC, sizeof(header.magic));
+    header.version = HISTORY_INDEX_VERSION;
+    header.indexedSegment = indexedSegment;
+    header.device = (uint64_t)indexedDevice;
+    header.inode = (uint64_t)indexedInode;
+    header.coveredSize = readOffset;
+    header.entryCount = entryUsed;
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+
+    PersistedEntry saved;
+    for (size_t i = 0; ok && i < entrySize; i++) {
+        const HistoryEntry* entry = &entries[i];
+        if (entry->used) {
+            memset(&saved, 0, sizeof(saved));
+            memcpy(saved.accountID, entry->accountID, sizeof(saved.accountID));
+            saved.count = entry->count;
+            ok = fwrite(&saved, sizeof(saved), 1, file) == 1 &&
+                 fwrite(entry->postings, sizeof(HistoryPosting), entry->count, file) == entry->count;
+        }
+    }
+    ok = fclose(file) == 0 && ok;
+
+    // The index is only a cache of the log, so it is not synced
+    if (!ok || rename(tempPath, path) != 0) {
+        remove(tempPath);
+        writeErrorLog("Failed to save the transactions log index");
+        return false;
+    }
+    savedOffset = readOffset;
+    return true;
+}
+
+static void saveAtExit(void) {
+    historyIndexSave();
+}
+
+// Index the whole archive; the live log is read from the start afterwards; needs historyLock
+static void rebuildLocked(void) {
+    entryClear();
+    indexedSegment = 0;
+    readOffset = 0;
+    savedOffset = 0;
+    indexNewSegments();
+    if (indexedSegment > 0) {
+        savedOffset = -1;       // Save the archive's rows however little of the live log there is
+    }
+}
+
+// The live log was rotated: finish the file that was indexed from the
+// segment it became, then index any segments rotated after it; needs historyLock
+static bool followRotationLocked(void) {
+    if (indexedInode != 0) {
+        LogSegment segment;
+        if (!logArchiveFindFile(LOG_ARCHIVE_TRANSACTIONS, (uint64_t)indexedDevice, (uint64_t)indexedInode,
+                                &segment) || segment.id <= indexedSegment) {
+            return false;
+        }
+        postingsRotated(segment.id);
+        if (!indexSegment(&segment, (uint64_t)readOffset)) {
+            return false;
+        }
+    }
+    indexNewSegments();
+    readOffset = 0;
+    return true;
+}
+
+// Bring the index up to date with the archive and the live log; needs historyLock
+static void refreshLocked(void) {
+    static bool exitHandlerRegistered = false;
+    const char* path = getTransactionsLogFilePath();
+
+    // A missing live log is an empty one: it was just rotated or nothing was logged yet
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        memset(&st, 0, sizeof(st));
+    }
+
+    if (!loaded || strcmp(path, indexedPath) != 0) {
+        bool firstLoad = !loaded;
+        entryClear();
+        readOffset = 0;
+        savedOffset = 0;
+        snprintf(indexedPath, sizeof(indexedPath), "%s", path);
+        indexedDevice = st.st_dev;
+        indexedInode = st.st_ino;
+        // A saved index is only worth reading at startup; later the log itself changed
+        if (!firstLoad || !loadSaved(&st)) {
+            rebuildLocked();
+        }
+        loaded = true;
+
+        if (!exitHandlerRegistered) {
+            atexit(saveAtExit);
+            exitHandlerRegistered = true;
+        }
+    }
+
+    if (st.st_dev != indexedDevice || st.st_ino != indexedInode) {
+        if (!followRotationLocked()) {
+            rebuildLocked();
+        }
+        indexedDevice = st.st_dev;
+        indexedInode = st.st_ino;
+        savedOffset = -1;
+    } else if ((long)st.st_size < readOffset) {
+        // Replaced in place
+        rebuildLocked();
+    }
+
+    if (st.st_ino != 0 && (long)st.st_size > readOffset) {
+        FILE* file = fopen(path, "rb");
+        if (file != NULL) {
+            indexFrom(file);
+            fclose(file);
+        }
+    }
+
+    if (savedOffset < 0 || readOffset - savedOffset >= HISTORY_SAVE_BYTES) {
+        saveLocked();
+    }
+}
+
+// Read the records at `postings`; records that no longer belong to the
+// account are skipped. Postings are in time order, so each segment is
+// opened once in the usual case.
+static int readRows(const char* path, const char* accountID, const HistoryPosting* postings, int count,
+                    HistoryRecord* records) {
+    LogSegmentReader* reader = NULL;
+    uint32_t readerSegment = 0;
+    bool readerOpen = false;
+
+    int found = 0;
+    TransactionLogRecord record;
+    for (int i = 0; i < count; i++) {
+        if (!readerOpen || postings[i].segment != readerSegment) {
+            logSegmentClose(reader);
+            LogSegment segment;
+            memset(&segment, 0, sizeof(segment));
+            bool known = true;
+            if (postings[i].segment == LOG_ACTIVE_SEGMENT) {
+                segment.id = LOG_ACTIVE_SEGMENT;
+                snprintf(segment.path, sizeof(segment.path), "%s", path);
+            } else {
+                known = logArchiveFind(LOG_ARCHIVE_TRANSACTIONS, postings[i].segment, &segment);
+            }
+            reader = known ? logSegmentOpen(&segment) : NULL;
+            readerSegment = postings[i].segment;
+            readerOpen = true;
+        }
+
+        if (reader == NULL ||
+            logSegmentRead(reader, (uint64_t)postings[i].offset, &record, sizeof(record)) != sizeof(record)) {
+            continue;
+        }
+        if (record.id != 0 && strncmp(record.accountID, accountID, sizeof(record.accountID)) == 0) {
+            recordToHistory(&record, &records[found]);
+            found++;
+        }
+    }
+    logSegmentClose(reader);
+    return found;
+}
+
+int historyIndexRecent(const char* accountID, HistoryRecord* records, int max) {
+    if (accountID == NULL || records == NULL || max <= 0) {
+        return 0;
+    }
+
+    HistoryPosting* postings = (HistoryPosting*)malloc((size_t)max * sizeof(HistoryPosting));
+    if (postings == NULL) {
+        return 0;
+    }
+
+    // Copy the postings, then read the rows without holding the lock
+    int count = 0;
+    char path[100];
+
+    pthread_mutex_lock(&historyLock);
+    refreshLocked();
+    HistoryEntry* entry = loaded ? entryLookup(accountID) : NULL;
+    if (entry != NULL) {
+        count = entry->count < (uint32_t)max ? (int)entry->count : max;
+        memcpy(postings, &entry->postings[entry->count - (uint32_t)count], (size_t)count * sizeof(HistoryPosting));
+    }
+    snprintf(path, sizeof(path), "%s", indexedPath);
+    pthread_mutex_unlock(&historyLock);
+
+    int found = count > 0 ? readRows(path, accountID, postings, count, records) : 0;
+    free(postings);
+    return found;
+}
+
+int historyIndexQuery(const char* accountID, time_t from, time_t to, HistoryCursor* cursor,
+                      HistoryRecord* records, int max) {
+    if (accountID == NULL || cursor == NULL || records == NULL || max <= 0) {
+        return 0;
+    }
+
+    HistoryPosting* postings = (HistoryPosting*)malloc((size_t)max * sizeof(HistoryPosting));
+    if (postings == NULL) {
+        return 0;
+    }
+
+    int64_t fromKey = from != 0 ? (int64_t)from : INT64_MIN;
+    int64_t toKey = to != 0 ? (int64_t)to : INT64_MAX;
+    int count = 0;
+    char path[100];
+
+    pthread_mutex_lock(&historyLock);
+    refreshLocked();
+    HistoryEntry* entry = loaded ? entryLookup(accountID) : NULL;
+    if (entry != NULL) {
+        // Resume after the last row returned, but never before the start of the range
+        uint32_t pos = postingSearch(entry, fromKey, 0, INT64_MIN);
+        if (cursor->started) {
+            uint32_t resume = postingSearch(entry, cursor->time, cursor->segment, cursor->offset + 1);
+            pos = resume > pos ? resume : pos;
+        }
+        for (; count < max && pos < entry->count && entry->postings[pos].time <= toKey; pos++) {
+            postings[count++] = entry->postings[pos];
+            cursor->started = true;
+            cursor->time = entry->postings[pos].time;
+            cursor->segment = entry->postings[pos].segment;
+            cursor->offset = entry->postings[pos].offset;
+        }
+    }
+    snprintf(path, sizeof(path), "%s", indexedPath);
+    pthread_mutex_unlock(&historyLock);
+
+    int found = count > 0 ? readRows(path, accountID, postings, count, records) : 0;
+    free(postings);
+    return found;
+}
+
+bool historyIndexSave(void) {
+    pthread_mutex_lock(&historyLock);
+    bool ok = loaded && readOffset != savedOffset ? saveLocked() : loaded;
+    pthread_mutex_unlock(&historyLock);
+    return ok;
+}
+
+void historyIndexInvalidate(void) {
+    pthread_mutex_lock(&historyLock);
+    entryClear();
+    loaded = false;
+    indexedSegment = 0;
+    readOffset = 0;
+    savedOffset = 0;
+    pthread_mutex_unlock(&historyLock);
+}
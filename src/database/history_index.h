@@ -0,0 +1,82 @@
+#ifndef HISTORY_INDEX_H
+#define HISTORY_INDEX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * Per-account index of the records in the transactions log
+ *
+ * Each account keeps the positions of all its records, in the live log or
+ * in the archived segments it was rotated into, sorted by transaction
+ * time and then by position in the log, keyed on the exact account ID.
+ * Lookups binary search the time and then read only the records they
+ * return, so a page costs O(log n + page) regardless of how long the
+ * history is. Records appended since the last lookup, by this or any
+ * other process, are read on the next lookup; only the new bytes are
+ * read. The index is saved next to the log (transactions.idx) so a
+ * restart reads only the records added since it was written. When the
+ * log is rotated, its records are pointed at the new segment and indexing
+ * continues with the new live file; it is rebuilt from the archive if the
+ * log is replaced or shrinks.
+ */
+
+// One record of the transactions log, rendered as a row of its table
+typedef struct {
+    char transactionID[20];
+    char accountID[20];
+    char type[20];
+    float amount;
+    char timestamp[20];
+    char status[12];
+    char remarks[200];
+} HistoryRecord;
+
+// Position in an account's history, between two calls to historyIndexQuery.
+// Zero-initialise it to start at the beginning of the range.
+typedef struct {
+    bool started;
+    int64_t time;                           // Time of the last row returned
+    uint32_t segment;
+    int64_t offset;
+} HistoryCursor;
+
+/**
+ * Get an account's most recent transactions
+ *
+ * @param accountID The account
+ * @param records Receives up to `max` rows, oldest first
+ * @param max Room in `records`
+ * @return Number of rows stored, 0 if the account has none
+ */
+int historyIndexRecent(const char* accountID, HistoryRecord* records, int max);
+
+/**
+ * Page through an account's transactions within a time range, oldest first
+ *
+ * @param accountID The account
+ * @param from Earliest transaction time to return, 0 for no lower bound
+ * @param to Latest transaction time to return, 0 for no upper bound
+ * @param cursor Where the previous page ended; advanced past the rows returned
+ * @param records Receives up to `max` rows
+ * @param max Room in `records`
+ * @return Number of rows stored, 0 once the range is exhausted
+ */
+int historyIndexQuery(const char* accountID, time_t from, time_t to, HistoryCursor* cursor,
+                      HistoryRecord* records, int max);
+
+/**
+ * Write the index next to the transactions log
+ * Registered with atexit once the index is loaded.
+ *
+ * @return true on success
+ */
+bool historyIndexSave(void);
+
+/**
+ * Drop the index so the next lookup rebuilds it from the log
+ */
+void historyIndexInvalidate(void);
+
+#endif // HISTORY_INDEX_H
@@ -0,0 +1,233 @@
+#include "id_allocator.h"
+#include "transaction_log.h"
+#include "../common/paths.h"
+#include "../utils/logger.h"
+#include "../utils/table_reader.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+typedef struct {
+    const char* name;               // Key in the sequence file
+    long long first;                // Lowest ID ever issued
+    long long blockSize;            // IDs reserved per file update
+    bool memoryFallback;            // Issue IDs from memory when the file cannot be updated
+} SequenceInfo;
+
+// A sequence without an entry in the file starts after the largest ID
+// already in use. The legacy transactions file used IDs up to T50006.
+static const SequenceInfo sequenceInfo[ID_SEQUENCE_COUNT] = {
+    { "transaction", 60001, 100, true },
+    { "receipt",     100001, 100, true },
+    { "customer",    10001, 10, false },
+    { "account",     10001, 10, false },
+    { "card",        10001, 10, false },
+};
+
+typedef struct {
+    long long next;                 // Next ID to hand out
+    long long limit;                // First ID past the reserved block
+} SequenceBlock;
+
+// Reserved blocks, guarded by allocatorLock
+static pthread_mutex_t allocatorLock = PTHREAD_MUTEX_INITIALIZER;
+static SequenceBlock blocks[ID_SEQUENCE_COUNT];
+static int blockMode = -1;
+
+// Lock or unlock the whole sequence file, waiting for other processes
+static bool setFileLock(int fd, short type) {
+    struct flock region;
+    memset(&region, 0, sizeof(region));
+    region.l_type = type;
+    region.l_whence = SEEK_SET;
+
+    while (fcntl(fd, type == F_UNLCK ? F_SETLK : F_SETLKW, &region) != 0) {
+        if (errno != EINTR) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Largest `prefix`-number ID in one column of the card or customer files
+static long long largestTableId(bool cards, int column, char prefix) {
+    long long largest = 0;
+    for (int shard = 0; shard < getShardFileCount(); shard++) {
+        TableReader reader;
+        if (!tableReaderOpen(&reader, cards ? getCardShardFilePath(shard) : getCustomerShardFilePath(shard), '|')) {
+            continue;
+        }
+        tableReaderSkipLines(&reader, 2);
+
+        TableRow row;
+        while (tableReaderNext(&reader, &row)) {
+            FieldSlice* field = &row.fields[column];
+            if (row.fieldCount <= column || field->len < 2 || field->ptr[0] != prefix) {
+                continue;
+            }
+            FieldSlice digits = { field->ptr + 1, field->len - 1 };
+            long value;
+            if (tableFieldToLong(&digits, &value) && value > largest) {
+                largest = value;
+            }
+        }
+        tableReaderClose(&reader);
+    }
+    return largest;
+}
+
+// ID of the last record in the transactions log; IDs only grow, so it is the largest
+static long long largestTransactionId(void) {
+    int fd = open(getTransactionsLogFilePath(), O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+
+    long long largest = 0;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > TRANSACTION_LOG_HEADER_SIZE) {
+        off_t records = (st.st_size - TRANSACTION_LOG_HEADER_SIZE) / (off_t)sizeof(TransactionLogRecord);
+        TransactionLogRecord record;
+        // Padding records left by older versions have ID 0
+        while (records > 0 && largest == 0 &&
+               pread(fd, &record, sizeof(record),
+                     TRANSACTION_LOG_HEADER_SIZE + (records - 1) * (off_t)sizeof(record)) == (ssize_t)sizeof(record)) {
+            largest = (long long)record.id;
+            records--;
+        }
+    }
+    close(fd);
+    return largest;
+}
+
+// First ID of a sequence the file has no entry for
+static long long seedSequence(IdSequence sequence) {
+    long long largest = 0;
+    switch (sequence) {
+        case ID_SEQUENCE_TRANSACTION:
+            largest = largestTransactionId();
+            break;
+        case ID_SEQUENCE_CUSTOMER:
+            largest = largestTableId(false, 0, 'C');
+            break;
+        case ID_SEQUENCE_ACCOUNT:
+            largest = largestTableId(false, 1, 'A');
+            break;
+        case ID_SEQUENCE_CARD:
+            largest = largestTableId(true, 0, 'D');
+            break;
+        default:
+            break;
+    }
+    return largest >= sequenceInfo[sequence].first ? largest + 1 : sequenceInfo[sequence].first;
+}
+
+// Read `name next` lines; sequences without a line are seeded from the data files
+static void readSequences(int fd, long long* next) {
+    bool listed[ID_SEQUENCE_COUNT] = { false };
+    for (int i = 0; i < ID_SEQUENCE_COUNT; i++) {
+        next[i] = sequenceInfo[i].first;
+    }
+
+    char buffer[1024];
+    ssize_t len = pread(fd, buffer, sizeof(buffer) - 1, 0);
+    buffer[len > 0 ? len : 0] = '\0';
+
+    for (char* line = strtok(buffer, "\n"); line != NULL; line = strtok(NULL, "\n")) {
+        char name[32];
+        long long value;
+        if (line[0] == '#' || sscanf(line, "%31s %lld", name, &value) != 2) {
+            continue;
+        }
+        for (int i = 0; i < ID_SEQUENCE_COUNT; i++) {
+            if (strcmp(name, sequenceInfo[i].name) == 0) {
+                listed[i] = true;
+                // Never go back below the first ID, even if the file was edited
+                if (value > next[i]) {
+                    next[i] = value;
+                }
+            }
+        }
+    }
+
+    for (int i = 0; i < ID_SEQUENCE_COUNT; i++) {
+        if (!listed[i]) {
+            next[i] = seedSequence((IdSequence)i);
+        }
+    }
+}
+
+static bool writeSequences(int fd, const long long* next) {
+    char buffer[1024];
+    int len = snprintf(buffer, sizeof(buffer), "# Next unreserved ID of each sequence\n");
+    for (int i = 0; i < ID_SEQUENCE_COUNT; i++) {
+        len += snprintf(buffer + len, sizeof(buffer) - (size_t)len, "%s %lld\n", sequenceInfo[i].name, next[i]);
+    }
+
+    return pwrite(fd, buffer, (size_t)len, 0) == len && ftruncate(fd, len) == 0 && fdatasync(fd) == 0;
+}
+
+// Reserve the next block of a sequence in the file; needs allocatorLock
+static bool reserveBlock(IdSequence sequence) {
+    int fd = open(getIdSequenceFilePath(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    if (!setFileLock(fd, F_WRLCK)) {
+        close(fd);
+        return false;
+    }
+
+    long long next[ID_SEQUENCE_COUNT];
+    readSequences(fd, next);
+    long long first = next[sequence];
+    next[sequence] = first + sequenceInfo[sequence].blockSize;
+    bool ok = writeSequences(fd, next);
+
+    setFileLock(fd, F_UNLCK);
+    close(fd);
+
+    if (ok) {
+        blocks[sequence].next = first;
+        blocks[sequence].limit = next[sequence];
+    }
+    return ok;
+}
+
+long long allocateId(IdSequence sequence) {
+    if (sequence < 0 || sequence >= ID_SEQUENCE_COUNT) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&allocatorLock);
+    int mode = isTestingMode() ? 1 : 0;
+    if (mode != blockMode) {
+        memset(blocks, 0, sizeof(blocks));
+        blockMode = mode;
+    }
+
+    SequenceBlock* block = &blocks[sequence];
+    if (block->next >= block->limit && !reserveBlock(sequence)) {
+        if (!sequenceInfo[sequence].memoryFallback) {
+            // An ID from memory could repeat one another process hands out
+            pthread_mutex_unlock(&allocatorLock);
+            writeErrorLog("Failed to reserve IDs in the sequence file; no ID issued");
+            return 0;
+        }
+        writeErrorLog("Failed to reserve IDs in the sequence file; IDs are unique to this process only");
+        // Carry on from memory rather than stop issuing IDs
+        if (block->next < sequenceInfo[sequence].first) {
+            block->next = sequenceInfo[sequence].first;
+        }
+        block->limit = block->next + sequenceInfo[sequence].blockSize;
+    }
+    long long id = block->next++;
+    pthread_mutex_unlock(&allocatorLock);
+    return id;
+}
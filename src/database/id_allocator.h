@@ -0,0 +1,38 @@
+#ifndef ID_ALLOCATOR_H
+#define ID_ALLOCATOR_H
+
+/**
+ * Monotonic ID sequences shared by every ATM process
+ *
+ * The next free ID of each sequence is kept in id_sequences.txt in the
+ * data directory. A process reserves a block of IDs with one locked
+ * update of that file and hands them out from memory, so IDs never repeat
+ * across restarts or between ATMs sharing the data directory. IDs left in
+ * a block when a process exits are skipped, not reused. A sequence the
+ * file does not list yet starts after the largest ID already in the card,
+ * customer or transactions files. Production and test mode use separate
+ * files.
+ */
+
+typedef enum {
+    ID_SEQUENCE_TRANSACTION,        // Transaction IDs in the transactions log
+    ID_SEQUENCE_RECEIPT,            // Receipt numbers
+    ID_SEQUENCE_CUSTOMER,           // Customer IDs (C...)
+    ID_SEQUENCE_ACCOUNT,            // Account IDs (A...)
+    ID_SEQUENCE_CARD,               // Card IDs (D...)
+    ID_SEQUENCE_COUNT
+} IdSequence;
+
+/**
+ * Issue the next ID of a sequence
+ *
+ * If the sequence file cannot be updated the error is logged. Transaction
+ * and receipt IDs then continue from memory and are unique within this
+ * process only; customer, account and card IDs are not issued.
+ *
+ * @param sequence The sequence to draw from
+ * @return The ID, or 0 if none could be issued
+ */
+long long allocateId(IdSequence sequence);
+
+#endif // ID_ALLOCATOR_H
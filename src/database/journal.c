@@ -0,0 +1,1218 @@
+#include "journal.h"
+#include "database.h"
+#include "customer_index.h"
+#include "../common/paths.h"
+#include "../utils/logger.h"
+#include "../utils/file_utils.h"
+#include "../utils/hash_utils.h"
+#include "../config/config_manager.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/file.h>
+
+// Configuration keys
+#define CONFIG_JOURNAL_ENABLED "journal_enabled"
+#define CONFIG_JOURNAL_CHECKPOINT_MS "journal_checkpoint_interval_ms"
+
+#define DEFAULT_CHECKPOINT_MS 2000
+#define JOURNAL_RECORD_MAX 2048
+
+// Latest committed balance of an account that customer.txt may not have yet
+typedef struct {
+    char accountID[20];
+    float balance;
+    unsigned long seq;
+    bool used;
+} OverlayEntry;
+
+// A balance queued with its record; it enters the overlay once the record is on disk
+typedef struct {
+    char accountID[20];
+    float balance;
+    unsigned long seq;
+} QueuedBalance;
+
+// Journal state, guarded by journalLock
+static pthread_mutex_t journalLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t flushDone = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t checkpointWake = PTHREAD_COND_INITIALIZER;
+static bool journalReady = false;
+static bool journalFailed = false;
+static bool flushing = false;
+static bool stopRequested = false;
+static bool ownedElsewhere = false;       // Last open found another process holding the journal
+static int journalFd = -1;                // Holds an exclusive flock while the journal is open
+static int maintenanceFd = -1;            // Holds the same flock during offline maintenance
+
+// Records formatted but not yet written; the flushing committer takes the whole buffer
+static char* pending = NULL;
+static size_t pendingLen = 0;
+static size_t pendingCap = 0;
+static QueuedBalance* queued = NULL;      // Balances of the records in `pending`
+static size_t queuedCount = 0;
+static size_t queuedCap = 0;
+
+static unsigned long nextSeq = 1;
+static unsigned long bufferedSeq = 0;     // Highest sequence number in `pending`
+static unsigned long durableSeq = 0;      // Highest sequence number known to be on disk
+static unsigned long checkpointSeq = 0;   // Highest sequence number reflected in customer.txt
+static unsigned long snapshotSeq = 0;     // Highest sequence number reflected in the startup snapshot
+static bool snapshotRetained = false;     // Keep records after snapshotSeq through checkpoints
+
+// Client requests found at open, held until the request cache takes them
+static JournalRequest* replayedRequests = NULL;
+static size_t replayedCount = 0;
+static size_t replayedCap = 0;
+static unsigned long requestSeq = 0;        // Highest sequence number of a record carrying requests
+static unsigned long requestSyncedSeq = 0;  // Requests up to here are durable outside the journal
+static JournalRequestSyncFn requestSync = NULL;
+
+// Requests the calling thread attached for its next commit
+static _Thread_local JournalRequest* threadRequests = NULL;
+static _Thread_local int threadRequestCount = 0;
+static _Thread_local int threadRequestCap = 0;
+static _Thread_local bool threadRequestsSent = true;      // Taken by a commit or dropped
+static _Thread_local bool threadRequestsCommitted = false;
+static _Thread_local bool threadRequestsLost = false;     // An attach ran out of memory
+
+static OverlayEntry* overlay = NULL;
+static size_t overlaySize = 0;            // Always a power of two
+static size_t overlayUsed = 0;
+
+// Checkpointer thread; checkpointLock also guards the spans below
+static pthread_mutex_t checkpointLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t checkpointThread;
+static bool threadRunning = false;
+static int checkpointIntervalMs = DEFAULT_CHECKPOINT_MS;
+
+// Per customer file: it went from spanFrom to spanTo through checkpoints alone
+typedef struct {
+    FileSignature from;
+    FileSignature to;
+    bool known;
+} CheckpointSpan;
+
+static CheckpointSpan spans[MAX_DATA_SHARDS];
+
+// Find the overlay slot for an account, or the empty slot where it would go
+static size_t overlayFind(const OverlayEntry* table, size_t size, const char* accountID) {
+    size_t mask = size - 1;
+    size_t i = (size_t)fnv1a_hash(accountID) & mask;
+
+    while (table[i].used && strcmp(table[i].accountID, accountID) != 0) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+// Rebuild the overlay at `newSize` slots, dropping entries already checkpointed
+static bool overlayRebuild(size_t newSize, unsigned long dropUpTo) {
+    OverlayEntry* table = (OverlayEntry*)calloc(newSize, sizeof(OverlayEntry));
+    if (table == NULL) {
+        return false;
+    }
+
+    size_t used = 0;
+    for (size_t i = 0; i < overlaySize; i++) {
+        if (overlay[i].used && overlay[i].seq > dropUpTo) {
+            table[overlayFind(table, newSize, overlay[i].accountID)] = overlay[i];
+            used++;
+        }
+    }
+
+    free(overlay);
+    overlay = table;
+    overlaySize = newSize;
+    overlayUsed = used;
+    return true;
+}
+
+// Record the balance written by record `seq`, unless a later record already did
+static bool overlaySet(const char* accountID, float balance, unsigned long seq) {
+    if ((overlayUsed + 1) * 2 > overlaySize) {
+        if (!overlayRebuild(overlaySize == 0 ? 64 : overlaySize * 2, 0)) {
+            return false;
+        }
+    }
+
+    size_t slot = overlayFind(overlay, overlaySize, accountID);
+    OverlayEntry* entry = &overlay[slot];
+    if (entry->used && entry->seq > seq) {
+        return true;
+    }
+    if (!entry->used) {
+        strncpy(entry->accountID, accountID, sizeof(entry->accountID) - 1);
+        entry->accountID[sizeof(entry->accountID) - 1] = '\0';
+        entry->used = true;
+        overlayUsed++;
+    }
+    entry->balance = balance;
+    entry->seq = seq;
+    return true;
+}
+
+// Format one request: hex request ID:card:target:type:amount:old:new:batch
+static int formatRequest(const JournalRequest* request, bool separator, char* out, size_t outSize) {
+    int len = snprintf(out, outSize, "%s", separator ? ";" : "");
+    for (const char* c = request->requestID; *c != '\0' && (size_t)len < outSize; c++) {
+        len += snprintf(out + len, outSize - len, "%02x", (unsigned char)*c);
+    }
+    if ((size_t)len < outSize) {
+        len += snprintf(out + len, outSize - len, ":%d:%d:%d:%.2f:%.2f:%.2f:%d",
+                        request->cardNumber, request->targetCardNumber, request->type, request->amount,
+                        request->oldBalance, request->newBalance, request->batch ? 1 : 0);
+    }
+    return len;
+}
+
+// Format one record: seq|count|account:delta:balance;...|crc32, with a
+// |count|request;... section before the checksum when it carries requests.
+// A record that belongs to a batch carries the batch's last sequence number as seq/last.
+static int formatRecord(unsigned long seq, unsigned long last, const JournalDelta* deltas, int count,
+                        const JournalRequest* requests, int requestCount, char* out, size_t outSize) {
+    int len = last != 0 ? snprintf(out, outSize, "%lu/%lu|%d|", seq, last, count)
+                        : snprintf(out, outSize, "%lu|%d|", seq, count);
+
+    for (int i = 0; i < count && len > 0 && (size_t)len < outSize; i++) {
+        len += snprintf(out + len, outSize - len, "%s%s:%.2f:%.2f",
+                        i > 0 ? ";" : "", deltas[i].accountID, deltas[i].delta, deltas[i].newBalance);
+    }
+    if (requestCount > 0 && len > 0 && (size_t)len < outSize) {
+        len += snprintf(out + len, outSize - len, "|%d|", requestCount);
+    }
+    for (int i = 0; i < requestCount && len > 0 && (size_t)len < outSize; i++) {
+        len += formatRequest(&requests[i], i > 0, out + len, outSize - len);
+    }
+    if (len <= 0 || (size_t)len >= outSize) {
+        return -1;
+    }
+
+    uint32_t crc = crc32_checksum(out, (size_t)len);
+    len += snprintf(out + len, outSize - len, "|%08x\n", (unsigned int)crc);
+    if ((size_t)len >= outSize) {
+        return -1;
+    }
+    return len;
+}
+
+static bool parseRequest(const char* item, JournalRequest* request) {
+    memset(request, 0, sizeof(*request));
+    size_t idLen = strcspn(item, ":");
+    if (idLen == 0 || idLen % 2 != 0 || idLen / 2 >= sizeof(request->requestID)) {
+        return false;
+    }
+    for (size_t i = 0; i < idLen / 2; i++) {
+        unsigned int byte;
+        if (sscanf(item + i * 2, "%2x", &byte) != 1) {
+            return false;
+        }
+        request->requestID[i] = (char)byte;
+    }
+
+    int batch = 0;
+    if (sscanf(item + idLen, ":%d:%d:%d:%f:%f:%f:%d", &request->cardNumber, &request->targetCardNumber,
+               &request->type, &request->amount, &request->oldBalance, &request->newBalance, &batch) != 7) {
+        return false;
+    }
+    request->batch = batch != 0;
+    return true;
+}
+
+// Parse the count|request;... section of a record
+static bool parseRequests(char* field, JournalRequest* requests, int* count) {
+    int consumed = 0;
+    if (sscanf(field, "%d|%n", count, &consumed) < 1 || consumed == 0 ||
+        *count <= 0 || *count > JOURNAL_MAX_REQUESTS) {
+        return false;
+    }
+
+    char* saveptr = NULL;
+    char* item = strtok_r(field + consumed, ";", &saveptr);
+    for (int i = 0; i < *count; i++) {
+        if (item == NULL || !parseRequest(item, &requests[i])) {
+            return false;
+        }
+        item = strtok_r(NULL, ";", &saveptr);
+    }
+    return true;
+}
+
+// Parse and verify one record; fails on torn or corrupted lines
+// `last` is 0 for a record outside a batch
+static bool parseRecord(char* line, unsigned long* seq, unsigned long* last, JournalDelta* deltas, int* count,
+                        JournalRequest* requests, int* requestCount) {
+    size_t len = strlen(line);
+    if (len == 0 || line[len - 1] != '\n') {
+        return false;     // Torn write: the record never finished
+    }
+    line[--len] = '\0';
+
+    char* crcField = strrchr(line, '|');
+    if (crcField == NULL) {
+        return false;
+    }
+    uint32_t expected = (uint32_t)strtoul(crcField + 1, NULL, 16);
+    if (crc32_checksum(line, (size_t)(crcField - line)) != expected) {
+        return false;
+    }
+    *crcField = '\0';
+
+    int consumed = 0;
+    *last = 0;
+    if (sscanf(line, "%lu%n", seq, &consumed) < 1) {
+        return false;
+    }
+    if (line[consumed] == '/') {
+        int lastLen = 0;
+        if (sscanf(line + consumed + 1, "%lu%n", last, &lastLen) < 1 || *last < *seq) {
+            return false;
+        }
+        consumed += 1 + lastLen;
+    }
+    int countLen = 0;
+    if (sscanf(line + consumed, "|%d|%n", count, &countLen) < 1 || countLen == 0 ||
+        *count < 0 || *count > JOURNAL_MAX_DELTAS) {
+        return false;
+    }
+    consumed += countLen;
+
+    char* requestField = strchr(line + consumed, '|');
+    if (requestField != NULL) {
+        *requestField++ = '\0';
+    }
+
+    char* saveptr = NULL;
+    char* item = strtok_r(line + consumed, ";", &saveptr);
+    for (int i = 0; i < *count; i++) {
+        if (item == NULL || sscanf(item, "%19[^:]:%f:%f", deltas[i].accountID, &deltas[i].delta, &deltas[i].newBalance) != 3) {
+            return false;
+        }
+        item = strtok_r(NULL, ";", &saveptr);
+    }
+
+    *requestCount = 0;
+    if (requestField != NULL && !parseRequests(requestField, requests, requestCount)) {
+        return false;
+    }
+    return *count > 0 || *requestCount > 0;
+}
+
+static bool appendPending(const char* record, size_t len) {
+    if (pendingLen + len > pendingCap) {
+        size_t newCap = pendingCap == 0 ? 4096 : pendingCap;
+        while (newCap < pendingLen + len) {
+            newCap *= 2;
+        }
+        char* grown = (char*)realloc(pending, newCap);
+        if (grown == NULL) {
+            return false;
+        }
+        pending = grown;
+        pendingCap = newCap;
+    }
+    memcpy(pending + pendingLen, record, len);
+    pendingLen += len;
+    return true;
+}
+
+static bool queueBalance(const char* accountID, float balance, unsigned long seq) {
+    if (queuedCount == queuedCap) {
+        size_t newCap = queuedCap == 0 ? 64 : queuedCap * 2;
+        QueuedBalance* grown = (QueuedBalance*)realloc(queued, newCap * sizeof(QueuedBalance));
+        if (grown == NULL) {
+            return false;
+        }
+        queued = grown;
+        queuedCap = newCap;
+    }
+    QueuedBalance* entry = &queued[queuedCount++];
+    strncpy(entry->accountID, accountID, sizeof(entry->accountID) - 1);
+    entry->accountID[sizeof(entry->accountID) - 1] = '\0';
+    entry->balance = balance;
+    entry->seq = seq;
+    return true;
+}
+
+static bool writeAll(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t written = write(fd, data, len);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        len -= (size_t)written;
+    }
+    return true;
+}
+
+// Write and sync everything buffered so far. Called with journalLock held;
+// the lock is released during I/O so other sessions can keep queueing records.
+// The batch's balances enter the overlay before durableSeq covers them, so a
+// checkpoint up to durableSeq always sees them.
+static void flushPending(void) {
+    char* batch = pending;
+    size_t batchLen = pendingLen;
+    size_t batchCap = pendingCap;
+    QueuedBalance* balances = queued;
+    size_t balanceCount = queuedCount;
+    size_t balanceCap = queuedCap;
+    unsigned long upTo = bufferedSeq;
+
+    pending = NULL;
+    pendingLen = 0;
+    pendingCap = 0;
+    queued = NULL;
+    queuedCount = 0;
+    queuedCap = 0;
+    flushing = true;
+    pthread_mutex_unlock(&journalLock);
+
+    bool ok = writeAll(journalFd, batch, batchLen) && fdatasync(journalFd) == 0;
+
+    pthread_mutex_lock(&journalLock);
+    flushing = false;
+
+    // Reuse the batch buffer if nobody started a new one meanwhile
+    if (pending == NULL) {
+        pending = batch;
+        pendingCap = batchCap;
+    } else {
+        free(batch);
+    }
+
+    if (ok) {
+        for (size_t i = 0; i < balanceCount && ok; i++) {
+            ok = overlaySet(balances[i].accountID, balances[i].balance, balances[i].seq);
+        }
+        if (ok) {
+            durableSeq = upTo;
+        } else {
+            // The records are on disk, but a checkpoint cannot run ahead of the
+            // overlay; stop accepting commits rather than serve a stale balance
+            journalFailed = true;
+            writeErrorLog("Out of memory while tracking journaled balances");
+        }
+    } else {
+        journalFailed = true;
+        writeErrorLog("Balance journal write failed; balance updates are suspended");
+    }
+
+    if (queued == NULL) {
+        queued = balances;
+        queuedCap = balanceCap;
+    } else {
+        free(balances);
+    }
+    pthread_cond_broadcast(&flushDone);
+}
+
+// How many of `total` items fall into record `index` at `perRecord` a record
+static int itemsInRecord(int total, int index, int perRecord) {
+    int remaining = total - index * perRecord;
+    return remaining <= 0 ? 0 : remaining < perRecord ? remaining : perRecord;
+}
+
+// Queue `count` changes as one record, or as consecutive records of one batch
+// when there are more than fit in a record, and wait until they are on disk.
+// All records of a batch go into the same write. `requests` are spread over
+// the same records.
+static bool commitRecords(const JournalDelta* deltas, int count, const JournalRequest* requests, int requestCount) {
+    char record[JOURNAL_RECORD_MAX];
+
+    pthread_mutex_lock(&journalLock);
+    if (!journalReady || journalFailed) {
+        pthread_mutex_unlock(&journalLock);
+        return false;
+    }
+
+    int records = (count + JOURNAL_MAX_DELTAS - 1) / JOURNAL_MAX_DELTAS;
+    int requestRecords = (requestCount + JOURNAL_MAX_REQUESTS - 1) / JOURNAL_MAX_REQUESTS;
+    if (requestRecords > records) {
+        records = requestRecords;
+    }
+    unsigned long first = nextSeq;
+    unsigned long last = first + (unsigned long)records - 1;
+    size_t queuedFrom = pendingLen;
+    size_t balancesFrom = queuedCount;
+
+    for (int i = 0; i < records; i++) {
+        int len = formatRecord(first + (unsigned long)i, records > 1 ? last : 0,
+                               deltas + i * JOURNAL_MAX_DELTAS, itemsInRecord(count, i, JOURNAL_MAX_DELTAS),
+                               requests + i * JOURNAL_MAX_REQUESTS,
+                               itemsInRecord(requestCount, i, JOURNAL_MAX_REQUESTS), record, sizeof(record));
+        bool queuedRecord = len >= 0 && appendPending(record, (size_t)len);
+        for (int j = i * JOURNAL_MAX_DELTAS; j < count && j < (i + 1) * JOURNAL_MAX_DELTAS && queuedRecord; j++) {
+            queuedRecord = queueBalance(deltas[j].accountID, deltas[j].newBalance, first + (unsigned long)i);
+        }
+        if (!queuedRecord) {
+            // Drop the part of the batch already queued; nothing else was added meanwhile
+            pendingLen = queuedFrom;
+            queuedCount = balancesFrom;
+            pthread_mutex_unlock(&journalLock);
+            writeErrorLog("Failed to queue balance journal record");
+            return false;
+        }
+    }
+    nextSeq = last + 1;
+    bufferedSeq = last;
+    if (requestCount > 0) {
+        requestSeq = last;
+    }
+
+    // Group commit: whoever finds no flush in progress syncs every record queued so far
+    while (durableSeq < last && !journalFailed) {
+        if (flushing) {
+            pthread_cond_wait(&flushDone, &journalLock);
+        } else {
+            flushPending();
+        }
+    }
+
+    // The flush that covered these records already put their balances in the overlay
+    bool committed = durableSeq >= last;
+    pthread_mutex_unlock(&journalLock);
+    return committed;
+}
+
+// Commit with the requests the calling thread attached, which are then used up
+static bool commitWithRequests(const JournalDelta* deltas, int count) {
+    if (threadRequestsSent) {
+        return commitRecords(deltas, count, NULL, 0);
+    }
+
+    for (int i = 0; i < threadRequestCount; i++) {
+        if (!threadRequests[i].batch) {
+            threadRequests[i].newBalance = deltas[0].newBalance;
+            threadRequests[i].oldBalance = deltas[0].newBalance - deltas[0].delta;
+        }
+    }
+    bool committed = commitRecords(deltas, count, threadRequests, threadRequestCount);
+    threadRequestsSent = true;
+    threadRequestsCommitted = committed && !threadRequestsLost;
+    return committed;
+}
+
+bool journalCommit(const JournalDelta* deltas, int count) {
+    if (deltas == NULL || count <= 0 || count > JOURNAL_MAX_DELTAS) {
+        return false;
+    }
+    return commitWithRequests(deltas, count);
+}
+
+bool journalCommitBatch(const JournalDelta* deltas, int count) {
+    if (deltas == NULL || count <= 0) {
+        return false;
+    }
+    return commitWithRequests(deltas, count);
+}
+
+void journalAttachRequest(const JournalRequest* request) {
+    if (request == NULL) {
+        return;
+    }
+    if (threadRequestsSent) {
+        threadRequestCount = 0;
+        threadRequestsSent = false;
+        threadRequestsCommitted = false;
+        threadRequestsLost = false;
+    }
+
+    if (threadRequestCount == threadRequestCap) {
+        int newCap = threadRequestCap == 0 ? 4 : threadRequestCap * 2;
+        JournalRequest* grown = (JournalRequest*)realloc(threadRequests, (size_t)newCap * sizeof(JournalRequest));
+        if (grown == NULL) {
+            threadRequestsLost = true;
+            return;
+        }
+        threadRequests = grown;
+        threadRequestCap = newCap;
+    }
+    threadRequests[threadRequestCount++] = *request;
+}
+
+bool journalDetachRequests(void) {
+    bool committed = threadRequestsSent && threadRequestsCommitted;
+    free(threadRequests);
+    threadRequests = NULL;
+    threadRequestCount = 0;
+    threadRequestCap = 0;
+    threadRequestsSent = true;
+    return committed;
+}
+
+void journalTakeRequests(JournalRequestFn fn, void* context) {
+    pthread_mutex_lock(&journalLock);
+    JournalRequest* taken = replayedRequests;
+    size_t count = replayedCount;
+    replayedRequests = NULL;
+    replayedCount = 0;
+    replayedCap = 0;
+    pthread_mutex_unlock(&journalLock);
+
+    for (size_t i = 0; i < count && fn != NULL; i++) {
+        fn(&taken[i], context);
+    }
+    free(taken);
+}
+
+void journalSetRequestSync(JournalRequestSyncFn fn) {
+    pthread_mutex_lock(&journalLock);
+    requestSync = fn;
+    pthread_mutex_unlock(&journalLock);
+}
+
+bool journalLookupBalance(const char* accountID, float* balance) {
+    if (accountID == NULL) {
+        return false;
+    }
+
+    bool found = false;
+    pthread_mutex_lock(&journalLock);
+    if (journalReady && overlayUsed > 0) {
+        size_t slot = overlayFind(overlay, overlaySize, accountID);
+        if (overlay[slot].used) {
+            if (balance != NULL) {
+                *balance = overlay[slot].balance;
+            }
+            found = true;
+        }
+    }
+    pthread_mutex_unlock(&journalLock);
+    return found;
+}
+
+bool journalOwnedElsewhere(void) {
+    pthread_mutex_lock(&journalLock);
+    bool owned = ownedElsewhere;
+    pthread_mutex_unlock(&journalLock);
+    return owned;
+}
+
+bool journalIsOpen(void) {
+    pthread_mutex_lock(&journalLock);
+    bool open = journalReady;
+    pthread_mutex_unlock(&journalLock);
+    return open;
+}
+
+// Read the checkpoint file: the sequence number on the first line, then
+// one line per customer file with a known checkpoint span
+static unsigned long readCheckpointFile(CheckpointSpan* spansOut) {
+    unsigned long seq = 0;
+    if (spansOut != NULL) {
+        memset(spansOut, 0, MAX_DATA_SHARDS * sizeof(CheckpointSpan));
+    }
+
+    FILE* file = fopen(getJournalCheckpointFilePath(), "r");
+    if (file == NULL) {
+        return 0;
+    }
+    if (fscanf(file, "%lu", &seq) != 1) {
+        seq = 0;
+    }
+
+    char line[256];
+    while (spansOut != NULL && fgets(line, sizeof(line), file) != NULL) {
+        int shard;
+        unsigned long long dev[2], ino[2];
+        long long size[2], mtime[2];
+        long nsec[2];
+        if (sscanf(line, "span %d %llu %llu %lld %lld %ld %llu %llu %lld %lld %ld", &shard,
+                   &dev[0], &ino[0], &size[0], &mtime[0], &nsec[0],
+                   &dev[1], &ino[1], &size[1], &mtime[1], &nsec[1]) != 11 ||
+            shard < 0 || shard >= MAX_DATA_SHARDS) {
+            continue;
+        }
+        FileSignature* ends[2] = { &spansOut[shard].from, &spansOut[shard].to };
+        for (int i = 0; i < 2; i++) {
+            ends[i]->path = getCustomerShardFilePath(shard);
+            ends[i]->device = (dev_t)dev[i];
+            ends[i]->inode = (ino_t)ino[i];
+            ends[i]->size = (off_t)size[i];
+            ends[i]->mtime = (time_t)mtime[i];
+            ends[i]->mtimeNsec = nsec[i];
+        }
+        spansOut[shard].known = true;
+    }
+    fclose(file);
+    return seq;
+}
+
+// Atomically replace the checkpoint file with the new sequence number and
+// the current spans; needs checkpointLock
+static bool writeCheckpointSeq(unsigned long seq) {
+    const char* path = getJournalCheckpointFilePath();
+    char tempPath[256];
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+
+    FILE* file = fopen(tempPath, "w");
+    if (file == NULL) {
+        return false;
+    }
+    fprintf(file, "%lu\n", seq);
+    for (int shard = 0; shard < MAX_DATA_SHARDS; shard++) {
+        const FileSignature* from = &spans[shard].from;
+        const FileSignature* to = &spans[shard].to;
+        if (spans[shard].known) {
+            fprintf(file, "span %d %llu %llu %lld %lld %ld %llu %llu %lld %lld %ld\n", shard,
+                    (unsigned long long)from->device, (unsigned long long)from->inode, (long long)from->size,
+                    (long long)from->mtime, from->mtimeNsec,
+                    (unsigned long long)to->device, (unsigned long long)to->inode, (long long)to->size,
+                    (long long)to->mtime, to->mtimeNsec);
+        }
+    }
+    bool ok = fflush(file) == 0 && fsync(fileno(file)) == 0;
+    ok = fclose(file) == 0 && ok;
+
+    if (!ok || rename(tempPath, path) != 0) {
+        remove(tempPath);
+        return false;
+    }
+
+    // Make the rename itself durable
+    syncParentDirectory(path);
+    return true;
+}
+
+// Truncate the journal once every record on disk is checkpointed and, when a
+// snapshot depends on the journal, also covered by that snapshot. Needs journalLock.
+static void trimIfCovered(void) {
+    if (durableSeq != checkpointSeq || pendingLen != 0 || flushing || journalFd < 0) {
+        return;
+    }
+    if (snapshotRetained && snapshotSeq < durableSeq) {
+        return;
+    }
+    if (requestSeq > requestSyncedSeq) {
+        return;     // The journal is still the only durable copy of some request results
+    }
+    if (ftruncate(journalFd, 0) != 0) {
+        writeErrorLog("Failed to trim balance journal after checkpoint");
+    }
+}
+
+// Have the request sync function make the journaled requests durable, so
+// their records can be trimmed. Returns true if it synced any.
+static bool syncRequests(void) {
+    pthread_mutex_lock(&journalLock);
+    unsigned long upTo = requestSeq;
+    bool needed = requestSeq > requestSyncedSeq;
+    JournalRequestSyncFn sync = requestSync;
+    pthread_mutex_unlock(&journalLock);
+
+    // Every request in a record up to `upTo` was handed to the cache before
+    // its record was queued, so the sync covers them all
+    if (!needed || sync == NULL || !sync()) {
+        return false;
+    }
+
+    pthread_mutex_lock(&journalLock);
+    if (upTo > requestSyncedSeq) {
+        requestSyncedSeq = upTo;
+    }
+    pthread_mutex_unlock(&journalLock);
+    return true;
+}
+
+// Body of journalCheckpoint; the caller holds checkpointLock
+static bool checkpointLocked(void) {
+    pthread_mutex_lock(&journalLock);
+    if (!journalReady) {
+        pthread_mutex_unlock(&journalLock);
+        return false;
+    }
+
+    // Snapshot the overlay; commits may continue while customer.txt is written
+    unsigned long upTo = durableSeq;
+    size_t count = 0;
+    OverlayEntry* snapshot = NULL;
+    if (overlayUsed > 0) {
+        snapshot = (OverlayEntry*)malloc(overlayUsed * sizeof(OverlayEntry));
+        if (snapshot == NULL) {
+            pthread_mutex_unlock(&journalLock);
+            return false;
+        }
+        for (size_t i = 0; i < overlaySize; i++) {
+            if (overlay[i].used && overlay[i].seq <= upTo) {
+                snapshot[count++] = overlay[i];
+            }
+        }
+    }
+    pthread_mutex_unlock(&journalLock);
+
+    if (upTo == checkpointSeq) {
+        free(snapshot);
+
+        // Records kept only for their requests can go once those are synced
+        if (syncRequests()) {
+            pthread_mutex_lock(&journalLock);
+            trimIfCovered();
+            pthread_mutex_unlock(&journalLock);
+        }
+        return true;
+    }
+
+    // Only the customer files that received a balance need to be synced
+    bool ok = true;
+    bool touched[MAX_DATA_SHARDS] = { false };
+    FileSignature before[MAX_DATA_SHARDS];
+    for (size_t i = 0; i < count; i++) {
+        touched[getAccountShard(snapshot[i].accountID)] = true;
+    }
+    for (int shard = 0; shard < getShardFileCount(); shard++) {
+        if (touched[shard] && !readFileSignature(getCustomerShardFilePath(shard), &before[shard])) {
+            touched[shard] = false;
+            spans[shard].known = false;
+        }
+    }
+    for (size_t i = 0; i < count && ok; i++) {
+        ok = writeAccountBalance(snapshot[i].accountID, snapshot[i].balance);
+    }
+    free(snapshot);
+
+    for (int shard = 0; shard < getShardFileCount() && ok; shard++) {
+        ok = !touched[shard] || syncPath(getCustomerShardFilePath(shard));
+    }
+
+    // A span only grows while nothing else wrote the file since the last checkpoint
+    for (int shard = 0; shard < getShardFileCount() && ok; shard++) {
+        FileSignature after;
+        if (!touched[shard]) {
+            continue;
+        }
+        if (!readFileSignature(getCustomerShardFilePath(shard), &after)) {
+            spans[shard].known = false;
+            continue;
+        }
+        if (!spans[shard].known || !fileSignatureMatches(&spans[shard].to, &before[shard])) {
+            spans[shard].from = before[shard];
+            spans[shard].known = true;
+        }
+        spans[shard].to = after;
+    }
+    ok = ok && writeCheckpointSeq(upTo);
+    if (!ok) {
+        writeErrorLog("Balance journal checkpoint failed; will retry");
+        return false;
+    }
+    syncRequests();
+
+    pthread_mutex_lock(&journalLock);
+    checkpointSeq = upTo;
+    if (overlaySize > 0) {
+        overlayRebuild(overlaySize, upTo);
+    }
+
+    // Once every record on disk is covered by the checkpoint the journal can start over
+    trimIfCovered();
+    pthread_mutex_unlock(&journalLock);
+    return true;
+}
+
+bool journalCheckpoint(void) {
+    pthread_mutex_lock(&checkpointLock);
+    bool ok = checkpointLocked();
+    pthread_mutex_unlock(&checkpointLock);
+    return ok;
+}
+
+bool journalCheckpointThen(JournalCheckpointFn fn, void* context) {
+    pthread_mutex_lock(&checkpointLock);
+    bool ok = checkpointLocked();
+    if (ok) {
+        pthread_mutex_lock(&journalLock);
+        unsigned long seq = checkpointSeq;
+        pthread_mutex_unlock(&journalLock);
+
+        // Spans restart from the files as `fn` sees them
+        for (int shard = 0; shard < getShardFileCount(); shard++) {
+            spans[shard].known = readFileSignature(getCustomerShardFilePath(shard), &spans[shard].from);
+            spans[shard].to = spans[shard].from;
+        }
+        ok = writeCheckpointSeq(seq);
+
+        // No other checkpoint can touch customer.txt until fn returns
+        ok = ok && fn(seq, context);
+    }
+    pthread_mutex_unlock(&checkpointLock);
+    return ok;
+}
+
+void journalSetSnapshotSeq(unsigned long seq) {
+    pthread_mutex_lock(&journalLock);
+    snapshotSeq = seq;
+    snapshotRetained = true;
+    trimIfCovered();
+    pthread_mutex_unlock(&journalLock);
+}
+
+bool journalCheckpointSpan(int shard, FileSignature* from, FileSignature* to) {
+    if (shard < 0 || shard >= MAX_DATA_SHARDS) {
+        return false;
+    }
+    CheckpointSpan saved[MAX_DATA_SHARDS];
+    readCheckpointFile(saved);
+    if (!saved[shard].known) {
+        return false;
+    }
+    *from = saved[shard].from;
+    *to = saved[shard].to;
+    return true;
+}
+
+bool journalLockForMaintenance(void) {
+    pthread_mutex_lock(&journalLock);
+    bool locked = maintenanceFd >= 0;
+    bool inUse = false;
+    if (!locked && !journalReady) {
+        int fd = open(getJournalFilePath(), O_RDWR | O_CREAT | O_APPEND, 0644);
+        if (fd >= 0 && flock(fd, LOCK_EX | LOCK_NB) == 0) {
+            maintenanceFd = fd;
+            locked = true;
+        } else if (fd >= 0) {
+            inUse = errno == EWOULDBLOCK;
+            close(fd);
+        }
+    }
+    bool openHere = journalReady;
+    pthread_mutex_unlock(&journalLock);
+
+    if (!locked) {
+        writeErrorLog(openHere ? "Balance journal is open in this process; data files left unchanged"
+                      : inUse  ? "Balance journal is in use by another process; data files left unchanged"
+                               : "Failed to lock balance journal; data files left unchanged");
+    }
+    return locked;
+}
+
+void journalUnlockForMaintenance(void) {
+    pthread_mutex_lock(&journalLock);
+    if (maintenanceFd >= 0) {
+        close(maintenanceFd);
+        maintenanceFd = -1;
+    }
+    pthread_mutex_unlock(&journalLock);
+}
+
+bool journalEnabled(void) {
+    return !hasConfigKey(CONFIG_JOURNAL_ENABLED) || getConfigValueBool(CONFIG_JOURNAL_ENABLED);
+}
+
+static void* checkpointMain(void* arg) {
+    (void)arg;
+
+    pthread_mutex_lock(&journalLock);
+    while (!stopRequested) {
+        pthread_mutex_unlock(&journalLock);
+        journalCheckpoint();
+        pthread_mutex_lock(&journalLock);
+
+        if (stopRequested) {
+            break;
+        }
+
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += checkpointIntervalMs / 1000;
+        deadline.tv_nsec += (long)(checkpointIntervalMs % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&checkpointWake, &journalLock, &deadline);
+    }
+    pthread_mutex_unlock(&journalLock);
+    return NULL;
+}
+
+// A record of a batch read during replay, held until the batch is complete
+typedef struct {
+    unsigned long seq;
+    int count;
+    JournalDelta deltas[JOURNAL_MAX_DELTAS];
+    int requestCount;
+    JournalRequest requests[JOURNAL_MAX_REQUESTS];
+} StagedRecord;
+
+// Keep the requests of a complete record for the request cache, whether or
+// not its balances are replayed
+static bool replayRequests(const StagedRecord* record) {
+    if (record->requestCount == 0) {
+        return true;
+    }
+    if (replayedCount + (size_t)record->requestCount > replayedCap) {
+        size_t newCap = replayedCap == 0 ? 64 : replayedCap * 2;
+        JournalRequest* grown = (JournalRequest*)realloc(replayedRequests, newCap * sizeof(JournalRequest));
+        if (grown == NULL) {
+            return false;
+        }
+        replayedRequests = grown;
+        replayedCap = newCap;
+    }
+    memcpy(replayedRequests + replayedCount, record->requests, (size_t)record->requestCount * sizeof(JournalRequest));
+    replayedCount += (size_t)record->requestCount;
+    if (record->seq > requestSeq) {
+        requestSeq = record->seq;
+    }
+    return true;
+}
+
+// Load one replayed record into the overlay
+static bool replayRecord(unsigned long seq, const JournalDelta* deltas, int count, unsigned long from,
+                         unsigned long* lastSeq, unsigned long* covered) {
+    if (seq <= from) {
+        return true;
+    }
+    if (seq <= checkpointSeq) {
+        (*covered)++;
+    }
+    for (int i = 0; i < count; i++) {
+        if (!overlaySet(deltas[i].accountID, deltas[i].newBalance, seq)) {
+            return false;
+        }
+    }
+    if (seq > *lastSeq) {
+        *lastSeq = seq;
+    }
+    return true;
+}
+
+// Load records newer than `from` into the overlay and cut off a torn tail.
+// A batch is loaded only once its last record has been read; an unfinished
+// batch counts as part of the torn tail. `covered` counts the records found
+// between `from` and the checkpoint.
+// Returns the number of records replayed, or -1 on failure.
+static int replayJournal(unsigned long from, unsigned long* lastSeq, unsigned long* covered) {
+    FILE* file = fopen(getJournalFilePath(), "r");
+    if (file == NULL) {
+        return -1;
+    }
+
+    char line[JOURNAL_RECORD_MAX];
+    StagedRecord current;
+    StagedRecord* staged = NULL;
+    size_t stagedCount = 0;
+    size_t stagedCap = 0;
+    unsigned long last;
+    int replayed = 0;
+    long validEnd = 0;
+    bool torn = false;
+    bool ok = true;
+
+    while (ok && fgets(line, sizeof(line), file) != NULL) {
+        if (!parseRecord(line, &current.seq, &last, current.deltas, &current.count,
+                         current.requests, &current.requestCount)) {
+            torn = true;
+            break;
+        }
+
+        // Batch records must follow each other without a gap
+        if (stagedCount > 0 && (last == 0 || current.seq != staged[stagedCount - 1].seq + 1)) {
+            torn = true;
+            break;
+        }
+
+        if (last != 0 && current.seq != last) {
+            if (stagedCount == stagedCap) {
+                size_t newCap = stagedCap == 0 ? 64 : stagedCap * 2;
+                StagedRecord* grown = (StagedRecord*)realloc(staged, newCap * sizeof(StagedRecord));
+                if (grown == NULL) {
+                    ok = false;
+                    break;
+                }
+                staged = grown;
+                stagedCap = newCap;
+            }
+            staged[stagedCount++] = current;
+            continue;
+        }
+
+        // A record outside a batch, or the record completing one
+        for (size_t i = 0; i < stagedCount && ok; i++) {
+            ok = replayRecord(staged[i].seq, staged[i].deltas, staged[i].count, from, lastSeq, covered) &&
+                 replayRequests(&staged[i]);
+            replayed += staged[i].seq > from;
+        }
+        ok = ok && replayRecord(current.seq, current.deltas, current.count, from, lastSeq, covered) &&
+             replayRequests(&current);
+        replayed += current.seq > from;
+        stagedCount = 0;
+        validEnd = ftell(file);
+    }
+
+    fclose(file);
+    free(staged);
+    if (!ok) {
+        return -1;
+    }
+
+    if (torn || stagedCount > 0) {
+        char logMsg[150];
+        sprintf(logMsg, "Discarding incomplete balance journal tail after offset %ld", validEnd);
+        writeErrorLog(logMsg);
+        if (ftruncate(journalFd, (off_t)validEnd) != 0) {
+            return -1;
+        }
+    }
+    return replayed;
+}
+
+bool journalOpen(void) {
+    static bool exitHandlerRegistered = false;
+
+    pthread_mutex_lock(&journalLock);
+    if (journalReady) {
+        pthread_mutex_unlock(&journalLock);
+        return true;
+    }
+
+    // Balances taken from a snapshot are only current once the journal replays on top of them
+    bool snapshotBalances = snapshotRetained;
+
+    if (!journalEnabled()) {
+        pthread_mutex_unlock(&journalLock);
+        writeInfoLog("Balance journal disabled by configuration");
+        if (snapshotBalances) {
+            customerIndexInvalidate();
+        }
+        return false;
+    }
+
+    checkpointIntervalMs = getConfigValueInt(CONFIG_JOURNAL_CHECKPOINT_MS);
+    if (checkpointIntervalMs <= 0) {
+        checkpointIntervalMs = DEFAULT_CHECKPOINT_MS;
+    }
+
+    journalFd = open(getJournalFilePath(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (journalFd < 0) {
+        pthread_mutex_unlock(&journalLock);
+        writeErrorLog("Failed to open balance journal");
+        if (snapshotBalances) {
+            customerIndexInvalidate();
+        }
+        return false;
+    }
+
+    // Replay, trimming and the checkpoint file assume a single owner; a
+    // second process must not apply or truncate records it did not write
+    ownedElsewhere = false;
+    if (flock(journalFd, LOCK_EX | LOCK_NB) != 0) {
+        ownedElsewhere = errno == EWOULDBLOCK;
+        close(journalFd);
+        journalFd = -1;
+        pthread_mutex_unlock(&journalLock);
+        writeErrorLog(ownedElsewhere ? "Balance journal is in use by another process"
+                                     : "Failed to lock balance journal");
+        if (snapshotBalances) {
+            customerIndexInvalidate();
+        }
+        return false;
+    }
+
+    // Start from the snapshot if it is older than the checkpoint, so the
+    // records it has not seen are applied to its balances too
+    // No checkpoint touches the spans before journalReady is set
+    checkpointSeq = readCheckpointFile(spans);
+    unsigned long replayFrom = checkpointSeq;
+    if (snapshotRetained && snapshotSeq < replayFrom) {
+        replayFrom = snapshotSeq;
+    }
+    unsigned long lastSeq = checkpointSeq;
+    unsigned long covered = 0;
+    requestSeq = 0;
+    requestSyncedSeq = 0;
+    replayedCount = 0;
+    int replayed = replayJournal(replayFrom, &lastSeq, &covered);
+    if (replayed < 0) {
+        close(journalFd);
+        journalFd = -1;
+        pthread_mutex_unlock(&journalLock);
+        writeErrorLog("Failed to replay balance journal");
+        if (snapshotBalances) {
+            customerIndexInvalidate();
+        }
+        return false;
+    }
+    bool gap = covered != checkpointSeq - replayFrom;
+
+    nextSeq = lastSeq + 1;
+    bufferedSeq = lastSeq;
+    durableSeq = lastSeq;
+    journalFailed = false;
+    stopRequested = false;
+    journalReady = true;
+
+    // The checkpointer's first pass applies anything just replayed
+    threadRunning = pthread_create(&checkpointThread, NULL, checkpointMain, NULL) == 0;
+    pthread_mutex_unlock(&journalLock);
+
+    if (!threadRunning) {
+        writeErrorLog("Failed to start journal checkpointer; checkpointing at shutdown only");
+    }
+
+    // Records the snapshot missed are gone, so its balances cannot be trusted
+    if (gap) {
+        writeInfoLog("Balance journal no longer covers the snapshot; reloading customer.txt");
+        customerIndexInvalidate();
+    }
+
+    if (!exitHandlerRegistered) {
+        atexit(journalClose);
+        exitHandlerRegistered = true;
+    }
+
+    char logMsg[100];
+    sprintf(logMsg, "Balance journal opened, %d records replayed", replayed);
+    writeInfoLog(logMsg);
+    return true;
+}
+
+void journalClose(void) {
+    pthread_mutex_lock(&journalLock);
+    if (!journalReady) {
+        pthread_mutex_unlock(&journalLock);
+        return;
+    }
+    stopRequested = true;
+    pthread_cond_signal(&checkpointWake);
+    pthread_mutex_unlock(&journalLock);
+
+    if (threadRunning) {
+        pthread_join(checkpointThread, NULL);
+        threadRunning = false;
+    }
+
+    journalCheckpoint();
+
+    pthread_mutex_lock(&journalLock);
+    journalReady = false;
+    close(journalFd);
+    journalFd = -1;
+    free(pending);
+    pending = NULL;
+    pendingLen = 0;
+    pendingCap = 0;
+    free(queued);
+    queued = NULL;
+    queuedCount = 0;
+    queuedCap = 0;
+    free(overlay);
+    overlay = NULL;
+    overlaySize = 0;
+    overlayUsed = 0;
+    free(replayedRequests);
+    replayedRequests = NULL;
+    replayedCount = 0;
+    replayedCap = 0;
+    pthread_mutex_unlock(&journalLock);
+}
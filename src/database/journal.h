@@ -0,0 +1,213 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdbool.h>
+#include "../utils/file_utils.h"
+
+/**
+ * Write-ahead journal for balance changes
+ *
+ * Every committed balance change is appended to data/journal/ as one
+ * checksummed record, together with the client requests that caused it,
+ * before it is acknowledged. Concurrent committers share
+ * a single fdatasync (group commit). customer.txt is brought up to date by a
+ * background checkpointer; until then readers get the latest balance from
+ * the journal's in-memory overlay.
+ */
+
+// Maximum number of balance changes in one atomic journal record
+#define JOURNAL_MAX_DELTAS 8
+
+// One balance change inside a journal record
+typedef struct {
+    char accountID[20];
+    float delta;          // Signed change applied by this record
+    float newBalance;     // Balance after the change (what replay restores)
+} JournalDelta;
+
+// Maximum number of client requests in one journal record
+#define JOURNAL_MAX_REQUESTS 4
+
+// A client request committed together with the balance changes it caused
+typedef struct {
+    char requestID[40];
+    int cardNumber;
+    int targetCardNumber;
+    int type;             // TransactionType of the request
+    float amount;
+    float oldBalance;     // Balances of the request's own account
+    float newBalance;
+    bool batch;           // Posted by a batch rather than on its own
+} JournalRequest;
+
+// Called with each request found in the journal at open
+typedef void (*JournalRequestFn)(const JournalRequest* request, void* context);
+
+// Makes every journaled request durable elsewhere; false if it cannot yet
+typedef bool (*JournalRequestSyncFn)(void);
+
+/**
+ * Open the journal, replay records newer than the last checkpoint and start
+ * the background checkpointer
+ *
+ * Disabled when the configuration sets journal_enabled to false. The
+ * opening process holds an exclusive lock on the journal until it closes
+ * it; while another process holds it, opening fails and
+ * journalOwnedElsewhere reports why.
+ *
+ * @return true if the journal is open and accepting commits
+ */
+bool journalOpen(void);
+
+/**
+ * Check whether the last journalOpen failed because another process owns
+ * the journal
+ *
+ * Balances must not then be written around the journal, since the owner
+ * would overwrite them with its own at the next checkpoint.
+ */
+bool journalOwnedElsewhere(void);
+
+/**
+ * Check whether balance changes should go through the journal
+ */
+bool journalIsOpen(void);
+
+/**
+ * Durably record a set of balance changes as one atomic record
+ *
+ * Returns only once the record is on disk. All changes in the record are
+ * replayed together or not at all.
+ *
+ * @param deltas The balance changes
+ * @param count Number of changes (1..JOURNAL_MAX_DELTAS)
+ * @return true if the record was committed
+ */
+bool journalCommit(const JournalDelta* deltas, int count);
+
+/**
+ * Durably record any number of balance changes as one unit
+ *
+ * The changes are split over consecutive records that are written with a
+ * single write and sync. Replay applies the batch only if every one of its
+ * records reached the disk.
+ *
+ * @param deltas The balance changes
+ * @param count Number of changes (at least 1)
+ * @return true if the batch was committed
+ */
+bool journalCommitBatch(const JournalDelta* deltas, int count);
+
+/**
+ * Attach a client request to the next commit made by the calling thread
+ *
+ * The request is written into the same record as that commit's balance
+ * changes, so it is on disk exactly when its effect is. A request that is
+ * not a batch's takes its balances from the commit's first change, which
+ * is always the request's own account.
+ */
+void journalAttachRequest(const JournalRequest* request);
+
+/**
+ * Drop the calling thread's attached requests
+ *
+ * @return true if they went into a committed record
+ */
+bool journalDetachRequests(void);
+
+/**
+ * Hand over the requests found in the journal when it was opened
+ *
+ * Each is passed to `fn` once; later calls see only requests replayed by a
+ * later journalOpen.
+ */
+void journalTakeRequests(JournalRequestFn fn, void* context);
+
+/**
+ * Set the function that makes journaled requests durable elsewhere
+ *
+ * Records carrying requests are trimmed only after it succeeds. Without
+ * one they stay in the journal.
+ */
+void journalSetRequestSync(JournalRequestSyncFn fn);
+
+/**
+ * Get a committed balance that has not been checkpointed yet
+ *
+ * @param accountID The account to look up
+ * @param balance Receives the balance
+ * @return true if the journal holds a newer balance than customer.txt
+ */
+bool journalLookupBalance(const char* accountID, float* balance);
+
+/**
+ * Write all committed balances into customer.txt and trim the journal
+ *
+ * Runs periodically on the checkpointer thread; safe to call directly.
+ *
+ * @return true on success
+ */
+bool journalCheckpoint(void);
+
+// Called by journalCheckpointThen with the sequence number customer.txt now reflects
+typedef bool (*JournalCheckpointFn)(unsigned long seq, void* context);
+
+/**
+ * Run a checkpoint, then call `fn` before any later checkpoint can start
+ *
+ * While `fn` runs, the balances in customer.txt are exactly those of every
+ * record up to the sequence number it is given.
+ *
+ * @return false if the journal is not open, the checkpoint failed, or `fn` failed
+ */
+bool journalCheckpointThen(JournalCheckpointFn fn, void* context);
+
+/**
+ * Note that a snapshot holds every balance up to `seq`
+ *
+ * From then on the journal keeps records after `seq` through checkpoints,
+ * and journalOpen replays them on top of the snapshot's balances. Call
+ * before journalOpen when balances were loaded from a snapshot.
+ */
+void journalSetSnapshotSeq(unsigned long seq);
+
+/**
+ * Get the span of a customer file's history written by checkpoints alone
+ *
+ * The file went from `from` to `to` with nothing but journal checkpoints
+ * writing it. The span restarts from the current files whenever
+ * journalCheckpointThen runs, and is read from the checkpoint file, so it
+ * is available before journalOpen.
+ *
+ * @return false if no span is recorded for the shard
+ */
+bool journalCheckpointSpan(int shard, FileSignature* from, FileSignature* to);
+
+/**
+ * Take the journal's ownership lock for offline changes to the data files
+ *
+ * Fails while another process owns the journal, since its overlay and
+ * checkpointer would keep writing the files being changed, and while this
+ * process has the journal open. Release with journalUnlockForMaintenance.
+ *
+ * @return true if the lock is held
+ */
+bool journalLockForMaintenance(void);
+
+/**
+ * Release the lock taken by journalLockForMaintenance
+ */
+void journalUnlockForMaintenance(void);
+
+/**
+ * Check whether the configuration allows the journal (journal_enabled)
+ */
+bool journalEnabled(void);
+
+/**
+ * Stop the checkpointer, run a final checkpoint and close the journal
+ * Registered with atexit by journalOpen.
+ */
+void journalClose(void);
+
+#endif // JOURNAL_H
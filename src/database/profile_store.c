@@ -0,0 +1,471 @@
+#include "profile_store.h"
+#include "../common/paths.h"
+#include "../utils/logger.h"
+#include "../utils/table_reader.h"
+#include "../utils/file_utils.h"
+#include "../utils/hash_utils.h"
+#include "../config/config_manager.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/stat.h>
+
+// Configuration keys
+#define CONFIG_FLUSH_INTERVAL_MS "profile_store_flush_interval_ms"
+#define CONFIG_MAX_PENDING "profile_store_max_pending"
+
+#define DEFAULT_FLUSH_INTERVAL_MS 1000
+#define DEFAULT_MAX_PENDING 256
+#define PROFILE_KEY_MAX 32
+
+// How each table is laid out on disk
+typedef struct {
+    const char* name;
+    const char* (*path)(void);
+    const char* header;
+    const char* separator;
+} TableDescriptor;
+
+static const TableDescriptor tables[PROFILE_TABLE_COUNT] = {
+    [PROFILE_TABLE_CUSTOMERS] = {
+        "customer_profiles", getCustomerProfilesFilePath,
+        "Customer ID | Name | DOB | Address | Email | Mobile Number | KYC Status | Status | Created At | Last Login",
+        "------------|------|-----|---------|-------|---------------|------------|--------|------------|-----------"
+    },
+    [PROFILE_TABLE_ACCOUNTS] = {
+        "accounting", getAccountingFilePath,
+        "Account ID | Customer ID | Account Type | Balance   | Branch Code | Account Status | Created At           | Last Transaction",
+        "-----------|-------------|--------------|-----------|------------|---------------|---------------------|-----------------------"
+    },
+    [PROFILE_TABLE_WALLETS] = {
+        "virtual_wallet", getVirtualWalletFilePath,
+        "Wallet ID | User ID  | Balance  | Last Refill Time     | Refill Amount",
+        "----------|----------|----------|---------------------|-------------"
+    }
+};
+
+// One queued row
+typedef struct {
+    char key[PROFILE_KEY_MAX];
+    char* row;
+} PendingRecord;
+
+typedef struct {
+    PendingRecord* records;
+    size_t count;
+    size_t capacity;
+} RecordList;
+
+// Queued rows, guarded by storeLock. A flush moves a table's list to
+// `inflight`, where lookups still see it until the file has been replaced.
+static pthread_mutex_t storeLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t flusherWake = PTHREAD_COND_INITIALIZER;
+static RecordList pendingRecords[PROFILE_TABLE_COUNT];
+static RecordList inflightRecords[PROFILE_TABLE_COUNT];
+static size_t pendingCount = 0;
+
+// Serialises flushes so each table file has a single writer
+static pthread_mutex_t flushLock = PTHREAD_MUTEX_INITIALIZER;
+
+// Background flusher
+static pthread_t flusherThread;
+static bool started = false;
+static bool threadRunning = false;
+static bool stopRequested = false;
+static int flushIntervalMs = DEFAULT_FLUSH_INTERVAL_MS;
+static size_t maxPending = DEFAULT_MAX_PENDING;
+
+static void freeRecordList(RecordList* list) {
+    for (size_t i = 0; i < list->count; i++) {
+        free(list->records[i].row);
+    }
+    free(list->records);
+    list->records = NULL;
+    list->count = 0;
+    list->capacity = 0;
+}
+
+static bool reserveRecord(RecordList* list) {
+    if (list->count < list->capacity) {
+        return true;
+    }
+    size_t newCapacity = list->capacity == 0 ? 16 : list->capacity * 2;
+    PendingRecord* grown = (PendingRecord*)realloc(list->records, newCapacity * sizeof(PendingRecord));
+    if (grown == NULL) {
+        return false;
+    }
+    list->records = grown;
+    list->capacity = newCapacity;
+    return true;
+}
+
+// Index of the queued record with this key, or -1. The queue is bounded by
+// profile_store_max_pending, so a scan is cheaper than keeping a second index.
+static long findRecord(const RecordList* list, const char* key) {
+    for (size_t i = 0; i < list->count; i++) {
+        if (strcmp(list->records[i].key, key) == 0) {
+            return (long)i;
+        }
+    }
+    return -1;
+}
+
+// Check whether column `column` of a pipe-delimited row equals `value` once trimmed
+static bool rowColumnEquals(const char* row, int column, const char* value) {
+    const char* start = row;
+    for (int i = 0; i < column; i++) {
+        start = strchr(start, '|');
+        if (start == NULL) {
+            return false;
+        }
+        start++;
+    }
+
+    const char* end = strchr(start, '|');
+    if (end == NULL) {
+        end = start + strlen(start);
+    }
+    while (start < end && (*start == ' ' || *start == '\t')) {
+        start++;
+    }
+    while (end > start && (end[-1] == ' ' || end[-1] == '\t')) {
+        end--;
+    }
+
+    size_t len = strlen(value);
+    return (size_t)(end - start) == len && memcmp(start, value, len) == 0;
+}
+
+// Slot of the batch record whose key matches `key`, or -1
+static long batchIndexFind(const long* index, size_t slots, const RecordList* batch, const char* key, size_t keyLen) {
+    size_t mask = slots - 1;
+    for (size_t i = (size_t)fnv1a_hash_bytes(key, keyLen) & mask; index[i] >= 0; i = (i + 1) & mask) {
+        const char* candidate = batch->records[index[i]].key;
+        if (strlen(candidate) == keyLen && memcmp(candidate, key, keyLen) == 0) {
+            return index[i];
+        }
+    }
+    return -1;
+}
+
+// Rewrite one table file once with every record of the batch applied
+static bool rewriteTableFile(ProfileTable table, const char* path, const RecordList* batch) {
+    const TableDescriptor* desc = &tables[table];
+
+    // Index the batch by key so each existing row costs a single probe
+    size_t slots = 16;
+    while (slots < batch->count * 2) {
+        slots <<= 1;
+    }
+    long* index = (long*)malloc(slots * sizeof(long));
+    bool* written = (bool*)calloc(batch->count, sizeof(bool));
+    if (index == NULL || written == NULL) {
+        free(index);
+        free(written);
+        return false;
+    }
+    for (size_t i = 0; i < slots; i++) {
+        index[i] = -1;
+    }
+    for (size_t i = 0; i < batch->count; i++) {
+        size_t slot = (size_t)fnv1a_hash_bytes(batch->records[i].key, strlen(batch->records[i].key)) & (slots - 1);
+        while (index[slot] >= 0) {
+            slot = (slot + 1) & (slots - 1);
+        }
+        index[slot] = (long)i;
+    }
+
+    char tempPath[256];
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+    FILE* out = fopen(tempPath, "w");
+    if (out == NULL) {
+        free(index);
+        free(written);
+        return false;
+    }
+
+    TableReader reader;
+    bool haveFile = tableReaderOpen(&reader, path, '|');
+    if (haveFile && reader.size > 0) {
+        // Keep the existing header lines exactly as they are
+        tableReaderSkipLines(&reader, 2);
+        fwrite(reader.data, 1, reader.pos, out);
+        if (reader.data[reader.pos - 1] != '\n') {
+            fputc('\n', out);
+        }
+
+        TableRow row;
+        while (tableReaderNext(&reader, &row)) {
+            long match = batchIndexFind(index, slots, batch, row.fields[0].ptr, row.fields[0].len);
+            if (match >= 0) {
+                fprintf(out, "%s\n", batch->records[match].row);
+                written[match] = true;
+            } else {
+                fwrite(row.line, 1, row.lineLen, out);
+                fputc('\n', out);
+            }
+        }
+    } else {
+        fprintf(out, "%s\n%s\n", desc->header, desc->separator);
+    }
+    if (haveFile) {
+        tableReaderClose(&reader);
+    }
+
+    // Records not already in the file are new
+    for (size_t i = 0; i < batch->count; i++) {
+        if (!written[i]) {
+            fprintf(out, "%s\n", batch->records[i].row);
+        }
+    }
+    free(index);
+    free(written);
+
+    bool ok = fflush(out) == 0 && fsync(fileno(out)) == 0;
+    ok = fclose(out) == 0 && ok;
+    if (!ok || rename(tempPath, path) != 0) {
+        remove(tempPath);
+        return false;
+    }
+    syncParentDirectory(path);
+    return true;
+}
+
+// Put a failed batch back in front of anything queued since; called with storeLock held
+static void requeueBatch(ProfileTable table) {
+    RecordList* batch = &inflightRecords[table];
+    RecordList* queued = &pendingRecords[table];
+    RecordList merged = { NULL, 0, 0 };
+
+    merged.capacity = batch->count + queued->count;
+    merged.records = (PendingRecord*)malloc(merged.capacity * sizeof(PendingRecord));
+    if (merged.records == NULL) {
+        // Keep what was queued since; the failed batch is lost
+        freeRecordList(batch);
+        writeErrorLog("Out of memory requeueing profile records; a batch was dropped");
+        return;
+    }
+
+    for (size_t i = 0; i < batch->count; i++) {
+        PendingRecord* record = &batch->records[i];
+        // A newer save of the same record supersedes the failed one
+        if (findRecord(queued, record->key) >= 0) {
+            free(record->row);
+            continue;
+        }
+        merged.records[merged.count++] = *record;
+        pendingCount++;
+    }
+    for (size_t i = 0; i < queued->count; i++) {
+        merged.records[merged.count++] = queued->records[i];
+    }
+
+    free(batch->records);
+    free(queued->records);
+    *queued = merged;
+    batch->records = NULL;
+    batch->count = 0;
+    batch->capacity = 0;
+}
+
+bool profile_store_flush(void) {
+    pthread_mutex_lock(&flushLock);
+
+    pthread_mutex_lock(&storeLock);
+    for (int t = 0; t < PROFILE_TABLE_COUNT; t++) {
+        inflightRecords[t] = pendingRecords[t];
+        pendingRecords[t].records = NULL;
+        pendingRecords[t].count = 0;
+        pendingRecords[t].capacity = 0;
+    }
+    pendingCount = 0;
+    pthread_mutex_unlock(&storeLock);
+
+    bool allOk = true;
+    bool ok[PROFILE_TABLE_COUNT];
+    for (int t = 0; t < PROFILE_TABLE_COUNT; t++) {
+        const RecordList* batch = &inflightRecords[t];
+        ok[t] = true;
+        if (batch->count == 0) {
+            continue;
+        }
+
+        ok[t] = rewriteTableFile((ProfileTable)t, tables[t].path(), batch);
+        if (!ok[t]) {
+            char errorMsg[150];
+            sprintf(errorMsg, "Failed to write %zu %s records; will retry", batch->count, tables[t].name);
+            writeErrorLog(errorMsg);
+            allOk = false;
+        }
+    }
+
+    pthread_mutex_lock(&storeLock);
+    for (int t = 0; t < PROFILE_TABLE_COUNT; t++) {
+        if (ok[t]) {
+            freeRecordList(&inflightRecords[t]);
+        } else {
+            requeueBatch((ProfileTable)t);
+        }
+    }
+    pthread_mutex_unlock(&storeLock);
+
+    pthread_mutex_unlock(&flushLock);
+    return allOk;
+}
+
+static void* flusherMain(void* arg) {
+    (void)arg;
+
+    pthread_mutex_lock(&storeLock);
+    while (!stopRequested) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += flushIntervalMs / 1000;
+        deadline.tv_nsec += (long)(flushIntervalMs % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&flusherWake, &storeLock, &deadline);
+
+        if (stopRequested || pendingCount == 0) {
+            continue;
+        }
+        pthread_mutex_unlock(&storeLock);
+        profile_store_flush();
+        pthread_mutex_lock(&storeLock);
+    }
+    pthread_mutex_unlock(&storeLock);
+    return NULL;
+}
+
+// Stop the flusher and write whatever is still queued
+static void profileStoreShutdown(void) {
+    pthread_mutex_lock(&storeLock);
+    stopRequested = true;
+    pthread_cond_signal(&flusherWake);
+    pthread_mutex_unlock(&storeLock);
+
+    if (threadRunning) {
+        pthread_join(flusherThread, NULL);
+        threadRunning = false;
+    }
+
+    profile_store_flush();
+}
+
+// Read configuration and start the flusher on first use; called with storeLock held
+static void ensureStarted(void) {
+    if (started) {
+        return;
+    }
+    started = true;
+
+    flushIntervalMs = getConfigValueInt(CONFIG_FLUSH_INTERVAL_MS);
+    if (flushIntervalMs <= 0) {
+        flushIntervalMs = DEFAULT_FLUSH_INTERVAL_MS;
+    }
+    int configuredMax = getConfigValueInt(CONFIG_MAX_PENDING);
+    maxPending = configuredMax > 0 ? (size_t)configuredMax : DEFAULT_MAX_PENDING;
+
+    threadRunning = pthread_create(&flusherThread, NULL, flusherMain, NULL) == 0;
+    if (!threadRunning) {
+        writeErrorLog("Failed to start profile store flusher; records are written at the size limit and at exit");
+    }
+    atexit(profileStoreShutdown);
+}
+
+static bool isValidTable(ProfileTable table) {
+    return (int)table >= 0 && (int)table < PROFILE_TABLE_COUNT;
+}
+
+// Queue a row
+static bool queueRecord(ProfileTable table, const char* key, const char* row) {
+    char* copy = strdup(row);
+    if (copy == NULL) {
+        writeErrorLog("Out of memory queueing profile record");
+        return false;
+    }
+
+    pthread_mutex_lock(&storeLock);
+    ensureStarted();
+
+    RecordList* list = &pendingRecords[table];
+    long existing = findRecord(list, key);
+    if (existing >= 0) {
+        // Coalesce with the earlier unflushed save of the same record
+        free(list->records[existing].row);
+        list->records[existing].row = copy;
+    } else {
+        if (!reserveRecord(list)) {
+            pthread_mutex_unlock(&storeLock);
+            free(copy);
+            writeErrorLog("Out of memory queueing profile record");
+            return false;
+        }
+        PendingRecord* record = &list->records[list->count++];
+        strncpy(record->key, key, sizeof(record->key) - 1);
+        record->key[sizeof(record->key) - 1] = '\0';
+        record->row = copy;
+        pendingCount++;
+    }
+
+    bool flushNow = pendingCount >= maxPending;
+    pthread_mutex_unlock(&storeLock);
+
+    if (flushNow) {
+        return profile_store_flush();
+    }
+    return true;
+}
+
+bool profile_store_put(ProfileTable table, const char* key, const char* row) {
+    if (!isValidTable(table) || key == NULL || key[0] == '\0' || row == NULL) {
+        writeErrorLog("Invalid record passed to profile_store_put");
+        return false;
+    }
+    if (strlen(key) >= PROFILE_KEY_MAX) {
+        writeErrorLog("Record key too long for profile store");
+        return false;
+    }
+
+    return queueRecord(table, key, row);
+}
+
+bool profile_store_lookup(ProfileTable table, int column, const char* value, char* row, size_t rowSize) {
+    if (!isValidTable(table) || value == NULL || row == NULL || rowSize == 0) {
+        return false;
+    }
+
+    bool found = false;
+    pthread_mutex_lock(&storeLock);
+
+    // Newest first: the queue, then the batch being written
+    const RecordList* lists[2] = { &pendingRecords[table], &inflightRecords[table] };
+    for (int l = 0; l < 2 && !found; l++) {
+        for (size_t i = lists[l]->count; i > 0; i--) {
+            const char* candidate = lists[l]->records[i - 1].row;
+            if (rowColumnEquals(candidate, column, value)) {
+                strncpy(row, candidate, rowSize - 1);
+                row[rowSize - 1] = '\0';
+                found = true;
+                break;
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&storeLock);
+    return found;
+}
+
+size_t profile_store_pending(void) {
+    pthread_mutex_lock(&storeLock);
+    size_t count = pendingCount;
+    pthread_mutex_unlock(&storeLock);
+    return count;
+}
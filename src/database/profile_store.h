@@ -0,0 +1,64 @@
+#ifndef PROFILE_STORE_H
+#define PROFILE_STORE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Batched writer for the profile tables
+ *
+ * Saved records are queued in memory and written out together: each table
+ * with pending changes is rewritten once per flush, however many of its
+ * records changed. A background
+ * thread flushes every commit interval (profile_store_flush_interval_ms,
+ * default 1000), and a flush is forced once profile_store_max_pending
+ * records (default 256) are queued. Pending records are flushed at exit.
+ */
+
+// Tables managed by the store
+typedef enum {
+    PROFILE_TABLE_CUSTOMERS,      // customer_profiles.txt, keyed by Customer ID
+    PROFILE_TABLE_ACCOUNTS,       // accounting.txt, keyed by Account ID
+    PROFILE_TABLE_WALLETS,        // virtual_wallet.txt, keyed by Wallet ID
+    PROFILE_TABLE_COUNT
+} ProfileTable;
+
+/**
+ * Queue a full row to replace (or add) the record with the given key
+ *
+ * @param table A keyed table
+ * @param key Value of the table's key column
+ * @param row The complete pipe-delimited row, without a trailing newline
+ * @return true if queued
+ */
+bool profile_store_put(ProfileTable table, const char* key, const char* row);
+
+/**
+ * Find a queued row that has not reached the file yet
+ *
+ * Lets loaders see their own unflushed saves.
+ *
+ * @param table A keyed table
+ * @param column Zero-based column to match
+ * @param value Value the column must equal (after trimming)
+ * @param row Receives a copy of the row
+ * @param rowSize Size of the row buffer
+ * @return true if a pending row matched
+ */
+bool profile_store_lookup(ProfileTable table, int column, const char* value, char* row, size_t rowSize);
+
+/**
+ * Write every queued record to disk and fsync it
+ *
+ * Call when a save must be durable before continuing.
+ *
+ * @return true if all tables were written
+ */
+bool profile_store_flush(void);
+
+/**
+ * Number of records waiting to be flushed
+ */
+size_t profile_store_pending(void);
+
+#endif // PROFILE_STORE_H
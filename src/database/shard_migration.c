@@ -0,0 +1,219 @@
+#include "shard_migration.h"
+#include "card_index.h"
+#include "customer_index.h"
+#include "journal.h"
+#include "../common/paths.h"
+#include "../utils/logger.h"
+#include "../utils/file_utils.h"
+#include "../utils/table_reader.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Output files of one table while it is being split
+typedef struct {
+    FILE* files[MAX_DATA_SHARDS];
+    char tempPaths[MAX_DATA_SHARDS][84];
+    char paths[MAX_DATA_SHARDS][80];
+    int shardCount;
+} ShardWriter;
+
+static void closeShardWriter(ShardWriter* writer, bool removeTemp) {
+    for (int i = 0; i < writer->shardCount; i++) {
+        if (writer->files[i] != NULL) {
+            fclose(writer->files[i]);
+            writer->files[i] = NULL;
+        }
+        if (removeTemp) {
+            remove(writer->tempPaths[i]);
+        }
+    }
+}
+
+static bool openShardWriter(ShardWriter* writer, int shardCount, const char* fileName) {
+    memset(writer, 0, sizeof(*writer));
+    writer->shardCount = shardCount;
+
+    for (int i = 0; i < shardCount; i++) {
+        char dirPath[80];
+        formatShardFilePath(dirPath, sizeof(dirPath), i, NULL);
+        formatShardFilePath(writer->paths[i], sizeof(writer->paths[i]), i, fileName);
+        snprintf(writer->tempPaths[i], sizeof(writer->tempPaths[i]), "%s.tmp", writer->paths[i]);
+
+        writer->files[i] = ensureDirectoryExists(dirPath) ? fopen(writer->tempPaths[i], "w") : NULL;
+        if (writer->files[i] == NULL) {
+            char errorMsg[150];
+            sprintf(errorMsg, "Failed to create shard file %s", writer->tempPaths[i]);
+            writeErrorLog(errorMsg);
+            closeShardWriter(writer, true);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Sync every shard file and move it into place
+static bool commitShardWriter(ShardWriter* writer) {
+    bool ok = true;
+    for (int i = 0; i < writer->shardCount; i++) {
+        FILE* file = writer->files[i];
+        writer->files[i] = NULL;
+        ok = fflush(file) == 0 && fsync(fileno(file)) == 0 && ok;
+        ok = fclose(file) == 0 && ok;
+    }
+    for (int i = 0; i < writer->shardCount && ok; i++) {
+        ok = rename(writer->tempPaths[i], writer->paths[i]) == 0;
+    }
+    if (!ok) {
+        closeShardWriter(writer, true);
+    }
+    return ok;
+}
+
+// Copy the rows of one table into its shard files; `cardKey` selects the
+// card number column, otherwise rows are placed by account ID
+static long splitTable(const char* sourcePath, const char* fileName, int shardCount, bool cardKey) {
+    TableReader reader;
+    if (!tableReaderOpen(&reader, sourcePath, '|')) {
+        char errorMsg[150];
+        sprintf(errorMsg, "Failed to open %s for sharding", sourcePath);
+        writeErrorLog(errorMsg);
+        return -1;
+    }
+
+    ShardWriter writer;
+    if (!openShardWriter(&writer, shardCount, fileName)) {
+        tableReaderClose(&reader);
+        return -1;
+    }
+
+    // Every shard keeps the original header lines
+    tableReaderSkipLines(&reader, 2);
+    for (int i = 0; i < shardCount && reader.pos > 0; i++) {
+        fwrite(reader.data, 1, reader.pos, writer.files[i]);
+        if (reader.data[reader.pos - 1] != '\n') {
+            fputc('\n', writer.files[i]);
+        }
+    }
+
+    // Card rows: Card ID | Account ID | Card Number | ...
+    // Customer rows: Customer ID | Account ID | ...
+    long rows = 0;
+    TableRow row;
+    while (tableReaderNext(&reader, &row)) {
+        int shard;
+        long cardNumber;
+        char accountID[20];
+
+        if (cardKey && row.fieldCount >= 3 && tableFieldToLong(&row.fields[2], &cardNumber)) {
+            shard = getCardShardIn((int)cardNumber, shardCount);
+        } else if (!cardKey && row.fieldCount >= 2 && row.fields[1].len > 0) {
+            tableFieldCopy(&row.fields[1], accountID, sizeof(accountID));
+            shard = getAccountShardIn(accountID, shardCount);
+        } else {
+            // Refuse to shard rather than silently drop a row we cannot place
+            char errorMsg[150];
+            sprintf(errorMsg, "Unplaceable row in %s; sharding aborted", sourcePath);
+            writeErrorLog(errorMsg);
+            tableReaderClose(&reader);
+            closeShardWriter(&writer, true);
+            return -1;
+        }
+
+        fwrite(row.line, 1, row.lineLen, writer.files[shard]);
+        fputc('\n', writer.files[shard]);
+        rows++;
+    }
+    tableReaderClose(&reader);
+
+    if (!commitShardWriter(&writer)) {
+        char errorMsg[150];
+        sprintf(errorMsg, "Failed to write shard files for %s", sourcePath);
+        writeErrorLog(errorMsg);
+        return -1;
+    }
+    return rows;
+}
+
+// Write the layout file; once it is in place the shards are used
+static bool writeLayoutFile(int shardCount) {
+    const char* path = getShardLayoutFilePath();
+    char tempPath[100];
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+
+    FILE* file = fopen(tempPath, "w");
+    if (file == NULL) {
+        return false;
+    }
+    fprintf(file, "%d\n", shardCount);
+    bool ok = fflush(file) == 0 && fsync(fileno(file)) == 0;
+    ok = fclose(file) == 0 && ok;
+
+    if (!ok || rename(tempPath, path) != 0) {
+        remove(tempPath);
+        return false;
+    }
+    syncPath(getShardDirectory());
+    return true;
+}
+
+// Keep the single-file copy as a backup next to where it was
+static void keepUnshardedCopy(const char* path) {
+    char backupPath[100];
+    snprintf(backupPath, sizeof(backupPath), "%s.unsharded", path);
+    if (rename(path, backupPath) != 0) {
+        char errorMsg[150];
+        sprintf(errorMsg, "Sharded layout in use but %s could not be renamed", path);
+        writeErrorLog(errorMsg);
+    }
+}
+
+int migrateToShards(int shardCount) {
+    if (shardCount < 1 || shardCount > MAX_DATA_SHARDS) {
+        writeErrorLog("Shard count out of range");
+        return -1;
+    }
+    if (getShardCount() > 0) {
+        writeErrorLog("Data files are already sharded");
+        return -1;
+    }
+    if (!ensureDirectoryExists(getShardDirectory())) {
+        writeErrorLog("Failed to create shard directory");
+        return -1;
+    }
+
+    // A running process would keep checkpointing into the single-file paths
+    if (!journalLockForMaintenance()) {
+        return -1;
+    }
+
+    // Resolve the single-file paths before the layout changes what they mean
+    char cardPath[100], customerPath[100];
+    snprintf(cardPath, sizeof(cardPath), "%s", getCardFilePath());
+    snprintf(customerPath, sizeof(customerPath), "%s", getCustomerFilePath());
+
+    long cards = splitTable(cardPath, SHARD_CARD_FILE_NAME, shardCount, true);
+    long accounts = cards >= 0 ? splitTable(customerPath, SHARD_CUSTOMER_FILE_NAME, shardCount, false) : -1;
+    if (accounts < 0 || !writeLayoutFile(shardCount)) {
+        journalUnlockForMaintenance();
+        writeErrorLog("Sharding failed; the single-file layout is still in use");
+        return -1;
+    }
+
+    keepUnshardedCopy(cardPath);
+    keepUnshardedCopy(customerPath);
+
+    // The snapshot describes the single-file layout
+    remove(getSnapshotFilePath());
+    reloadShardLayout();
+    cardIndexInvalidate();
+    customerIndexInvalidate();
+    journalUnlockForMaintenance();
+
+    char logMsg[150];
+    sprintf(logMsg, "Split %ld cards and %ld accounts into %d shards", cards, accounts, shardCount);
+    writeAuditLog("ADMIN", logMsg);
+    return (int)(cards + accounts);
+}
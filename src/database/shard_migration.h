@@ -0,0 +1,29 @@
+#ifndef SHARD_MIGRATION_H
+#define SHARD_MIGRATION_H
+
+#include <stdbool.h>
+
+/**
+ * Split card.txt and customer.txt into the sharded layout
+ *
+ * Cards go to shard (card number % shardCount) and accounts to shard
+ * (FNV-1a of the account ID % shardCount), under
+ * data/shards/NN/card.txt and data/shards/NN/customer.txt. Rows are
+ * copied verbatim, so fixed-width customer files stay fixed-width.
+ *
+ * Every shard file is written to a temporary file, synced and renamed
+ * before the layout file is written; the layout file is the commit point,
+ * so an interrupted migration leaves the single-file layout in use. The
+ * original files are then kept as card.txt.unsharded and
+ * customer.txt.unsharded.
+ *
+ * Run before the storage engine is opened. The migration holds the
+ * journal's ownership lock throughout and fails without changing anything
+ * while a running process owns the journal.
+ *
+ * @param shardCount Number of shards, 1 to MAX_DATA_SHARDS
+ * @return Number of rows moved, or -1 on failure
+ */
+int migrateToShards(int shardCount);
+
+#endif // SHARD_MIGRATION_H
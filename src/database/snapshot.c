@@ -0,0 +1,586 @@
+#include "snapshot.h"
+#include "card_index.h"
+#include "customer_index.h"
+#include "journal.h"
+#include "../validation/pin_validation.h"
+#include "../common/paths.h"
+#include "../utils/logger.h"
+#include "../utils/file_utils.h"
+#include "../utils/hash_utils.h"
+#include "../config/config_manager.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Configuration key for the snapshot schedule
+#define CONFIG_SNAPSHOT_INTERVAL_MS "snapshot_interval_ms"
+#define DEFAULT_SNAPSHOT_INTERVAL_MS 300000
+
+#define SNAPSHOT_MAGIC "ATMSNAP1"
+#define SNAPSHOT_VERSION 2
+#define SNAPSHOT_ALIGN 8
+
+enum {
+    SECTION_CARDS,
+    SECTION_CUSTOMERS,
+    SECTION_PIN_ATTEMPTS,
+    SECTION_COUNT
+};
+
+// Identity of a section's source file when the section was written
+typedef struct {
+    uint64_t device;
+    uint64_t inode;
+    int64_t size;
+    int64_t mtime;
+    int64_t mtimeNsec;
+    uint32_t exists;
+    uint32_t reserved;
+} SnapshotFileId;
+
+// Entries (and for the indexes, their hash slot table) stored in place
+typedef struct {
+    SnapshotFileId source;
+    uint64_t entryOffset;
+    uint64_t entryCount;
+    uint64_t slotOffset;
+    uint64_t slotCount;
+} SnapshotSection;
+
+/**
+ * Snapshot file layout
+ *
+ *   header | per shard: card entries, card slots | per shard: customer entries,
+ *   customer slots | PIN attempts
+ *
+ * The single-file layout is written as one shard. Every section starts on
+ * an 8-byte boundary so it can be used straight from the mapping.
+ */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t entrySizes[SECTION_COUNT];
+    uint32_t shardCount;        // getShardCount() when written, 0 for the single-file layout
+    uint32_t journalBacked;     // Balances are those of journal record journalSeq
+    uint32_t reserved0;
+    uint64_t journalSeq;
+    int64_t createdAt;
+    SnapshotSection cards[MAX_DATA_SHARDS];
+    SnapshotSection customers[MAX_DATA_SHARDS];
+    SnapshotSection pinAttempts;
+    uint32_t headerCrc;         // Over the header with this field zeroed
+    uint32_t reserved;
+} SnapshotHeader;
+
+typedef struct {
+    FILE* file;
+    uint64_t offset;
+    int shard;                  // Shard whose index is being exported
+    SnapshotHeader header;
+} SnapshotWriter;
+
+// Serialises writers; stateLock guards the fields below
+static pthread_mutex_t writeLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t stateLock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned long invalidations = 0;
+static SnapshotFileId lastCards[MAX_DATA_SHARDS];
+static SnapshotFileId lastCustomers[MAX_DATA_SHARDS];
+static bool haveWritten = false;
+
+// The mapping backs adopted index arrays and is kept for the life of the process
+static void* mappedBase = NULL;
+static size_t mappedSize = 0;
+
+// Periodic writer
+static pthread_cond_t writerWake = PTHREAD_COND_INITIALIZER;
+static pthread_t writerThread;
+static bool writerRunning = false;
+static bool stopRequested = false;
+static bool started = false;
+static int intervalMs = DEFAULT_SNAPSHOT_INTERVAL_MS;
+
+static void fileIdFromSignature(const FileSignature* signature, SnapshotFileId* id) {
+    memset(id, 0, sizeof(*id));
+    if (signature != NULL) {
+        id->device = (uint64_t)signature->device;
+        id->inode = (uint64_t)signature->inode;
+        id->size = (int64_t)signature->size;
+        id->mtime = (int64_t)signature->mtime;
+        id->mtimeNsec = (int64_t)signature->mtimeNsec;
+        id->exists = 1;
+    }
+}
+
+static void signatureFromFileId(const SnapshotFileId* id, FileSignature* signature) {
+    memset(signature, 0, sizeof(*signature));
+    signature->device = (dev_t)id->device;
+    signature->inode = (ino_t)id->inode;
+    signature->size = (off_t)id->size;
+    signature->mtime = (time_t)id->mtime;
+    signature->mtimeNsec = (long)id->mtimeNsec;
+}
+
+// Same file with the same size; in-place balance writes keep this true
+static bool sameLayout(const SnapshotFileId* a, const SnapshotFileId* b) {
+    return a->exists && b->exists && a->device == b->device && a->inode == b->inode && a->size == b->size;
+}
+
+static bool sameFile(const SnapshotFileId* a, const SnapshotFileId* b) {
+    return sameLayout(a, b) && a->mtime == b->mtime && a->mtimeNsec == b->mtimeNsec;
+}
+
+// Whether a customer file changed since `source` only through journal checkpoints
+static bool changedByCheckpoints(int shard, const SnapshotFileId* source, const SnapshotFileId* current) {
+    FileSignature from, to;
+    if (!journalCheckpointSpan(shard, &from, &to)) {
+        return false;
+    }
+    SnapshotFileId fromId, toId;
+    fileIdFromSignature(&from, &fromId);
+    fileIdFromSignature(&to, &toId);
+    return sameFile(&fromId, source) && sameFile(&toId, current);
+}
+
+static void currentFileId(const char* path, SnapshotFileId* id) {
+    FileSignature signature;
+    fileIdFromSignature(readFileSignature(path, &signature) ? &signature : NULL, id);
+}
+
+static uint32_t headerChecksum(const SnapshotHeader* header) {
+    SnapshotHeader copy = *header;
+    copy.headerCrc = 0;
+    return crc32_checksum(&copy, sizeof(copy));
+}
+
+static bool writeBytes(SnapshotWriter* writer, const void* data, size_t len) {
+    if (len > 0 && fwrite(data, 1, len, writer->file) != len) {
+        return false;
+    }
+    writer->offset += len;
+    return true;
+}
+
+static bool writeAlignment(SnapshotWriter* writer) {
+    static const char zeros[SNAPSHOT_ALIGN] = {0};
+    size_t pad = (size_t)((SNAPSHOT_ALIGN - writer->offset % SNAPSHOT_ALIGN) % SNAPSHOT_ALIGN);
+    return writeBytes(writer, zeros, pad);
+}
+
+// Append entries and an optional slot table as one section
+static bool writeSection(SnapshotWriter* writer, SnapshotSection* section, const void* entries, size_t count,
+                         size_t entrySize, const int* slots, size_t slotCount, const FileSignature* signature) {
+    fileIdFromSignature(signature, &section->source);
+
+    if (!writeAlignment(writer)) {
+        return false;
+    }
+    section->entryOffset = writer->offset;
+    section->entryCount = count;
+    if (!writeBytes(writer, entries, count * entrySize)) {
+        return false;
+    }
+
+    if (slots != NULL && slotCount > 0) {
+        if (!writeAlignment(writer)) {
+            return false;
+        }
+        section->slotOffset = writer->offset;
+        section->slotCount = slotCount;
+        if (!writeBytes(writer, slots, slotCount * sizeof(int))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool writeCards(const CardIndexEntry* entries, size_t count, const int* slots, size_t slotCount,
+                       const FileSignature* signature, void* context) {
+    SnapshotWriter* writer = (SnapshotWriter*)context;
+    return writeSection(writer, &writer->header.cards[writer->shard], entries, count, sizeof(CardIndexEntry),
+                        slots, slotCount, signature);
+}
+
+static bool writeCustomers(const CustomerIndexEntry* entries, size_t count, const int* slots, size_t slotCount,
+                           const FileSignature* signature, void* context) {
+    SnapshotWriter* writer = (SnapshotWriter*)context;
+    return writeSection(writer, &writer->header.customers[writer->shard], entries, count,
+                        sizeof(CustomerIndexEntry), slots, slotCount, signature);
+}
+
+static bool writePinAttempts(const PinAttemptEntry* entries, size_t count, const FileSignature* signature,
+                             void* context) {
+    SnapshotWriter* writer = (SnapshotWriter*)context;
+    return writeSection(writer, &writer->header.pinAttempts, entries, count, sizeof(PinAttemptEntry),
+                        NULL, 0, signature);
+}
+
+static bool writeAllCustomers(SnapshotWriter* writer) {
+    int shardFiles = writer->header.shardCount > 0 ? (int)writer->header.shardCount : 1;
+    for (writer->shard = 0; writer->shard < shardFiles; writer->shard++) {
+        if (!customerIndexExport(writer->shard, writeCustomers, writer)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Runs with the journal's checkpoint held, so the balances match record `seq`
+static bool writeCustomersAtCheckpoint(unsigned long seq, void* context) {
+    SnapshotWriter* writer = (SnapshotWriter*)context;
+    writer->header.journalBacked = 1;
+    writer->header.journalSeq = seq;
+    return writeAllCustomers(writer);
+}
+
+// Sum of the entry counts of a shard section array
+static unsigned long long sectionTotal(const SnapshotSection* sections, int shardFiles) {
+    unsigned long long total = 0;
+    for (int i = 0; i < shardFiles; i++) {
+        total += sections[i].entryCount;
+    }
+    return total;
+}
+
+bool snapshotWrite(void) {
+    const char* path = getSnapshotFilePath();
+    char tempPath[256];
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+
+    pthread_mutex_lock(&writeLock);
+
+    pthread_mutex_lock(&stateLock);
+    unsigned long generation = invalidations;
+    pthread_mutex_unlock(&stateLock);
+
+    SnapshotWriter writer;
+    memset(&writer, 0, sizeof(writer));
+    writer.header.shardCount = (uint32_t)getShardCount();
+    int shardFiles = getShardFileCount();
+    writer.file = fopen(tempPath, "wb");
+    if (writer.file == NULL) {
+        pthread_mutex_unlock(&writeLock);
+        writeErrorLog("Failed to create temporary snapshot file");
+        return false;
+    }
+
+    // Sections follow a placeholder header that is filled in last
+    bool ok = writeBytes(&writer, &writer.header, sizeof(writer.header));
+    for (writer.shard = 0; ok && writer.shard < shardFiles; writer.shard++) {
+        ok = cardIndexExport(writer.shard, writeCards, &writer);
+    }
+    if (ok) {
+        ok = journalIsOpen() ? journalCheckpointThen(writeCustomersAtCheckpoint, &writer)
+                             : writeAllCustomers(&writer);
+    }
+    ok = ok && pinAttemptsExport(writePinAttempts, &writer);
+
+    if (ok) {
+        SnapshotHeader* header = &writer.header;
+        memcpy(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic));
+        header->version = SNAPSHOT_VERSION;
+        header->headerSize = sizeof(SnapshotHeader);
+        header->entrySizes[SECTION_CARDS] = sizeof(CardIndexEntry);
+        header->entrySizes[SECTION_CUSTOMERS] = sizeof(CustomerIndexEntry);
+        header->entrySizes[SECTION_PIN_ATTEMPTS] = sizeof(PinAttemptEntry);
+        header->createdAt = (int64_t)time(NULL);
+        header->headerCrc = headerChecksum(header);
+
+        ok = fseek(writer.file, 0, SEEK_SET) == 0 &&
+             fwrite(header, sizeof(*header), 1, writer.file) == 1 &&
+             fflush(writer.file) == 0 && fsync(fileno(writer.file)) == 0;
+    }
+    ok = fclose(writer.file) == 0 && ok;
+
+    // A balance written around the journal since we started makes this snapshot stale
+    pthread_mutex_lock(&stateLock);
+    ok = ok && generation == invalidations && rename(tempPath, path) == 0;
+    if (ok) {
+        for (int i = 0; i < MAX_DATA_SHARDS; i++) {
+            lastCards[i] = writer.header.cards[i].source;
+            lastCustomers[i] = writer.header.customers[i].source;
+        }
+        haveWritten = true;
+    }
+    pthread_mutex_unlock(&stateLock);
+
+    if (!ok) {
+        remove(tempPath);
+        pthread_mutex_unlock(&writeLock);
+        writeErrorLog("Failed to write snapshot");
+        return false;
+    }
+    syncParentDirectory(path);
+
+    // Records up to the snapshot are no longer needed to rebuild balances
+    if (writer.header.journalBacked) {
+        journalSetSnapshotSeq((unsigned long)writer.header.journalSeq);
+    }
+    pthread_mutex_unlock(&writeLock);
+
+    char logMsg[150];
+    sprintf(logMsg, "Snapshot written with %llu cards, %llu accounts and %llu PIN attempt records",
+            sectionTotal(writer.header.cards, shardFiles), sectionTotal(writer.header.customers, shardFiles),
+            (unsigned long long)writer.header.pinAttempts.entryCount);
+    writeInfoLog(logMsg);
+    return true;
+}
+
+// Check that a section's arrays lie inside the mapping
+static bool sectionInBounds(const SnapshotSection* section, size_t entrySize, size_t fileSize) {
+    uint64_t entryBytes = section->entryCount * entrySize;
+    if (section->entryCount > fileSize / (entrySize > 0 ? entrySize : 1) ||
+        section->entryOffset % SNAPSHOT_ALIGN != 0 || section->entryOffset > fileSize ||
+        entryBytes > fileSize - section->entryOffset) {
+        return false;
+    }
+    if (section->slotCount == 0) {
+        return true;
+    }
+    return section->slotCount <= fileSize / sizeof(int) && section->slotOffset % SNAPSHOT_ALIGN == 0 &&
+           section->slotOffset <= fileSize && section->slotCount * sizeof(int) <= fileSize - section->slotOffset;
+}
+
+static bool headerValid(const SnapshotHeader* header, size_t fileSize) {
+    static const uint32_t entrySizes[SECTION_COUNT] = {
+        sizeof(CardIndexEntry), sizeof(CustomerIndexEntry), sizeof(PinAttemptEntry)
+    };
+
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != SNAPSHOT_VERSION || header->headerSize != sizeof(SnapshotHeader) ||
+        header->headerCrc != headerChecksum(header) || header->shardCount > MAX_DATA_SHARDS) {
+        return false;
+    }
+    for (int i = 0; i < SECTION_COUNT; i++) {
+        if (header->entrySizes[i] != entrySizes[i]) {
+            return false;
+        }
+    }
+    for (int i = 0; i < MAX_DATA_SHARDS; i++) {
+        if (!sectionInBounds(&header->cards[i], entrySizes[SECTION_CARDS], fileSize) ||
+            !sectionInBounds(&header->customers[i], entrySizes[SECTION_CUSTOMERS], fileSize)) {
+            return false;
+        }
+    }
+    return sectionInBounds(&header->pinAttempts, entrySizes[SECTION_PIN_ATTEMPTS], fileSize);
+}
+
+bool snapshotLoad(void) {
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    int fd = open(getSnapshotFilePath(), O_RDONLY);
+    if (fd < 0) {
+        writeInfoLog("No snapshot found; indexes will be built from the data files");
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SnapshotHeader)) {
+        close(fd);
+        writeErrorLog("Snapshot file is truncated; ignoring it");
+        return false;
+    }
+
+    // Private writable mapping: balance updates to adopted entries copy the page
+    size_t size = (size_t)st.st_size;
+    void* base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        writeErrorLog("Failed to map snapshot file");
+        return false;
+    }
+
+    const SnapshotHeader* header = (const SnapshotHeader*)base;
+    if (!headerValid(header, size)) {
+        munmap(base, size);
+        writeErrorLog("Snapshot file is corrupt or from another build; ignoring it");
+        return false;
+    }
+
+    char* bytes = (char*)base;
+    const SnapshotSection* attempts = &header->pinAttempts;
+    int shardFiles = getShardFileCount();
+    bool sameShards = (int)header->shardCount == getShardCount();
+    int usedCards = 0, usedCustomers = 0;
+    bool usedAttempts = false;
+    FileSignature current;
+    SnapshotFileId currentId;
+
+    if (!sameShards) {
+        writeInfoLog("Snapshot was written for another shard layout; indexes will be built from the data files");
+    }
+
+    for (int shard = 0; sameShards && shard < shardFiles; shard++) {
+        const SnapshotSection* cards = &header->cards[shard];
+        const SnapshotSection* customers = &header->customers[shard];
+
+        // Cards: any change to a card file rewrites or appends to it
+        if (readFileSignature(getCardShardFilePath(shard), &current)) {
+            fileIdFromSignature(&current, &currentId);
+            if (sameFile(&cards->source, &currentId) && cards->slotCount > 0 &&
+                cardIndexAdopt(shard, (CardIndexEntry*)(bytes + cards->entryOffset), (size_t)cards->entryCount,
+                               (int*)(bytes + cards->slotOffset), (size_t)cards->slotCount, &current)) {
+                usedCards++;
+            }
+        }
+
+        // Customers: checkpoints rewrite balances in place, so a snapshot taken at a
+        // journal checkpoint stays usable as long as nothing but checkpoints wrote the file
+        if (readFileSignature(getCustomerShardFilePath(shard), &current)) {
+            fileIdFromSignature(&current, &currentId);
+            bool usable = sameFile(&customers->source, &currentId) ||
+                          (header->journalBacked && journalEnabled() && sameLayout(&customers->source, &currentId) &&
+                           changedByCheckpoints(shard, &customers->source, &currentId));
+            if (usable && customers->slotCount > 0 &&
+                customerIndexAdopt(shard, (CustomerIndexEntry*)(bytes + customers->entryOffset),
+                                   (size_t)customers->entryCount,
+                                   (int*)(bytes + customers->slotOffset), (size_t)customers->slotCount,
+                                   &current)) {
+                usedCustomers++;
+            }
+        }
+    }
+    if (usedCustomers > 0 && header->journalBacked && journalEnabled()) {
+        journalSetSnapshotSeq((unsigned long)header->journalSeq);
+    }
+
+    FileSignature savedAttempts;
+    signatureFromFileId(&attempts->source, &savedAttempts);
+    usedAttempts = pinAttemptsAdopt((const PinAttemptEntry*)(bytes + attempts->entryOffset),
+                                    (size_t)attempts->entryCount,
+                                    attempts->source.exists ? &savedAttempts : NULL);
+
+    if (usedCards == 0 && usedCustomers == 0) {
+        munmap(base, size);
+    } else {
+        mappedBase = base;
+        mappedSize = size;
+    }
+
+    pthread_mutex_lock(&stateLock);
+    for (int i = 0; i < MAX_DATA_SHARDS; i++) {
+        lastCards[i] = header->cards[i].source;
+        lastCustomers[i] = header->customers[i].source;
+    }
+    haveWritten = sameShards;
+    pthread_mutex_unlock(&stateLock);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    long micros = (long)(end.tv_sec - start.tv_sec) * 1000000L + (end.tv_nsec - start.tv_nsec) / 1000;
+
+    char logMsg[200];
+    sprintf(logMsg, "Snapshot loaded in %ld us (card files %d/%d, customer files %d/%d, PIN attempts %s)", micros,
+            usedCards, shardFiles, usedCustomers, shardFiles, usedAttempts ? "used" : "stale");
+    writeInfoLog(logMsg);
+    return usedCards > 0 || usedCustomers > 0 || usedAttempts;
+}
+
+// Skip the periodic write when no index source has changed since the last snapshot
+static bool snapshotOutdated(void) {
+    SnapshotFileId cardIds[MAX_DATA_SHARDS], customerIds[MAX_DATA_SHARDS];
+    int shardFiles = getShardFileCount();
+    for (int i = 0; i < shardFiles; i++) {
+        currentFileId(getCardShardFilePath(i), &cardIds[i]);
+        currentFileId(getCustomerShardFilePath(i), &customerIds[i]);
+    }
+
+    pthread_mutex_lock(&stateLock);
+    bool outdated = !haveWritten;
+    for (int i = 0; !outdated && i < shardFiles; i++) {
+        outdated = !sameFile(&cardIds[i], &lastCards[i]) || !sameFile(&customerIds[i], &lastCustomers[i]);
+    }
+    pthread_mutex_unlock(&stateLock);
+    return outdated;
+}
+
+static void* writerMain(void* arg) {
+    (void)arg;
+
+    pthread_mutex_lock(&stateLock);
+    while (!stopRequested) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += intervalMs / 1000;
+        deadline.tv_nsec += (long)(intervalMs % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&writerWake, &stateLock, &deadline);
+        if (stopRequested) {
+            break;
+        }
+
+        pthread_mutex_unlock(&stateLock);
+        if (snapshotOutdated()) {
+            snapshotWrite();
+        }
+        pthread_mutex_lock(&stateLock);
+    }
+    pthread_mutex_unlock(&stateLock);
+    return NULL;
+}
+
+bool snapshotStart(void) {
+    pthread_mutex_lock(&stateLock);
+    if (started) {
+        pthread_mutex_unlock(&stateLock);
+        return true;
+    }
+    started = true;
+    stopRequested = false;
+
+    int configured = getConfigValueInt(CONFIG_SNAPSHOT_INTERVAL_MS);
+    intervalMs = configured >= 0 ? configured : DEFAULT_SNAPSHOT_INTERVAL_MS;
+    if (intervalMs > 0) {
+        writerRunning = pthread_create(&writerThread, NULL, writerMain, NULL) == 0;
+    }
+    pthread_mutex_unlock(&stateLock);
+
+    atexit(snapshotStop);
+
+    if (intervalMs > 0 && !writerRunning) {
+        writeErrorLog("Failed to start snapshot writer; snapshots will be written at shutdown only");
+        return false;
+    }
+    return true;
+}
+
+void snapshotStop(void) {
+    pthread_mutex_lock(&stateLock);
+    if (!started) {
+        pthread_mutex_unlock(&stateLock);
+        return;
+    }
+    started = false;
+    stopRequested = true;
+    pthread_cond_signal(&writerWake);
+    pthread_mutex_unlock(&stateLock);
+
+    if (writerRunning) {
+        pthread_join(writerThread, NULL);
+        writerRunning = false;
+    }
+
+    if (snapshotOutdated()) {
+        snapshotWrite();
+    }
+}
+
+void snapshotInvalidate(void) {
+    pthread_mutex_lock(&stateLock);
+    invalidations++;
+    haveWritten = false;
+    if (remove(getSnapshotFilePath()) == 0) {
+        writeInfoLog("Snapshot discarded after a balance change outside the journal");
+    }
+    pthread_mutex_unlock(&stateLock);
+}
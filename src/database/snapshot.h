@@ -0,0 +1,55 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdbool.h>
+
+/**
+ * Binary startup snapshot
+ *
+ * Holds the card index, the customer index (with account balances) and the
+ * PIN attempt table in their in-memory layout, so a restart maps one file
+ * instead of parsing card.txt and customer.txt. Each section is only used
+ * if its source file is unchanged since the snapshot was written; balances
+ * committed after it are replayed from the journal on top of it.
+ *
+ * The file is native-endian and tied to this build's struct layouts; a
+ * snapshot from another build is ignored and the text files are parsed.
+ */
+
+/**
+ * Map the snapshot and seed the indexes from it
+ *
+ * Call after the configuration is loaded and before storageEngineInit, so
+ * the journal knows where to start replaying.
+ *
+ * @return true if at least one section was used
+ */
+bool snapshotLoad(void);
+
+/**
+ * Write a new snapshot: temporary file, fsync, rename
+ *
+ * @return true if the snapshot was replaced
+ */
+bool snapshotWrite(void);
+
+/**
+ * Start writing snapshots every snapshot_interval_ms (0 disables the
+ * schedule) and register a final snapshot at exit
+ *
+ * @return true if the schedule is running or disabled by configuration
+ */
+bool snapshotStart(void);
+
+/**
+ * Stop the periodic writer and write a final snapshot
+ * Registered with atexit by snapshotStart.
+ */
+void snapshotStop(void);
+
+/**
+ * Delete the snapshot after a balance change the journal does not record
+ */
+void snapshotInvalidate(void);
+
+#endif // SNAPSHOT_H
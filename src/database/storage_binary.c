@@ -0,0 +1,680 @@
+#include "storage_engine.h"
+#include "storage_records.h"
+#include "../common/paths.h"
+#include "../utils/logger.h"
+#include "../utils/hash_utils.h"
+#include "../utils/file_utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+/**
+ * Binary engine: fixed-size records in a page file
+ *
+ * Page 0 holds the header, followed by the card pages and then the account
+ * pages. Records never straddle a page, so a record's file offset follows
+ * from its slot. The file is imported from the text files the first time
+ * the engine opens. All records are also kept in memory for lookups; each
+ * change is written in place with pwrite.
+ *
+ * A multi-account balance change is first recorded in the header and
+ * synced, then applied to the records; an interrupted change is finished
+ * at the next open. A batch too large for the header is recorded the same
+ * way in a separate intent file, so it too is applied whole or not at all.
+ * Adding an account rewrites the page file, because the card pages come
+ * before the account pages.
+ */
+
+#define PAGE_SIZE 4096
+#define PAGE_FILE_MAGIC "ATMPAGE1"
+#define BATCH_FILE_MAGIC "ATMBATCH"
+
+typedef struct {
+    int32_t cardNumber;
+    char cardID[12];
+    char accountID[20];
+    char status[12];
+    char pinHash[65];
+    char reserved[3];
+} DiskCard;
+
+typedef struct {
+    char accountID[20];
+    char customerID[20];
+    char holderName[100];
+    char type[20];
+    char status[20];
+    char reserved[4];
+    double balance;
+} DiskAccount;
+
+// A balance being written by an interrupted apply_delta
+typedef struct {
+    uint32_t accountSlot;
+    uint32_t reserved;
+    double balance;
+} PendingBalance;
+
+typedef struct {
+    char magic[8];
+    uint32_t pageSize;
+    uint32_t cardCount;
+    uint32_t accountCount;
+    uint32_t cardFirstPage;
+    uint32_t accountFirstPage;
+    uint32_t pendingCount;
+    PendingBalance pending[STORAGE_MAX_DELTAS];
+    uint32_t pendingChecksum;     // CRC-32 of pendingCount and pending[]
+} PageFileHeader;
+
+// Start of the batch intent file, followed by `count` PendingBalance entries
+typedef struct {
+    char magic[8];
+    uint32_t count;
+    uint32_t checksum;            // CRC-32 of count and the entries
+} BatchFileHeader;
+
+#define CARDS_PER_PAGE (PAGE_SIZE / sizeof(DiskCard))
+#define ACCOUNTS_PER_PAGE (PAGE_SIZE / sizeof(DiskAccount))
+
+static pthread_mutex_t binaryLock = PTHREAD_MUTEX_INITIALIZER;
+static StorageRecordSet records;
+static PageFileHeader header;
+static int pageFd = -1;
+static bool batchPending = false;      // A batch intent file is still on disk
+
+static off_t cardOffset(const PageFileHeader* h, size_t slot) {
+    return (off_t)(h->cardFirstPage + slot / CARDS_PER_PAGE) * PAGE_SIZE +
+           (off_t)((slot % CARDS_PER_PAGE) * sizeof(DiskCard));
+}
+
+static off_t accountOffset(const PageFileHeader* h, size_t slot) {
+    return (off_t)(h->accountFirstPage + slot / ACCOUNTS_PER_PAGE) * PAGE_SIZE +
+           (off_t)((slot % ACCOUNTS_PER_PAGE) * sizeof(DiskAccount));
+}
+
+static uint32_t pendingChecksum(const PageFileHeader* h) {
+    uint32_t crc = crc32_checksum(&h->pendingCount, sizeof(h->pendingCount));
+    return crc ^ crc32_checksum(h->pending, sizeof(h->pending));
+}
+
+static uint32_t batchChecksum(uint32_t count, const PendingBalance* balances) {
+    uint32_t crc = crc32_checksum(&count, sizeof(count));
+    return crc ^ crc32_checksum(balances, (size_t)count * sizeof(PendingBalance));
+}
+
+static void copyString(char* dest, size_t destSize, const char* src, size_t srcSize) {
+    size_t len = strnlen(src, srcSize);
+    if (len >= destSize) {
+        len = destSize - 1;
+    }
+    memcpy(dest, src, len);
+    dest[len] = '\0';
+}
+
+static void cardToDisk(const StorageCard* card, DiskCard* disk) {
+    memset(disk, 0, sizeof(*disk));
+    disk->cardNumber = card->cardNumber;
+    copyString(disk->cardID, sizeof(disk->cardID), card->cardID, sizeof(card->cardID));
+    copyString(disk->accountID, sizeof(disk->accountID), card->accountID, sizeof(card->accountID));
+    copyString(disk->status, sizeof(disk->status), card->status, sizeof(card->status));
+    copyString(disk->pinHash, sizeof(disk->pinHash), card->pinHash, sizeof(card->pinHash));
+}
+
+static void cardFromDisk(const DiskCard* disk, StorageCard* card) {
+    memset(card, 0, sizeof(*card));
+    card->cardNumber = disk->cardNumber;
+    copyString(card->cardID, sizeof(card->cardID), disk->cardID, sizeof(disk->cardID));
+    copyString(card->accountID, sizeof(card->accountID), disk->accountID, sizeof(disk->accountID));
+    copyString(card->status, sizeof(card->status), disk->status, sizeof(disk->status));
+    copyString(card->pinHash, sizeof(card->pinHash), disk->pinHash, sizeof(disk->pinHash));
+}
+
+static void accountToDisk(const StorageAccount* account, DiskAccount* disk) {
+    memset(disk, 0, sizeof(*disk));
+    copyString(disk->accountID, sizeof(disk->accountID), account->accountID, sizeof(account->accountID));
+    copyString(disk->customerID, sizeof(disk->customerID), account->customerID, sizeof(account->customerID));
+    copyString(disk->holderName, sizeof(disk->holderName), account->holderName, sizeof(account->holderName));
+    copyString(disk->type, sizeof(disk->type), account->type, sizeof(account->type));
+    copyString(disk->status, sizeof(disk->status), account->status, sizeof(account->status));
+    disk->balance = account->balance;
+}
+
+static void accountFromDisk(const DiskAccount* disk, StorageAccount* account) {
+    memset(account, 0, sizeof(*account));
+    copyString(account->accountID, sizeof(account->accountID), disk->accountID, sizeof(disk->accountID));
+    copyString(account->customerID, sizeof(account->customerID), disk->customerID, sizeof(disk->customerID));
+    copyString(account->holderName, sizeof(account->holderName), disk->holderName, sizeof(disk->holderName));
+    copyString(account->type, sizeof(account->type), disk->type, sizeof(disk->type));
+    copyString(account->status, sizeof(account->status), disk->status, sizeof(disk->status));
+    account->balance = (float)disk->balance;
+}
+
+static bool writeAllAt(int fd, const void* data, size_t len, off_t offset) {
+    const char* p = (const char*)data;
+    while (len > 0) {
+        ssize_t written = pwrite(fd, p, len, offset);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        p += written;
+        len -= (size_t)written;
+        offset += written;
+    }
+    return true;
+}
+
+static bool readAllAt(int fd, void* data, size_t len, off_t offset) {
+    char* p = (char*)data;
+    while (len > 0) {
+        ssize_t got = pread(fd, p, len, offset);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            return false;
+        }
+        p += got;
+        len -= (size_t)got;
+        offset += got;
+    }
+    return true;
+}
+
+// Write the whole record set as a new page file, replacing any existing one
+static bool createPageFile(const char* path) {
+    char tempPath[256];
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+
+    int fd = open(tempPath, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    PageFileHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, PAGE_FILE_MAGIC, sizeof(h.magic));
+    h.pageSize = PAGE_SIZE;
+    h.cardCount = (uint32_t)records.cardCount;
+    h.accountCount = (uint32_t)records.accountCount;
+    h.cardFirstPage = 1;
+    h.accountFirstPage = 1 + (uint32_t)((records.cardCount + CARDS_PER_PAGE - 1) / CARDS_PER_PAGE);
+    h.pendingChecksum = pendingChecksum(&h);
+
+    bool ok = writeAllAt(fd, &h, sizeof(h), 0);
+    for (size_t i = 0; ok && i < records.cardCount; i++) {
+        DiskCard disk;
+        cardToDisk(&records.cards[i], &disk);
+        ok = writeAllAt(fd, &disk, sizeof(disk), cardOffset(&h, i));
+    }
+    for (size_t i = 0; ok && i < records.accountCount; i++) {
+        DiskAccount disk;
+        accountToDisk(&records.accounts[i], &disk);
+        ok = writeAllAt(fd, &disk, sizeof(disk), accountOffset(&h, i));
+    }
+
+    // Pad the last page so every page is whole
+    off_t end = (off_t)(h.accountFirstPage +
+                (records.accountCount + ACCOUNTS_PER_PAGE - 1) / ACCOUNTS_PER_PAGE) * PAGE_SIZE;
+    ok = ok && ftruncate(fd, end) == 0 && fsync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+
+    if (!ok || rename(tempPath, path) != 0) {
+        remove(tempPath);
+        return false;
+    }
+    return true;
+}
+
+// Load every record from an open page file into memory
+static bool loadPageFile(int fd) {
+    if (!readAllAt(fd, &header, sizeof(header), 0) ||
+        memcmp(header.magic, PAGE_FILE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.pageSize != PAGE_SIZE) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < header.cardCount; i++) {
+        DiskCard disk;
+        StorageCard card;
+        if (!readAllAt(fd, &disk, sizeof(disk), cardOffset(&header, i))) {
+            return false;
+        }
+        cardFromDisk(&disk, &card);
+        if (!recordSetPutCard(&records, &card, NULL)) {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < header.accountCount; i++) {
+        DiskAccount disk;
+        StorageAccount account;
+        if (!readAllAt(fd, &disk, sizeof(disk), accountOffset(&header, i))) {
+            return false;
+        }
+        accountFromDisk(&disk, &account);
+        if (!recordSetPutAccount(&records, &account, NULL)) {
+            return false;
+        }
+    }
+
+    // Slots must line up with the file for in-place writes
+    return records.cardCount == header.cardCount && records.accountCount == header.accountCount;
+}
+
+static bool writeAccountRecord(size_t slot) {
+    DiskAccount disk;
+    accountToDisk(&records.accounts[slot], &disk);
+    return writeAllAt(pageFd, &disk, sizeof(disk), accountOffset(&header, slot));
+}
+
+static bool writeCardRecord(size_t slot) {
+    DiskCard disk;
+    cardToDisk(&records.cards[slot], &disk);
+    return writeAllAt(pageFd, &disk, sizeof(disk), cardOffset(&header, slot)) && fdatasync(pageFd) == 0;
+}
+
+// Set recorded balances in memory and in their records, then sync. Memory
+// is updated first, so it holds the committed balances even if a write fails.
+static bool writePendingBalances(const PendingBalance* balances, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        if (balances[i].accountSlot >= records.accountCount) {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        records.accounts[balances[i].accountSlot].balance = (float)balances[i].balance;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (!writeAccountRecord(balances[i].accountSlot)) {
+            return false;
+        }
+    }
+    return fdatasync(pageFd) == 0;
+}
+
+// Apply the balances recorded in the header, then clear them
+static bool finishPendingBalances(void) {
+    if (!writePendingBalances(header.pending, header.pendingCount)) {
+        return false;
+    }
+
+    // Replaying the same balances again is harmless, so clearing needs no sync
+    header.pendingCount = 0;
+    header.pendingChecksum = pendingChecksum(&header);
+    return writeAllAt(pageFd, &header, sizeof(header), 0);
+}
+
+// Remove the batch intent file once its balances are in the records. The
+// removal must be durable before the next change, or a restart would apply
+// the batch's balances over newer ones.
+static bool removeBatchFile(void) {
+    const char* path = getStorageBatchFilePath();
+    batchPending = !((unlink(path) == 0 || errno == ENOENT) && syncParentDirectory(path));
+    return !batchPending;
+}
+
+// Apply the batch left in the intent file by an interrupted apply_batch. A
+// torn or corrupt file is a batch that never committed and is dropped.
+static bool finishBatchFile(void) {
+    int fd = open(getStorageBatchFilePath(), O_RDONLY);
+    if (fd < 0) {
+        batchPending = false;
+        return errno == ENOENT;
+    }
+
+    BatchFileHeader batchHeader;
+    PendingBalance* balances = NULL;
+    bool valid = readAllAt(fd, &batchHeader, sizeof(batchHeader), 0) &&
+                 memcmp(batchHeader.magic, BATCH_FILE_MAGIC, sizeof(batchHeader.magic)) == 0 &&
+                 batchHeader.count > 0 && batchHeader.count <= records.accountCount;
+    if (valid) {
+        balances = (PendingBalance*)malloc((size_t)batchHeader.count * sizeof(PendingBalance));
+        valid = balances != NULL &&
+                readAllAt(fd, balances, (size_t)batchHeader.count * sizeof(PendingBalance), sizeof(batchHeader)) &&
+                batchHeader.checksum == batchChecksum(batchHeader.count, balances);
+    }
+    close(fd);
+
+    bool ok = true;
+    if (valid) {
+        ok = writePendingBalances(balances, batchHeader.count);
+    } else {
+        writeErrorLog("Discarding an incomplete balance batch in the storage batch file");
+    }
+    free(balances);
+
+    // A batch that could not be applied stays on disk for the next attempt
+    return ok && removeBatchFile();
+}
+
+static bool binaryOpen(void) {
+    const char* path = getStoragePageFilePath();
+
+    pthread_mutex_lock(&binaryLock);
+    recordSetFree(&records);
+
+    if (access(path, F_OK) != 0) {
+        if (!recordSetImportText(&records) || !createPageFile(path)) {
+            recordSetFree(&records);
+            pthread_mutex_unlock(&binaryLock);
+            writeErrorLog("Failed to create the storage page file from the text data files");
+            return false;
+        }
+        recordSetFree(&records);
+
+        char logMsg[300];
+        snprintf(logMsg, sizeof(logMsg), "Imported text data files into %s", path);
+        writeInfoLog(logMsg);
+    }
+
+    pageFd = open(path, O_RDWR);
+    if (pageFd < 0 || !loadPageFile(pageFd)) {
+        if (pageFd >= 0) {
+            close(pageFd);
+            pageFd = -1;
+        }
+        recordSetFree(&records);
+        pthread_mutex_unlock(&binaryLock);
+        writeErrorLog("Failed to load the storage page file");
+        return false;
+    }
+
+    if (header.pendingCount > 0) {
+        bool valid = header.pendingCount <= STORAGE_MAX_DELTAS &&
+                     header.pendingChecksum == pendingChecksum(&header);
+        if (!valid || !finishPendingBalances()) {
+            writeErrorLog("Discarding an incomplete balance change in the storage page file");
+            header.pendingCount = 0;
+            header.pendingChecksum = pendingChecksum(&header);
+            writeAllAt(pageFd, &header, sizeof(header), 0);
+        }
+    }
+
+    // A batch is newer than any change left in the header
+    if (!finishBatchFile()) {
+        writeErrorLog("Failed to apply an interrupted balance batch; it will be retried");
+    }
+
+    pthread_mutex_unlock(&binaryLock);
+    return true;
+}
+
+static void binaryClose(void) {
+    pthread_mutex_lock(&binaryLock);
+    if (pageFd >= 0) {
+        fsync(pageFd);
+        close(pageFd);
+        pageFd = -1;
+    }
+    recordSetFree(&records);
+    pthread_mutex_unlock(&binaryLock);
+}
+
+static bool binaryGetCard(int cardNumber, StorageCard* card) {
+    pthread_mutex_lock(&binaryLock);
+    long index = recordSetFindCard(&records, cardNumber);
+    if (index >= 0 && card != NULL) {
+        *card = records.cards[index];
+    }
+    pthread_mutex_unlock(&binaryLock);
+    return index >= 0;
+}
+
+static bool binaryGetAccount(const char* accountID, StorageAccount* account) {
+    pthread_mutex_lock(&binaryLock);
+    long index = recordSetFindAccount(&records, accountID);
+    if (index >= 0 && account != NULL) {
+        *account = records.accounts[index];
+    }
+    pthread_mutex_unlock(&binaryLock);
+    return index >= 0;
+}
+
+static bool binaryGetBalance(const char* accountID, float* balance) {
+    pthread_mutex_lock(&binaryLock);
+    long index = recordSetFindAccount(&records, accountID);
+    if (index >= 0) {
+        *balance = records.accounts[index].balance;
+    }
+    pthread_mutex_unlock(&binaryLock);
+    return index >= 0;
+}
+
+// Record the new balances in the header, sync, then write them to the
+// records. Called with binaryLock held and the page file open.
+static bool applyDeltasLocked(StorageDelta* deltas, int count) {
+    if (batchPending && !finishBatchFile()) {
+        writeErrorLog("An earlier balance batch is not yet applied; balance change refused");
+        return false;
+    }
+
+    PageFileHeader intent = header;
+    intent.pendingCount = (uint32_t)count;
+    memset(intent.pending, 0, sizeof(intent.pending));
+    for (int i = 0; i < count; i++) {
+        long slot = recordSetFindAccount(&records, deltas[i].accountID);
+        if (slot < 0) {
+            return false;
+        }
+        deltas[i].newBalance = records.accounts[slot].balance + deltas[i].delta;
+        if (deltas[i].newBalance < 0) {
+            return false;
+        }
+        intent.pending[i].accountSlot = (uint32_t)slot;
+        intent.pending[i].balance = deltas[i].newBalance;
+    }
+    intent.pendingChecksum = pendingChecksum(&intent);
+
+    // Once the intent is durable the change will complete, even across a crash
+    if (!writeAllAt(pageFd, &intent, sizeof(intent), 0) || fdatasync(pageFd) != 0) {
+        writeErrorLog("Failed to record balance change in the storage page file");
+        return false;
+    }
+    header = intent;
+
+    if (!finishPendingBalances()) {
+        writeErrorLog("Balance change recorded but not yet applied; it will complete on restart");
+        return false;
+    }
+    return true;
+}
+
+static bool binaryApplyDelta(StorageDelta* deltas, int count) {
+    if (deltas == NULL || count <= 0 || count > STORAGE_MAX_DELTAS) {
+        return false;
+    }
+
+    pthread_mutex_lock(&binaryLock);
+    bool ok = pageFd >= 0 && applyDeltasLocked(deltas, count);
+    pthread_mutex_unlock(&binaryLock);
+    return ok;
+}
+
+// Record the whole batch in the intent file, sync it, then write the
+// records. Called with binaryLock held and the page file open.
+static bool applyBatchLocked(StorageDelta* deltas, int count) {
+    if (batchPending && !finishBatchFile()) {
+        writeErrorLog("An earlier balance batch is not yet applied; batch refused");
+        return false;
+    }
+
+    PendingBalance* balances = (PendingBalance*)calloc((size_t)count, sizeof(PendingBalance));
+    if (balances == NULL) {
+        return false;
+    }
+    for (int i = 0; i < count; i++) {
+        long slot = recordSetFindAccount(&records, deltas[i].accountID);
+        if (slot < 0) {
+            free(balances);
+            return false;
+        }
+        deltas[i].newBalance = records.accounts[slot].balance + deltas[i].delta;
+        if (deltas[i].newBalance < 0) {
+            free(balances);
+            return false;
+        }
+        balances[i].accountSlot = (uint32_t)slot;
+        balances[i].balance = deltas[i].newBalance;
+    }
+
+    BatchFileHeader batchHeader;
+    memset(&batchHeader, 0, sizeof(batchHeader));
+    memcpy(batchHeader.magic, BATCH_FILE_MAGIC, sizeof(batchHeader.magic));
+    batchHeader.count = (uint32_t)count;
+    batchHeader.checksum = batchChecksum(batchHeader.count, balances);
+
+    // Once the intent file and its directory entry are durable the batch
+    // will complete, even across a crash
+    const char* path = getStorageBatchFilePath();
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    bool ok = fd >= 0 && writeAllAt(fd, &batchHeader, sizeof(batchHeader), 0) &&
+              writeAllAt(fd, balances, (size_t)count * sizeof(PendingBalance), sizeof(batchHeader)) &&
+              fsync(fd) == 0;
+    if (fd >= 0) {
+        ok = close(fd) == 0 && ok;
+    }
+    if (!ok || !syncParentDirectory(path)) {
+        unlink(path);
+        free(balances);
+        writeErrorLog("Failed to record balance batch in the storage batch file");
+        return false;
+    }
+
+    batchPending = true;
+    if (!writePendingBalances(balances, (uint32_t)count) || !removeBatchFile()) {
+        writeErrorLog("Balance batch recorded but not yet applied; it will complete before the next change");
+    }
+    free(balances);
+    return true;
+}
+
+// Small batches fit in the header; larger ones go through the intent file
+static bool binaryApplyBatch(StorageDelta* deltas, int count) {
+    if (deltas == NULL || count <= 0) {
+        return false;
+    }
+
+    pthread_mutex_lock(&binaryLock);
+    bool ok = pageFd >= 0 && (count <= STORAGE_MAX_DELTAS ? applyDeltasLocked(deltas, count)
+                                                          : applyBatchLocked(deltas, count));
+    pthread_mutex_unlock(&binaryLock);
+    return ok;
+}
+
+static bool binarySetCardStatus(int cardNumber, const char* status) {
+    if (status == NULL) {
+        return false;
+    }
+
+    pthread_mutex_lock(&binaryLock);
+    long slot = recordSetFindCard(&records, cardNumber);
+    bool ok = slot >= 0 && pageFd >= 0;
+    if (ok) {
+        StorageCard* card = &records.cards[slot];
+        strncpy(card->status, status, sizeof(card->status) - 1);
+        card->status[sizeof(card->status) - 1] = '\0';
+        ok = writeCardRecord((size_t)slot);
+    }
+    pthread_mutex_unlock(&binaryLock);
+    return ok;
+}
+
+static bool binarySetCardPinHash(int cardNumber, const char* pinHash) {
+    if (pinHash == NULL) {
+        return false;
+    }
+
+    pthread_mutex_lock(&binaryLock);
+    long slot = recordSetFindCard(&records, cardNumber);
+    bool ok = slot >= 0 && pageFd >= 0;
+    if (ok) {
+        StorageCard* card = &records.cards[slot];
+        strncpy(card->pinHash, pinHash, sizeof(card->pinHash) - 1);
+        card->pinHash[sizeof(card->pinHash) - 1] = '\0';
+        ok = writeCardRecord((size_t)slot);
+    }
+    pthread_mutex_unlock(&binaryLock);
+    return ok;
+}
+
+// The records are added in memory and the page file rewritten from them;
+// on failure the records are reloaded from the unchanged file
+static bool binaryAddAccount(const StorageAccount* account, const StorageCard* card, const char* expiryDate) {
+    (void)expiryDate;
+    if (account == NULL || card == NULL) {
+        return false;
+    }
+
+    const char* path = getStoragePageFilePath();
+    pthread_mutex_lock(&binaryLock);
+    bool ok = pageFd >= 0 && recordSetFindCard(&records, card->cardNumber) < 0 &&
+              recordSetFindAccount(&records, account->accountID) < 0;
+    if (!ok) {
+        pthread_mutex_unlock(&binaryLock);
+        return false;
+    }
+
+    ok = recordSetPutAccount(&records, account, NULL) && recordSetPutCard(&records, card, NULL) &&
+         createPageFile(path);
+    if (ok) {
+        int fd = open(path, O_RDWR);
+        ok = fd >= 0 && readAllAt(fd, &header, sizeof(header), 0);
+        if (ok) {
+            close(pageFd);
+            pageFd = fd;
+        } else if (fd >= 0) {
+            close(fd);
+        }
+    }
+    if (!ok) {
+        writeErrorLog("Failed to add an account to the storage page file");
+        recordSetFree(&records);
+        if (!loadPageFile(pageFd)) {
+            writeErrorLog("Failed to reload the storage page file");
+        }
+    }
+    pthread_mutex_unlock(&binaryLock);
+    return ok;
+}
+
+// The callback runs with the engine locked and must not call back into it
+static bool binaryScan(StorageTable table, StorageScanFn fn, void* context) {
+    if (fn == NULL) {
+        return false;
+    }
+
+    pthread_mutex_lock(&binaryLock);
+    size_t count = table == STORAGE_CARDS ? records.cardCount : records.accountCount;
+    for (size_t i = 0; i < count; i++) {
+        const void* record = table == STORAGE_CARDS ? (const void*)&records.cards[i]
+                                                    : (const void*)&records.accounts[i];
+        if (!fn(record, context)) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&binaryLock);
+    return true;
+}
+
+const StorageEngine binaryStorageEngine = {
+    "binary",
+    binaryOpen,
+    binaryClose,
+    binaryGetCard,
+    binaryGetAccount,
+    binaryGetBalance,
+    binaryApplyDelta,
+    binaryApplyBatch,
+    binarySetCardStatus,
+    binarySetCardPinHash,
+    binaryAddAccount,
+    binaryScan
+};
@@ -0,0 +1,79 @@
+#include "storage_engine.h"
+#include "../utils/logger.h"
+#include "../config/config_manager.h"
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+// Configuration key naming the engine
+#define CONFIG_STORAGE_ENGINE "storage_engine"
+#define DEFAULT_STORAGE_ENGINE "text"
+
+static const StorageEngine* const engines[] = {
+    &textStorageEngine,
+    &binaryStorageEngine,
+    &memoryStorageEngine
+};
+
+static pthread_mutex_t engineLock = PTHREAD_MUTEX_INITIALIZER;
+static const StorageEngine* activeEngine = NULL;
+
+bool storageEngineSelect(const char* name) {
+    const StorageEngine* engine = NULL;
+    for (size_t i = 0; i < sizeof(engines) / sizeof(engines[0]); i++) {
+        if (name != NULL && strcmp(engines[i]->name, name) == 0) {
+            engine = engines[i];
+            break;
+        }
+    }
+    if (engine == NULL) {
+        char errorMsg[100];
+        snprintf(errorMsg, sizeof(errorMsg), "Unknown storage engine '%s'", name != NULL ? name : "");
+        writeErrorLog(errorMsg);
+        return false;
+    }
+
+    pthread_mutex_lock(&engineLock);
+    if (activeEngine != NULL) {
+        activeEngine->close();
+        activeEngine = NULL;
+    }
+    bool opened = engine->open();
+    if (opened) {
+        activeEngine = engine;
+    }
+    pthread_mutex_unlock(&engineLock);
+
+    char logMsg[100];
+    snprintf(logMsg, sizeof(logMsg), opened ? "Storage engine '%s' opened" : "Failed to open storage engine '%s'",
+             engine->name);
+    if (opened) {
+        writeInfoLog(logMsg);
+    } else {
+        writeErrorLog(logMsg);
+    }
+    return opened;
+}
+
+bool storageEngineInit(void) {
+    return storageEngineSelect(getConfigValue(CONFIG_STORAGE_ENGINE, DEFAULT_STORAGE_ENGINE));
+}
+
+const StorageEngine* storageEngine(void) {
+    pthread_mutex_lock(&engineLock);
+    if (activeEngine == NULL && textStorageEngine.open()) {
+        activeEngine = &textStorageEngine;
+    }
+    const StorageEngine* engine = activeEngine != NULL ? activeEngine : &textStorageEngine;
+    pthread_mutex_unlock(&engineLock);
+    return engine;
+}
+
+void storageEngineShutdown(void) {
+    pthread_mutex_lock(&engineLock);
+    if (activeEngine != NULL) {
+        activeEngine->close();
+        activeEngine = NULL;
+    }
+    pthread_mutex_unlock(&engineLock);
+}
@@ -0,0 +1,132 @@
+#ifndef STORAGE_ENGINE_H
+#define STORAGE_ENGINE_H
+
+#include <stdbool.h>
+
+/**
+ * Pluggable storage backends for cards and account balances
+ *
+ * database.c talks to the active engine through this table of operations,
+ * so the on-disk format can change without touching its callers. Three
+ * engines are provided:
+ *   text    - card.txt / customer.txt with the balance journal (default)
+ *   binary  - fixed-size records in a page file, imported from the text files
+ *   memory  - in-process tables for tests and benchmarks; nothing is persisted
+ *
+ * The engine is chosen at startup with the storage_engine config key.
+ */
+
+// Card fields served by every engine
+typedef struct {
+    int cardNumber;
+    char cardID[12];
+    char accountID[20];
+    char status[12];
+    char pinHash[65];
+} StorageCard;
+
+// Account fields served by every engine
+typedef struct {
+    char accountID[20];
+    char customerID[20];
+    char holderName[100];
+    char type[20];
+    char status[20];
+    float balance;
+} StorageAccount;
+
+// One balance change; newBalance is filled in by apply_delta
+typedef struct {
+    char accountID[20];
+    float delta;
+    float newBalance;
+} StorageDelta;
+
+// Most deltas applied as one unit
+#define STORAGE_MAX_DELTAS 8
+
+typedef enum {
+    STORAGE_CARDS,
+    STORAGE_ACCOUNTS
+} StorageTable;
+
+// Scan callback; `record` is a StorageCard or StorageAccount. Return false to stop.
+typedef bool (*StorageScanFn)(const void* record, void* context);
+
+typedef struct {
+    const char* name;
+
+    // Prepare the engine; called once at startup
+    bool (*open)(void);
+
+    // Flush and release everything; the engine may be opened again later
+    void (*close)(void);
+
+    // Look up a card; `card` may be NULL for an existence check
+    bool (*get_card)(int cardNumber, StorageCard* card);
+
+    // Look up an account with its current balance; `account` may be NULL
+    bool (*get_account)(const char* accountID, StorageAccount* account);
+
+    // Read only an account's last committed balance; the text engine serves
+    // it from its balance versions without waiting for commits
+    bool (*get_balance)(const char* accountID, float* balance);
+
+    // Add each delta to its account, all or nothing; fails if any balance would go negative
+    bool (*apply_delta)(StorageDelta* deltas, int count);
+
+    // apply_delta without the STORAGE_MAX_DELTAS limit, for batch posting; each
+    // account may appear only once. Still all or nothing.
+    bool (*apply_batch)(StorageDelta* deltas, int count);
+
+    // Set a card's status, e.g. "Active" or "Blocked"
+    bool (*set_card_status)(int cardNumber, const char* status);
+
+    // Replace a card's PIN hash
+    bool (*set_card_pin_hash)(int cardNumber, const char* pinHash);
+
+    // Add a new account together with its first card; fails if either
+    // already exists. `expiryDate` is kept only by engines that store it.
+    bool (*add_account)(const StorageAccount* account, const StorageCard* card, const char* expiryDate);
+
+    // Visit every record of a table in storage order
+    bool (*scan)(StorageTable table, StorageScanFn fn, void* context);
+} StorageEngine;
+
+extern const StorageEngine textStorageEngine;
+extern const StorageEngine binaryStorageEngine;
+extern const StorageEngine memoryStorageEngine;
+
+/**
+ * Open the engine named by the storage_engine config key ("text" if unset)
+ *
+ * @return true if the engine opened
+ */
+bool storageEngineInit(void);
+
+/**
+ * Switch to an engine by name, closing the current one
+ *
+ * @param name "text", "binary" or "memory"
+ * @return true if the engine opened
+ */
+bool storageEngineSelect(const char* name);
+
+/**
+ * The active engine; the text engine is opened on first use if none was selected
+ */
+const StorageEngine* storageEngine(void);
+
+/**
+ * Close the active engine
+ */
+void storageEngineShutdown(void);
+
+/**
+ * Add or replace records in the memory engine, for tests and benchmarks
+ *
+ * Either pointer may be NULL.
+ */
+bool memoryStoragePut(const StorageCard* card, const StorageAccount* account);
+
+#endif // STORAGE_ENGINE_H
@@ -0,0 +1,202 @@
+#include "storage_engine.h"
+#include "storage_records.h"
+#include "../utils/logger.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+/**
+ * Memory engine: the text files are imported at open and every change
+ * stays in this process. Intended for tests and benchmarks.
+ */
+
+static pthread_mutex_t memoryLock = PTHREAD_MUTEX_INITIALIZER;
+static StorageRecordSet records;
+
+static bool memoryOpen(void) {
+    pthread_mutex_lock(&memoryLock);
+    recordSetFree(&records);
+    bool ok = recordSetImportText(&records);
+    pthread_mutex_unlock(&memoryLock);
+
+    if (!ok) {
+        writeErrorLog("Memory storage engine could not import the data files; starting empty");
+    }
+    return true;
+}
+
+static void memoryClose(void) {
+    pthread_mutex_lock(&memoryLock);
+    recordSetFree(&records);
+    pthread_mutex_unlock(&memoryLock);
+}
+
+static bool memoryGetCard(int cardNumber, StorageCard* card) {
+    pthread_mutex_lock(&memoryLock);
+    long index = recordSetFindCard(&records, cardNumber);
+    if (index >= 0 && card != NULL) {
+        *card = records.cards[index];
+    }
+    pthread_mutex_unlock(&memoryLock);
+    return index >= 0;
+}
+
+static bool memoryGetAccount(const char* accountID, StorageAccount* account) {
+    pthread_mutex_lock(&memoryLock);
+    long index = recordSetFindAccount(&records, accountID);
+    if (index >= 0 && account != NULL) {
+        *account = records.accounts[index];
+    }
+    pthread_mutex_unlock(&memoryLock);
+    return index >= 0;
+}
+
+static bool memoryGetBalance(const char* accountID, float* balance) {
+    pthread_mutex_lock(&memoryLock);
+    long index = recordSetFindAccount(&records, accountID);
+    if (index >= 0) {
+        *balance = records.accounts[index].balance;
+    }
+    pthread_mutex_unlock(&memoryLock);
+    return index >= 0;
+}
+
+// Validate every delta, then apply them all; `indexes` has room for `count` entries
+static bool applyDeltas(StorageDelta* deltas, int count, long* indexes) {
+    pthread_mutex_lock(&memoryLock);
+
+    // Validate everything before changing anything
+    for (int i = 0; i < count; i++) {
+        indexes[i] = recordSetFindAccount(&records, deltas[i].accountID);
+        if (indexes[i] < 0) {
+            pthread_mutex_unlock(&memoryLock);
+            return false;
+        }
+        deltas[i].newBalance = records.accounts[indexes[i]].balance + deltas[i].delta;
+        if (deltas[i].newBalance < 0) {
+            pthread_mutex_unlock(&memoryLock);
+            return false;
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        records.accounts[indexes[i]].balance += deltas[i].delta;
+        deltas[i].newBalance = records.accounts[indexes[i]].balance;
+    }
+
+    pthread_mutex_unlock(&memoryLock);
+    return true;
+}
+
+static bool memoryApplyDelta(StorageDelta* deltas, int count) {
+    long indexes[STORAGE_MAX_DELTAS];
+
+    if (deltas == NULL || count <= 0 || count > STORAGE_MAX_DELTAS) {
+        return false;
+    }
+    return applyDeltas(deltas, count, indexes);
+}
+
+static bool memoryApplyBatch(StorageDelta* deltas, int count) {
+    if (deltas == NULL || count <= 0) {
+        return false;
+    }
+
+    long* indexes = (long*)malloc((size_t)count * sizeof(long));
+    bool ok = indexes != NULL && applyDeltas(deltas, count, indexes);
+    free(indexes);
+    return ok;
+}
+
+static bool memorySetCardStatus(int cardNumber, const char* status) {
+    if (status == NULL) {
+        return false;
+    }
+
+    pthread_mutex_lock(&memoryLock);
+    long index = recordSetFindCard(&records, cardNumber);
+    if (index >= 0) {
+        StorageCard* card = &records.cards[index];
+        strncpy(card->status, status, sizeof(card->status) - 1);
+        card->status[sizeof(card->status) - 1] = '\0';
+    }
+    pthread_mutex_unlock(&memoryLock);
+    return index >= 0;
+}
+
+static bool memorySetCardPinHash(int cardNumber, const char* pinHash) {
+    if (pinHash == NULL) {
+        return false;
+    }
+
+    pthread_mutex_lock(&memoryLock);
+    long index = recordSetFindCard(&records, cardNumber);
+    if (index >= 0) {
+        StorageCard* card = &records.cards[index];
+        strncpy(card->pinHash, pinHash, sizeof(card->pinHash) - 1);
+        card->pinHash[sizeof(card->pinHash) - 1] = '\0';
+    }
+    pthread_mutex_unlock(&memoryLock);
+    return index >= 0;
+}
+
+// The callback runs with the engine locked and must not call back into it
+static bool memoryScan(StorageTable table, StorageScanFn fn, void* context) {
+    if (fn == NULL) {
+        return false;
+    }
+
+    pthread_mutex_lock(&memoryLock);
+    size_t count = table == STORAGE_CARDS ? records.cardCount : records.accountCount;
+    for (size_t i = 0; i < count; i++) {
+        const void* record = table == STORAGE_CARDS ? (const void*)&records.cards[i]
+                                                    : (const void*)&records.accounts[i];
+        if (!fn(record, context)) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&memoryLock);
+    return true;
+}
+
+static bool memoryAddAccount(const StorageAccount* account, const StorageCard* card, const char* expiryDate) {
+    (void)expiryDate;
+    if (account == NULL || card == NULL) {
+        return false;
+    }
+
+    pthread_mutex_lock(&memoryLock);
+    bool ok = recordSetFindCard(&records, card->cardNumber) < 0 &&
+              recordSetFindAccount(&records, account->accountID) < 0 &&
+              recordSetPutAccount(&records, account, NULL) && recordSetPutCard(&records, card, NULL);
+    pthread_mutex_unlock(&memoryLock);
+    return ok;
+}
+
+bool memoryStoragePut(const StorageCard* card, const StorageAccount* account) {
+    bool ok = true;
+
+    pthread_mutex_lock(&memoryLock);
+    if (card != NULL) {
+        ok = recordSetPutCard(&records, card, NULL);
+    }
+    if (ok && account != NULL) {
+        ok = recordSetPutAccount(&records, account, NULL);
+    }
+    pthread_mutex_unlock(&memoryLock);
+    return ok;
+}
+
+const StorageEngine memoryStorageEngine = {
+    "memory",
+    memoryOpen,
+    memoryClose,
+    memoryGetCard,
+    memoryGetAccount,
+    memoryGetBalance,
+    memoryApplyDelta,
+    memoryApplyBatch,
+    memorySetCardStatus,
+    memorySetCardPinHash,
+    memoryAddAccount,
+    memoryScan
+};
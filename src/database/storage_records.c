@@ -0,0 +1,197 @@
+#include "storage_records.h"
+#include "../utils/hash_utils.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+static size_t hashCardNumber(int cardNumber) {
+    uint32_t x = (uint32_t)cardNumber;
+    x ^= x >> 16;
+    x *= 0x45d9f3bu;
+    x ^= x >> 16;
+    return (size_t)x;
+}
+
+long recordSetFindCard(const StorageRecordSet* set, int cardNumber) {
+    if (set->cardSlotCount == 0) {
+        return -1;
+    }
+    size_t mask = set->cardSlotCount - 1;
+    for (size_t i = hashCardNumber(cardNumber) & mask; set->cardSlots[i] >= 0; i = (i + 1) & mask) {
+        if (set->cards[set->cardSlots[i]].cardNumber == cardNumber) {
+            return set->cardSlots[i];
+        }
+    }
+    return -1;
+}
+
+long recordSetFindAccount(const StorageRecordSet* set, const char* accountID) {
+    if (set->accountSlotCount == 0) {
+        return -1;
+    }
+    size_t mask = set->accountSlotCount - 1;
+    for (size_t i = (size_t)fnv1a_hash(accountID) & mask; set->accountSlots[i] >= 0; i = (i + 1) & mask) {
+        if (strcmp(set->accounts[set->accountSlots[i]].accountID, accountID) == 0) {
+            return set->accountSlots[i];
+        }
+    }
+    return -1;
+}
+
+// Rebuild the card index with room for at least twice the records
+static bool rehashCards(StorageRecordSet* set, size_t wanted) {
+    size_t slotCount = 64;
+    while (slotCount < wanted * 2) {
+        slotCount <<= 1;
+    }
+    long* slots = (long*)malloc(slotCount * sizeof(long));
+    if (slots == NULL) {
+        return false;
+    }
+    for (size_t i = 0; i < slotCount; i++) {
+        slots[i] = -1;
+    }
+    for (size_t r = 0; r < set->cardCount; r++) {
+        size_t i = hashCardNumber(set->cards[r].cardNumber) & (slotCount - 1);
+        while (slots[i] >= 0) {
+            i = (i + 1) & (slotCount - 1);
+        }
+        slots[i] = (long)r;
+    }
+
+    free(set->cardSlots);
+    set->cardSlots = slots;
+    set->cardSlotCount = slotCount;
+    return true;
+}
+
+static bool rehashAccounts(StorageRecordSet* set, size_t wanted) {
+    size_t slotCount = 64;
+    while (slotCount < wanted * 2) {
+        slotCount <<= 1;
+    }
+    long* slots = (long*)malloc(slotCount * sizeof(long));
+    if (slots == NULL) {
+        return false;
+    }
+    for (size_t i = 0; i < slotCount; i++) {
+        slots[i] = -1;
+    }
+    for (size_t r = 0; r < set->accountCount; r++) {
+        size_t i = (size_t)fnv1a_hash(set->accounts[r].accountID) & (slotCount - 1);
+        while (slots[i] >= 0) {
+            i = (i + 1) & (slotCount - 1);
+        }
+        slots[i] = (long)r;
+    }
+
+    free(set->accountSlots);
+    set->accountSlots = slots;
+    set->accountSlotCount = slotCount;
+    return true;
+}
+
+bool recordSetPutCard(StorageRecordSet* set, const StorageCard* card, long* index) {
+    long existing = recordSetFindCard(set, card->cardNumber);
+    if (existing >= 0) {
+        set->cards[existing] = *card;
+        if (index != NULL) {
+            *index = existing;
+        }
+        return true;
+    }
+
+    if (set->cardCount == set->cardCapacity) {
+        size_t capacity = set->cardCapacity == 0 ? 64 : set->cardCapacity * 2;
+        StorageCard* grown = (StorageCard*)realloc(set->cards, capacity * sizeof(StorageCard));
+        if (grown == NULL) {
+            return false;
+        }
+        set->cards = grown;
+        set->cardCapacity = capacity;
+    }
+    if ((set->cardCount + 1) * 2 > set->cardSlotCount && !rehashCards(set, set->cardCount + 1)) {
+        return false;
+    }
+
+    long slot = (long)set->cardCount++;
+    set->cards[slot] = *card;
+    size_t i = hashCardNumber(card->cardNumber) & (set->cardSlotCount - 1);
+    while (set->cardSlots[i] >= 0) {
+        i = (i + 1) & (set->cardSlotCount - 1);
+    }
+    set->cardSlots[i] = slot;
+
+    if (index != NULL) {
+        *index = slot;
+    }
+    return true;
+}
+
+bool recordSetPutAccount(StorageRecordSet* set, const StorageAccount* account, long* index) {
+    long existing = recordSetFindAccount(set, account->accountID);
+    if (existing >= 0) {
+        set->accounts[existing] = *account;
+        if (index != NULL) {
+            *index = existing;
+        }
+        return true;
+    }
+
+    if (set->accountCount == set->accountCapacity) {
+        size_t capacity = set->accountCapacity == 0 ? 64 : set->accountCapacity * 2;
+        StorageAccount* grown = (StorageAccount*)realloc(set->accounts, capacity * sizeof(StorageAccount));
+        if (grown == NULL) {
+            return false;
+        }
+        set->accounts = grown;
+        set->accountCapacity = capacity;
+    }
+    if ((set->accountCount + 1) * 2 > set->accountSlotCount && !rehashAccounts(set, set->accountCount + 1)) {
+        return false;
+    }
+
+    long slot = (long)set->accountCount++;
+    set->accounts[slot] = *account;
+    size_t i = (size_t)fnv1a_hash(account->accountID) & (set->accountSlotCount - 1);
+    while (set->accountSlots[i] >= 0) {
+        i = (i + 1) & (set->accountSlotCount - 1);
+    }
+    set->accountSlots[i] = slot;
+
+    if (index != NULL) {
+        *index = slot;
+    }
+    return true;
+}
+
+typedef struct {
+    StorageRecordSet* set;
+    bool ok;
+} ImportContext;
+
+static bool importCard(const void* record, void* context) {
+    ImportContext* import = (ImportContext*)context;
+    import->ok = recordSetPutCard(import->set, (const StorageCard*)record, NULL);
+    return import->ok;
+}
+
+static bool importAccount(const void* record, void* context) {
+    ImportContext* import = (ImportContext*)context;
+    import->ok = recordSetPutAccount(import->set, (const StorageAccount*)record, NULL);
+    return import->ok;
+}
+
+bool recordSetImportText(StorageRecordSet* set) {
+    ImportContext import = { set, true };
+    return textStorageEngine.scan(STORAGE_CARDS, importCard, &import) && import.ok &&
+           textStorageEngine.scan(STORAGE_ACCOUNTS, importAccount, &import) && import.ok;
+}
+
+void recordSetFree(StorageRecordSet* set) {
+    free(set->cards);
+    free(set->cardSlots);
+    free(set->accounts);
+    free(set->accountSlots);
+    memset(set, 0, sizeof(*set));
+}
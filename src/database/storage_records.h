@@ -0,0 +1,42 @@
+#ifndef STORAGE_RECORDS_H
+#define STORAGE_RECORDS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "storage_engine.h"
+
+/**
+ * In-memory card and account tables shared by the binary and memory engines
+ *
+ * Records live in arrays, so a record's index doubles as its slot in the
+ * binary page file; hash indexes map card numbers and account IDs to those
+ * indexes. Callers provide their own locking.
+ */
+typedef struct {
+    StorageCard* cards;
+    size_t cardCount;
+    size_t cardCapacity;
+    long* cardSlots;              // Open-addressed index into `cards`, -1 when empty
+    size_t cardSlotCount;         // Always a power of two
+
+    StorageAccount* accounts;
+    size_t accountCount;
+    size_t accountCapacity;
+    long* accountSlots;
+    size_t accountSlotCount;
+} StorageRecordSet;
+
+// Index of a card or account, or -1 if absent
+long recordSetFindCard(const StorageRecordSet* set, int cardNumber);
+long recordSetFindAccount(const StorageRecordSet* set, const char* accountID);
+
+// Add a record, or replace the one with the same key; `index` receives its position
+bool recordSetPutCard(StorageRecordSet* set, const StorageCard* card, long* index);
+bool recordSetPutAccount(StorageRecordSet* set, const StorageAccount* account, long* index);
+
+// Fill the set from card.txt and customer.txt through the text engine
+bool recordSetImportText(StorageRecordSet* set);
+
+void recordSetFree(StorageRecordSet* set);
+
+#endif // STORAGE_RECORDS_H
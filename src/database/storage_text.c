@@ -0,0 +1,468 @@
+#include "storage_engine.h"
+#include "database.h"
+#include "card_index.h"
+#include "customer_index.h"
+#include "journal.h"
+#include "balance_versions.h"
+#include "snapshot.h"
+#include "../common/paths.h"
+#include "../utils/logger.h"
+#include "../utils/table_reader.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+/**
+ * Text engine: the original pipe-delimited files
+ *
+ * Cards come from the card.txt index and accounts from the customer.txt
+ * offset index, with balances committed to the journal but not yet
+ * checkpointed taking precedence. With the sharded layout each card and
+ * account lives in its shard's copy of those files. Every commit also
+ * publishes balance versions, so balance reads and account scans see a
+ * committed snapshot without waiting for writers.
+ */
+
+// Serialises read-modify-write balance updates and account additions
+static pthread_mutex_t balanceLock = PTHREAD_MUTEX_INITIALIZER;
+
+// Serialises writers of the card files, which share one temp file per shard
+static pthread_mutex_t cardFileLock = PTHREAD_MUTEX_INITIALIZER;
+
+static void copyString(char* dest, size_t destSize, const char* src) {
+    strncpy(dest, src, destSize - 1);
+    dest[destSize - 1] = '\0';
+}
+
+static bool textOpen(void) {
+    // Replay any balance changes not yet checkpointed before serving sessions
+    if (!journalOpen()) {
+        if (journalOwnedElsewhere()) {
+            return false;
+        }
+        writeErrorLog("Balance journal unavailable; balances will be written directly");
+    }
+    return true;
+}
+
+static void textClose(void) {
+    journalClose();
+    balanceVersionsReset();
+}
+
+static bool textGetCard(int cardNumber, StorageCard* card) {
+    CardIndexEntry entry;
+    if (!cardIndexLookup(cardNumber, card != NULL ? &entry : NULL)) {
+        return false;
+    }
+
+    if (card != NULL) {
+        card->cardNumber = entry.cardNumber;
+        copyString(card->cardID, sizeof(card->cardID), entry.cardID);
+        copyString(card->accountID, sizeof(card->accountID), entry.accountID);
+        copyString(card->status, sizeof(card->status), entry.status);
+        copyString(card->pinHash, sizeof(card->pinHash), entry.pinHash);
+    }
+    return true;
+}
+
+static bool textGetAccount(const char* accountID, StorageAccount* account) {
+    CustomerIndexEntry entry;
+    if (!customerIndexLookup(accountID, &entry)) {
+        return false;
+    }
+
+    if (account != NULL) {
+        copyString(account->accountID, sizeof(account->accountID), entry.accountID);
+        copyString(account->customerID, sizeof(account->customerID), entry.customerID);
+        copyString(account->holderName, sizeof(account->holderName), entry.holderName);
+        copyString(account->type, sizeof(account->type), entry.type);
+        copyString(account->status, sizeof(account->status), entry.status);
+
+        // A committed change may still be waiting in the journal
+        if (!journalLookupBalance(accountID, &account->balance)) {
+            account->balance = entry.balance;
+        }
+    }
+    return true;
+}
+
+// Current balance including journaled changes
+static bool currentBalance(const char* accountID, float* balance) {
+    if (journalLookupBalance(accountID, balance)) {
+        return true;
+    }
+
+    CustomerIndexEntry entry;
+    if (!customerIndexLookup(accountID, &entry)) {
+        return false;
+    }
+    *balance = entry.balance;
+    return true;
+}
+
+// Generation of the customer file holding the account
+static unsigned long accountGeneration(const char* accountID) {
+    return customerIndexGeneration(getAccountShard(accountID));
+}
+
+// Last committed balance from the version table; an account read for the
+// first time, or whose customer file changed since it was versioned, is
+// read from storage under the commit lock and seeded
+static bool textGetBalance(const char* accountID, float* balance) {
+    unsigned long generation = accountGeneration(accountID);
+    if (balanceVersionRead(accountID, generation, balance)) {
+        return true;
+    }
+
+    pthread_mutex_lock(&balanceLock);
+    bool found = currentBalance(accountID, balance);
+    if (found) {
+        balanceVersionSeed(accountID, *balance, generation);
+    }
+    pthread_mutex_unlock(&balanceLock);
+    return found;
+}
+
+// Set several balances as one unit: journal records when the journal is open,
+// otherwise sequential writes that are undone if a later one fails.
+// `oldBalances`, `journalDeltas` and `generations` provide room for `count` entries.
+static bool commitDeltas(StorageDelta* deltas, int count, float* oldBalances, JournalDelta* journalDeltas,
+                         unsigned long* generations) {
+    pthread_mutex_lock(&balanceLock);
+
+    for (int i = 0; i < count; i++) {
+        if (!currentBalance(deltas[i].accountID, &oldBalances[i])) {
+            pthread_mutex_unlock(&balanceLock);
+            char errorMsg[100];
+            sprintf(errorMsg, "Account ID %s not found in customer database", deltas[i].accountID);
+            writeErrorLog(errorMsg);
+            return false;
+        }
+        deltas[i].newBalance = oldBalances[i] + deltas[i].delta;
+        if (deltas[i].newBalance < 0) {
+            pthread_mutex_unlock(&balanceLock);
+            return false;
+        }
+    }
+
+    bool ok = true;
+    if (journalOwnedElsewhere()) {
+        // The owning process would overwrite a direct write at its next checkpoint
+        writeErrorLog("Balance journal is owned by another process; balance change refused");
+        ok = false;
+    } else if (journalIsOpen()) {
+        memset(journalDeltas, 0, (size_t)count * sizeof(JournalDelta));
+        for (int i = 0; i < count; i++) {
+            copyString(journalDeltas[i].accountID, sizeof(journalDeltas[i].accountID), deltas[i].accountID);
+            journalDeltas[i].delta = deltas[i].delta;
+            journalDeltas[i].newBalance = deltas[i].newBalance;
+        }
+        ok = count <= JOURNAL_MAX_DELTAS ? journalCommit(journalDeltas, count)
+                                         : journalCommitBatch(journalDeltas, count);
+    } else {
+        // The journal cannot replay these onto the snapshot's balances
+        snapshotInvalidate();
+        for (int i = 0; i < count; i++) {
+            if (!writeAccountBalance(deltas[i].accountID, deltas[i].newBalance)) {
+                while (--i >= 0) {
+                    writeAccountBalance(deltas[i].accountID, oldBalances[i]);
+                }
+                ok = false;
+                break;
+            }
+        }
+    }
+
+    if (ok) {
+        // One stat per shard, however many of its accounts the commit touched
+        unsigned long shardGenerations[MAX_DATA_SHARDS] = { 0 };
+        for (int i = 0; i < count; i++) {
+            int shard = getAccountShard(deltas[i].accountID);
+            if (shardGenerations[shard] == 0) {
+                shardGenerations[shard] = customerIndexGeneration(shard);
+            }
+            generations[i] = shardGenerations[shard];
+        }
+        balanceVersionPublish(deltas, oldBalances, generations, count);
+    }
+    pthread_mutex_unlock(&balanceLock);
+    return ok;
+}
+
+static bool textApplyDelta(StorageDelta* deltas, int count) {
+    float oldBalances[STORAGE_MAX_DELTAS];
+    JournalDelta journalDeltas[JOURNAL_MAX_DELTAS];
+    unsigned long generations[STORAGE_MAX_DELTAS];
+
+    if (deltas == NULL || count <= 0 || count > STORAGE_MAX_DELTAS || count > JOURNAL_MAX_DELTAS) {
+        return false;
+    }
+    return commitDeltas(deltas, count, oldBalances, journalDeltas, generations);
+}
+
+// A batch is one journal write; without the journal it falls back to one
+// customer file update per account
+static bool textApplyBatch(StorageDelta* deltas, int count) {
+    if (deltas == NULL || count <= 0) {
+        return false;
+    }
+
+    float* oldBalances = (float*)malloc((size_t)count * sizeof(float));
+    JournalDelta* journalDeltas = (JournalDelta*)malloc((size_t)count * sizeof(JournalDelta));
+    unsigned long* generations = (unsigned long*)malloc((size_t)count * sizeof(unsigned long));
+    bool ok = oldBalances != NULL && journalDeltas != NULL && generations != NULL &&
+              commitDeltas(deltas, count, oldBalances, journalDeltas, generations);
+    free(oldBalances);
+    free(journalDeltas);
+    free(generations);
+    return ok;
+}
+
+// Rewrite the card's file with one row's status and/or PIN hash replaced
+static bool rewriteCardRow(int cardNumber, const char* status, const char* pinHash) {
+    const char* cardFilePath = getCardFilePathFor(cardNumber);
+    TableReader reader;
+    if (!tableReaderOpen(&reader, cardFilePath, '|')) {
+        writeErrorLog("Failed to open card.txt file");
+        return false;
+    }
+
+    char tempFilePath[256];
+    snprintf(tempFilePath, sizeof(tempFilePath), "%s.tmp", cardFilePath);
+    FILE* tempFile = fopen(tempFilePath, "w");
+    if (tempFile == NULL) {
+        tableReaderClose(&reader);
+        writeErrorLog("Failed to create temporary card file");
+        return false;
+    }
+
+    // Copy header lines
+    tableReaderSkipLines(&reader, 2);
+    fwrite(reader.data, 1, reader.pos, tempFile);
+
+    char cardNumberStr[20];
+    sprintf(cardNumberStr, "%d", cardNumber);
+
+    // Format: Card ID | Account ID | Card Number | Card Type | Expiry Date | Status | PIN Hash
+    TableRow row;
+    bool updated = false;
+    while (tableReaderNext(&reader, &row)) {
+        if (row.fieldCount < 7 || !tableFieldEquals(&row.fields[2], cardNumberStr)) {
+            fwrite(row.line, 1, row.lineLen, tempFile);
+            fputc('\n', tempFile);
+            continue;
+        }
+
+        char cardID[20], accountID[20], cardType[20], expiryDate[20], oldStatus[20], oldPinHash[65];
+        tableFieldCopy(&row.fields[0], cardID, sizeof(cardID));
+        tableFieldCopy(&row.fields[1], accountID, sizeof(accountID));
+        tableFieldCopy(&row.fields[3], cardType, sizeof(cardType));
+        tableFieldCopy(&row.fields[4], expiryDate, sizeof(expiryDate));
+        tableFieldCopy(&row.fields[5], oldStatus, sizeof(oldStatus));
+        tableFieldCopy(&row.fields[6], oldPinHash, sizeof(oldPinHash));
+
+        fprintf(tempFile, "%-7s | %-10s | %-15s | %-9s | %-11s | %-7s | %s\n",
+                cardID, accountID, cardNumberStr, cardType, expiryDate,
+                status != NULL ? status : oldStatus, pinHash != NULL ? pinHash : oldPinHash);
+        updated = true;
+    }
+
+    tableReaderClose(&reader);
+    bool written = fclose(tempFile) == 0;
+
+    if (!updated || !written || rename(tempFilePath, cardFilePath) != 0) {
+        remove(tempFilePath);
+        return false;
+    }
+    cardIndexInvalidateCard(cardNumber);
+    return true;
+}
+
+static bool textSetCardStatus(int cardNumber, const char* status) {
+    if (status == NULL) {
+        return false;
+    }
+    pthread_mutex_lock(&cardFileLock);
+    bool ok = rewriteCardRow(cardNumber, status, NULL);
+    pthread_mutex_unlock(&cardFileLock);
+    return ok;
+}
+
+static bool textSetCardPinHash(int cardNumber, const char* pinHash) {
+    if (pinHash == NULL) {
+        return false;
+    }
+    pthread_mutex_lock(&cardFileLock);
+    bool ok = rewriteCardRow(cardNumber, NULL, pinHash);
+    pthread_mutex_unlock(&cardFileLock);
+    return ok;
+}
+
+// Append a row to a data file
+static bool appendRow(const char* path, const char* row) {
+    FILE* file = fopen(path, "a");
+    if (file == NULL) {
+        return false;
+    }
+    bool ok = fputs(row, file) >= 0;
+    return fclose(file) == 0 && ok;
+}
+
+// New rows go at the end of the shard's customer and card files; the
+// indexes pick them up from the changed files
+static bool textAddAccount(const StorageAccount* account, const StorageCard* card, const char* expiryDate) {
+    if (account == NULL || card == NULL) {
+        return false;
+    }
+
+    // Held from the duplicate checks to the last append, so two adds of the
+    // same account or card cannot both pass the checks
+    pthread_mutex_lock(&balanceLock);
+    if (textGetCard(card->cardNumber, NULL) || customerIndexLookup(account->accountID, NULL)) {
+        pthread_mutex_unlock(&balanceLock);
+        return false;
+    }
+
+    char row[512];
+    snprintf(row, sizeof(row), "%s | %s | %-20s | %s | %s | %.2f\n",
+             account->customerID, account->accountID, account->holderName, account->type, account->status,
+             account->balance);
+    if (!appendRow(getCustomerFilePathFor(account->accountID), row)) {
+        pthread_mutex_unlock(&balanceLock);
+        writeErrorLog("Failed to append to customer.txt while adding an account");
+        return false;
+    }
+    customerIndexInvalidateAccount(account->accountID);
+
+    snprintf(row, sizeof(row), "%s | %s | %-16d | Debit     | %s | %-7s | %s\n",
+             card->cardID, account->accountID, card->cardNumber, expiryDate != NULL ? expiryDate : "",
+             card->status, card->pinHash);
+
+    // An append during a row rewrite would be lost in the rename
+    pthread_mutex_lock(&cardFileLock);
+    bool appended = appendRow(getCardFilePathFor(card->cardNumber), row);
+    pthread_mutex_unlock(&cardFileLock);
+    if (appended) {
+        cardIndexInvalidateCard(card->cardNumber);
+    }
+    pthread_mutex_unlock(&balanceLock);
+
+    if (!appended) {
+        writeErrorLog("Failed to append to card.txt while adding an account");
+    }
+    return appended;
+}
+
+// Scan one card file; `stopped` is set when the callback ends the scan
+static bool scanCardFile(const char* path, StorageScanFn fn, void* context, bool* stopped) {
+    TableReader reader;
+    if (!tableReaderOpen(&reader, path, '|')) {
+        return false;
+    }
+    tableReaderSkipLines(&reader, 2);
+
+    TableRow row;
+    while (tableReaderNext(&reader, &row)) {
+        long cardNumber;
+        if (row.fieldCount < 7 || !tableFieldToLong(&row.fields[2], &cardNumber)) {
+            continue;
+        }
+
+        StorageCard card;
+        memset(&card, 0, sizeof(card));
+        card.cardNumber = (int)cardNumber;
+        tableFieldCopy(&row.fields[0], card.cardID, sizeof(card.cardID));
+        tableFieldCopy(&row.fields[1], card.accountID, sizeof(card.accountID));
+        tableFieldCopy(&row.fields[5], card.status, sizeof(card.status));
+        tableFieldCopy(&row.fields[6], card.pinHash, sizeof(card.pinHash));
+        if (!fn(&card, context)) {
+            *stopped = true;
+            break;
+        }
+    }
+
+    tableReaderClose(&reader);
+    return true;
+}
+
+// Scan one customer file; `stopped` is set when the callback ends the scan.
+// Balances come from `snapshot` when it is open and holds the account at
+// the file's current `generation`.
+static bool scanAccountFile(const char* path, const BalanceSnapshot* snapshot, unsigned long generation,
+                            StorageScanFn fn, void* context, bool* stopped) {
+    TableReader reader;
+    if (!tableReaderOpen(&reader, path, '|')) {
+        return false;
+    }
+    tableReaderSkipLines(&reader, 2);
+
+    // Format: Customer ID | Account ID | Name | Type | Status | Balance
+    TableRow row;
+    while (tableReaderNext(&reader, &row)) {
+        double balance;
+        if (row.fieldCount < 6 || !tableFieldToDouble(&row.fields[5], &balance)) {
+            continue;
+        }
+
+        StorageAccount account;
+        memset(&account, 0, sizeof(account));
+        tableFieldCopy(&row.fields[0], account.customerID, sizeof(account.customerID));
+        tableFieldCopy(&row.fields[1], account.accountID, sizeof(account.accountID));
+        tableFieldCopy(&row.fields[2], account.holderName, sizeof(account.holderName));
+        tableFieldCopy(&row.fields[3], account.type, sizeof(account.type));
+        tableFieldCopy(&row.fields[4], account.status, sizeof(account.status));
+        if ((snapshot->slot < 0 || !balanceSnapshotRead(snapshot, account.accountID, generation, &account.balance)) &&
+            !journalLookupBalance(account.accountID, &account.balance)) {
+            account.balance = (float)balance;
+        }
+        if (!fn(&account, context)) {
+            *stopped = true;
+            break;
+        }
+    }
+
+    tableReaderClose(&reader);
+    return true;
+}
+
+// Shards are visited in order, so a sharded scan is grouped by shard.
+// Accounts are read at one snapshot, so balances moved by a concurrent
+// transfer are seen on both sides or neither.
+static bool textScan(StorageTable table, StorageScanFn fn, void* context) {
+    if (fn == NULL) {
+        return false;
+    }
+
+    // Without a free reader slot balances come from the journal and files
+    BalanceSnapshot snapshot = { 0, -1 };
+    if (table == STORAGE_ACCOUNTS) {
+        balanceSnapshotBegin(&snapshot);
+    }
+
+    bool ok = true, stopped = false;
+    for (int shard = 0; shard < getShardFileCount() && !stopped && ok; shard++) {
+        ok = table == STORAGE_CARDS
+                 ? scanCardFile(getCardShardFilePath(shard), fn, context, &stopped)
+                 : scanAccountFile(getCustomerShardFilePath(shard), &snapshot,
+                                   customerIndexGeneration(shard), fn, context, &stopped);
+    }
+    balanceSnapshotEnd(&snapshot);
+    return ok;
+}
+
+const StorageEngine textStorageEngine = {
+    "text",
+    textOpen,
+    textClose,
+    textGetCard,
+    textGetAccount,
+    textGetBalance,
+    textApplyDelta,
+    textApplyBatch,
+    textSetCardStatus,
+    textSetCardPinHash,
+    textAddAccount,
+    textScan
+};
@@ -0,0 +1,295 @@
+#include "transaction_log.h"
+#include "../common/paths.h"
+#include "../utils/logger.h"
+#include "../utils/clock_utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+
+// Records written with one call to write()
+#define APPEND_BATCH 256
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+} TransactionLogHeader;
+
+static const char* const typeNames[] = {
+    [TRANSACTION_BALANCE_CHECK] = "Balance Check",
+    [TRANSACTION_DEPOSIT] = "Deposit",
+    [TRANSACTION_WITHDRAWAL] = "Withdrawal",
+    [TRANSACTION_PIN_CHANGE] = "PIN Change",
+    [TRANSACTION_MINI_STATEMENT] = "Mini Statement",
+    [TRANSACTION_MONEY_TRANSFER] = "Transfer",
+    [TRANSACTION_CARD_REQUEST] = "Card Request"
+};
+
+#define TYPE_NAME_COUNT (sizeof(typeNames) / sizeof(typeNames[0]))
+
+static const char* const remarkTexts[TRANSACTION_REMARK_COUNT] = {
+    [TRANSACTION_REMARK_GENERAL] = "General Transaction",
+    [TRANSACTION_REMARK_INFORMATION_REQUEST] = "Information Request",
+    [TRANSACTION_REMARK_CASH_DEPOSIT] = "Cash Deposit",
+    [TRANSACTION_REMARK_ATM_WITHDRAWAL] = "ATM Withdrawal",
+    [TRANSACTION_REMARK_SECURITY_UPDATE] = "Security Update",
+    [TRANSACTION_REMARK_FUND_TRANSFER] = "Fund Transfer"
+};
+
+// Writer state, guarded by writerLock
+static pthread_mutex_t writerLock = PTHREAD_MUTEX_INITIALIZER;
+static int logFd = -1;
+static char logPath[100] = "";
+
+const char* transactionLogTypeName(int type) {
+    if (type >= 0 && (size_t)type < TYPE_NAME_COUNT) {
+        return typeNames[type];
+    }
+    return "Other";
+}
+
+int transactionLogTypeFromName(const char* name) {
+    for (size_t i = 0; name != NULL && i < TYPE_NAME_COUNT; i++) {
+        if (strcmp(typeNames[i], name) == 0) {
+            return (int)i;
+        }
+    }
+    return TRANSACTION_LOG_TYPE_OTHER;
+}
+
+const char* transactionLogRemarkText(int remark) {
+    if (remark >= 0 && remark < TRANSACTION_REMARK_COUNT) {
+        return remarkTexts[remark];
+    }
+    return remarkTexts[TRANSACTION_REMARK_GENERAL];
+}
+
+TransactionRemark transactionLogRemarkFromText(const char* text) {
+    for (int i = 0; text != NULL && i < TRANSACTION_REMARK_COUNT; i++) {
+        if (strcmp(remarkTexts[i], text) == 0) {
+            return (TransactionRemark)i;
+        }
+    }
+    return TRANSACTION_REMARK_GENERAL;
+}
+
+TransactionRemark transactionLogDefaultRemark(int type) {
+    switch (type) {
+        case TRANSACTION_BALANCE_CHECK:
+        case TRANSACTION_MINI_STATEMENT:
+            return TRANSACTION_REMARK_INFORMATION_REQUEST;
+        case TRANSACTION_DEPOSIT:
+            return TRANSACTION_REMARK_CASH_DEPOSIT;
+        case TRANSACTION_WITHDRAWAL:
+            return TRANSACTION_REMARK_ATM_WITHDRAWAL;
+        case TRANSACTION_PIN_CHANGE:
+            return TRANSACTION_REMARK_SECURITY_UPDATE;
+        case TRANSACTION_MONEY_TRANSFER:
+            return TRANSACTION_REMARK_FUND_TRANSFER;
+        default:
+            return TRANSACTION_REMARK_GENERAL;
+    }
+}
+
+void transactionLogInitRecord(TransactionLogRecord* record, long long id, const char* accountID, int type,
+                              float amount, time_t time, bool success) {
+    memset(record, 0, sizeof(*record));
+    record->id = (uint64_t)id;
+    record->amount = (int64_t)llround((double)amount * 100.0);
+    record->time = (int64_t)time;
+    if (accountID != NULL) {
+        strncpy(record->accountID, accountID, sizeof(record->accountID) - 1);
+    }
+    record->type = (uint8_t)type;
+    record->success = success ? 1 : 0;
+    record->remark = (uint16_t)transactionLogDefaultRemark(type);
+}
+
+void transactionLogFormatID(const TransactionLogRecord* record, char* buffer, size_t size) {
+    snprintf(buffer, size, "T%llu", (unsigned long long)record->id);
+}
+
+void transactionLogFormatRow(const TransactionLogRecord* record, char* row, size_t size) {
+    char transactionID[24];
+    char accountID[sizeof(record->accountID) + 1];
+    char timestamp[CLOCK_TIMESTAMP_SIZE];
+    char amount[32];
+
+    transactionLogFormatID(record, transactionID, sizeof(transactionID));
+    memcpy(accountID, record->accountID, sizeof(record->accountID));
+    accountID[sizeof(record->accountID)] = '\0';
+    clockFormatTimestamp((time_t)record->time, timestamp, sizeof(timestamp));
+    long long cents = (long long)record->amount;
+    snprintf(amount, sizeof(amount), "%s%lld.%02lld", cents < 0 ? "-" : "", llabs(cents) / 100, llabs(cents) % 100);
+
+    snprintf(row, size, "%-14s | %-10s | %-15s | %-8s | %-19s | %-17s | %s",
+             transactionID, accountID, transactionLogTypeName(record->type), amount, timestamp,
+             record->success ? "Success" : "Failed", transactionLogRemarkText(record->remark));
+}
+
+bool transactionLogValidHeader(const void* header) {
+    TransactionLogHeader value;
+    memcpy(&value, header, sizeof(value));
+    return memcmp(value.magic, TRANSACTION_LOG_MAGIC, sizeof(value.magic)) == 0 &&
+           value.version == TRANSACTION_LOG_VERSION && value.recordSize == sizeof(TransactionLogRecord);
+}
+
+// Create the log with its header; the header appears atomically, so a
+// concurrent creator or reader never sees a file without one
+static bool createLog(const char* path) {
+    char tempPath[128];
+    snprintf(tempPath, sizeof(tempPath), "%s.%ld.tmp", path, (long)getpid());
+
+    TransactionLogHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TRANSACTION_LOG_MAGIC, sizeof(header.magic));
+    header.version = TRANSACTION_LOG_VERSION;
+    header.recordSize = sizeof(TransactionLogRecord);
+
+    int fd = open(tempPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = write(fd, &header, sizeof(header)) == (ssize_t)sizeof(header);
+    ok = close(fd) == 0 && ok;
+    ok = ok && (link(tempPath, path) == 0 || errno == EEXIST);
+    unlink(tempPath);
+    return ok;
+}
+
+// Cut off a record left short by a failed write, so later records stay
+// aligned. Appends hold a shared lock, so none is in progress meanwhile.
+static bool alignLocked(int fd) {
+    if (flock(fd, LOCK_EX) != 0) {
+        return false;
+    }
+    struct stat st;
+    bool ok = fstat(fd, &st) == 0 && st.st_size >= TRANSACTION_LOG_HEADER_SIZE;
+    if (ok) {
+        off_t partial = (off_t)((size_t)(st.st_size - TRANSACTION_LOG_HEADER_SIZE) % sizeof(TransactionLogRecord));
+        if (partial != 0) {
+            ok = ftruncate(fd, st.st_size - partial) == 0;
+            writeErrorLog("Removed a partial record at the end of the transactions log");
+        }
+    }
+    flock(fd, LOCK_UN);
+    return ok;
+}
+
+// The log, opened for appending and aligned on a record; needs writerLock
+static int openLocked(void) {
+    const char* path = getTransactionsLogFilePath();
+    struct stat st;
+    struct stat current;
+
+    // Reopen once the file has been rotated away, deleted or the mode changed
+    if (logFd >= 0 && (strcmp(path, logPath) != 0 || fstat(logFd, &st) != 0 || stat(path, &current) != 0 ||
+                       st.st_ino != current.st_ino || st.st_dev != current.st_dev)) {
+        close(logFd);
+        logFd = -1;
+    }
+
+    if (logFd < 0) {
+        if (access(path, F_OK) != 0 && !createLog(path)) {
+            return -1;
+        }
+        int fd = open(path, O_RDWR | O_APPEND);
+        char header[TRANSACTION_LOG_HEADER_SIZE];
+        if (fd >= 0 && (pread(fd, header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+                        !transactionLogValidHeader(header))) {
+            close(fd);
+            writeErrorLog("The transactions log is not in the binary format; not appending to it");
+            return -1;
+        }
+        if (fd < 0 || fstat(fd, &st) != 0) {
+            if (fd >= 0) {
+                close(fd);
+            }
+            return -1;
+        }
+        logFd = fd;
+        snprintf(logPath, sizeof(logPath), "%s", path);
+    }
+
+    if ((size_t)(st.st_size - TRANSACTION_LOG_HEADER_SIZE) % sizeof(TransactionLogRecord) != 0 &&
+        !alignLocked(logFd)) {
+        return -1;
+    }
+    return logFd;
+}
+
+bool transactionLogAppend(const TransactionLogRecord* records, size_t count) {
+    if (records == NULL || count == 0) {
+        return true;
+    }
+
+    pthread_mutex_lock(&writerLock);
+    int fd = openLocked();
+
+    // Shared with other appenders; only alignLocked truncating a torn record excludes it
+    bool ok = fd >= 0 && flock(fd, LOCK_SH) == 0;
+    while (ok && count > 0) {
+        // Whole records per write, so other processes' appends never land inside one
+        size_t batch = count < APPEND_BATCH ? count : APPEND_BATCH;
+        size_t length = batch * sizeof(TransactionLogRecord);
+        ssize_t written = write(fd, records, length);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        ok = written == (ssize_t)length;
+        records += batch;
+        count -= batch;
+    }
+    if (fd >= 0) {
+        flock(fd, LOCK_UN);
+    }
+    pthread_mutex_unlock(&writerLock);
+
+    if (!ok) {
+        writeErrorLog("Failed to write to the transactions log");
+    }
+    return ok;
+}
+
+bool transactionLogFileTimes(const char* path, char* firstTime, char* lastTime) {
+    firstTime[0] = '\0';
+    lastTime[0] = '\0';
+
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        return false;
+    }
+    char header[TRANSACTION_LOG_HEADER_SIZE];
+    if (fread(header, sizeof(header), 1, file) != 1 || !transactionLogValidHeader(header)) {
+        fclose(file);
+        return false;
+    }
+
+    TransactionLogRecord records[APPEND_BATCH];
+    int64_t first = INT64_MAX;
+    int64_t last = INT64_MIN;
+    size_t count;
+    while ((count = fread(records, sizeof(TransactionLogRecord), APPEND_BATCH, file)) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            if (records[i].id == 0) {
+                continue;
+            }
+            first = records[i].time < first ? records[i].time : first;
+            last = records[i].time > last ? records[i].time : last;
+        }
+    }
+    fclose(file);
+
+    if (first <= last) {
+        clockFormatTimestamp((time_t)first, firstTime, CLOCK_TIMESTAMP_SIZE);
+        clockFormatTimestamp((time_t)last, lastTime, CLOCK_TIMESTAMP_SIZE);
+    }
+    return true;
+}
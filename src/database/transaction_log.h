@@ -0,0 +1,138 @@
+#ifndef TRANSACTION_LOG_H
+#define TRANSACTION_LOG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include "../transaction/transaction_types.h"
+
+/**
+ * Binary transactions log
+ *
+ * Every transaction is one fixed-size TransactionLogRecord appended to
+ * the transactions log after a short file header. Appends copy the
+ * records into one write; readers step through the file a record at a
+ * time without parsing text. transactionLogFormatRow renders a record as
+ * a row of the pipe-delimited table the log used to hold, which is what
+ * atm_logcat prints.
+ */
+
+#define TRANSACTION_LOG_MAGIC "ATMTXN01"
+#define TRANSACTION_LOG_VERSION 1
+
+// Bytes before the first record
+#define TRANSACTION_LOG_HEADER_SIZE 16
+
+// Type stored for transactions that have no TransactionType
+#define TRANSACTION_LOG_TYPE_OTHER 0xFF
+
+// Heading of the rendered table
+#define TRANSACTION_LOG_TABLE_HEADER \
+    "Transaction ID | Account ID | Transaction Type | Amount   | Transaction Time    | Transaction Status | Transaction Remarks"
+#define TRANSACTION_LOG_TABLE_SEPARATOR \
+    "---------------|------------|-----------------|----------|---------------------|-------------------|--------------------"
+
+// Remarks column, stored as a code
+typedef enum {
+    TRANSACTION_REMARK_GENERAL,
+    TRANSACTION_REMARK_INFORMATION_REQUEST,
+    TRANSACTION_REMARK_CASH_DEPOSIT,
+    TRANSACTION_REMARK_ATM_WITHDRAWAL,
+    TRANSACTION_REMARK_SECURITY_UPDATE,
+    TRANSACTION_REMARK_FUND_TRANSFER,
+    TRANSACTION_REMARK_COUNT
+} TransactionRemark;
+
+// One transaction; 48 bytes, little-endian as written by this machine
+typedef struct {
+    uint64_t id;                  // Transaction ID without its "T"
+    int64_t amount;               // In cents
+    int64_t time;                 // Seconds since the epoch
+    char accountID[20];           // NUL-padded
+    uint8_t type;                 // TransactionType or TRANSACTION_LOG_TYPE_OTHER
+    uint8_t success;
+    uint16_t remark;              // TransactionRemark
+} TransactionLogRecord;
+
+/**
+ * Fill in a record
+ *
+ * @param record Record to fill in
+ * @param id Transaction ID
+ * @param accountID Account the transaction belongs to
+ * @param type A TransactionType or TRANSACTION_LOG_TYPE_OTHER
+ * @param amount Amount in currency units; stored rounded to cents
+ * @param time When it happened
+ * @param success Whether it succeeded
+ */
+void transactionLogInitRecord(TransactionLogRecord* record, long long id, const char* accountID, int type,
+                              float amount, time_t time, bool success);
+
+/**
+ * Append records to the transactions log with a single write
+ *
+ * @param records The records
+ * @param count How many
+ * @return true if all of them were written
+ */
+bool transactionLogAppend(const TransactionLogRecord* records, size_t count);
+
+/**
+ * Check a transactions log header
+ *
+ * @param header The first TRANSACTION_LOG_HEADER_SIZE bytes of the file
+ * @return true if it is a transactions log this build can read
+ */
+bool transactionLogValidHeader(const void* header);
+
+/**
+ * Name of a type in the rendered table
+ */
+const char* transactionLogTypeName(int type);
+
+/**
+ * Type with the given name, or TRANSACTION_LOG_TYPE_OTHER
+ */
+int transactionLogTypeFromName(const char* name);
+
+/**
+ * Remarks text in the rendered table
+ */
+const char* transactionLogRemarkText(int remark);
+
+/**
+ * Remark with the given text, or TRANSACTION_REMARK_GENERAL
+ */
+TransactionRemark transactionLogRemarkFromText(const char* text);
+
+/**
+ * Remark written for a type
+ */
+TransactionRemark transactionLogDefaultRemark(int type);
+
+/**
+ * Render the Transaction ID column, "T<id>"
+ */
+void transactionLogFormatID(const TransactionLogRecord* record, char* buffer, size_t size);
+
+/**
+ * Render a record as a row of the table, without a newline
+ *
+ * @param record The record
+ * @param row Receives the row
+ * @param size Room in `row`
+ */
+void transactionLogFormatRow(const TransactionLogRecord* record, char* row, size_t size);
+
+/**
+ * Earliest and latest transaction times in a transactions log file
+ *
+ * @param path The file
+ * @param firstTime Receives "YYYY-MM-DD HH:MM:SS", or "" if it has no records
+ * @param lastTime Likewise
+ * @return false if the file is not a transactions log
+ */
+bool transactionLogFileTimes(const char* path, char* firstTime, char* lastTime);
+
+#endif // TRANSACTION_LOG_H
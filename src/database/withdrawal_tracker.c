@@ -0,0 +1,324 @@
+#include "withdrawal_tracker.h"
+#include "../common/paths.h"
+#include "../utils/logger.h"
+#include "../config/config_manager.h"
+#include "../utils/clock_utils.h"
+#include "../utils/log_archive.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+// Config key prefix for per-card daily limits
+#define CONFIG_CARD_DAILY_LIMIT_PREFIX "daily_limit_"
+
+// Below this many bytes the day's start is found by reading forward
+#define DAY_SEARCH_MIN_SPAN 4096
+
+typedef struct {
+    int cardNumber;
+    float total;                            // Logged today
+    float held;                             // Committed but not logged yet
+    bool used;
+} WithdrawalEntry;
+
+// Tracker state, guarded by trackerLock
+static pthread_mutex_t trackerLock = PTHREAD_MUTEX_INITIALIZER;
+static WithdrawalEntry* entries = NULL;
+static size_t entrySize = 0;              // Always a power of two
+static size_t entryUsed = 0;
+static bool loaded = false;
+static char trackedDay[11] = "";          // YYYY-MM-DD the totals belong to
+static char trackedPath[100] = "";        // Log the totals were read from
+static dev_t trackedDevice = 0;           // Its identity, to notice rotation
+static ino_t trackedInode = 0;
+static long readOffset = 0;               // End of the last complete line parsed
+
+// Today's date as last announced by the clock, guarded by dayLock. Kept
+// apart from trackerLock: the clock announces a new day from whichever
+// thread reads it first, which may be one holding trackerLock.
+static pthread_mutex_t dayLock = PTHREAD_MUTEX_INITIALIZER;
+static char currentDay[CLOCK_DATE_SIZE] = "";
+static pthread_once_t dayListenerOnce = PTHREAD_ONCE_INIT;
+
+static void onDateChange(const char* date, void* context) {
+    (void)context;
+    pthread_mutex_lock(&dayLock);
+    snprintf(currentDay, sizeof(currentDay), "%s", date);
+    pthread_mutex_unlock(&dayLock);
+}
+
+static void registerDayListener(void) {
+    clockOnDateChange(onDateChange, NULL);
+}
+
+// Reading the clock first makes it announce a day that has just begun
+static void getToday(char* buffer, size_t size) {
+    pthread_once(&dayListenerOnce, registerDayListener);
+    char today[CLOCK_DATE_SIZE];
+    clockDate(today, sizeof(today));
+
+    pthread_mutex_lock(&dayLock);
+    if (currentDay[0] == '\0') {
+        snprintf(currentDay, sizeof(currentDay), "%s", today);
+    }
+    snprintf(buffer, size, "%s", currentDay);
+    pthread_mutex_unlock(&dayLock);
+}
+
+static size_t entryFind(const WithdrawalEntry* table, size_t size, int cardNumber) {
+    size_t mask = size - 1;
+    size_t i = ((unsigned int)cardNumber * 2654435761u) & mask;
+
+    while (table[i].used && table[i].cardNumber != cardNumber) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+static bool entryGrow(void) {
+    size_t newSize = entrySize == 0 ? 256 : entrySize * 2;
+    WithdrawalEntry* table = (WithdrawalEntry*)calloc(newSize, sizeof(WithdrawalEntry));
+    if (table == NULL) {
+        return false;
+    }
+    for (size_t i = 0; i < entrySize; i++) {
+        if (entries[i].used) {
+            table[entryFind(table, newSize, entries[i].cardNumber)] = entries[i];
+        }
+    }
+    free(entries);
+    entries = table;
+    entrySize = newSize;
+    return true;
+}
+
+// The card's entry, created if missing; NULL when out of memory
+static WithdrawalEntry* entryGet(int cardNumber) {
+    if ((entryUsed + 1) * 2 > entrySize && !entryGrow()) {
+        writeErrorLog("Out of memory while tracking daily withdrawals");
+        return NULL;
+    }
+    WithdrawalEntry* entry = &entries[entryFind(entries, entrySize, cardNumber)];
+    if (!entry->used) {
+        entry->cardNumber = cardNumber;
+        entry->total = 0.0f;
+        entry->held = 0.0f;
+        entry->used = true;
+        entryUsed++;
+    }
+    return entry;
+}
+
+static void entryAdd(int cardNumber, float amount) {
+    WithdrawalEntry* entry = entryGet(cardNumber);
+    if (entry != NULL) {
+        entry->total += amount;
+    }
+}
+
+static void entryClear(void) {
+    if (entries != NULL) {
+        memset(entries, 0, entrySize * sizeof(WithdrawalEntry));
+    }
+    entryUsed = 0;
+}
+
+// Forget the logged totals but keep the amounts held for withdrawals in progress
+static void entryResetTotals(void) {
+    for (size_t i = 0; i < entrySize; i++) {
+        entries[i].total = 0.0f;
+    }
+}
+
+// Format: cardNumber,date,amount,timestamp
+static bool parseLine(const char* line, int* cardNumber, char* date, float* amount) {
+    return sscanf(line, "%d,%10[^,],%f", cardNumber, date, amount) == 3;
+}
+
+// Offset to start reading today's lines from. The log is appended in time
+// order, so lines before the result are all from earlier days.
+static long findDayStart(FILE* file, long size, const char* today) {
+    char line[256];
+    long lo = 0;
+    long hi = size;
+
+    while (hi - lo > DAY_SEARCH_MIN_SPAN) {
+        long mid = lo + (hi - lo) / 2;
+        fseek(file, mid, SEEK_SET);
+        // Skip the line `mid` falls in; the next one is the probe
+        if (fgets(line, sizeof(line), file) == NULL || fgets(line, sizeof(line), file) == NULL) {
+            hi = mid;
+            continue;
+        }
+
+        int cardNumber;
+        char date[11];
+        float amount;
+        if (parseLine(line, &cardNumber, date, &amount) && strcmp(date, today) >= 0) {
+            hi = mid;
+        } else {
+            lo = mid;
+        }
+    }
+    return lo;
+}
+
+// Parse complete lines from `readOffset` to the end of the log
+static void readFrom(FILE* file, bool skipPartial) {
+    char line[256];
+
+    fseek(file, readOffset, SEEK_SET);
+    if (skipPartial && readOffset > 0) {
+        // Starting inside a line from an earlier day
+        if (fgets(line, sizeof(line), file) == NULL) {
+            return;
+        }
+        readOffset = ftell(file);
+    }
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        size_t len = strlen(line);
+        if (len == 0 || line[len - 1] != '\n') {
+            break;      // Still being written; read it next time
+        }
+        readOffset = ftell(file);
+
+        int cardNumber;
+        char date[11];
+        float amount;
+        if (parseLine(line, &cardNumber, date, &amount) && strcmp(date, trackedDay) == 0) {
+            entryAdd(cardNumber, amount);
+        }
+    }
+}
+
+static bool addArchivedLine(const char* line, size_t length, uint64_t offset, void* context) {
+    (void)offset;
+    (void)context;
+    char text[256];
+    size_t copy = length < sizeof(text) - 1 ? length : sizeof(text) - 1;
+    memcpy(text, line, copy);
+    text[copy] = '\0';
+
+    int cardNumber;
+    char date[11];
+    float amount;
+    if (parseLine(text, &cardNumber, date, &amount) && strcmp(date, trackedDay) == 0) {
+        entryAdd(cardNumber, amount);
+    }
+    return true;
+}
+
+// Add today's lines from the log's rotated segments; needs trackerLock
+static void readArchived(void) {
+    int count;
+    LogSegment* segments = logArchiveList(LOG_ARCHIVE_WITHDRAWALS, trackedDay, NULL, &count);
+    for (int i = 0; i < count; i++) {
+        if (!logSegmentScan(&segments[i], 0, addArchivedLine, NULL)) {
+            writeErrorLog("Failed to read an archived withdrawals log segment");
+        }
+    }
+    free(segments);
+}
+
+// Bring the totals up to date with the log; needs trackerLock
+static void refreshLocked(void) {
+    const char* path = getWithdrawalsLogFilePath();
+    char today[11];
+    getToday(today, sizeof(today));
+
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        memset(&st, 0, sizeof(st));
+    }
+    long size = (long)st.st_size;
+
+    // Rebuild on first use, at midnight, or when the log was rotated, replaced or truncated
+    bool newDay = !loaded || strcmp(today, trackedDay) != 0 || strcmp(path, trackedPath) != 0;
+    bool rebuild = newDay || st.st_dev != trackedDevice || st.st_ino != trackedInode || size < readOffset;
+    if (!rebuild && size == readOffset) {
+        return;
+    }
+
+    FILE* file = size > 0 ? fopen(path, "r") : NULL;
+    if (rebuild) {
+        if (newDay) {
+            entryClear();
+        } else {
+            entryResetTotals();
+        }
+        strcpy(trackedDay, today);
+        snprintf(trackedPath, sizeof(trackedPath), "%s", path);
+        trackedDevice = st.st_dev;
+        trackedInode = st.st_ino;
+        readArchived();
+        readOffset = file != NULL ? findDayStart(file, size, today) : 0;
+        loaded = true;
+    }
+    if (file != NULL) {
+        readFrom(file, rebuild);
+        fclose(file);
+    }
+}
+
+float withdrawalTrackerTotal(int cardNumber) {
+    pthread_mutex_lock(&trackerLock);
+    refreshLocked();
+    float total = 0.0f;
+    if (entryUsed > 0) {
+        WithdrawalEntry* entry = &entries[entryFind(entries, entrySize, cardNumber)];
+        if (entry->used) {
+            total = entry->total + entry->held;
+        }
+    }
+    pthread_mutex_unlock(&trackerLock);
+    return total;
+}
+
+void withdrawalTrackerHold(int cardNumber, float amount) {
+    pthread_mutex_lock(&trackerLock);
+    refreshLocked();
+    WithdrawalEntry* entry = entryGet(cardNumber);
+    if (entry != NULL) {
+        entry->held += amount;
+    }
+    pthread_mutex_unlock(&trackerLock);
+}
+
+void withdrawalTrackerRecord(int cardNumber, float amount, bool logged, bool held) {
+    pthread_mutex_lock(&trackerLock);
+    // Reading the log picks up the line just appended, and any from other processes
+    refreshLocked();
+    if (!logged) {
+        entryAdd(cardNumber, amount);
+    }
+    if (held && entryUsed > 0) {
+        // In the same critical section, so the amount is never counted twice
+        WithdrawalEntry* entry = &entries[entryFind(entries, entrySize, cardNumber)];
+        if (entry->used) {
+            entry->held = entry->held > amount ? entry->held - amount : 0.0f;
+        }
+    }
+    pthread_mutex_unlock(&trackerLock);
+}
+
+int withdrawalDailyLimit(int cardNumber, int defaultLimit) {
+    char key[40];
+    snprintf(key, sizeof(key), CONFIG_CARD_DAILY_LIMIT_PREFIX "%d", cardNumber);
+    if (hasConfigKey(key)) {
+        int limit = getConfigValueInt(key);
+        if (limit > 0) {
+            return limit;
+        }
+    }
+    return defaultLimit;
+}
+
+void withdrawalTrackerInvalidate(void) {
+    pthread_mutex_lock(&trackerLock);
+    loaded = false;
+    readOffset = 0;
+    pthread_mutex_unlock(&trackerLock);
+}
@@ -0,0 +1,62 @@
+#ifndef WITHDRAWAL_TRACKER_H
+#define WITHDRAWAL_TRACKER_H
+
+#include <stdbool.h>
+
+/**
+ * Running per-card totals of today's withdrawals
+ *
+ * On first use the table is built from today's part of withdrawals.log,
+ * which is found by binary search since the log is appended in time order.
+ * From then on only bytes appended since the last read are parsed, so
+ * withdrawals logged by other ATM processes sharing the log are counted
+ * too. Withdrawals committed but not yet logged are held in the total.
+ * The table starts over at local midnight.
+ */
+
+/**
+ * Total withdrawn today with a card
+ *
+ * @param cardNumber The card to look up
+ * @return Sum of today's logged withdrawals, 0 if none
+ */
+float withdrawalTrackerTotal(int cardNumber);
+
+/**
+ * Count a committed withdrawal before it is written to withdrawals.log
+ *
+ * @param cardNumber The card the money was withdrawn with
+ * @param amount The amount withdrawn
+ */
+void withdrawalTrackerHold(int cardNumber, float amount);
+
+/**
+ * Count a withdrawal that was just appended to withdrawals.log
+ *
+ * @param cardNumber The card the money was withdrawn with
+ * @param amount The amount withdrawn
+ * @param logged false if the log write failed; the amount is then added
+ *               to the in-memory total only
+ * @param held true if the amount was held with withdrawalTrackerHold;
+ *             the hold is dropped now that the amount is counted
+ */
+void withdrawalTrackerRecord(int cardNumber, float amount, bool logged, bool held);
+
+/**
+ * Daily withdrawal limit for a card
+ *
+ * A config key daily_limit_<cardNumber> overrides the default for that card.
+ *
+ * @param cardNumber The card
+ * @param defaultLimit Limit for cards without their own key
+ * @return The card's limit
+ */
+int withdrawalDailyLimit(int cardNumber, int defaultLimit);
+
+/**
+ * Drop the table so the next lookup rebuilds it from the log
+ * Call after truncating or replacing withdrawals.log.
+ */
+void withdrawalTrackerInvalidate(void);
+
+#endif // WITHDRAWAL_TRACKER_H
@@ -5,7 +5,14 @@
 #include "../validation/card_num_validation.h"
 #include "../validation/pin_validation.h"
 #include "../database/database.h"
+#include "../database/customer_index.h"
+#include "../database/journal.h"
+#include "../database/storage_engine.h"
+#include "../database/snapshot.h"
+#include "../database/shard_migration.h"
+#include "../transaction/request_cache.h"
 #include "../utils/logger.h"
+#include "../utils/log_archive.h"
 #include "../config/config_manager.h"
 #include "../common/paths.h"
 #include "../utils/language_support.h"
@@ -16,6 +23,10 @@
 
 // Command-line argument for test mode
 #define TEST_MODE_ARG "--test"
+// Command-line argument to convert customer.txt to the fixed-width layout and exit
+#define FIXED_WIDTH_CUSTOMERS_ARG "--fixed-width-customers"
+// Command-line argument to split card.txt and customer.txt into N shards and exit
+#define SHARD_DATA_ARG "--shard-data"
 
 // Forward declarations of functions used in this file
 extern void displayMainMenu(int cardNumber);
@@ -25,12 +36,22 @@ void displayWelcomeBanner();
 // Main function
 int main(int argc, char *argv[]) {
     bool testMode = false;
+    bool convertCustomers = false;
+    int shardCount = 0;
     
     // Check for test mode flag
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], TEST_MODE_ARG) == 0) {
             testMode = true;
             printf("Running in TEST MODE - Using test data files\n");
+        } else if (strcmp(argv[i], FIXED_WIDTH_CUSTOMERS_ARG) == 0) {
+            convertCustomers = true;
+        } else if (strcmp(argv[i], SHARD_DATA_ARG) == 0 && i + 1 < argc) {
+            shardCount = atoi(argv[++i]);
+            if (shardCount < 1 || shardCount > MAX_DATA_SHARDS) {
+                printf("Error: %s expects a shard count from 1 to %d.\n", SHARD_DATA_ARG, MAX_DATA_SHARDS);
+                return 1;
+            }
         }
     }
     
@@ -40,6 +61,37 @@ int main(int argc, char *argv[]) {
         return 1;
     }
     
+    if (convertCustomers) {
+        // A running ATM would keep writing balances into the files being rewritten
+        if (!journalLockForMaintenance()) {
+            printf("Error: The data files are in use by a running ATM process.\n");
+            return 1;
+        }
+        int rows = 0;
+        for (int shard = 0; shard < getShardFileCount(); shard++) {
+            int converted = convertCustomerFileToFixedWidth(getCustomerShardFilePath(shard));
+            if (converted < 0) {
+                journalUnlockForMaintenance();
+                printf("Error: Failed to convert %s to fixed-width layout.\n", getCustomerShardFilePath(shard));
+                return 1;
+            }
+            rows += converted;
+        }
+        journalUnlockForMaintenance();
+        printf("Converted %d customer records to fixed-width layout.\n", rows);
+        return 0;
+    }
+    
+    if (shardCount > 0) {
+        int rows = migrateToShards(shardCount);
+        if (rows < 0) {
+            printf("Error: Failed to split the data files into %d shards.\n", shardCount);
+            return 1;
+        }
+        printf("Moved %d records into %d shards under %s.\n", rows, shardCount, getShardDirectory());
+        return 0;
+    }
+    
     // Initialize language support
     if (!initLanguageSupport()) {
         printf("Warning: Language support could not be fully initialized.\n");
@@ -51,6 +103,29 @@ int main(int argc, char *argv[]) {
     if (!initializeConfigs()) {
         printf("Warning: Failed to load system configurations. Using defaults.\n");
     }
+
+    // What logging does when its queue fills up
+    logConfigure();
+    
+    // Seed the card and account indexes from the last snapshot instead of
+    // parsing the data files; falls back to the files for anything stale
+    snapshotLoad();
+
+    // Open the storage engine named in the configuration (text files by default);
+    // the text engine replays the balance journal before serving sessions
+    if (!storageEngineInit()) {
+        printf("Error: Failed to open the configured storage engine.\n");
+        return 1;
+    }
+
+    // Recover request IDs whose results only reached the balance journal
+    requestCacheStart();
+
+    // Keep the snapshot current on a schedule and at shutdown
+    snapshotStart();
+
+    // Rotate and compress the logs in the background
+    logArchiveStart();
     
     // Main application loop
     while (1) {
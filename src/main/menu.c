@@ -1,6 +1,7 @@
 #include "menu.h"
 #include "../validation/pin_validation.h"
 #include "../database/database.h"
+#include "../database/account_view.h"
 #include "../transaction/transaction_manager.h"
 #include "../utils/logger.h"
 #include "../utils/hash_utils.h"
@@ -26,15 +27,20 @@ void displayMainMenu(int cardNumber) {
     time_t currentTime;
     
     int choice;
-    char holderName[50] = "Customer";
-    char phoneNumber[15] = "0000000000";
     
-    // Get card holder's name and phone number
-    getCardHolderName(cardNumber, holderName, sizeof(holderName));
-    getCardHolderPhone(cardNumber, phoneNumber, sizeof(phoneNumber));
+    // Resolve card, account and customer once for the whole session
+    AccountView account;
+    if (!loadAccountView(cardNumber, &account)) {
+        memset(&account, 0, sizeof(account));
+        account.cardNumber = cardNumber;
+        strcpy(account.holderName, "Customer");
+        strcpy(account.phone, "0000000000");
+    }
+    const char* holderName = account.holderName;
+    const char* phoneNumber = account.phone;
     
     // Record session start
-    char logMsg[100];
+    char logMsg[200];
     sprintf(logMsg, "Session started for card %d (%s)", cardNumber, holderName);
     writeAuditLog("SESSION", logMsg);
     
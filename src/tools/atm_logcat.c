@@ -0,0 +1,103 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "../common/paths.h"
+#include "../database/transaction_log.h"
+#include "../utils/log_archive.h"
+
+// Print the binary transactions log as the pipe-delimited table it replaced.
+//
+//   atm_logcat [--test] [file...]
+//
+// With no files it prints every archived segment, oldest first, and then
+// the live log. Compressed segments (.lzs) are read like plain ones.
+
+// Command-line argument for test mode
+#define TEST_MODE_ARG "--test"
+
+// Records read at a time
+#define LOGCAT_BATCH 256
+
+static bool hasSuffix(const char* text, const char* suffix) {
+    size_t length = strlen(text);
+    size_t suffixLength = strlen(suffix);
+    return length >= suffixLength && strcmp(text + length - suffixLength, suffix) == 0;
+}
+
+// Print the rows of one log file; false if it is not a transactions log
+static bool printSegment(const LogSegment* segment) {
+    LogSegmentReader* reader = logSegmentOpen(segment);
+    char header[TRANSACTION_LOG_HEADER_SIZE];
+    if (reader == NULL || logSegmentRead(reader, 0, header, sizeof(header)) != sizeof(header) ||
+        !transactionLogValidHeader(header)) {
+        logSegmentClose(reader);
+        fprintf(stderr, "atm_logcat: %s: not a transactions log\n", segment->path);
+        return false;
+    }
+
+    TransactionLogRecord records[LOGCAT_BATCH];
+    char row[512];
+    uint64_t offset = TRANSACTION_LOG_HEADER_SIZE;
+    size_t got;
+    while ((got = logSegmentRead(reader, offset, records, sizeof(records)) / sizeof(TransactionLogRecord)) > 0) {
+        for (size_t i = 0; i < got; i++) {
+            if (records[i].id != 0) {
+                transactionLogFormatRow(&records[i], row, sizeof(row));
+                printf("%s\n", row);
+            }
+        }
+        offset += got * sizeof(TransactionLogRecord);
+    }
+
+    bool ok = logSegmentSize(reader) - offset < sizeof(TransactionLogRecord);
+    logSegmentClose(reader);
+    if (!ok) {
+        fprintf(stderr, "atm_logcat: %s: damaged at offset %llu\n", segment->path, (unsigned long long)offset);
+    }
+    return ok;
+}
+
+static bool printFile(const char* path) {
+    LogSegment segment;
+    memset(&segment, 0, sizeof(segment));
+    snprintf(segment.path, sizeof(segment.path), "%s", path);
+    segment.compressed = hasSuffix(path, ".lzs");
+    return printSegment(&segment);
+}
+
+int main(int argc, char *argv[]) {
+    int firstFile = argc;
+    for (int i = 1; i < argc && firstFile == argc; i++) {
+        if (strcmp(argv[i], TEST_MODE_ARG) == 0) {
+            setTestingMode(1);
+        } else {
+            firstFile = i;
+        }
+    }
+
+    printf("%s\n%s\n", TRANSACTION_LOG_TABLE_HEADER, TRANSACTION_LOG_TABLE_SEPARATOR);
+
+    bool ok = true;
+    if (firstFile < argc) {
+        for (int i = firstFile; i < argc; i++) {
+            ok = printFile(argv[i]) && ok;
+        }
+        return ok ? 0 : 1;
+    }
+
+    int count;
+    LogSegment* segments = logArchiveList(LOG_ARCHIVE_TRANSACTIONS, NULL, NULL, &count);
+    for (int i = 0; i < count; i++) {
+        ok = printSegment(&segments[i]) && ok;
+    }
+    free(segments);
+
+    // The live log is missing right after a rotation or before the first transaction
+    FILE* live = fopen(getTransactionsLogFilePath(), "rb");
+    if (live != NULL) {
+        fclose(live);
+        ok = printFile(getTransactionsLogFilePath()) && ok;
+    }
+    return ok ? 0 : 1;
+}
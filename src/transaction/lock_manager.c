@@ -0,0 +1,196 @@
+#define _GNU_SOURCE             // F_OFD_SETLKW
+#include "lock_manager.h"
+#include "../common/paths.h"
+#include "../utils/logger.h"
+#include "../utils/hash_utils.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+static pthread_mutex_t stripeLocks[ACCOUNT_LOCK_STRIPES];
+static pthread_once_t stripesInitialized = PTHREAD_ONCE_INIT;
+
+// Open file description locks belong to the descriptor, not the process, so
+// the kernel does not mistake two threads of one process waiting on each
+// other's stripes for a deadlock. Where they are missing, classic fcntl
+// locks are used; those are dropped when any descriptor for the file is
+// closed, so the lock file stays open for the process lifetime.
+#ifdef F_OFD_SETLKW
+#define LOCK_WAIT_CMD F_OFD_SETLKW
+#define LOCK_CMD F_OFD_SETLK
+#else
+#define LOCK_WAIT_CMD F_SETLKW
+#define LOCK_CMD F_SETLK
+#endif
+
+static pthread_mutex_t fileLock = PTHREAD_MUTEX_INITIALIZER;
+static int lockFd = -1;
+static int lockFdMode = -1;
+
+static void initStripes(void) {
+    for (int i = 0; i < ACCOUNT_LOCK_STRIPES; i++) {
+        pthread_mutex_init(&stripeLocks[i], NULL);
+    }
+}
+
+// FNV-1a over the account ID
+static int stripeForAccount(const char* accountID) {
+    return (int)(fnv1a_hash(accountID) % ACCOUNT_LOCK_STRIPES);
+}
+
+// Open the lock file for the current mode on first use
+static int lockFileDescriptor(void) {
+    pthread_mutex_lock(&fileLock);
+    int mode = isTestingMode() ? 1 : 0;
+    if (lockFd >= 0 && lockFdMode != mode) {
+        // Only reached when switching modes, with no locks held
+        close(lockFd);
+        lockFd = -1;
+    }
+    if (lockFd < 0) {
+        lockFd = open(getAccountLockFilePath(), O_RDWR | O_CREAT, 0644);
+        lockFdMode = mode;
+        if (lockFd < 0) {
+            writeErrorLog("Failed to open account lock file");
+        }
+    }
+    int fd = lockFd;
+    pthread_mutex_unlock(&fileLock);
+    return fd;
+}
+
+// Lock or unlock one stripe's byte in the lock file
+static bool setStripeFileLock(int fd, int stripe, short type) {
+    struct flock region;
+    memset(&region, 0, sizeof(region));
+    region.l_type = type;
+    region.l_whence = SEEK_SET;
+    region.l_start = stripe;
+    region.l_len = 1;
+
+    // Classic locks may report EDEADLK for threads of one process; the stripe
+    // order rules out a real cycle, so waiting again is safe
+    while (fcntl(fd, type == F_UNLCK ? LOCK_CMD : LOCK_WAIT_CMD, &region) != 0) {
+        if (errno != EINTR && errno != EDEADLK) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool lockStripe(int fd, int stripe) {
+    pthread_mutex_lock(&stripeLocks[stripe]);
+    if (!setStripeFileLock(fd, stripe, F_WRLCK)) {
+        pthread_mutex_unlock(&stripeLocks[stripe]);
+        return false;
+    }
+    return true;
+}
+
+static void unlockStripe(int fd, int stripe) {
+    setStripeFileLock(fd, stripe, F_UNLCK);
+    pthread_mutex_unlock(&stripeLocks[stripe]);
+}
+
+bool lockAccounts(AccountLockSet* locks, const char* const* accountIDs, int count) {
+    locks->count = 0;
+    locks->fd = -1;
+    if (accountIDs == NULL || count <= 0 || count > ACCOUNT_LOCK_MAX) {
+        return false;
+    }
+
+    // Sorted, distinct stripes give every transaction the same lock order
+    int stripes[ACCOUNT_LOCK_MAX];
+    int stripeCount = 0;
+    for (int i = 0; i < count; i++) {
+        if (accountIDs[i] == NULL) {
+            return false;
+        }
+        int stripe = stripeForAccount(accountIDs[i]);
+        int pos = stripeCount;
+        while (pos > 0 && stripes[pos - 1] > stripe) {
+            pos--;
+        }
+        if (pos > 0 && stripes[pos - 1] == stripe) {
+            continue;
+        }
+        memmove(&stripes[pos + 1], &stripes[pos], (size_t)(stripeCount - pos) * sizeof(int));
+        stripes[pos] = stripe;
+        stripeCount++;
+    }
+
+    pthread_once(&stripesInitialized, initStripes);
+    locks->fd = lockFileDescriptor();
+    if (locks->fd < 0) {
+        return false;
+    }
+
+    for (int i = 0; i < stripeCount; i++) {
+        if (!lockStripe(locks->fd, stripes[i])) {
+            writeErrorLog("Failed to lock account stripe in lock file");
+            unlockAccounts(locks);
+            return false;
+        }
+        locks->stripes[locks->count++] = stripes[i];
+    }
+    return true;
+}
+
+bool lockAccount(AccountLockSet* locks, const char* accountID) {
+    return lockAccounts(locks, &accountID, 1);
+}
+
+void unlockAccounts(AccountLockSet* locks) {
+    for (int i = locks->count - 1; i >= 0; i--) {
+        unlockStripe(locks->fd, locks->stripes[i]);
+    }
+    locks->count = 0;
+}
+
+bool lockAccountBatch(AccountBatchLock* locks, const char* const* accountIDs, int count) {
+    memset(locks->held, 0, sizeof(locks->held));
+    locks->fd = -1;
+    if (accountIDs == NULL || count <= 0) {
+        return false;
+    }
+
+    bool wanted[ACCOUNT_LOCK_STRIPES] = { false };
+    for (int i = 0; i < count; i++) {
+        if (accountIDs[i] == NULL) {
+            return false;
+        }
+        wanted[stripeForAccount(accountIDs[i])] = true;
+    }
+
+    pthread_once(&stripesInitialized, initStripes);
+    locks->fd = lockFileDescriptor();
+    if (locks->fd < 0) {
+        return false;
+    }
+
+    for (int stripe = 0; stripe < ACCOUNT_LOCK_STRIPES; stripe++) {
+        if (!wanted[stripe]) {
+            continue;
+        }
+        if (!lockStripe(locks->fd, stripe)) {
+            writeErrorLog("Failed to lock account stripe in lock file");
+            unlockAccountBatch(locks);
+            return false;
+        }
+        locks->held[stripe] = true;
+    }
+    return true;
+}
+
+void unlockAccountBatch(AccountBatchLock* locks) {
+    for (int stripe = ACCOUNT_LOCK_STRIPES - 1; stripe >= 0; stripe--) {
+        if (locks->held[stripe]) {
+            unlockStripe(locks->fd, stripe);
+            locks->held[stripe] = false;
+        }
+    }
+}
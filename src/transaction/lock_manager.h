@@ -0,0 +1,71 @@
+#ifndef LOCK_MANAGER_H
+#define LOCK_MANAGER_H
+
+#include <stdbool.h>
+
+/**
+ * Per-account locks for balance read-modify-write
+ *
+ * Accounts hash onto ACCOUNT_LOCK_STRIPES stripes. Each stripe is a mutex
+ * for the threads of this process and a one-byte fcntl lock in the
+ * account lock file for other ATM processes sharing the data directory.
+ * Transactions on accounts in different stripes run in parallel.
+ *
+ * A lock set takes its stripes in ascending stripe order, so two
+ * transfers over the same accounts can never wait on each other in a cycle.
+ */
+
+#define ACCOUNT_LOCK_STRIPES 256
+#define ACCOUNT_LOCK_MAX 8
+
+// Stripes held by one transaction, in the order they were taken
+typedef struct {
+    int stripes[ACCOUNT_LOCK_MAX];
+    int count;
+    int fd;                   // Lock file the byte locks were taken on
+} AccountLockSet;
+
+/**
+ * Lock every account in `accountIDs`, blocking until all are held
+ *
+ * Duplicate accounts, and accounts sharing a stripe, are locked once.
+ *
+ * @param locks Receives the held stripes; pass to unlockAccounts
+ * @param accountIDs Accounts to lock, in any order
+ * @param count Number of accounts, at most ACCOUNT_LOCK_MAX
+ * @return true if all locks are held, false (holding none) on failure
+ */
+bool lockAccounts(AccountLockSet* locks, const char* const* accountIDs, int count);
+
+/**
+ * Release the locks taken by lockAccounts
+ */
+void unlockAccounts(AccountLockSet* locks);
+
+/**
+ * Lock a single account
+ */
+bool lockAccount(AccountLockSet* locks, const char* accountID);
+
+// Stripes held by a batch, which may touch any number of accounts
+typedef struct {
+    bool held[ACCOUNT_LOCK_STRIPES];
+    int fd;
+} AccountBatchLock;
+
+/**
+ * Lock every stripe used by `accountIDs`, in ascending stripe order
+ *
+ * Meant for back-office batches: a large batch holds most stripes, so ATM
+ * sessions wait until unlockAccountBatch.
+ *
+ * @return true if all locks are held, false (holding none) on failure
+ */
+bool lockAccountBatch(AccountBatchLock* locks, const char* const* accountIDs, int count);
+
+/**
+ * Release the locks taken by lockAccountBatch
+ */
+void unlockAccountBatch(AccountBatchLock* locks);
+
+#endif // LOCK_MANAGER_H
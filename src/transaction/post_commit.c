@@ -0,0 +1,207 @@
+#include "post_commit.h"
+#include "transaction_manager.h"
+#include "../database/database.h"
+#include "../utils/logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#define POST_COMMIT_QUEUE_SIZE 1024
+
+// Events the worker takes from the queue at once
+#define POST_COMMIT_BATCH 64
+
+// Queue state, guarded by queueLock
+static pthread_mutex_t queueLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queueNotEmpty = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t queueNotFull = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t queueDrained = PTHREAD_COND_INITIALIZER;
+static PostCommitEvent queue[POST_COMMIT_QUEUE_SIZE];
+static size_t queueHead = 0;                // Oldest queued event
+static size_t queueCount = 0;
+static bool workerBusy = false;             // Writing events already taken off the queue
+static bool workerRunning = false;
+static bool workerStopping = false;
+static pthread_t worker;
+
+// Details lines for the audit log, in the same wording as writeTransactionDetails
+static void formatEventDetails(const PostCommitEvent* event, char* line, size_t size,
+                               char* receivedLine, size_t receivedSize) {
+    char details[150];
+    receivedLine[0] = '\0';
+
+    switch (event->type) {
+        case TRANSACTION_DEPOSIT:
+            snprintf(details, sizeof(details), "Deposited $%.2f. Old balance: $%.2f, New balance: $%.2f",
+                     event->amount, event->oldBalance, event->newBalance);
+            formatTransactionDetails(line, size, event->username, "Deposit", details);
+            break;
+        case TRANSACTION_WITHDRAWAL:
+            snprintf(details, sizeof(details), "Withdrew $%.2f. Old balance: $%.2f, New balance: $%.2f",
+                     event->amount, event->oldBalance, event->newBalance);
+            formatTransactionDetails(line, size, event->username, "Withdrawal", details);
+            break;
+        case TRANSACTION_MONEY_TRANSFER: {
+            snprintf(details, sizeof(details), "Transferred $%.2f to card %d",
+                     event->amount, event->targetCardNumber);
+            formatTransactionDetails(line, size, event->username, "Money Transfer", details);
+
+            // The recipient's line is written under their own name
+            char recipientName[50] = "Unknown";
+            getCardHolderName(event->targetCardNumber, recipientName, sizeof(recipientName));
+            snprintf(details, sizeof(details), "Received $%.2f from card %d (%s)",
+                     event->amount, event->cardNumber, event->username);
+            formatTransactionDetails(receivedLine, receivedSize, recipientName, "Money Received", details);
+            break;
+        }
+        default:
+            line[0] = '\0';
+            break;
+    }
+}
+
+// Write the side effects of `count` events, with one write to the transactions log
+static void writeEvents(const PostCommitEvent* events, size_t count) {
+    TransactionLogEntry entries[POST_COMMIT_BATCH * 2];
+    char lines[POST_COMMIT_BATCH * 2][300];
+    size_t entryCount = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        const PostCommitEvent* event = &events[i];
+        char* line = lines[entryCount];
+        char* receivedLine = lines[entryCount + 1];
+        formatEventDetails(event, line, sizeof(lines[0]), receivedLine, sizeof(lines[0]));
+
+        TransactionLogEntry entry = { event->cardNumber, event->accountID, event->type, event->amount, true,
+                                      event->transactionID, event->time, line[0] != '\0' ? line : NULL };
+        entries[entryCount++] = entry;
+        if (event->type == TRANSACTION_MONEY_TRANSFER) {
+            TransactionLogEntry received = { event->targetCardNumber, event->targetAccountID, event->type,
+                                             event->amount, true, 0, event->time, receivedLine };
+            entries[entryCount++] = received;
+        }
+
+        if (event->type == TRANSACTION_WITHDRAWAL) {
+            logHeldWithdrawal(event->cardNumber, event->amount);
+        }
+
+        char auditMsg[200];
+        snprintf(auditMsg, sizeof(auditMsg), "Committed transaction %lld for card %d (account %s): "
+                 "amount %.2f, balance %.2f -> %.2f", event->transactionID, event->cardNumber,
+                 event->accountID, event->amount, event->oldBalance, event->newBalance);
+        writeAuditLog("TRANSACTION", auditMsg);
+    }
+
+    logTransactions(entries, entryCount);
+}
+
+static void* workerMain(void* arg) {
+    (void)arg;
+    PostCommitEvent batch[POST_COMMIT_BATCH];
+
+    pthread_mutex_lock(&queueLock);
+    for (;;) {
+        while (queueCount == 0 && !workerStopping) {
+            pthread_cond_wait(&queueNotEmpty, &queueLock);
+        }
+        if (queueCount == 0) {
+            break;
+        }
+
+        size_t taken = 0;
+        while (taken < POST_COMMIT_BATCH && queueCount > 0) {
+            batch[taken++] = queue[queueHead];
+            queueHead = (queueHead + 1) % POST_COMMIT_QUEUE_SIZE;
+            queueCount--;
+        }
+        workerBusy = true;
+        pthread_cond_broadcast(&queueNotFull);
+        pthread_mutex_unlock(&queueLock);
+
+        writeEvents(batch, taken);
+
+        pthread_mutex_lock(&queueLock);
+        workerBusy = false;
+        pthread_cond_broadcast(&queueDrained);
+    }
+    pthread_mutex_unlock(&queueLock);
+    return NULL;
+}
+
+// Drain the queue and stop the worker
+static void stopWorkerAtExit(void) {
+    pthread_mutex_lock(&queueLock);
+    if (!workerRunning) {
+        pthread_mutex_unlock(&queueLock);
+        return;
+    }
+    workerStopping = true;
+    pthread_cond_broadcast(&queueNotEmpty);
+    pthread_mutex_unlock(&queueLock);
+
+    pthread_join(worker, NULL);
+
+    pthread_mutex_lock(&queueLock);
+    workerRunning = false;
+    workerStopping = false;
+    pthread_mutex_unlock(&queueLock);
+}
+
+// A forked child has no worker; the parent's worker writes what was queued
+static void resetInChild(void) {
+    pthread_mutex_init(&queueLock, NULL);
+    queueHead = 0;
+    queueCount = 0;
+    workerBusy = false;
+    workerRunning = false;
+    workerStopping = false;
+}
+
+// Start the worker on first use; needs queueLock
+static bool ensureWorkerLocked(void) {
+    static bool handlersRegistered = false;
+    if (workerRunning) {
+        return true;
+    }
+    if (pthread_create(&worker, NULL, workerMain, NULL) != 0) {
+        return false;
+    }
+    workerRunning = true;
+    if (!handlersRegistered) {
+        atexit(stopWorkerAtExit);
+        pthread_atfork(NULL, NULL, resetInChild);
+        handlersRegistered = true;
+    }
+    return true;
+}
+
+void postCommitEnqueue(const PostCommitEvent* event) {
+    if (event == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&queueLock);
+    if (workerStopping || !ensureWorkerLocked()) {
+        pthread_mutex_unlock(&queueLock);
+        writeErrorLog("Post-commit worker unavailable; writing transaction logs inline");
+        writeEvents(event, 1);
+        return;
+    }
+    while (queueCount == POST_COMMIT_QUEUE_SIZE) {
+        pthread_cond_wait(&queueNotFull, &queueLock);
+    }
+    queue[(queueHead + queueCount) % POST_COMMIT_QUEUE_SIZE] = *event;
+    queueCount++;
+    pthread_cond_signal(&queueNotEmpty);
+    pthread_mutex_unlock(&queueLock);
+}
+
+void postCommitFlush(void) {
+    pthread_mutex_lock(&queueLock);
+    while (workerRunning && (queueCount > 0 || workerBusy)) {
+        pthread_cond_wait(&queueDrained, &queueLock);
+    }
+    pthread_mutex_unlock(&queueLock);
+}
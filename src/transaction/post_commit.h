@@ -0,0 +1,50 @@
+#ifndef POST_COMMIT_H
+#define POST_COMMIT_H
+
+#include "transaction_types.h"
+#include <time.h>
+
+/**
+ * Side effects of committed transactions, written by a background worker
+ *
+ * Once a balance change is durable the transaction queues a PostCommitEvent
+ * and returns its result. A worker thread writes the records to the
+ * transactions log and the withdrawal log and the details lines to the
+ * audit log, with one write to the transactions log per batch of queued
+ * events. A full queue makes the caller wait for room; if the worker
+ * cannot be started the caller writes the event itself. The queue is
+ * drained at exit.
+ */
+
+// A committed deposit, withdrawal or transfer
+typedef struct {
+    TransactionType type;
+    int cardNumber;
+    int targetCardNumber;           // Receiving card of a transfer
+    char accountID[20];
+    char targetAccountID[20];
+    float amount;
+    float oldBalance;
+    float newBalance;
+    char username[50];
+    time_t time;                    // Commit time
+    long long transactionID;        // 0 to allocate one when the row is written
+} PostCommitEvent;
+
+/**
+ * Queue the side effects of a committed transaction
+ *
+ * Withdrawals must already be held with withdrawalTrackerHold; the hold
+ * is dropped once the withdrawal is logged.
+ *
+ * @param event The committed transaction; copied into the queue
+ */
+void postCommitEnqueue(const PostCommitEvent* event);
+
+/**
+ * Wait until every event queued so far has been written
+ * Call before reading the transactions log for this process's own rows.
+ */
+void postCommitFlush(void);
+
+#endif // POST_COMMIT_H
@@ -0,0 +1,445 @@
+#include "request_cache.h"
+#include "../common/paths.h"
+#include "../database/journal.h"
+#include "../utils/logger.h"
+#include "../utils/hash_utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define REQUEST_BUCKETS (REQUEST_CACHE_CAPACITY * 2)
+#define REQUEST_RECORD_MAGIC 0x31514552u          // "REQ1"
+
+// requests.log is rewritten with only the cached results once it holds this many records
+#define REQUEST_COMPACT_RECORDS (REQUEST_CACHE_CAPACITY * 2)
+
+// What a request ID was first used for; a retry must match it
+typedef struct {
+    char requestID[40];
+    int cardNumber;
+    int targetCardNumber;
+    TransactionType type;
+    float amount;
+} RequestKey;
+
+typedef struct {
+    RequestKey key;
+    TransactionResult result;
+    bool used;
+    bool done;                  // false while the first attempt is running
+    int next;                   // Next slot in the same bucket, -1 at the end
+} RequestEntry;
+
+// One record of requests.log
+typedef struct {
+    uint32_t magic;
+    RequestKey key;
+    TransactionResult result;
+    uint32_t crc;               // Over everything before it
+} PersistedRequest;
+
+// Cache state, guarded by cacheLock
+static pthread_mutex_t cacheLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t requestDone = PTHREAD_COND_INITIALIZER;
+static RequestEntry* entries = NULL;
+static int buckets[REQUEST_BUCKETS];
+static int nextSlot = 0;                    // Slots are reused oldest first
+static int loadedMode = -1;
+static int unclaimed = 0;                   // Running requests that found no free slot
+static int unwritten = 0;                   // Results not yet appended to requests.log
+
+// requests.log, guarded by fileLock
+static pthread_mutex_t fileLock = PTHREAD_MUTEX_INITIALIZER;
+static int requestFd = -1;
+static long fileRecords = 0;
+
+// FNV-1a over the request ID
+static size_t hashRequestID(const char* requestID) {
+    return (size_t)fnv1a_hash(requestID) % REQUEST_BUCKETS;
+}
+
+static void makeKey(const TransactionData* op, RequestKey* key) {
+    memset(key, 0, sizeof(*key));
+    snprintf(key->requestID, sizeof(key->requestID), "%.*s",
+             (int)sizeof(op->request_id), op->request_id);
+    key->cardNumber = op->card_number;
+    key->targetCardNumber = op->type == TRANSACTION_MONEY_TRANSFER ? op->target_card_number : 0;
+    key->type = op->type;
+    key->amount = op->amount;
+}
+
+static bool sameTransaction(const RequestKey* a, const RequestKey* b) {
+    return a->cardNumber == b->cardNumber && a->targetCardNumber == b->targetCardNumber &&
+           a->type == b->type && a->amount == b->amount;
+}
+
+static int entryFind(const char* requestID) {
+    for (int slot = buckets[hashRequestID(requestID)]; slot >= 0; slot = entries[slot].next) {
+        if (strcmp(entries[slot].key.requestID, requestID) == 0) {
+            return slot;
+        }
+    }
+    return -1;
+}
+
+static void entryRemove(int slot) {
+    int* link = &buckets[hashRequestID(entries[slot].key.requestID)];
+    while (*link != slot) {
+        link = &entries[*link].next;
+    }
+    *link = entries[slot].next;
+    entries[slot].used = false;
+}
+
+// Take the oldest slot that is not running; -1 if every slot is
+static int entryInsert(const RequestKey* key) {
+    for (int tries = 0; tries < REQUEST_CACHE_CAPACITY; tries++) {
+        int slot = nextSlot;
+        nextSlot = (nextSlot + 1) % REQUEST_CACHE_CAPACITY;
+        if (entries[slot].used && !entries[slot].done) {
+            continue;
+        }
+        if (entries[slot].used) {
+            entryRemove(slot);
+        }
+
+        RequestEntry* entry = &entries[slot];
+        memset(entry, 0, sizeof(*entry));
+        entry->key = *key;
+        entry->used = true;
+        size_t bucket = hashRequestID(key->requestID);
+        entry->next = buckets[bucket];
+        buckets[bucket] = slot;
+        return slot;
+    }
+    return -1;
+}
+
+static uint32_t recordChecksum(const PersistedRequest* record) {
+    return crc32_checksum(record, offsetof(PersistedRequest, crc));
+}
+
+static void writeRecordLocked(const RequestKey* key, const TransactionResult* result);
+static bool syncJournaledRequests(void);
+
+// Rebuild the result a journaled request returned
+static void journaledResult(const JournalRequest* request, TransactionResult* result) {
+    memset(result, 0, sizeof(*result));
+    result->success = 1;
+    result->oldBalance = request->oldBalance;
+    result->newBalance = request->newBalance;
+    if (request->batch) {
+        snprintf(result->message, sizeof(result->message), "Posted. New balance: $%.2f", request->newBalance);
+    } else if (request->type == TRANSACTION_DEPOSIT) {
+        snprintf(result->message, sizeof(result->message), "Deposit successful. New balance: $%.2f", request->newBalance);
+    } else if (request->type == TRANSACTION_WITHDRAWAL) {
+        snprintf(result->message, sizeof(result->message), "Withdrawal successful. New balance: $%.2f", request->newBalance);
+    } else {
+        snprintf(result->message, sizeof(result->message), "Transfer successful. Your new balance: $%.2f", request->newBalance);
+    }
+}
+
+// Add a request replayed from the balance journal that requests.log missed;
+// needs cacheLock and fileLock
+static void importJournaledRequest(const JournalRequest* request, void* context) {
+    (void)context;
+    if (request->requestID[0] == '\0' || entryFind(request->requestID) >= 0) {
+        return;
+    }
+
+    RequestKey key;
+    memset(&key, 0, sizeof(key));
+    memcpy(key.requestID, request->requestID, sizeof(key.requestID));
+    key.cardNumber = request->cardNumber;
+    key.targetCardNumber = request->targetCardNumber;
+    key.type = (TransactionType)request->type;
+    key.amount = request->amount;
+
+    int slot = entryInsert(&key);
+    if (slot >= 0) {
+        journaledResult(request, &entries[slot].result);
+        entries[slot].done = true;
+        writeRecordLocked(&key, &entries[slot].result);
+    }
+}
+
+// Read requests.log into the table and cut off a torn tail; needs fileLock and cacheLock
+static void loadLocked(void) {
+    if (entries == NULL) {
+        entries = (RequestEntry*)calloc(REQUEST_CACHE_CAPACITY, sizeof(RequestEntry));
+        if (entries == NULL) {
+            return;
+        }
+    }
+    memset(entries, 0, REQUEST_CACHE_CAPACITY * sizeof(RequestEntry));
+    for (int i = 0; i < REQUEST_BUCKETS; i++) {
+        buckets[i] = -1;
+    }
+    nextSlot = 0;
+
+    if (requestFd >= 0) {
+        close(requestFd);
+    }
+    fileRecords = 0;
+    requestFd = open(getRequestCacheFilePath(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (requestFd < 0) {
+        writeErrorLog("Failed to open the request cache file; request IDs are remembered until exit only");
+        return;
+    }
+
+    PersistedRequest record;
+    off_t validEnd = 0;
+    while (pread(requestFd, &record, sizeof(record), validEnd) == (ssize_t)sizeof(record) &&
+           record.magic == REQUEST_RECORD_MAGIC && record.crc == recordChecksum(&record) &&
+           memchr(record.key.requestID, '\0', sizeof(record.key.requestID)) != NULL) {
+        int slot = entryFind(record.key.requestID);
+        if (slot < 0) {
+            slot = entryInsert(&record.key);
+        }
+        if (slot >= 0) {
+            entries[slot].result = record.result;
+            entries[slot].done = true;
+        }
+        validEnd += (off_t)sizeof(record);
+        fileRecords++;
+    }
+
+    off_t size = lseek(requestFd, 0, SEEK_END);
+    if (size > validEnd) {
+        writeErrorLog("Discarding incomplete request cache tail");
+        if (ftruncate(requestFd, validEnd) != 0) {
+            writeErrorLog("Failed to trim the request cache file");
+        }
+    }
+
+    // Results whose requests.log write was lost are in the journal with their balance change
+    journalTakeRequests(importJournaledRequest, NULL);
+    journalSetRequestSync(syncJournaledRequests);
+}
+
+// Load the table on first use and when switching between production and test
+// mode. Where both locks are held, fileLock is always taken first.
+static bool ensureLoaded(void) {
+    pthread_mutex_lock(&fileLock);
+    pthread_mutex_lock(&cacheLock);
+    int mode = isTestingMode() ? 1 : 0;
+    if (entries == NULL || mode != loadedMode) {
+        loadLocked();
+        loadedMode = mode;
+    }
+    bool loaded = entries != NULL;
+    pthread_mutex_unlock(&cacheLock);
+    pthread_mutex_unlock(&fileLock);
+    return loaded;
+}
+
+// Rewrite requests.log with the cached results only; needs fileLock
+static void compactLocked(void) {
+    const char* path = getRequestCacheFilePath();
+    char tempPath[128];
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+
+    int fd = open(tempPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return;
+    }
+
+    long written = 0;
+    bool ok = true;
+    PersistedRequest record;
+    pthread_mutex_lock(&cacheLock);
+    for (int slot = 0; slot < REQUEST_CACHE_CAPACITY && ok; slot++) {
+        if (entries[slot].used && entries[slot].done) {
+            memset(&record, 0, sizeof(record));
+            record.magic = REQUEST_RECORD_MAGIC;
+            record.key = entries[slot].key;
+            record.result = entries[slot].result;
+            record.crc = recordChecksum(&record);
+            ok = write(fd, &record, sizeof(record)) == (ssize_t)sizeof(record);
+            written++;
+        }
+    }
+    pthread_mutex_unlock(&cacheLock);
+
+    ok = ok && fdatasync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+    if (!ok || rename(tempPath, path) != 0) {
+        remove(tempPath);
+        writeErrorLog("Failed to compact the request cache file");
+        return;
+    }
+
+    close(requestFd);
+    requestFd = open(path, O_RDWR | O_APPEND, 0644);
+    fileRecords = written;
+}
+
+// Append a result to requests.log; needs fileLock
+static void writeRecordLocked(const RequestKey* key, const TransactionResult* result) {
+    PersistedRequest record;
+    memset(&record, 0, sizeof(record));
+    record.magic = REQUEST_RECORD_MAGIC;
+    record.key = *key;
+    record.result = *result;
+    record.crc = recordChecksum(&record);
+
+    if (requestFd < 0 || write(requestFd, &record, sizeof(record)) != (ssize_t)sizeof(record)) {
+        writeErrorLog("Failed to write the request cache file");
+        return;
+    }
+    fileRecords++;
+}
+
+// Append a result to requests.log. A result that is not in the balance
+// journal is waited for until it is on disk; a journaled one is synced by
+// syncJournaledRequests before the journal lets go of it.
+static void persistResult(const RequestKey* key, const TransactionResult* result, bool journaled) {
+    pthread_mutex_lock(&fileLock);
+    long before = fileRecords;
+    writeRecordLocked(key, result);
+    if (fileRecords > before) {
+        if (!journaled && fdatasync(requestFd) != 0) {
+            writeErrorLog("Failed to sync the request cache file");
+        } else if (fileRecords >= REQUEST_COMPACT_RECORDS) {
+            compactLocked();
+        }
+    }
+    pthread_mutex_unlock(&fileLock);
+}
+
+// Called by the journal before it trims records that carry request IDs.
+// Fails while a claimed request may still be missing from requests.log.
+static bool syncJournaledRequests(void) {
+    pthread_mutex_lock(&cacheLock);
+    bool settled = entries != NULL && unclaimed == 0 && unwritten == 0;
+    for (int slot = 0; settled && slot < REQUEST_CACHE_CAPACITY; slot++) {
+        settled = !entries[slot].used || entries[slot].done;
+    }
+    pthread_mutex_unlock(&cacheLock);
+    if (!settled) {
+        return false;
+    }
+
+    pthread_mutex_lock(&fileLock);
+    bool ok = requestFd >= 0 && fdatasync(requestFd) == 0;
+    pthread_mutex_unlock(&fileLock);
+    return ok;
+}
+
+void requestCacheStart(void) {
+    ensureLoaded();
+}
+
+bool requestCacheBegin(const TransactionData* op, TransactionResult* cached) {
+    if (op == NULL || op->request_id[0] == '\0') {
+        return false;
+    }
+
+    RequestKey key;
+    makeKey(op, &key);
+    if (!ensureLoaded()) {
+        return false;
+    }
+
+    pthread_mutex_lock(&cacheLock);
+
+    for (;;) {
+        int slot = entryFind(key.requestID);
+        if (slot < 0) {
+            // First attempt: claim the ID so a concurrent retry waits for this result
+            if (entryInsert(&key) < 0) {
+                unclaimed++;
+            }
+            pthread_mutex_unlock(&cacheLock);
+            return false;
+        }
+
+        if (!sameTransaction(&entries[slot].key, &key)) {
+            memset(cached, 0, sizeof(*cached));
+            cached->success = 0;
+            strcpy(cached->message, "Error: Request ID was already used for a different transaction");
+            pthread_mutex_unlock(&cacheLock);
+            return true;
+        }
+        if (entries[slot].done) {
+            *cached = entries[slot].result;
+            pthread_mutex_unlock(&cacheLock);
+            return true;
+        }
+
+        // The first attempt is still running; if it fails this one takes over
+        pthread_cond_wait(&requestDone, &cacheLock);
+    }
+}
+
+void requestCacheJournal(const TransactionData* op, const TransactionResult* result) {
+    if (op == NULL || op->request_id[0] == '\0') {
+        return;
+    }
+
+    RequestKey key;
+    makeKey(op, &key);
+
+    JournalRequest request;
+    memset(&request, 0, sizeof(request));
+    memcpy(request.requestID, key.requestID, sizeof(request.requestID));
+    request.cardNumber = key.cardNumber;
+    request.targetCardNumber = key.targetCardNumber;
+    request.type = (int)key.type;
+    request.amount = key.amount;
+    if (result != NULL) {
+        request.oldBalance = result->oldBalance;
+        request.newBalance = result->newBalance;
+        request.batch = true;
+    }
+    journalAttachRequest(&request);
+}
+
+void requestCacheFinish(const TransactionData* op, const TransactionResult* result) {
+    bool journaled = journalDetachRequests();
+    if (op == NULL || result == NULL || op->request_id[0] == '\0') {
+        return;
+    }
+
+    RequestKey key;
+    makeKey(op, &key);
+    if (!ensureLoaded()) {
+        return;
+    }
+
+    pthread_mutex_lock(&cacheLock);
+
+    int slot = entryFind(key.requestID);
+    if (slot < 0 && unclaimed > 0) {
+        unclaimed--;
+    }
+    if (result->success) {
+        if (slot < 0) {
+            // Every slot was running when the request began
+            slot = entryInsert(&key);
+        }
+        if (slot >= 0) {
+            entries[slot].result = *result;
+            entries[slot].done = true;
+        }
+    } else if (slot >= 0 && !entries[slot].done) {
+        entryRemove(slot);
+    }
+    unwritten += result->success ? 1 : 0;
+    pthread_cond_broadcast(&requestDone);
+    pthread_mutex_unlock(&cacheLock);
+
+    // A retry may already have the result; the caller gets it once it is durable
+    if (result->success) {
+        persistResult(&key, result, journaled);
+
+        pthread_mutex_lock(&cacheLock);
+        unwritten--;
+        pthread_mutex_unlock(&cacheLock);
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef REQUEST_CACHE_H
+#define REQUEST_CACHE_H
+
+#include <stdbool.h>
+#include "transaction_manager.h"
+
+/**
+ * Replay cache for client request IDs
+ *
+ * A deposit, withdrawal or transfer that carries a request_id runs at most
+ * once. The request ID is written into the balance journal record that
+ * commits the request's balance change, so the two reach the disk together.
+ * The result is kept in a bounded in-memory table and appended to
+ * requests.log in the journal directory, so a retry after a timeout or a
+ * restart gets the stored result without touching the data files. A retry
+ * that arrives while the first attempt is still running waits for its
+ * result. Failed requests changed nothing and are not kept, so they can be
+ * retried.
+ *
+ * requests.log is synced only before the journal trims the records whose
+ * requests it holds; at startup, results missing from it are rebuilt from
+ * the journal. Without the journal every result is synced as it is stored.
+ */
+
+// Results kept in memory; the oldest are dropped first
+#define REQUEST_CACHE_CAPACITY 4096
+
+/**
+ * Claim a request before running it
+ *
+ * @param op The request; one without a request_id is never cached
+ * @param cached Receives the stored result when true is returned
+ * @return true if `cached` holds the answer: the stored result of an
+ *         earlier attempt, or an error if the ID was used for a different
+ *         transaction. false if the caller must run the request and then
+ *         call requestCacheFinish.
+ */
+bool requestCacheBegin(const TransactionData* op, TransactionResult* cached);
+
+/**
+ * Load the stored results and take over the request IDs found in the
+ * balance journal
+ *
+ * Call after storageEngineInit. Until the cache is loaded the journal keeps
+ * every record that carries a request ID.
+ */
+void requestCacheStart(void);
+
+/**
+ * Write a claimed request into the next balance journal record the calling
+ * thread commits
+ *
+ * @param op The request
+ * @param result Its result when it is part of a batch; NULL for a single
+ *        request, whose balances are taken from the commit itself
+ */
+void requestCacheJournal(const TransactionData* op, const TransactionResult* result);
+
+/**
+ * Store the result of a request claimed with requestCacheBegin
+ *
+ * @param op The request
+ * @param result Its result; kept only if it succeeded
+ */
+void requestCacheFinish(const TransactionData* op, const TransactionResult* result);
+
+#endif // REQUEST_CACHE_H
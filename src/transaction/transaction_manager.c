@@ -1,7 +1,15 @@
 #include "transaction_manager.h"
+#include "lock_manager.h"
 #include "../database/database.h"
+#include "../database/storage_engine.h"
+#include "../database/withdrawal_tracker.h"
+#include "../database/history_index.h"
+#include "../database/id_allocator.h"
+#include "post_commit.h"
+#include "request_cache.h"
 #include "../utils/logger.h"
 #include "../utils/hash_utils.h"
+#include "../utils/clock_utils.h"
 #include "../common/paths.h"
 #include "../database/customer_profile.h"
 #include "../config/config_manager.h"  // Added config manager include
@@ -23,37 +31,75 @@
 #define CONFIG_DAILY_TRANSACTION_LIMIT "daily_limit"
 #endif
 
-// Helper function to get current timestamp as a string
-static void getCurrentTimestamp(char *buffer, size_t size) {
-    time_t now = time(NULL);
-    struct tm *t = localtime(&now);
-    strftime(buffer, size, "%Y-%m-%d %H:%M:%S", t);
+// Format a details line for the audit log
+void formatTransactionDetails(char* buffer, size_t size, const char* username,
+                              const char* transactionType, const char* details) {
+    snprintf(buffer, size, "User: %s, Type: %s, Details: %s", username, transactionType, details);
 }
 
-// Write detailed transaction information to log
+// Write detailed transaction information to the audit log; the
+// transactions log holds only the fixed-size records
 void writeTransactionDetails(const char* username, const char* transactionType, const char* details) {
-    time_t now = time(NULL);
-    struct tm* tm_now = localtime(&now);
-    char timestamp[30];
-    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", tm_now);
-    
-    // Create a log message with all details
     char logMessage[512];
-    snprintf(logMessage, sizeof(logMessage), "[%s] User: %s, Type: %s, Details: %s", 
-             timestamp, username, transactionType, details);
-    
-    // Log to transaction file
-    const char* transactionPath = isTestingMode() ? 
-        TEST_TRANSACTIONS_LOG_FILE : PROD_TRANSACTIONS_LOG_FILE;
-    
-    FILE* file = fopen(transactionPath, "a");
-    if (file != NULL) {
-        fprintf(file, "%s\n", logMessage);
-        fclose(file);
-    } else {
-        // If transaction log cannot be opened, fall back to error log
-        writeErrorLog("Failed to write transaction details");
+    formatTransactionDetails(logMessage, sizeof(logMessage), username, transactionType, details);
+    writeAuditLog("TRANSACTION", logMessage);
+}
+
+// Daily withdrawal limit of a card: its own config key, else the configured default
+static int cardDailyLimit(int cardNumber) {
+    int dailyLimit = getConfigValueInt(CONFIG_DAILY_TRANSACTION_LIMIT);
+    if (dailyLimit <= 0) {
+        dailyLimit = 50000; // Default limit if not configured
+    }
+    return withdrawalDailyLimit(cardNumber, dailyLimit);
+}
+
+// Fill in a post-commit event for a transaction committed just now
+static void initCommittedEvent(PostCommitEvent* event, TransactionType type, int cardNumber, float amount,
+                               float oldBalance, float newBalance, const char* username) {
+    memset(event, 0, sizeof(*event));
+    event->type = type;
+    event->cardNumber = cardNumber;
+    event->amount = amount;
+    event->oldBalance = oldBalance;
+    event->newBalance = newBalance;
+    snprintf(event->username, sizeof(event->username), "%s", username != NULL ? username : "");
+    ClockReading now;
+    clockRead(&now);
+    event->time = now.second;
+    event->transactionID = allocateId(ID_SEQUENCE_TRANSACTION);
+}
+
+// Hand a committed single-account transaction's logging to the post-commit worker
+static void queueCommitted(TransactionType type, int cardNumber, float amount, float oldBalance,
+                           float newBalance, const char* username) {
+    PostCommitEvent event;
+    initCommittedEvent(&event, type, cardNumber, amount, oldBalance, newBalance, username);
+
+    StorageCard card;
+    if (storageEngine()->get_card(cardNumber, &card)) {
+        memcpy(event.accountID, card.accountID, sizeof(event.accountID));
     }
+    postCommitEnqueue(&event);
+}
+
+// Lock the accounts behind the given cards for a balance read-modify-write
+static bool lockCardAccounts(AccountLockSet* locks, const int* cardNumbers, int count) {
+    char accountIDs[ACCOUNT_LOCK_MAX][20];
+    const char* ids[ACCOUNT_LOCK_MAX];
+
+    if (count <= 0 || count > ACCOUNT_LOCK_MAX) {
+        return false;
+    }
+    for (int i = 0; i < count; i++) {
+        StorageCard card;
+        if (!storageEngine()->get_card(cardNumbers[i], &card)) {
+            return false;
+        }
+        strcpy(accountIDs[i], card.accountID);
+        ids[i] = accountIDs[i];
+    }
+    return lockAccounts(locks, ids, count);
 }
 
 // Function to check account balance
@@ -95,9 +141,19 @@ TransactionResult performDeposit(int cardNumber, float amount, const char* usern
         return result;
     }
     
+    // Hold the account from reading the balance until the new one is written
+    AccountLockSet locks;
+    if (!lockCardAccounts(&locks, &cardNumber, 1)) {
+        result.success = 0;
+        strcpy(result.message, "Error: System busy, please try again later");
+        logTransaction(cardNumber, TRANSACTION_DEPOSIT, amount, 0);
+        return result;
+    }
+    
     // Fetch current balance
     float oldBalance = fetchBalance(cardNumber);
     if (oldBalance < 0) {
+        unlockAccounts(&locks);
         result.success = 0;
         strcpy(result.message, "Error: Unable to fetch account balance");
         logTransaction(cardNumber, TRANSACTION_DEPOSIT, amount, 0);
@@ -106,19 +162,16 @@ TransactionResult performDeposit(int cardNumber, float amount, const char* usern
     
     // Perform deposit by updating balance
     float newBalance = oldBalance + amount;
-    if (updateBalance(cardNumber, newBalance)) {
+    bool updated = updateBalance(cardNumber, newBalance);
+    unlockAccounts(&locks);
+    if (updated) {
         result.success = 1;
         result.oldBalance = oldBalance;
         result.newBalance = newBalance;
         sprintf(result.message, "Deposit successful. New balance: $%.2f", newBalance);
         
-        // Log the transaction
-        char detailsLog[100];
-        sprintf(detailsLog, "Deposited $%.2f. Old balance: $%.2f, New balance: $%.2f", 
-               amount, oldBalance, newBalance);
-        writeTransactionDetails(username, "Deposit", detailsLog);
-        
-        logTransaction(cardNumber, TRANSACTION_DEPOSIT, amount, 1);
+        // The balance is durable; the logs are written in the background
+        queueCommitted(TRANSACTION_DEPOSIT, cardNumber, amount, oldBalance, newBalance, username);
     } else {
         result.success = 0;
         strcpy(result.message, "Error: Unable to update balance");
@@ -147,10 +200,7 @@ TransactionResult performWithdrawal(int cardNumber, float amount, const char* us
     }
 
     // Get daily transaction limit from system configuration
-    int dailyLimit = getConfigValueInt(CONFIG_DAILY_TRANSACTION_LIMIT);
-    if (dailyLimit <= 0) {
-        dailyLimit = 50000; // Default limit if not configured
-    }
+    int dailyLimit = cardDailyLimit(cardNumber);
     
     // Validate withdrawal amount
     if (amount <= 0) {
@@ -168,9 +218,19 @@ TransactionResult performWithdrawal(int cardNumber, float amount, const char* us
         return result;
     }
     
+    // Hold the account from the daily limit check until the withdrawal is recorded
+    AccountLockSet locks;
+    if (!lockCardAccounts(&locks, &cardNumber, 1)) {
+        result.success = 0;
+        strcpy(result.message, "Error: System busy, please try again later");
+        logTransaction(cardNumber, TRANSACTION_WITHDRAWAL, amount, 0);
+        return result;
+    }
+    
     // Check if amount exceeds daily withdrawal limit
     float todayWithdrawals = getDailyWithdrawals(cardNumber);
     if (todayWithdrawals + amount > dailyLimit) {
+        unlockAccounts(&locks);
         result.success = 0;
         sprintf(result.message, "Error: Would exceed daily transaction limit of $%d", dailyLimit);
         logTransaction(cardNumber, TRANSACTION_WITHDRAWAL, amount, 0);
@@ -180,6 +240,7 @@ TransactionResult performWithdrawal(int cardNumber, float amount, const char* us
     // Fetch current balance
     float oldBalance = fetchBalance(cardNumber);
     if (oldBalance < 0) {
+        unlockAccounts(&locks);
         result.success = 0;
         strcpy(result.message, "Error: Unable to fetch account balance");
         logTransaction(cardNumber, TRANSACTION_WITHDRAWAL, amount, 0);
@@ -188,6 +249,7 @@ TransactionResult performWithdrawal(int cardNumber, float amount, const char* us
     
     // Check if sufficient funds
     if (oldBalance < amount) {
+        unlockAccounts(&locks);
         result.success = 0;
         sprintf(result.message, "Error: Insufficient funds. Current balance: $%.2f", oldBalance);
         logTransaction(cardNumber, TRANSACTION_WITHDRAWAL, amount, 0);
@@ -202,17 +264,14 @@ TransactionResult performWithdrawal(int cardNumber, float amount, const char* us
         result.newBalance = newBalance;
         sprintf(result.message, "Withdrawal successful. New balance: $%.2f", newBalance);
         
-        // Log the transaction
-        char detailsLog[100];
-        sprintf(detailsLog, "Withdrew $%.2f. Old balance: $%.2f, New balance: $%.2f", 
-               amount, oldBalance, newBalance);
-        writeTransactionDetails(username, "Withdrawal", detailsLog);
-        
-        // Track withdrawal for daily limit
-        logWithdrawal(cardNumber, amount);
+        // Count it toward the daily limit before the next check can run; the
+        // withdrawal log and the other logs are written in the background
+        withdrawalTrackerHold(cardNumber, amount);
+        unlockAccounts(&locks);
         
-        logTransaction(cardNumber, TRANSACTION_WITHDRAWAL, amount, 1);
+        queueCommitted(TRANSACTION_WITHDRAWAL, cardNumber, amount, oldBalance, newBalance, username);
     } else {
+        unlockAccounts(&locks);
         result.success = 0;
         strcpy(result.message, "Error: Unable to complete withdrawal");
         logTransaction(cardNumber, TRANSACTION_WITHDRAWAL, amount, 0);
@@ -223,135 +282,67 @@ TransactionResult performWithdrawal(int cardNumber, float amount, const char* us
 
 // Get mini statement (recent transactions)
 TransactionResult getMiniStatement(int cardNumber, const char* username) {
+    return getMiniStatementWithCount(cardNumber, username, MINI_STATEMENT_DEFAULT_COUNT);
+}
+
+// Mini statement with the last `count` transactions, read through the history index
+TransactionResult getMiniStatementWithCount(int cardNumber, const char* username, int count) {
     TransactionResult result = {0};
     
-    // Set up transaction log file path
-    char transactionsLogPath[200];
-    sprintf(transactionsLogPath, "%s/transactions.log", 
-            isTestingMode() ? TEST_DATA_DIR : PROD_DATA_DIR "/../logs");
+    if (count <= 0) {
+        count = MINI_STATEMENT_DEFAULT_COUNT;
+    }
+    if (count > MINI_STATEMENT_MAX_COUNT) {
+        count = MINI_STATEMENT_MAX_COUNT;
+    }
     
-    FILE* file = fopen(transactionsLogPath, "r");
-    if (file == NULL) {
+    StorageCard card;
+    if (!storageEngine()->get_card(cardNumber, &card)) {
         result.success = 0;
         strcpy(result.message, "No transaction history available.");
         logTransaction(cardNumber, TRANSACTION_MINI_STATEMENT, 0.0f, 0);
         return result;
     }
     
-    // Get account ID from card number
-    char accountID[10] = "";
-    FILE* cardFile = fopen(getCardFilePath(), "r");
-    if (cardFile != NULL) {
-        char line[256];
-        
-        // Skip header lines
-        fgets(line, sizeof(line), cardFile);
-        fgets(line, sizeof(line), cardFile);
-        
-        char cardID[10], accID[10], cardNumberStr[20], cardType[10], expiryDate[15], status[10], pinHash[65];
-        
-        while (fgets(line, sizeof(line), cardFile) != NULL) {
-            if (sscanf(line, "%s | %s | %s | %s | %s | %s | %s", 
-                       cardID, accID, cardNumberStr, cardType, expiryDate, status, pinHash) >= 7) {
-                int storedCardNumber = atoi(cardNumberStr);
-                if (storedCardNumber == cardNumber) {
-                    strcpy(accountID, accID);
-                    break;
-                }
-            }
-        }
-        
-        fclose(cardFile);
-    }
-    
-    // If account ID not found, use card number as a fallback
-    if (strlen(accountID) == 0) {
-        sprintf(accountID, "A%d", cardNumber);
-    }
-    
-    // Count how many transactions are for this account
-    int transactionCount = 0;
-    char line[256];
-    while (fgets(line, sizeof(line), file) != NULL) {
-        // Check if this line is for the current account ID
-        if (strstr(line, accountID) != NULL) {
-            transactionCount++;
-        }
-    }
-    
-    if (transactionCount == 0) {
-        fclose(file);
+    // Include this process's transactions still waiting to be logged
+    postCommitFlush();
+    HistoryRecord records[MINI_STATEMENT_MAX_COUNT];
+    int found = historyIndexRecent(card.accountID, records, count);
+    if (found == 0) {
         result.success = 0;
         strcpy(result.message, "No transaction history available for this account.");
         logTransaction(cardNumber, TRANSACTION_MINI_STATEMENT, 0.0f, 0);
         return result;
     }
     
-    // Reset to beginning of file
-    rewind(file);
-    
     // Get current balance
     float balance = fetchBalance(cardNumber);
     if (balance < 0) {
-        fclose(file);
         result.success = 0;
         strcpy(result.message, "Error: Unable to fetch current balance.");
         logTransaction(cardNumber, TRANSACTION_MINI_STATEMENT, 0.0f, 0);
         return result;
     }
     
-    // Format mini statement with up to 5 most recent transactions
-    char miniStatement[1024] = "Recent Transactions:\n";
-    char transactions[5][256];
-    int count = 0;
-    
-    while (fgets(line, sizeof(line), file) != NULL) {
-        if (strstr(line, accountID) != NULL) {
-            // Store this transaction
-            strcpy(transactions[count % 5], line);
-            count++;
-        }
+    // Oldest first, as they appear in the log
+    size_t len = (size_t)snprintf(result.message, sizeof(result.message),
+                                  "Recent Transactions:\n\n"
+                                  "Date       | Type        | Amount    | Status\n"
+                                  "-------------------------------------\n");
+    for (int i = 0; i < found && len < sizeof(result.message); i++) {
+        // Show only the date part of the timestamp
+        len += (size_t)snprintf(result.message + len, sizeof(result.message) - len,
+                                "%.10s | %-10s | $%-8.2f | %s\n",
+                                records[i].timestamp, records[i].type, records[i].amount, records[i].status);
     }
-    
-    // Format the mini statement with the most recent transactions
-    strcat(miniStatement, "\n");
-    strcat(miniStatement, "Date       | Type        | Amount    | Status\n");
-    strcat(miniStatement, "-------------------------------------\n");
-    
-    // Start from the most recent transaction (if more than 5, show only the last 5)
-    int start = (count <= 5) ? 0 : count - 5;
-    for (int i = start; i < count; i++) {
-        char transactionID[10], accountIDFromLog[10], transactionType[20], statusStr[10], remarks[50];
-        float amount;
-        char timestamp[30];
-        
-        // Extract transaction details (simplified parsing)
-        if (sscanf(transactions[i % 5], "%s | %s | %s | %f | %s | %s | %s",
-                  transactionID, accountIDFromLog, transactionType, &amount,
-                  timestamp, statusStr, remarks) >= 7) {
-                  
-            // Format date to show only the date part
-            char dateStr[15];
-            strncpy(dateStr, timestamp, 10);
-            dateStr[10] = '\0';
-            
-            char formattedTransaction[100];
-            sprintf(formattedTransaction, "%s | %-10s | $%-8.2f | %s\n",
-                   dateStr, transactionType, amount, statusStr);
-            strcat(miniStatement, formattedTransaction);
-        }
+    if (len < sizeof(result.message)) {
+        snprintf(result.message + len, sizeof(result.message) - len,
+                 "-------------------------------------\nCurrent Balance: $%.2f", balance);
     }
     
-    strcat(miniStatement, "-------------------------------------\n");
-    sprintf(line, "Current Balance: $%.2f", balance);
-    strcat(miniStatement, line);
-    
-    fclose(file);
-    
     result.success = 1;
     result.newBalance = balance;
     result.oldBalance = balance;
-    strcpy(result.message, miniStatement);
     
     logTransaction(cardNumber, TRANSACTION_MINI_STATEMENT, 0.0f, 1);
     
@@ -367,137 +358,478 @@ TransactionResult getMiniStatement(int cardNumber, const char* username) {
 TransactionResult performMoneyTransfer(int senderCardNumber, int receiverCardNumber, float amount, const char* username) {
     TransactionResult result = {0};
     
-    // Validate transfer amount
-    if (amount <= 0) {
-        result.success = 0;
-        strcpy(result.message, "Error: Invalid transfer amount");
-        logTransaction(senderCardNumber, TRANSACTION_MONEY_TRANSFER, amount, 0);
-        return result;
-    }
+    // Validation, locking and the two-account commit happen in one pass in the data layer
+    TransferOutcome outcome;
+    TransferStatus status = transferBetweenCards(senderCardNumber, receiverCardNumber, amount, &outcome);
     
-    // Check if receiver card exists
-    if (!doesCardExist(receiverCardNumber)) {
+    if (status != TRANSFER_OK) {
         result.success = 0;
-        strcpy(result.message, "Error: Recipient card number is invalid");
+        switch (status) {
+            case TRANSFER_INVALID_AMOUNT:
+                strcpy(result.message, "Error: Invalid transfer amount");
+                break;
+            case TRANSFER_SENDER_NOT_FOUND:
+                strcpy(result.message, "Error: Unable to fetch your account balance");
+                break;
+            case TRANSFER_RECEIVER_NOT_FOUND:
+                strcpy(result.message, "Error: Recipient card number is invalid");
+                break;
+            case TRANSFER_RECEIVER_INACTIVE:
+                strcpy(result.message, "Error: Recipient card is not active");
+                break;
+            case TRANSFER_SAME_ACCOUNT:
+                strcpy(result.message, "Error: Cannot transfer to the same account");
+                break;
+            case TRANSFER_INSUFFICIENT_FUNDS:
+                sprintf(result.message, "Error: Insufficient funds. Current balance: $%.2f", outcome.senderOldBalance);
+                break;
+            case TRANSFER_BUSY:
+                strcpy(result.message, "Error: System busy, please try again later");
+                break;
+            default:
+                strcpy(result.message, "Error: Failed to complete transfer");
+                break;
+        }
         logTransaction(senderCardNumber, TRANSACTION_MONEY_TRANSFER, amount, 0);
         return result;
     }
     
-    // Check if receiver card is active
-    if (!isCardActive(receiverCardNumber)) {
-        result.success = 0;
-        strcpy(result.message, "Error: Recipient card is not active");
-        logTransaction(senderCardNumber, TRANSACTION_MONEY_TRANSFER, amount, 0);
-        return result;
-    }
+    // Update result with success info
+    result.success = 1;
+    result.oldBalance = outcome.senderOldBalance;
+    result.newBalance = outcome.senderNewBalance;
+    sprintf(result.message, "Transfer successful. Your new balance: $%.2f", result.newBalance);
     
-    // Lock the transaction files to ensure atomicity
-    if (!lockTransactionFiles()) {
-        result.success = 0;
-        strcpy(result.message, "Error: System busy, please try again later");
-        logTransaction(senderCardNumber, TRANSACTION_MONEY_TRANSFER, amount, 0);
-        return result;
-    }
+    // Both accounts' rows are written in the background
+    PostCommitEvent event;
+    initCommittedEvent(&event, TRANSACTION_MONEY_TRANSFER, senderCardNumber, amount,
+                       outcome.senderOldBalance, outcome.senderNewBalance, username);
+    event.targetCardNumber = receiverCardNumber;
+    memcpy(event.accountID, outcome.senderAccountID, sizeof(event.accountID));
+    memcpy(event.targetAccountID, outcome.receiverAccountID, sizeof(event.targetAccountID));
+    postCommitEnqueue(&event);
     
-    // Start transaction - create backup of account files
-    if (!backupAccountFiles()) {
-        unlockTransactionFiles();
-        result.success = 0;
-        strcpy(result.message, "Error: Could not initiate transaction safely");
-        logTransaction(senderCardNumber, TRANSACTION_MONEY_TRANSFER, amount, 0);
+    return result;
+}
+
+// Alias kept for the menu code
+TransactionResult performFundTransfer(int cardNumber, int targetCardNumber, float amount, const char* username) {
+    return performMoneyTransfer(cardNumber, targetCardNumber, amount, username);
+}
+
+// Run a request once per request_id
+TransactionResult performTransactionRequest(const TransactionData* op, const char* username) {
+    TransactionResult result;
+    if (requestCacheBegin(op, &result)) {
         return result;
     }
-    
-    // Fetch sender balance
-    float senderBalance = fetchBalance(senderCardNumber);
-    if (senderBalance < 0) {
-        // Rollback by restoring from backup
-        restoreAccountFiles();
-        unlockTransactionFiles();
-        
-        result.success = 0;
-        strcpy(result.message, "Error: Unable to fetch your account balance");
-        logTransaction(senderCardNumber, TRANSACTION_MONEY_TRANSFER, amount, 0);
-        return result;
+    requestCacheJournal(op, NULL);
+
+    switch (op->type) {
+        case TRANSACTION_DEPOSIT:
+            result = performDeposit(op->card_number, op->amount, username);
+            break;
+        case TRANSACTION_WITHDRAWAL:
+            result = performWithdrawal(op->card_number, op->amount, username);
+            break;
+        case TRANSACTION_MONEY_TRANSFER:
+            result = performMoneyTransfer(op->card_number, op->target_card_number, op->amount, username);
+            break;
+        default:
+            memset(&result, 0, sizeof(result));
+            strcpy(result.message, "Error: Unsupported transaction type");
+            break;
     }
-    
-    // Check if sender has sufficient funds
-    if (senderBalance < amount) {
-        // No need to rollback, just release locks
-        unlockTransactionFiles();
-        
-        result.success = 0;
-        sprintf(result.message, "Error: Insufficient funds. Current balance: $%.2f", senderBalance);
-        logTransaction(senderCardNumber, TRANSACTION_MONEY_TRANSFER, amount, 0);
-        return result;
+
+    requestCacheFinish(op, &result);
+    return result;
+}
+
+// An account touched by a batch, loaded once and updated in memory
+typedef struct {
+    char accountID[20];
+    float original;        // Balance when the batch took its locks
+    float balance;         // Balance after the operations applied so far
+    bool found;
+} BatchAccount;
+
+// A card withdrawn from by a batch, with its daily limit
+typedef struct {
+    int cardNumber;
+    int dailyLimit;
+    float withdrawn;       // Today's withdrawals, including the batch's so far
+} BatchCard;
+
+// What a batch operation resolved to before any balance is read
+typedef struct {
+    char sourceAccountID[20];
+    char targetAccountID[20];
+    BatchAccount* source;
+    BatchAccount* target;   // Transfers only
+    BatchCard* card;        // Withdrawals only
+    bool valid;
+    bool claimed;           // Holds its request_id in the request cache until the batch is done
+    bool replayed;          // Answered from the request cache instead of running
+    bool repeated;          // Same request_id as the earlier operation sameRequestAs
+    size_t sameRequestAs;
+} BatchOperation;
+
+static int compareBatchAccounts(const void* a, const void* b) {
+    return strcmp(((const BatchAccount*)a)->accountID, ((const BatchAccount*)b)->accountID);
+}
+
+// Sorted, distinct accounts referenced by the valid operations
+static BatchAccount* collectBatchAccounts(BatchOperation* resolved, size_t n, size_t* accountCount) {
+    BatchAccount* accounts = (BatchAccount*)calloc(n * 2 + 1, sizeof(BatchAccount));
+    if (accounts == NULL) {
+        return NULL;
     }
-    
-    // Fetch receiver balance
-    float receiverBalance = fetchBalance(receiverCardNumber);
-    if (receiverBalance < 0) {
-        // Rollback by restoring from backup
-        restoreAccountFiles();
-        unlockTransactionFiles();
-        
-        result.success = 0;
-        strcpy(result.message, "Error: Unable to fetch recipient's account balance");
-        logTransaction(senderCardNumber, TRANSACTION_MONEY_TRANSFER, amount, 0);
-        return result;
+
+    size_t count = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (!resolved[i].valid) {
+            continue;
+        }
+        strcpy(accounts[count++].accountID, resolved[i].sourceAccountID);
+        if (resolved[i].targetAccountID[0] != '\0') {
+            strcpy(accounts[count++].accountID, resolved[i].targetAccountID);
+        }
     }
-    
-    // Update balances of both sender and receiver
-    int senderUpdateSuccess = updateBalance(senderCardNumber, senderBalance - amount);
-    int receiverUpdateSuccess = updateBalance(receiverCardNumber, receiverBalance + amount);
-    
-    if (!senderUpdateSuccess || !receiverUpdateSuccess) {
-        // Rollback if either update fails
-        restoreAccountFiles();
-        unlockTransactionFiles();
-        
-        result.success = 0;
-        strcpy(result.message, "Error: Failed to complete transfer");
-        logTransaction(senderCardNumber, TRANSACTION_MONEY_TRANSFER, amount, 0);
-        return result;
+
+    qsort(accounts, count, sizeof(BatchAccount), compareBatchAccounts);
+    size_t distinct = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (distinct == 0 || strcmp(accounts[distinct - 1].accountID, accounts[i].accountID) != 0) {
+            accounts[distinct++] = accounts[i];
+        }
     }
-    
-    // Transaction successful, commit changes
-    unlockTransactionFiles();
-    
-    // Update result with success info
-    result.success = 1;
-    result.oldBalance = senderBalance;
-    result.newBalance = senderBalance - amount;
-    sprintf(result.message, "Transfer successful. Your new balance: $%.2f", result.newBalance);
-    
-    // Log the transaction for both accounts
-    char detailsLog[100];
-    sprintf(detailsLog, "Transferred $%.2f to card %d", amount, receiverCardNumber);
-    writeTransactionDetails(username, "Money Transfer", detailsLog);
-    
-    logTransaction(senderCardNumber, TRANSACTION_MONEY_TRANSFER, amount, 1);
-    
-    // Also log for recipient
-    char recipientName[50] = "Unknown"; // Default if we can't find name
-    getCardHolderName(receiverCardNumber, recipientName, sizeof(recipientName));
-    
-    char recipientLog[100];
-    sprintf(recipientLog, "Received $%.2f from card %d (%s)", amount, senderCardNumber, username);
-    writeTransactionDetails(recipientName, "Money Received", recipientLog);
-    
-    logTransaction(receiverCardNumber, TRANSACTION_MONEY_TRANSFER, amount, 1);
-    
-    return result;
+
+    for (size_t i = 0; i < n; i++) {
+        if (!resolved[i].valid) {
+            continue;
+        }
+        BatchAccount key;
+        strcpy(key.accountID, resolved[i].sourceAccountID);
+        resolved[i].source = (BatchAccount*)bsearch(&key, accounts, distinct, sizeof(BatchAccount), compareBatchAccounts);
+        if (resolved[i].targetAccountID[0] != '\0') {
+            strcpy(key.accountID, resolved[i].targetAccountID);
+            resolved[i].target = (BatchAccount*)bsearch(&key, accounts, distinct, sizeof(BatchAccount), compareBatchAccounts);
+        }
+    }
+
+    *accountCount = distinct;
+    return accounts;
+}
+
+static int compareBatchCards(const void* a, const void* b) {
+    int left = ((const BatchCard*)a)->cardNumber, right = ((const BatchCard*)b)->cardNumber;
+    return (left > right) - (left < right);
+}
+
+// Distinct cards of the valid withdrawals, each with today's total so far.
+// Call with the batch's accounts locked, so no other withdrawal moves the totals.
+static BatchCard* collectBatchCards(const TransactionData* ops, BatchOperation* resolved, size_t n) {
+    BatchCard* cards = (BatchCard*)calloc(n + 1, sizeof(BatchCard));
+    if (cards == NULL) {
+        return NULL;
+    }
+
+    size_t count = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (resolved[i].valid && ops[i].type == TRANSACTION_WITHDRAWAL) {
+            cards[count++].cardNumber = ops[i].card_number;
+        }
+    }
+
+    qsort(cards, count, sizeof(BatchCard), compareBatchCards);
+    size_t distinct = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (distinct == 0 || cards[distinct - 1].cardNumber != cards[i].cardNumber) {
+            cards[distinct].cardNumber = cards[i].cardNumber;
+            cards[distinct].dailyLimit = cardDailyLimit(cards[i].cardNumber);
+            cards[distinct].withdrawn = getDailyWithdrawals(cards[i].cardNumber);
+            distinct++;
+        }
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        if (resolved[i].valid && ops[i].type == TRANSACTION_WITHDRAWAL) {
+            BatchCard key = { ops[i].card_number, 0, 0.0f };
+            resolved[i].card = (BatchCard*)bsearch(&key, cards, distinct, sizeof(BatchCard), compareBatchCards);
+        }
+    }
+    return cards;
+}
+
+// Check an operation's cards and find the accounts it moves money between
+static bool resolveBatchOperation(const TransactionData* op, BatchOperation* resolved, TransactionResult* result) {
+    StorageCard card, target;
+
+    if (op->type != TRANSACTION_DEPOSIT && op->type != TRANSACTION_WITHDRAWAL &&
+        op->type != TRANSACTION_MONEY_TRANSFER) {
+        strcpy(result->message, "Error: Transaction type cannot be posted in a batch");
+        return false;
+    }
+    if (op->amount <= 0) {
+        strcpy(result->message, "Error: Invalid transaction amount");
+        return false;
+    }
+    if (!storageEngine()->get_card(op->card_number, &card)) {
+        strcpy(result->message, "Error: Card not found");
+        return false;
+    }
+    strcpy(resolved->sourceAccountID, card.accountID);
+
+    if (op->type == TRANSACTION_MONEY_TRANSFER) {
+        if (!storageEngine()->get_card(op->target_card_number, &target)) {
+            strcpy(result->message, "Error: Recipient card number is invalid");
+            return false;
+        }
+        if (strcmp(target.status, "Active") != 0) {
+            strcpy(result->message, "Error: Recipient card is not active");
+            return false;
+        }
+        if (strcmp(target.accountID, card.accountID) == 0) {
+            strcpy(result->message, "Error: Cannot transfer to the same account");
+            return false;
+        }
+        strcpy(resolved->targetAccountID, target.accountID);
+    }
+
+    resolved->valid = true;
+    return true;
+}
+
+// Answer an operation from the request cache or claim its request_id; true if it must not run
+static bool claimBatchRequest(const TransactionData* ops, size_t i, BatchOperation* resolved, TransactionResult* result) {
+    if (ops[i].request_id[0] == '\0') {
+        return false;
+    }
+
+    // A repeat within the batch takes the earlier operation's result once the batch is done
+    for (size_t j = 0; j < i; j++) {
+        if (resolved[j].claimed && strncmp(ops[j].request_id, ops[i].request_id, sizeof(ops[i].request_id)) == 0) {
+            resolved[i].repeated = true;
+            resolved[i].sameRequestAs = j;
+            return true;
+        }
+    }
+
+    if (requestCacheBegin(&ops[i], result)) {
+        resolved[i].replayed = true;
+        return true;
+    }
+    resolved[i].claimed = true;
+    return false;
+}
+
+// Apply one operation to the batch's in-memory balances
+static void applyBatchOperation(const TransactionData* op, const BatchOperation* resolved, TransactionResult* result) {
+    BatchAccount* source = resolved->source;
+    if (source == NULL || !source->found || (resolved->targetAccountID[0] != '\0' &&
+                                             (resolved->target == NULL || !resolved->target->found))) {
+        strcpy(result->message, "Error: Unable to fetch account balance");
+        return;
+    }
+
+    BatchCard* card = resolved->card;
+    if (op->type == TRANSACTION_WITHDRAWAL && (card == NULL || card->withdrawn + op->amount > card->dailyLimit)) {
+        if (card != NULL) {
+            sprintf(result->message, "Error: Would exceed daily transaction limit of $%d", card->dailyLimit);
+        } else {
+            strcpy(result->message, "Error: Unable to check the daily transaction limit");
+        }
+        return;
+    }
+
+    result->oldBalance = source->balance;
+    if (op->type == TRANSACTION_DEPOSIT) {
+        source->balance += op->amount;
+    } else if (source->balance < op->amount) {
+        sprintf(result->message, "Error: Insufficient funds. Current balance: $%.2f", source->balance);
+        return;
+    } else {
+        source->balance -= op->amount;
+        if (op->type == TRANSACTION_MONEY_TRANSFER) {
+            resolved->target->balance += op->amount;
+        } else {
+            card->withdrawn += op->amount;
+        }
+    }
+
+    result->success = 1;
+    result->newBalance = source->balance;
+    sprintf(result->message, "Posted. New balance: $%.2f", source->balance);
+}
+
+// Post many deposits, withdrawals and transfers with one commit
+size_t performTransactionBatch(const TransactionData* ops, size_t n, TransactionResult* out) {
+    if (ops == NULL || out == NULL || n == 0) {
+        return 0;
+    }
+    memset(out, 0, n * sizeof(TransactionResult));
+
+    BatchOperation* resolved = (BatchOperation*)calloc(n, sizeof(BatchOperation));
+    size_t resolvedCount = 0;
+    for (size_t i = 0; resolved != NULL && i < n; i++) {
+        if (claimBatchRequest(ops, i, resolved, &out[i])) {
+            continue;
+        }
+        resolvedCount += resolveBatchOperation(&ops[i], &resolved[i], &out[i]) ? 1 : 0;
+    }
+
+    size_t accountCount = 0;
+    BatchAccount* accounts = resolved != NULL ? collectBatchAccounts(resolved, n, &accountCount) : NULL;
+    const char** accountIDs = accounts != NULL ? (const char**)malloc((accountCount + 1) * sizeof(char*)) : NULL;
+    StorageDelta* deltas = accounts != NULL ? (StorageDelta*)calloc(accountCount + 1, sizeof(StorageDelta)) : NULL;
+    if (accountIDs == NULL || deltas == NULL) {
+        for (size_t i = 0; i < n; i++) {
+            if (resolved != NULL && resolved[i].replayed) {
+                continue;
+            }
+            memset(&out[i], 0, sizeof(out[i]));
+            strcpy(out[i].message, "Error: Out of memory while posting the batch");
+            if (resolved != NULL && resolved[i].claimed) {
+                requestCacheFinish(&ops[i], &out[i]);
+            }
+        }
+        free(resolved);
+        free(accounts);
+        free(accountIDs);
+        free(deltas);
+        writeErrorLog("Out of memory while posting a transaction batch");
+        return 0;
+    }
+
+    // Every account stays locked from the first balance read until the commit
+    AccountBatchLock locks;
+    for (size_t i = 0; i < accountCount; i++) {
+        accountIDs[i] = accounts[i].accountID;
+    }
+    bool locked = accountCount > 0 && lockAccountBatch(&locks, accountIDs, (int)accountCount);
+
+    for (size_t i = 0; locked && i < accountCount; i++) {
+        StorageAccount account;
+        accounts[i].found = storageEngine()->get_account(accounts[i].accountID, &account);
+        accounts[i].original = accounts[i].found ? account.balance : 0.0f;
+        accounts[i].balance = accounts[i].original;
+    }
+
+    // Withdrawals count toward the card's daily limit like ATM withdrawals
+    BatchCard* cards = locked ? collectBatchCards(ops, resolved, n) : NULL;
+
+    // Operations run in input order, so each sees the balances left by the ones before it
+    size_t posted = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (!resolved[i].valid) {
+            continue;
+        }
+        if (!locked) {
+            strcpy(out[i].message, "Error: System busy, please try again later");
+            continue;
+        }
+        applyBatchOperation(&ops[i], &resolved[i], &out[i]);
+        posted += out[i].success ? 1 : 0;
+    }
+
+    // One delta per account carries the net effect of all its operations
+    int deltaCount = 0;
+    for (size_t i = 0; locked && i < accountCount; i++) {
+        if (accounts[i].balance != accounts[i].original) {
+            strcpy(deltas[deltaCount].accountID, accounts[i].accountID);
+            deltas[deltaCount].delta = accounts[i].balance - accounts[i].original;
+            deltaCount++;
+        }
+    }
+    for (size_t i = 0; deltaCount > 0 && i < n; i++) {
+        if (resolved[i].claimed && out[i].success) {
+            requestCacheJournal(&ops[i], &out[i]);
+        }
+    }
+    bool committed = deltaCount == 0 || storageEngine()->apply_batch(deltas, deltaCount);
+
+    // Hold committed withdrawals in the daily totals before another withdrawal can check them
+    for (size_t i = 0; committed && i < n; i++) {
+        if (resolved[i].valid && out[i].success && ops[i].type == TRANSACTION_WITHDRAWAL) {
+            withdrawalTrackerHold(ops[i].card_number, ops[i].amount);
+        }
+    }
+    if (locked) {
+        unlockAccountBatch(&locks);
+    }
+    free(cards);
+
+    if (!committed) {
+        writeErrorLog("Failed to commit transaction batch; no balance was changed");
+        for (size_t i = 0; i < n; i++) {
+            if (out[i].success) {
+                out[i].success = 0;
+                out[i].newBalance = out[i].oldBalance;
+                strcpy(out[i].message, "Error: Unable to update balance");
+            }
+        }
+        posted = 0;
+    }
+
+    // One pass over the transactions log; transfers get a row for each side
+    TransactionLogEntry* entries = (TransactionLogEntry*)malloc((n + resolvedCount) * sizeof(TransactionLogEntry));
+    if (entries != NULL) {
+        size_t entryCount = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (resolved[i].replayed || resolved[i].repeated) {
+                continue;
+            }
+            TransactionLogEntry entry = { ops[i].card_number, resolved[i].valid ? resolved[i].sourceAccountID : NULL,
+                                          ops[i].type, ops[i].amount, out[i].success != 0, 0, 0, NULL };
+            entries[entryCount++] = entry;
+            if (out[i].success && ops[i].type == TRANSACTION_MONEY_TRANSFER) {
+                TransactionLogEntry received = { ops[i].target_card_number, resolved[i].targetAccountID,
+                                                 ops[i].type, ops[i].amount, true, 0, 0, NULL };
+                entries[entryCount++] = received;
+            }
+        }
+        logTransactions(entries, entryCount);
+        free(entries);
+    }
+
+    // Write the held withdrawals to withdrawals.log, dropping their holds
+    for (size_t i = 0; i < n; i++) {
+        if (resolved[i].valid && out[i].success && ops[i].type == TRANSACTION_WITHDRAWAL) {
+            logHeldWithdrawal(ops[i].card_number, ops[i].amount);
+        }
+    }
+
+    // Store results for retries, then answer repeats within the batch from them
+    for (size_t i = 0; i < n; i++) {
+        if (resolved[i].claimed) {
+            requestCacheFinish(&ops[i], &out[i]);
+        }
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (resolved[i].repeated && !requestCacheBegin(&ops[i], &out[i])) {
+            // The first operation failed and left nothing to replay
+            out[i] = out[resolved[i].sameRequestAs];
+            requestCacheFinish(&ops[i], &out[i]);
+        }
+    }
+
+    char logMsg[150];
+    sprintf(logMsg, "Batch posted %zu of %zu transactions across %zu accounts", posted, n, accountCount);
+    writeAuditLog("TRANSACTION", logMsg);
+
+    free(resolved);
+    free(accounts);
+    free(accountIDs);
+    free(deltas);
+    return posted;
 }
 
 // Generate transaction receipt
 void generateReceipt(int cardNumber, TransactionType type, float amount, float balance, const char* phoneNumber) {
-    time_t now = time(NULL);
-    struct tm* tm_now = localtime(&now);
     char timestamp[30];
-    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", tm_now);
+    clockTimestamp(timestamp, sizeof(timestamp));
     
-    // Get a unique receipt number
-    int receiptNumber = (int)time(NULL) % 100000 + cardNumber % 1000;
+    long long receiptNumber = allocateId(ID_SEQUENCE_RECEIPT);
     
     // Convert transaction type to string
     const char* typeStr;
@@ -515,7 +847,7 @@ void generateReceipt(int cardNumber, TransactionType type, float amount, float b
     printf("╔══════════════════════════════════════════╗\n");
     printf("║             ATM RECEIPT                  ║\n");
     printf("╠══════════════════════════════════════════╣\n");
-    printf("║ Receipt #: %d                       ║\n", receiptNumber);
+    printf("║ Receipt #: %-29lld ║\n", receiptNumber);
     printf("║ Date: %s              ║\n", timestamp);
     printf("║ Card: %d                          ║\n", cardNumber);
     printf("║ Transaction: %-28s ║\n", typeStr);
@@ -545,31 +877,6 @@ void generateReceipt(int cardNumber, TransactionType type, float amount, float b
 }
 
 // Helper functions for transaction atomicity
-int lockTransactionFiles() {
-    // Create a lock file to indicate that a transaction is in progress
-    FILE* lockFile = fopen("data/temp/transaction.lock", "w");
-    if (lockFile == NULL) {
-        writeErrorLog("Failed to create transaction lock file");
-        return 0;
-    }
-    
-    // Write current timestamp and process ID to the lock file
-    time_t now = time(NULL);
-    fprintf(lockFile, "LOCKED:%ld:%d\n", (long)now, getpid());
-    fclose(lockFile);
-    
-    return 1;
-}
-
-int unlockTransactionFiles() {
-    // Remove the lock file
-    if (remove("data/temp/transaction.lock") != 0) {
-        writeErrorLog("Failed to remove transaction lock file");
-        return 0;
-    }
-    return 1;
-}
-
 int backupAccountFiles() {
     // Backup accounting file
     const char* accountingFile = isTestingMode() ? TEST_ACCOUNTING_FILE : PROD_ACCOUNTING_FILE;
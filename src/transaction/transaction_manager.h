@@ -2,6 +2,7 @@
 #define TRANSACTION_MANAGER_H
 
 #include "transaction_types.h"
+#include "../common/atm_api.h"
 #include <unistd.h>  // For getpid()
 
 // Transaction result structure
@@ -9,9 +10,13 @@ typedef struct {
     int success;           // 1 for success, 0 for failure
     float oldBalance;      // Balance before transaction
     float newBalance;      // Balance after transaction
-    char message[200];     // Result message or error
+    char message[512];     // Result message or error; large enough for a mini statement
 } TransactionResult;
 
+// Transactions shown by getMiniStatement
+#define MINI_STATEMENT_DEFAULT_COUNT 5
+#define MINI_STATEMENT_MAX_COUNT 16
+
 // Balance check operation
 TransactionResult checkAccountBalance(int cardNumber, const char* username);
 
@@ -24,20 +29,61 @@ TransactionResult performWithdrawal(int cardNumber, float amount, const char* us
 // Mini-statement operation
 TransactionResult getMiniStatement(int cardNumber, const char* username);
 
+// Mini statement with the last `count` transactions (0 for the default, at most MINI_STATEMENT_MAX_COUNT)
+TransactionResult getMiniStatementWithCount(int cardNumber, const char* username, int count);
+
 // Money transfer operation (with transaction atomicity)
 TransactionResult performMoneyTransfer(int senderCardNumber, int receiverCardNumber, float amount, const char* username);
 
 // Alias for backward compatibility
 TransactionResult performFundTransfer(int cardNumber, int targetCardNumber, float amount, const char* username);
 
-// Transaction atomicity helpers
-int lockTransactionFiles();
-int unlockTransactionFiles();
+/**
+ * Run a deposit, withdrawal or transfer described by a TransactionData
+ *
+ * If `op` carries a request_id the request runs at most once: a retry with
+ * the same ID gets the stored result of the first successful attempt (see
+ * request_cache.h).
+ *
+ * @param op The request; card_number, amount, type, target_card_number and
+ *           request_id are used
+ * @param username Name recorded in the audit log
+ * @return The result
+ */
+TransactionResult performTransactionRequest(const TransactionData* op, const char* username);
+
+/**
+ * Post a batch of deposits, withdrawals and transfers, e.g. an end-of-day
+ * file or a salary run
+ *
+ * Every card is resolved first, then all touched accounts are locked, each
+ * read once, and the operations applied in order against those balances.
+ * Each operation is validated on its own: one with a bad card, too little
+ * money or a withdrawal over the card's daily limit fails in `out` without
+ * affecting the rest. Withdrawals are counted and logged toward the daily
+ * limit like ATM withdrawals; the per-withdrawal ATM cash limit does not
+ * apply. The net change of every account is committed with a single
+ * storage write, and the transactions log is written in one pass.
+ *
+ * Operations with a request_id are answered from the request cache when
+ * the ID was seen before, and their results are stored for retries.
+ *
+ * @param ops The operations; card_number, amount, type, request_id and, for
+ *            transfers, target_card_number are used
+ * @param n Number of operations
+ * @param out Receives one result per operation
+ * @return Number of operations posted; 0 if the commit failed
+ */
+size_t performTransactionBatch(const TransactionData* ops, size_t n, TransactionResult* out);
+
+// Transaction atomicity helpers (account locking lives in lock_manager.h)
 int backupAccountFiles();
 int restoreAccountFiles();
 
 // Transaction logging
 void writeTransactionDetails(const char* username, const char* type, const char* details);
+void formatTransactionDetails(char* buffer, size_t size, const char* username, const char* type,
+                              const char* details);
 void generateReceipt(int cardNumber, TransactionType type, float amount, float balance, const char* phoneNumber);
 
 #endif // TRANSACTION_MANAGER_H
\ No newline at end of file
@@ -0,0 +1,130 @@
+#include "clock_utils.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+typedef struct {
+    ClockDateChangeFn fn;
+    void* context;
+} DateListener;
+
+// The cached reading; `version` is odd while it is being rewritten
+static ClockReading current;
+static atomic_uint version = 0;
+
+// CLOCK_MONOTONIC_COARSE time, in nanoseconds, at which `current` ends; 0 before the first reading
+static atomic_llong expiresAt = 0;
+
+// Serialises refreshes; also guards the listeners
+static pthread_mutex_t refreshLock = PTHREAD_MUTEX_INITIALIZER;
+static DateListener listeners[CLOCK_MAX_LISTENERS];
+static int listenerCount = 0;
+
+static long long coarseNanos(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static void formatReading(ClockReading* reading, time_t value) {
+    reading->second = value;
+    localtime_r(&value, &reading->local);
+    strftime(reading->timestamp, sizeof(reading->timestamp), "%Y-%m-%d %H:%M:%S", &reading->local);
+    strftime(reading->date, sizeof(reading->date), "%Y-%m-%d", &reading->local);
+}
+
+// Format the second that has just started, unless another thread already has
+static void refresh(void) {
+    pthread_mutex_lock(&refreshLock);
+    long long coarse = coarseNanos();
+    if (coarse < atomic_load(&expiresAt)) {
+        pthread_mutex_unlock(&refreshLock);
+        return;
+    }
+
+    struct timespec wall;
+    clock_gettime(CLOCK_REALTIME, &wall);
+    ClockReading next;
+    formatReading(&next, wall.tv_sec);
+
+    // Listeners hear of a new day before anyone can read it
+    if (current.date[0] != '\0' && strcmp(next.date, current.date) != 0) {
+        for (int i = 0; i < listenerCount; i++) {
+            listeners[i].fn(next.date, listeners[i].context);
+        }
+    }
+
+    unsigned int v = atomic_load_explicit(&version, memory_order_relaxed);
+    atomic_store_explicit(&version, v + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    current = next;
+    atomic_store_explicit(&version, v + 2, memory_order_release);
+
+    // Readers check the coarse clock, so they notice the next second up to a tick late
+    atomic_store(&expiresAt, coarse + (1000000000LL - wall.tv_nsec));
+    pthread_mutex_unlock(&refreshLock);
+}
+
+void clockRead(ClockReading* reading) {
+    if (coarseNanos() >= atomic_load_explicit(&expiresAt, memory_order_acquire)) {
+        refresh();
+    }
+
+    for (;;) {
+        unsigned int before = atomic_load_explicit(&version, memory_order_acquire);
+        if ((before & 1) == 0) {
+            *reading = current;
+            atomic_thread_fence(memory_order_acquire);
+            if (atomic_load_explicit(&version, memory_order_relaxed) == before) {
+                return;
+            }
+        }
+    }
+}
+
+void clockTimestamp(char* buffer, size_t size) {
+    ClockReading reading;
+    clockRead(&reading);
+    snprintf(buffer, size, "%s", reading.timestamp);
+}
+
+void clockDate(char* buffer, size_t size) {
+    ClockReading reading;
+    clockRead(&reading);
+    snprintf(buffer, size, "%s", reading.date);
+}
+
+void clockFormatTimestamp(time_t value, char* buffer, size_t size) {
+    ClockReading reading;
+    clockRead(&reading);
+    if (reading.second != value) {
+        formatReading(&reading, value);
+    }
+    snprintf(buffer, size, "%s", reading.timestamp);
+}
+
+void clockFormatDate(time_t value, char* buffer, size_t size) {
+    ClockReading reading;
+    clockRead(&reading);
+    if (reading.second != value) {
+        formatReading(&reading, value);
+    }
+    snprintf(buffer, size, "%s", reading.date);
+}
+
+bool clockOnDateChange(ClockDateChangeFn fn, void* context) {
+    if (fn == NULL) {
+        return false;
+    }
+
+    pthread_mutex_lock(&refreshLock);
+    bool added = listenerCount < CLOCK_MAX_LISTENERS;
+    if (added) {
+        listeners[listenerCount].fn = fn;
+        listeners[listenerCount].context = context;
+        listenerCount++;
+    }
+    pthread_mutex_unlock(&refreshLock);
+    return added;
+}
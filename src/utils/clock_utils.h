@@ -0,0 +1,88 @@
+#ifndef CLOCK_UTILS_H
+#define CLOCK_UTILS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+/**
+ * Cached wall clock
+ *
+ * The local time is formatted once per second, by the first caller to
+ * notice the second has ended (checked against CLOCK_MONOTONIC_COARSE, so
+ * up to one clock tick late), and every other call copies the cached
+ * strings without a lock. When
+ * the local date changes, the listeners registered with
+ * clockOnDateChange are called before any caller can see the new date.
+ */
+
+#define CLOCK_TIMESTAMP_SIZE 20     // "YYYY-MM-DD HH:MM:SS" and its terminator
+#define CLOCK_DATE_SIZE 11          // "YYYY-MM-DD" and its terminator
+#define CLOCK_MAX_LISTENERS 8
+
+// The current second, broken down and formatted
+typedef struct {
+    time_t second;
+    struct tm local;
+    char timestamp[CLOCK_TIMESTAMP_SIZE];
+    char date[CLOCK_DATE_SIZE];
+} ClockReading;
+
+/**
+ * Called with the new local date, "YYYY-MM-DD"
+ * Runs on the thread that noticed the change, inside the clock's refresh,
+ * so it must not call the clock or wait for a lock held around clock calls.
+ */
+typedef void (*ClockDateChangeFn)(const char* date, void* context);
+
+/**
+ * Read the current second
+ *
+ * @param reading Receives the time, its local breakdown and both strings
+ */
+void clockRead(ClockReading* reading);
+
+/**
+ * Current local time as "YYYY-MM-DD HH:MM:SS"
+ *
+ * @param buffer Receives the string
+ * @param size Size of the buffer
+ */
+void clockTimestamp(char* buffer, size_t size);
+
+/**
+ * Current local date as "YYYY-MM-DD"
+ *
+ * @param buffer Receives the string
+ * @param size Size of the buffer
+ */
+void clockDate(char* buffer, size_t size);
+
+/**
+ * Format any time as "YYYY-MM-DD HH:MM:SS"; the current second comes from the cache
+ *
+ * @param value The time to format
+ * @param buffer Receives the string
+ * @param size Size of the buffer
+ */
+void clockFormatTimestamp(time_t value, char* buffer, size_t size);
+
+/**
+ * Format any time as "YYYY-MM-DD"; the current second comes from the cache
+ *
+ * @param value The time to format
+ * @param buffer Receives the string
+ * @param size Size of the buffer
+ */
+void clockFormatDate(time_t value, char* buffer, size_t size);
+
+/**
+ * Register a listener for local date changes
+ *
+ * @param fn The listener
+ * @param context Passed to the listener
+ * @return false if CLOCK_MAX_LISTENERS are already registered
+ */
+bool clockOnDateChange(ClockDateChangeFn fn, void* context);
+
+#endif // CLOCK_UTILS_H
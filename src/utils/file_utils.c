@@ -1,10 +1,14 @@
 #include "file_utils.h"
+#include "clock_utils.h"
 #include "../common/constants.h"
 #include "../common/paths.h"  // Added for isTestingMode()
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 // Function to read a file and return its contents as a string
 char *readFile(const char *filePath) {
@@ -72,10 +76,10 @@ int fileExists(const char *filePath) {
 int backupFile(const char *filePath) {
     char backupPath[256];
     char timestamp[20];
-    time_t now = time(NULL);
-    struct tm *t = localtime(&now);
+    ClockReading now;
+    clockRead(&now);
     
-    strftime(timestamp, sizeof(timestamp), "%Y%m%d_%H%M%S", t);
+    strftime(timestamp, sizeof(timestamp), "%Y%m%d_%H%M%S", &now.local);
     sprintf(backupPath, "%s.%s.bak", filePath, timestamp);
     
     char *content = readFile(filePath);
@@ -147,4 +151,66 @@ const char* getFilePath(const char* baseFileName) {
         sprintf(filePath, "%s/%s", PROD_DATA_DIR, baseFileName);
     }
     return filePath;
-}
\ No newline at end of file
+}
+
+// Fill a signature from stat data
+static void fillSignature(const struct stat *st, const char *filePath, FileSignature *signature) {
+    signature->path = filePath;
+    signature->device = st->st_dev;
+    signature->inode = st->st_ino;
+    signature->size = st->st_size;
+    signature->mtime = st->st_mtime;
+#ifdef __linux__
+    signature->mtimeNsec = st->st_mtim.tv_nsec;
+#else
+    signature->mtimeNsec = 0;
+#endif
+}
+
+// Function to read the current signature of a file
+bool readFileSignature(const char *filePath, FileSignature *signature) {
+    struct stat st;
+    if (stat(filePath, &st) != 0) {
+        return false;
+    }
+    fillSignature(&st, filePath, signature);
+    return true;
+}
+
+// Function to read the signature of an already open file descriptor
+bool readFdSignature(int fd, const char *filePath, FileSignature *signature) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        return false;
+    }
+    fillSignature(&st, filePath, signature);
+    return true;
+}
+
+// Function to check whether two signatures describe the same file contents
+bool fileSignatureMatches(const FileSignature *a, const FileSignature *b) {
+    return a->path == b->path && a->device == b->device && a->inode == b->inode &&
+           a->size == b->size && a->mtime == b->mtime && a->mtimeNsec == b->mtimeNsec;
+}
+
+bool syncPath(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+bool syncParentDirectory(const char *filePath) {
+    char dirPath[256];
+    strncpy(dirPath, filePath, sizeof(dirPath) - 1);
+    dirPath[sizeof(dirPath) - 1] = '\0';
+    char *slash = strrchr(dirPath, '/');
+    if (slash == NULL) {
+        return syncPath(".");
+    }
+    *slash = '\0';
+    return syncPath(dirPath[0] != '\0' ? dirPath : "/");
+}
@@ -1,6 +1,20 @@
 #ifndef FILE_UTILS_H
 #define FILE_UTILS_H
 
+#include <stdbool.h>
+#include <sys/types.h>
+#include <time.h>
+
+// On-disk identity of a file, used to detect when a cached copy is stale
+typedef struct {
+    const char* path;
+    dev_t device;
+    ino_t inode;
+    off_t size;
+    time_t mtime;
+    long mtimeNsec;
+} FileSignature;
+
 // Function to read a file and return its contents as a string
 char *readFile(const char *filePath);
 
@@ -25,4 +39,19 @@ int appendStructuredData(const char *filePath, const char **data, int numFields)
 // Function to get the production or test file path based on mode
 const char* getFilePath(const char* baseFileName);
 
+// Function to read the current signature of a file (false if it cannot be stat'ed)
+bool readFileSignature(const char *filePath, FileSignature *signature);
+
+// Function to read the signature of an already open file descriptor
+bool readFdSignature(int fd, const char *filePath, FileSignature *signature);
+
+// Function to check whether two signatures describe the same file contents
+bool fileSignatureMatches(const FileSignature *a, const FileSignature *b);
+
+// Function to fsync a file or directory by path
+bool syncPath(const char *path);
+
+// Function to fsync the directory holding a file, making a rename or unlink in it durable
+bool syncParentDirectory(const char *filePath);
+
 #endif // FILE_UTILS_H
\ No newline at end of file
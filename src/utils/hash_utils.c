@@ -228,4 +228,88 @@ int secure_hash_compare(const char* hash1, const char* hash2) {
     
     // Return 1 if hashes match, 0 otherwise
     return result;
-}
\ No newline at end of file
+}
+
+// CRC-32 (IEEE 802.3, reflected polynomial 0xEDB88320)
+// Bitwise rather than table-driven: inputs are short records and this keeps it reentrant
+uint32_t crc32_checksum(const void* data, size_t len) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    uint32_t crc = 0xFFFFFFFFu;
+
+    for (size_t i = 0; i < len; i++) {
+        crc ^= bytes[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+// FNV-1a, 32-bit offset basis and prime
+uint32_t fnv1a_hash(const char* str) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*)str; *p != '\0'; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+uint32_t fnv1a_hash_bytes(const void* data, size_t len) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+size_t slot_table_find(const SlotTable* table, size_t hash, const void* entries, const void* key,
+                       SlotKeyMatchFn match) {
+    size_t mask = table->slotCount - 1;
+    size_t i = hash & mask;
+
+    while (table->slots[i] != SLOT_EMPTY && !match(entries, table->slots[i], key)) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+bool slot_table_reserve(SlotTable* table, size_t needed, const void* entries, size_t entryCount,
+                        SlotEntryHashFn hashAt) {
+    size_t wanted = 64;
+    while (wanted < needed * 2) {
+        wanted <<= 1;
+    }
+    if (wanted <= table->slotCount) {
+        return true;
+    }
+
+    int* newSlots = (int*)malloc(wanted * sizeof(int));
+    if (newSlots == NULL) {
+        return false;
+    }
+
+    free(table->slots);
+    table->slots = newSlots;
+    table->slotCount = wanted;
+    slot_table_clear(table);
+
+    // Keys are distinct, so each entry goes into the first free slot of its probe
+    size_t mask = wanted - 1;
+    for (size_t e = 0; e < entryCount; e++) {
+        size_t i = hashAt(entries, (int)e) & mask;
+        while (table->slots[i] != SLOT_EMPTY) {
+            i = (i + 1) & mask;
+        }
+        table->slots[i] = (int)e;
+    }
+    return true;
+}
+
+void slot_table_clear(SlotTable* table) {
+    for (size_t i = 0; i < table->slotCount; i++) {
+        table->slots[i] = SLOT_EMPTY;
+    }
+}
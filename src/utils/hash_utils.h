@@ -1,6 +1,10 @@
 #ifndef HASH_UTILS_H
 #define HASH_UTILS_H
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
 /**
  * Computes a SHA-256 hash of the input string
  * 
@@ -20,4 +24,89 @@ char* sha256_hash(const char* input);
  */
 int secure_hash_compare(const char* hash1, const char* hash2);
 
+/**
+ * Computes a CRC-32 checksum, used to detect torn or corrupted records
+ * 
+ * @param data The bytes to checksum
+ * @param len Number of bytes
+ * @return The CRC-32 of the data
+ */
+uint32_t crc32_checksum(const void* data, size_t len);
+
+/**
+ * Computes the 32-bit FNV-1a hash of a NUL-terminated string
+ *
+ * Used to place IDs in hash tables and shards; shard placement is stored
+ * on disk, so the function must never change.
+ *
+ * @param str The string to hash
+ * @return The hash
+ */
+uint32_t fnv1a_hash(const char* str);
+
+/**
+ * Computes the 32-bit FNV-1a hash of a byte range
+ *
+ * @param data The bytes to hash
+ * @param len Number of bytes
+ * @return The hash, equal to fnv1a_hash for the same bytes
+ */
+uint32_t fnv1a_hash_bytes(const void* data, size_t len);
+
+// Marks a free slot in a SlotTable
+#define SLOT_EMPTY -1
+
+/**
+ * Open-addressing table of positions into a caller's array of entries
+ *
+ * The caller owns the entries and hashes its own keys; the table only
+ * probes linearly from a hash and is kept at most half full. The slot
+ * array is plain ints, so it can be saved and mapped back as it is.
+ */
+typedef struct {
+    int* slots;
+    size_t slotCount;       // Always a power of two once allocated
+} SlotTable;
+
+// Whether the entry at `position` has the key being looked up
+typedef bool (*SlotKeyMatchFn)(const void* entries, int position, const void* key);
+
+// Hash of the key of the entry at `position`, used when the table grows
+typedef size_t (*SlotEntryHashFn)(const void* entries, int position);
+
+/**
+ * Finds the slot holding a key, or the free slot where it would go
+ *
+ * @param table A table with at least one slot
+ * @param hash Hash of `key`
+ * @param entries The caller's entries, passed through to `match`
+ * @param key The key, passed through to `match`
+ * @param match Compares an entry with `key`
+ * @return The slot index; its value is SLOT_EMPTY if the key is absent
+ */
+size_t slot_table_find(const SlotTable* table, size_t hash, const void* entries, const void* key,
+                       SlotKeyMatchFn match);
+
+/**
+ * Grows the table so `needed` entries keep it at most half full
+ *
+ * Growing re-inserts entries 0..entryCount-1, which must have distinct keys.
+ *
+ * @param table The table; a zeroed table is valid
+ * @param needed Number of entries the table must hold
+ * @param entries The caller's entries
+ * @param entryCount Number of entries already in the table
+ * @param hashAt Hashes an entry's key
+ * @return false if memory ran out; the table is then unchanged
+ */
+bool slot_table_reserve(SlotTable* table, size_t needed, const void* entries, size_t entryCount,
+                        SlotEntryHashFn hashAt);
+
+/**
+ * Marks every slot free, keeping the allocation
+ *
+ * @param table The table
+ */
+void slot_table_clear(SlotTable* table);
+
 #endif // HASH_UTILS_H
\ No newline at end of file
@@ -0,0 +1,1010 @@
+#include "log_archive.h"
+#include "lz_block.h"
+#include "logger.h"
+#include "clock_utils.h"
+#include "hash_utils.h"
+#include "table_reader.h"
+#include "../common/paths.h"
+#include "../database/transaction_log.h"
+#include "../config/config_manager.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+
+// Configuration key for the size that triggers rotation
+#define CONFIG_LOG_ROTATE_MAX_BYTES "log_rotate_max_bytes"
+#define DEFAULT_LOG_ROTATE_MAX_BYTES (8 * 1024 * 1024)
+
+#define LOG_ARCHIVE_CHECK_MS 1000
+
+// Bytes read from a plain segment for a single line; scans read whole blocks
+#define PLAIN_READ_SIZE 4096
+
+#define COMPRESSED_MAGIC "ATMLZS01"
+
+#define MANIFEST_HEADER \
+    "Log          | Segment | First Time          | Last Time           | Size       | Device | Inode      | Compressed | File"
+#define MANIFEST_SEPARATOR \
+    "-------------|---------|---------------------|---------------------|------------|--------|------------|------------|-----"
+
+// Header of a compressed segment, followed by `blockCount` CompressedBlock
+// entries and then the blocks
+typedef struct {
+    char magic[8];
+    uint32_t blockSize;
+    uint32_t blockCount;
+    uint64_t size;                // Uncompressed bytes
+} CompressedHeader;
+
+typedef struct {
+    uint64_t offset;              // Position of the block in the file
+    uint32_t storedSize;
+    uint32_t size;                // Uncompressed bytes
+    uint32_t crc;                 // Of the uncompressed bytes
+    uint32_t raw;                 // 1 if stored uncompressed
+} CompressedBlock;
+
+struct LogSegmentReader {
+    int fd;
+    bool compressed;
+    uint64_t size;
+    size_t readSize;              // Bytes per read from a plain segment
+    uint32_t blockCount;
+    CompressedBlock* blocks;
+    char* stored;                 // One block as stored
+    char* cache;                  // Uncompressed bytes from cacheStart
+    uint64_t cacheStart;
+    size_t cacheLength;
+};
+
+typedef struct {
+    LogArchiveLog log;
+    LogSegment segment;
+} ManifestEntry;
+
+static const struct {
+    const char* name;
+    const char* (*path)(void);
+} archivedLogs[LOG_ARCHIVE_LOG_COUNT] = {
+    [LOG_ARCHIVE_TRANSACTIONS] = { "transactions", getTransactionsLogFilePath },
+    [LOG_ARCHIVE_WITHDRAWALS] = { "withdrawals", getWithdrawalsLogFilePath },
+    [LOG_ARCHIVE_AUDIT] = { "audit", getAuditLogFilePath },
+    [LOG_ARCHIVE_ERROR] = { "error", getErrorLogFilePath }
+};
+
+// The manifest as last read, guarded by manifestLock; reread when the file changes
+static pthread_mutex_t manifestLock = PTHREAD_MUTEX_INITIALIZER;
+static ManifestEntry* manifest = NULL;
+static size_t manifestCount = 0;
+static size_t manifestCapacity = 0;
+static char manifestPath[100] = "";
+static struct stat manifestStat;
+
+// Day of the first line of each live log, by file identity; guarded by manifestLock
+static struct {
+    dev_t device;
+    ino_t inode;
+    char day[CLOCK_DATE_SIZE];
+} firstDays[LOG_ARCHIVE_LOG_COUNT];
+
+// Archiver thread state, guarded by archiverLock
+static pthread_mutex_t archiverLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t archiverWake = PTHREAD_COND_INITIALIZER;
+static pthread_t archiverThread;
+static bool started = false;
+static bool archiverRunning = false;
+static bool stopRequested = false;
+static long long maxBytes = DEFAULT_LOG_ROTATE_MAX_BYTES;
+
+static bool isTimestampAt(const char* p) {
+    static const char pattern[] = "dddd-dd-dd dd:dd:dd";
+    for (int i = 0; pattern[i] != '\0'; i++) {
+        if (pattern[i] == 'd' ? (p[i] < '0' || p[i] > '9') : p[i] != pattern[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// First "YYYY-MM-DD HH:MM:SS" in a line; every log line carries one
+static bool findTimestamp(const char* line, size_t length, char* timestamp) {
+    for (size_t i = 0; i + 19 <= length; i++) {
+        if (line[i + 4] == '-' && isTimestampAt(line + i)) {
+            memcpy(timestamp, line + i, 19);
+            timestamp[19] = '\0';
+            return true;
+        }
+    }
+    return false;
+}
+
+// Time of the first transaction in the start of a transactions log
+static bool findRecordTime(const char* data, size_t length, char* timestamp) {
+    if (length < TRANSACTION_LOG_HEADER_SIZE || !transactionLogValidHeader(data)) {
+        return false;
+    }
+    TransactionLogRecord record;
+    for (size_t pos = TRANSACTION_LOG_HEADER_SIZE; pos + sizeof(record) <= length; pos += sizeof(record)) {
+        memcpy(&record, data + pos, sizeof(record));
+        if (record.id != 0) {
+            clockFormatTimestamp((time_t)record.time, timestamp, CLOCK_TIMESTAMP_SIZE);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Earliest and latest timestamps in a plain file
+static void scanTimes(LogArchiveLog log, const char* path, LogSegment* segment) {
+    segment->firstTime[0] = '\0';
+    segment->lastTime[0] = '\0';
+
+    if (log == LOG_ARCHIVE_TRANSACTIONS) {
+        transactionLogFileTimes(path, segment->firstTime, segment->lastTime);
+        return;
+    }
+
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        return;
+    }
+    char* line = NULL;
+    size_t capacity = 0;
+    ssize_t length;
+    char timestamp[20];
+    while ((length = getline(&line, &capacity, file)) > 0) {
+        if (!findTimestamp(line, (size_t)length, timestamp)) {
+            continue;
+        }
+        if (segment->firstTime[0] == '\0' || strcmp(timestamp, segment->firstTime) < 0) {
+            memcpy(segment->firstTime, timestamp, sizeof(timestamp));
+        }
+        if (strcmp(timestamp, segment->lastTime) > 0) {
+            memcpy(segment->lastTime, timestamp, sizeof(timestamp));
+        }
+    }
+    free(line);
+    fclose(file);
+}
+
+static void segmentPath(char* path, size_t size, const char* file) {
+    snprintf(path, size, "%s/%s", getLogArchiveDirPath(), file);
+}
+
+static const char* segmentFileName(const LogSegment* segment) {
+    const char* slash = strrchr(segment->path, '/');
+    return slash != NULL ? slash + 1 : segment->path;
+}
+
+static bool sameStat(const struct stat* a, const struct stat* b) {
+    return a->st_dev == b->st_dev && a->st_ino == b->st_ino && a->st_size == b->st_size &&
+           a->st_mtim.tv_sec == b->st_mtim.tv_sec && a->st_mtim.tv_nsec == b->st_mtim.tv_nsec;
+}
+
+static bool manifestAppend(LogArchiveLog log, const LogSegment* segment) {
+    if (manifestCount == manifestCapacity) {
+        size_t capacity = manifestCapacity == 0 ? 64 : manifestCapacity * 2;
+        ManifestEntry* grown = (ManifestEntry*)realloc(manifest, capacity * sizeof(ManifestEntry));
+        if (grown == NULL) {
+            return false;
+        }
+        manifest = grown;
+        manifestCapacity = capacity;
+    }
+    manifest[manifestCount].log = log;
+    manifest[manifestCount].segment = *segment;
+    manifestCount++;
+    return true;
+}
+
+static bool parseManifestRow(const TableRow* row, ManifestEntry* entry) {
+    long id, size, device, inode;
+    if (row->fieldCount < 9 || !tableFieldToLong(&row->fields[1], &id) || id <= 0 ||
+        !tableFieldToLong(&row->fields[4], &size) || size < 0 ||
+        !tableFieldToLong(&row->fields[5], &device) || !tableFieldToLong(&row->fields[6], &inode)) {
+        return false;
+    }
+
+    int log = -1;
+    for (int i = 0; i < LOG_ARCHIVE_LOG_COUNT; i++) {
+        if (tableFieldEquals(&row->fields[0], archivedLogs[i].name)) {
+            log = i;
+        }
+    }
+    if (log < 0) {
+        return false;
+    }
+
+    memset(entry, 0, sizeof(*entry));
+    entry->log = (LogArchiveLog)log;
+    entry->segment.id = (uint32_t)id;
+    if (!tableFieldEquals(&row->fields[2], "-")) {
+        tableFieldCopy(&row->fields[2], entry->segment.firstTime, sizeof(entry->segment.firstTime));
+    }
+    if (!tableFieldEquals(&row->fields[3], "-")) {
+        tableFieldCopy(&row->fields[3], entry->segment.lastTime, sizeof(entry->segment.lastTime));
+    }
+    entry->segment.size = (uint64_t)size;
+    entry->segment.device = (uint64_t)device;
+    entry->segment.inode = (uint64_t)inode;
+    entry->segment.compressed = tableFieldEquals(&row->fields[7], "yes");
+
+    char file[128];
+    tableFieldCopy(&row->fields[8], file, sizeof(file));
+    segmentPath(entry->segment.path, sizeof(entry->segment.path), file);
+    return true;
+}
+
+// Bring the cached manifest up to date with the file; needs manifestLock
+static void loadManifestLocked(void) {
+    const char* path = getLogManifestFilePath();
+    struct stat st;
+    bool exists = stat(path, &st) == 0;
+    if (strcmp(path, manifestPath) == 0 &&
+        (exists ? manifestStat.st_ino != 0 && sameStat(&st, &manifestStat) : manifestStat.st_ino == 0)) {
+        return;
+    }
+
+    manifestCount = 0;
+    snprintf(manifestPath, sizeof(manifestPath), "%s", path);
+    memset(&manifestStat, 0, sizeof(manifestStat));
+    if (!exists) {
+        return;
+    }
+
+    TableReader reader;
+    if (!tableReaderOpen(&reader, path, '|')) {
+        return;
+    }
+    tableReaderSkipLines(&reader, 2);
+    TableRow row;
+    ManifestEntry entry;
+    while (tableReaderNext(&reader, &row)) {
+        if (parseManifestRow(&row, &entry) && !manifestAppend(entry.log, &entry.segment)) {
+            writeErrorLog("Out of memory reading the log manifest");
+            break;
+        }
+    }
+    tableReaderClose(&reader);
+    manifestStat = st;
+}
+
+// Write the cached manifest to a temporary file and move it into place;
+// needs manifestLock and the manifest file lock
+static bool saveManifestLocked(void) {
+    const char* path = getLogManifestFilePath();
+    char tempPath[128];
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+
+    FILE* file = fopen(tempPath, "w");
+    if (file == NULL) {
+        writeErrorLog("Failed to write the log manifest");
+        return false;
+    }
+    fprintf(file, "%s\n%s\n", MANIFEST_HEADER, MANIFEST_SEPARATOR);
+    for (size_t i = 0; i < manifestCount; i++) {
+        const LogSegment* segment = &manifest[i].segment;
+        fprintf(file, "%-12s | %-7u | %-19s | %-19s | %-10llu | %-6llu | %-10llu | %-10s | %s\n",
+                archivedLogs[manifest[i].log].name, segment->id,
+                segment->firstTime[0] != '\0' ? segment->firstTime : "-",
+                segment->lastTime[0] != '\0' ? segment->lastTime : "-",
+                (unsigned long long)segment->size, (unsigned long long)segment->device,
+                (unsigned long long)segment->inode, segment->compressed ? "yes" : "no",
+                segmentFileName(segment));
+    }
+    bool ok = fflush(file) == 0 && fsync(fileno(file)) == 0;
+    ok = fclose(file) == 0 && ok;
+
+    if (!ok || rename(tempPath, path) != 0) {
+        remove(tempPath);
+        writeErrorLog("Failed to write the log manifest");
+        return false;
+    }
+    // Read back on next use, so this process sees the same file as the others
+    memset(&manifestStat, 0, sizeof(manifestStat));
+    manifestPath[0] = '\0';
+    return true;
+}
+
+// Lock the manifest against other processes; returns the lock descriptor or -1
+static int lockManifestFile(void) {
+    char lockPath[128];
+    snprintf(lockPath, sizeof(lockPath), "%s.lock", getLogManifestFilePath());
+    int fd = open(lockPath, O_RDWR | O_CREAT, 0644);
+    if (fd >= 0 && flock(fd, LOCK_EX) != 0) {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+static void unlockManifestFile(int fd) {
+    if (fd >= 0) {
+        flock(fd, LOCK_UN);
+        close(fd);
+    }
+}
+
+// Whether a segment has lines between `from` and `to`; "YYYY-MM-DD HH:MM:SS"
+// strings compare in time order, and a bare date covers its day
+static bool segmentInRange(const LogSegment* segment, const char* from, const char* to) {
+    if (segment->firstTime[0] == '\0') {
+        return from == NULL && to == NULL;
+    }
+    if (from != NULL && strcmp(segment->lastTime, from) < 0) {
+        return false;
+    }
+    if (to != NULL && strncmp(segment->firstTime, to, strlen(to)) > 0) {
+        return false;
+    }
+    return true;
+}
+
+static int compareEntryIds(const void* a, const void* b) {
+    uint32_t left = ((const LogSegment*)a)->id;
+    uint32_t right = ((const LogSegment*)b)->id;
+    return left < right ? -1 : left > right;
+}
+
+LogSegment* logArchiveList(LogArchiveLog log, const char* from, const char* to, int* count) {
+    *count = 0;
+    LogSegment* segments = NULL;
+
+    pthread_mutex_lock(&manifestLock);
+    loadManifestLocked();
+    size_t matching = 0;
+    for (size_t i = 0; i < manifestCount; i++) {
+        if (manifest[i].log == log && segmentInRange(&manifest[i].segment, from, to)) {
+            matching++;
+        }
+    }
+    if (matching > 0 && (segments = (LogSegment*)malloc(matching * sizeof(LogSegment))) != NULL) {
+        for (size_t i = 0; i < manifestCount; i++) {
+            if (manifest[i].log == log && segmentInRange(&manifest[i].segment, from, to)) {
+                segments[(*count)++] = manifest[i].segment;
+            }
+        }
+    }
+    pthread_mutex_unlock(&manifestLock);
+
+    if (*count > 1) {
+        qsort(segments, (size_t)*count, sizeof(LogSegment), compareEntryIds);
+    }
+    return segments;
+}
+
+bool logArchiveFindFile(LogArchiveLog log, uint64_t device, uint64_t inode, LogSegment* segment) {
+    bool found = false;
+    pthread_mutex_lock(&manifestLock);
+    loadManifestLocked();
+    // Inodes of removed plain segments are reused, so the newest match is the one
+    for (size_t i = 0; i < manifestCount; i++) {
+        if (manifest[i].log == log && manifest[i].segment.device == device && manifest[i].segment.inode == inode &&
+            (!found || manifest[i].segment.id > segment->id)) {
+            *segment = manifest[i].segment;
+            found = true;
+        }
+    }
+    pthread_mutex_unlock(&manifestLock);
+    return found;
+}
+
+bool logArchiveFind(LogArchiveLog log, uint32_t id, LogSegment* segment) {
+    bool found = false;
+    pthread_mutex_lock(&manifestLock);
+    loadManifestLocked();
+    for (size_t i = 0; i < manifestCount && !found; i++) {
+        if (manifest[i].log == log && manifest[i].segment.id == id) {
+            *segment = manifest[i].segment;
+            found = true;
+        }
+    }
+    pthread_mutex_unlock(&manifestLock);
+    return found;
+}
+
+static bool readFully(int fd, void* buffer, size_t size, uint64_t offset) {
+    char* p = (char*)buffer;
+    while (size > 0) {
+        ssize_t got = pread(fd, p, size, (off_t)offset);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            return false;
+        }
+        p += got;
+        size -= (size_t)got;
+        offset += (uint64_t)got;
+    }
+    return true;
+}
+
+static bool writeFully(int fd, const void* buffer, size_t size, uint64_t offset) {
+    const char* p = (const char*)buffer;
+    while (size > 0) {
+        ssize_t written = pwrite(fd, p, size, (off_t)offset);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        p += written;
+        size -= (size_t)written;
+        offset += (uint64_t)written;
+    }
+    return true;
+}
+
+static LogSegmentReader* openReaderAt(const char* path, bool compressed) {
+    LogSegmentReader* reader = (LogSegmentReader*)calloc(1, sizeof(LogSegmentReader));
+    if (reader == NULL) {
+        return NULL;
+    }
+    reader->fd = open(path, O_RDONLY);
+    reader->compressed = compressed;
+    reader->readSize = PLAIN_READ_SIZE;
+    reader->cache = (char*)malloc(LOG_ARCHIVE_BLOCK_SIZE);
+    bool ok = reader->fd >= 0 && reader->cache != NULL;
+
+    struct stat st;
+    if (ok && !compressed) {
+        ok = fstat(reader->fd, &st) == 0;
+        reader->size = ok ? (uint64_t)st.st_size : 0;
+    } else if (ok) {
+        CompressedHeader header;
+        ok = readFully(reader->fd, &header, sizeof(header), 0) &&
+             memcmp(header.magic, COMPRESSED_MAGIC, sizeof(header.magic)) == 0 &&
+             header.blockSize == LOG_ARCHIVE_BLOCK_SIZE &&
+             header.blockCount == (header.size + LOG_ARCHIVE_BLOCK_SIZE - 1) / LOG_ARCHIVE_BLOCK_SIZE;
+        if (ok && header.blockCount > 0) {
+            reader->blocks = (CompressedBlock*)malloc(header.blockCount * sizeof(CompressedBlock));
+            reader->stored = (char*)malloc(LZ_BLOCK_BOUND(LOG_ARCHIVE_BLOCK_SIZE));
+            ok = reader->blocks != NULL && reader->stored != NULL &&
+                 readFully(reader->fd, reader->blocks, header.blockCount * sizeof(CompressedBlock), sizeof(header));
+        }
+        reader->size = header.size;
+        reader->blockCount = header.blockCount;
+    }
+
+    if (!ok) {
+        logSegmentClose(reader);
+        return NULL;
+    }
+    return reader;
+}
+
+LogSegmentReader* logSegmentOpen(const LogSegment* segment) {
+    LogSegmentReader* reader = openReaderAt(segment->path, segment->compressed);
+    if (reader == NULL) {
+        // Compressed since the segment was looked up
+        LogSegment current;
+        for (int log = 0; log < LOG_ARCHIVE_LOG_COUNT && reader == NULL; log++) {
+            if (logArchiveFind((LogArchiveLog)log, segment->id, &current) && current.inode == segment->inode &&
+                strcmp(current.path, segment->path) != 0) {
+                reader = openReaderAt(current.path, current.compressed);
+            }
+        }
+    }
+    return reader;
+}
+
+void logSegmentClose(LogSegmentReader* reader) {
+    if (reader == NULL) {
+        return;
+    }
+    if (reader->fd >= 0) {
+        close(reader->fd);
+    }
+    free(reader->blocks);
+    free(reader->stored);
+    free(reader->cache);
+    free(reader);
+}
+
+// Bytes of the segment from `offset` on, as many as are at hand; 0 at the end
+static size_t readerBytes(LogSegmentReader* reader, uint64_t offset, const char** data) {
+    if (offset >= reader->size) {
+        return 0;
+    }
+    if (offset < reader->cacheStart || offset >= reader->cacheStart + reader->cacheLength) {
+        reader->cacheLength = 0;
+        if (!reader->compressed) {
+            uint64_t left = reader->size - offset;
+            size_t length = left < reader->readSize ? (size_t)left : reader->readSize;
+            if (!readFully(reader->fd, reader->cache, length, offset)) {
+                return 0;
+            }
+            reader->cacheStart = offset;
+            reader->cacheLength = length;
+        } else {
+            uint32_t index = (uint32_t)(offset / LOG_ARCHIVE_BLOCK_SIZE);
+            const CompressedBlock* block = &reader->blocks[index];
+            if (block->size > LOG_ARCHIVE_BLOCK_SIZE || block->storedSize > LZ_BLOCK_BOUND(LOG_ARCHIVE_BLOCK_SIZE) ||
+                !readFully(reader->fd, reader->stored, block->storedSize, block->offset)) {
+                return 0;
+            }
+            bool ok = block->raw ? block->storedSize == block->size
+                                 : lzDecompressBlock(reader->stored, block->storedSize, reader->cache, block->size);
+            if (ok && block->raw) {
+                memcpy(reader->cache, reader->stored, block->size);
+            }
+            if (!ok || crc32_checksum(reader->cache, block->size) != block->crc) {
+                return 0;
+            }
+            reader->cacheStart = (uint64_t)index * LOG_ARCHIVE_BLOCK_SIZE;
+            reader->cacheLength = block->size;
+        }
+    }
+    *data = reader->cache + (offset - reader->cacheStart);
+    return reader->cacheLength - (size_t)(offset - reader->cacheStart);
+}
+
+bool logSegmentReadLine(LogSegmentReader* reader, uint64_t offset, char* line, size_t size) {
+    size_t used = 0;
+    bool any = false;
+    const char* data;
+    size_t available;
+
+    while ((available = readerBytes(reader, offset, &data)) > 0) {
+        any = true;
+        const char* newline = (const char*)memchr(data, '\n', available);
+        size_t length = newline != NULL ? (size_t)(newline - data) : available;
+        size_t copy = length < size - 1 - used ? length : size - 1 - used;
+        memcpy(line + used, data, copy);
+        used += copy;
+        if (newline != NULL) {
+            break;
+        }
+        offset += available;
+    }
+    line[used] = '\0';
+    return any;
+}
+
+size_t logSegmentRead(LogSegmentReader* reader, uint64_t offset, void* buffer, size_t size) {
+    if (offset >= reader->size) {
+        return 0;
+    }
+    if (size > reader->size - offset) {
+        size = (size_t)(reader->size - offset);
+    }
+    // Plain segments are read straight into the caller's buffer
+    if (!reader->compressed) {
+        return readFully(reader->fd, buffer, size, offset) ? size : 0;
+    }
+
+    size_t copied = 0;
+    const char* data;
+    size_t available;
+    while (copied < size && (available = readerBytes(reader, offset + copied, &data)) > 0) {
+        size_t length = available < size - copied ? available : size - copied;
+        memcpy((char*)buffer + copied, data, length);
+        copied += length;
+    }
+    return copied;
+}
+
+uint64_t logSegmentSize(const LogSegmentReader* reader) {
+    return reader->size;
+}
+
+bool logSegmentScan(const LogSegment* segment, uint64_t start, LogSegmentLineFn fn, void* context) {
+    LogSegmentReader* reader = logSegmentOpen(segment);
+    if (reader == NULL) {
+        return false;
+    }
+    reader->readSize = LOG_ARCHIVE_BLOCK_SIZE;
+
+    // A line split across blocks is put together here
+    char* pending = NULL;
+    size_t pendingLength = 0;
+    size_t pendingCapacity = 0;
+    uint64_t lineStart = start;
+    uint64_t offset = start;
+    bool ok = true;
+    bool stopped = false;
+    const char* data;
+    size_t available;
+
+    while (!stopped && (available = readerBytes(reader, offset, &data)) > 0) {
+        size_t pos = 0;
+        while (!stopped && pos < available) {
+            const char* newline = (const char*)memchr(data + pos, '\n', available - pos);
+            size_t length = newline != NULL ? (size_t)(newline - (data + pos)) : available - pos;
+
+            if (newline != NULL && pendingLength == 0) {
+                stopped = !fn(data + pos, length, lineStart, context);
+            } else {
+                if (pendingLength + length > pendingCapacity) {
+                    size_t capacity = (pendingLength + length) * 2;
+                    char* grown = (char*)realloc(pending, capacity);
+                    if (grown == NULL) {
+                        ok = false;
+                        stopped = true;
+                        break;
+                    }
+                    pending = grown;
+                    pendingCapacity = capacity;
+                }
+                memcpy(pending + pendingLength, data + pos, length);
+                pendingLength += length;
+                if (newline != NULL) {
+                    stopped = !fn(pending, pendingLength, lineStart, context);
+                    pendingLength = 0;
+                }
+            }
+
+            pos += length + (newline != NULL ? 1 : 0);
+            if (newline != NULL) {
+                lineStart = offset + pos;
+            }
+        }
+        offset += available;
+    }
+    if (!stopped && offset < reader->size) {
+        ok = false;     // Damaged block
+    }
+
+    free(pending);
+    logSegmentClose(reader);
+    return ok;
+}
+
+// Day the live log's first line or record is from, or "" if it has none yet; needs manifestLock
+static const char* firstDayLocked(LogArchiveLog log, const char* path, const struct stat* st) {
+    if (firstDays[log].device == st->st_dev && firstDays[log].inode == st->st_ino) {
+        return firstDays[log].day;
+    }
+
+    char buffer[4096];
+    FILE* file = fopen(path, "r");
+    size_t length = file != NULL ? fread(buffer, 1, sizeof(buffer), file) : 0;
+    if (file != NULL) {
+        fclose(file);
+    }
+    char timestamp[20];
+    bool found = log == LOG_ARCHIVE_TRANSACTIONS ? findRecordTime(buffer, length, timestamp)
+                                                 : findTimestamp(buffer, length, timestamp);
+    if (!found) {
+        return "";
+    }
+    firstDays[log].device = st->st_dev;
+    firstDays[log].inode = st->st_ino;
+    snprintf(firstDays[log].day, sizeof(firstDays[log].day), "%.10s", timestamp);
+    return firstDays[log].day;
+}
+
+// Whether the live log should be rotated; needs manifestLock
+static bool rotationDueLocked(LogArchiveLog log, const char* path, const struct stat* st) {
+    if (st->st_size == 0) {
+        return false;
+    }
+    if (maxBytes > 0 && (long long)st->st_size >= maxBytes) {
+        return true;
+    }
+    char today[CLOCK_DATE_SIZE];
+    clockDate(today, sizeof(today));
+    const char* day = firstDayLocked(log, path, st);
+    return day[0] != '\0' && strcmp(day, today) < 0;
+}
+
+// Move the live log into the archive; needs manifestLock and the manifest file lock
+static bool rotateLocked(LogArchiveLog log, bool force) {
+    const char* path = archivedLogs[log].path();
+    struct stat st;
+    loadManifestLocked();
+    if (stat(path, &st) != 0 || st.st_size == 0) {
+        return true;
+    }
+    if (!force && !rotationDueLocked(log, path, &st)) {
+        return true;        // Another process rotated it first
+    }
+
+    LogSegment segment;
+    memset(&segment, 0, sizeof(segment));
+    for (size_t i = 0; i < manifestCount; i++) {
+        if (manifest[i].log == log && manifest[i].segment.id > segment.id) {
+            segment.id = manifest[i].segment.id;
+        }
+    }
+    segment.id++;
+    scanTimes(log, path, &segment);
+    segment.size = (uint64_t)st.st_size;
+    segment.device = (uint64_t)st.st_dev;
+    segment.inode = (uint64_t)st.st_ino;
+
+    char day[CLOCK_DATE_SIZE];
+    if (segment.firstTime[0] != '\0') {
+        snprintf(day, sizeof(day), "%.10s", segment.firstTime);
+    } else {
+        clockDate(day, sizeof(day));
+    }
+    char file[96];
+    snprintf(file, sizeof(file), "%s-%s-%06u.log", archivedLogs[log].name, day, segment.id);
+    segmentPath(segment.path, sizeof(segment.path), file);
+
+    // Listed before the move, so a reader that sees the live log change finds it
+    if (!manifestAppend(log, &segment) || !saveManifestLocked()) {
+        memset(&manifestStat, 0, sizeof(manifestStat));
+        manifestPath[0] = '\0';
+        return false;
+    }
+    if (rename(path, segment.path) != 0) {
+        char errorMsg[200];
+        snprintf(errorMsg, sizeof(errorMsg), "Failed to rotate %s into %s", path, segment.path);
+        writeErrorLog(errorMsg);
+        loadManifestLocked();
+        for (size_t i = manifestCount; i > 0; i--) {
+            if (manifest[i - 1].log == log && manifest[i - 1].segment.id == segment.id) {
+                manifest[i - 1] = manifest[--manifestCount];
+                saveManifestLocked();
+                break;
+            }
+        }
+        return false;
+    }
+
+    char logMsg[200];
+    snprintf(logMsg, sizeof(logMsg), "Rotated %s into segment %u (%llu bytes)", path, segment.id,
+             (unsigned long long)segment.size);
+    writeInfoLog(logMsg);
+    return true;
+}
+
+bool logArchiveRotate(LogArchiveLog log) {
+    if (log < 0 || log >= LOG_ARCHIVE_LOG_COUNT) {
+        return false;
+    }
+    ensureDirectoryExists(getLogArchiveDirPath());
+    // Queued lines belong in the segment
+    logSync();
+
+    int lockFd = lockManifestFile();
+    if (lockFd < 0) {
+        return false;
+    }
+    pthread_mutex_lock(&manifestLock);
+    bool ok = rotateLocked(log, true);
+    pthread_mutex_unlock(&manifestLock);
+    unlockManifestFile(lockFd);
+    return ok;
+}
+
+// Write a compressed copy of a plain segment to `path`
+static bool writeCompressed(const char* plainPath, const char* path, uint64_t* size) {
+    int in = open(plainPath, O_RDONLY);
+    if (in < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(in, &st) != 0) {
+        close(in);
+        return false;
+    }
+
+    CompressedHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, COMPRESSED_MAGIC, sizeof(header.magic));
+    header.blockSize = LOG_ARCHIVE_BLOCK_SIZE;
+    header.size = (uint64_t)st.st_size;
+    header.blockCount = (uint32_t)((header.size + LOG_ARCHIVE_BLOCK_SIZE - 1) / LOG_ARCHIVE_BLOCK_SIZE);
+
+    int out = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    CompressedBlock* blocks = (CompressedBlock*)calloc(header.blockCount > 0 ? header.blockCount : 1,
+                                                       sizeof(CompressedBlock));
+    char* raw = (char*)malloc(LOG_ARCHIVE_BLOCK_SIZE);
+    char* packed = (char*)malloc(LZ_BLOCK_BOUND(LOG_ARCHIVE_BLOCK_SIZE));
+    bool ok = out >= 0 && blocks != NULL && raw != NULL && packed != NULL;
+
+    uint64_t position = sizeof(header) + (uint64_t)header.blockCount * sizeof(CompressedBlock);
+    for (uint32_t i = 0; ok && i < header.blockCount; i++) {
+        uint64_t start = (uint64_t)i * LOG_ARCHIVE_BLOCK_SIZE;
+        size_t length = header.size - start < LOG_ARCHIVE_BLOCK_SIZE ? (size_t)(header.size - start)
+                                                                     : LOG_ARCHIVE_BLOCK_SIZE;
+        ok = readFully(in, raw, length, start);
+        if (!ok) {
+            break;
+        }
+        size_t packedLength = lzCompressBlock(raw, length, packed, LZ_BLOCK_BOUND(LOG_ARCHIVE_BLOCK_SIZE));
+        bool storeRaw = packedLength == 0 || packedLength >= length;
+
+        blocks[i].offset = position;
+        blocks[i].size = (uint32_t)length;
+        blocks[i].storedSize = (uint32_t)(storeRaw ? length : packedLength);
+        blocks[i].crc = crc32_checksum(raw, length);
+        blocks[i].raw = storeRaw ? 1 : 0;
+        ok = writeFully(out, storeRaw ? raw : packed, blocks[i].storedSize, position);
+        position += blocks[i].storedSize;
+    }
+
+    ok = ok && writeFully(out, &header, sizeof(header), 0) &&
+         writeFully(out, blocks, (size_t)header.blockCount * sizeof(CompressedBlock), sizeof(header)) &&
+         fdatasync(out) == 0;
+
+    if (out >= 0 && close(out) != 0) {
+        ok = false;
+    }
+    close(in);
+    free(blocks);
+    free(raw);
+    free(packed);
+    if (!ok) {
+        remove(path);
+    }
+    *size = header.size;
+    return ok;
+}
+
+// Compress a plain segment and point the manifest at the compressed file
+static void compressSegment(LogArchiveLog log, const LogSegment* segment) {
+    char path[160];
+    snprintf(path, sizeof(path), "%.*s.lzs", (int)(strlen(segment->path) - 4), segment->path);
+    char tempPath[176];
+    snprintf(tempPath, sizeof(tempPath), "%s.%ld.tmp", path, (long)getpid());
+
+    LogSegment compressed = *segment;
+    scanTimes(log, segment->path, &compressed);
+    if (!writeCompressed(segment->path, tempPath, &compressed.size)) {
+        writeErrorLog("Failed to compress a log segment");
+        return;
+    }
+    compressed.compressed = true;
+    snprintf(compressed.path, sizeof(compressed.path), "%s", path);
+
+    int lockFd = lockManifestFile();
+    pthread_mutex_lock(&manifestLock);
+    loadManifestLocked();
+    ManifestEntry* entry = NULL;
+    for (size_t i = 0; i < manifestCount && entry == NULL; i++) {
+        if (manifest[i].log == log && manifest[i].segment.id == segment->id && !manifest[i].segment.compressed) {
+            entry = &manifest[i];
+        }
+    }
+
+    bool done = false;
+    if (lockFd >= 0 && entry != NULL && rename(tempPath, path) == 0) {
+        entry->segment = compressed;
+        done = saveManifestLocked();
+        if (!done) {
+            remove(path);
+        }
+    }
+    pthread_mutex_unlock(&manifestLock);
+    unlockManifestFile(lockFd);
+
+    if (done) {
+        // Readers that looked the segment up before find the new file through the manifest
+        remove(segment->path);
+    } else {
+        remove(tempPath);
+    }
+}
+
+void logArchiveCheck(void) {
+    ensureDirectoryExists(getLogArchiveDirPath());
+
+    // Rotate the logs that are due; the file lock is taken only when one is
+    for (int log = 0; log < LOG_ARCHIVE_LOG_COUNT; log++) {
+        const char* path = archivedLogs[log].path();
+        struct stat st;
+        if (stat(path, &st) != 0) {
+            continue;
+        }
+        pthread_mutex_lock(&manifestLock);
+        bool due = rotationDueLocked((LogArchiveLog)log, path, &st);
+        pthread_mutex_unlock(&manifestLock);
+        if (!due) {
+            continue;
+        }
+
+        logSync();
+        int lockFd = lockManifestFile();
+        if (lockFd < 0) {
+            continue;
+        }
+        pthread_mutex_lock(&manifestLock);
+        rotateLocked((LogArchiveLog)log, false);
+        pthread_mutex_unlock(&manifestLock);
+        unlockManifestFile(lockFd);
+    }
+
+    // Compress segments nobody has written to for the grace period
+    time_t now = time(NULL);
+    for (int log = 0; log < LOG_ARCHIVE_LOG_COUNT; log++) {
+        int count;
+        LogSegment* segments = logArchiveList((LogArchiveLog)log, NULL, NULL, &count);
+        for (int i = 0; i < count; i++) {
+            struct stat st;
+            if (!segments[i].compressed && stat(segments[i].path, &st) == 0 &&
+                now - st.st_mtime >= LOG_ARCHIVE_GRACE_SECONDS) {
+                compressSegment((LogArchiveLog)log, &segments[i]);
+            }
+        }
+        free(segments);
+    }
+}
+
+static void onDateChange(const char* date, void* context) {
+    (void)date;
+    (void)context;
+    // Without archiverLock: the clock may be read with it held
+    pthread_cond_signal(&archiverWake);
+}
+
+static void* archiverMain(void* arg) {
+    (void)arg;
+
+    pthread_mutex_lock(&archiverLock);
+    while (!stopRequested) {
+        pthread_mutex_unlock(&archiverLock);
+        logArchiveCheck();
+        pthread_mutex_lock(&archiverLock);
+        if (stopRequested) {
+            break;
+        }
+
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += LOG_ARCHIVE_CHECK_MS / 1000;
+        deadline.tv_nsec += (long)(LOG_ARCHIVE_CHECK_MS % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&archiverWake, &archiverLock, &deadline);
+    }
+    pthread_mutex_unlock(&archiverLock);
+    return NULL;
+}
+
+bool logArchiveStart(void) {
+    static bool listening = false;
+
+    pthread_mutex_lock(&archiverLock);
+    if (started) {
+        pthread_mutex_unlock(&archiverLock);
+        return archiverRunning;
+    }
+    started = true;
+    stopRequested = false;
+
+    maxBytes = hasConfigKey(CONFIG_LOG_ROTATE_MAX_BYTES) ? getConfigValueInt(CONFIG_LOG_ROTATE_MAX_BYTES)
+                                                          : DEFAULT_LOG_ROTATE_MAX_BYTES;
+    archiverRunning = pthread_create(&archiverThread, NULL, archiverMain, NULL) == 0;
+    pthread_mutex_unlock(&archiverLock);
+
+    if (!listening) {
+        listening = true;
+        clockOnDateChange(onDateChange, NULL);
+        atexit(logArchiveStop);
+    }
+    if (!archiverRunning) {
+        writeErrorLog("Failed to start the log archiver; logs will not be rotated");
+    }
+    return archiverRunning;
+}
+
+void logArchiveStop(void) {
+    pthread_mutex_lock(&archiverLock);
+    if (!started) {
+        pthread_mutex_unlock(&archiverLock);
+        return;
+    }
+    started = false;
+    stopRequested = true;
+    pthread_cond_signal(&archiverWake);
+    pthread_mutex_unlock(&archiverLock);
+
+    if (archiverRunning) {
+        pthread_join(archiverThread, NULL);
+        archiverRunning = false;
+    }
+}
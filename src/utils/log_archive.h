@@ -0,0 +1,178 @@
+#ifndef LOG_ARCHIVE_H
+#define LOG_ARCHIVE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Log rotation and archived segments
+ *
+ * The archiver thread moves a log into the archive directory once it
+ * reaches log_rotate_max_bytes (default 8 MB, 0 for daily rotation only)
+ * or once its first line (or record, for the binary transactions log) is
+ * from an earlier day. The moved file is a segment named
+ * <log>-<date>-<id>.log; ids count up per log, so a higher id holds later
+ * lines. After LOG_ARCHIVE_GRACE_SECONDS without writes a
+ * segment is compressed in LOG_ARCHIVE_BLOCK_SIZE blocks, any of which
+ * can be read without the others, and the plain file is removed.
+ *
+ * The manifest (a pipe-delimited table next to the segments) records each
+ * segment's log, id, first and last line timestamps, size, the identity
+ * the file had as the live log, and where it is now, so readers open only
+ * the segments covering the time they need. Processes sharing the logs
+ * rotate under a lock file and notice rotations by the live file's
+ * identity changing.
+ */
+
+// Seconds a rotated segment must go unwritten before it is compressed
+#define LOG_ARCHIVE_GRACE_SECONDS 5
+
+// Uncompressed bytes per compressed block
+#define LOG_ARCHIVE_BLOCK_SIZE (64 * 1024)
+
+// Segment id standing for the live log file; archived ids start at 1
+#define LOG_ACTIVE_SEGMENT UINT32_MAX
+
+typedef enum {
+    LOG_ARCHIVE_TRANSACTIONS,
+    LOG_ARCHIVE_WITHDRAWALS,
+    LOG_ARCHIVE_AUDIT,
+    LOG_ARCHIVE_ERROR,
+    LOG_ARCHIVE_LOG_COUNT
+} LogArchiveLog;
+
+// One archived segment as listed in the manifest
+typedef struct {
+    uint32_t id;
+    char firstTime[20];           // "YYYY-MM-DD HH:MM:SS" of its first and last
+    char lastTime[20];            // timestamped lines; empty if it has none
+    uint64_t size;                // Uncompressed bytes
+    uint64_t device;              // Identity of the file while it was the live log
+    uint64_t inode;
+    bool compressed;
+    char path[160];
+} LogSegment;
+
+typedef struct LogSegmentReader LogSegmentReader;
+
+/**
+ * Called for each complete line of a segment
+ *
+ * @param line The line, without its newline; not NUL-terminated
+ * @param length Its length
+ * @param offset Where the line starts in the uncompressed segment
+ * @param context As passed to logSegmentScan
+ * @return false to stop the scan
+ */
+typedef bool (*LogSegmentLineFn)(const char* line, size_t length, uint64_t offset, void* context);
+
+/**
+ * List a log's segments with lines in a time range, oldest first
+ *
+ * @param log The log
+ * @param from Earliest time wanted, "YYYY-MM-DD[ HH:MM:SS]", or NULL for no bound
+ * @param to Latest time wanted, likewise; a date covers the whole day
+ * @param count Receives the number of segments
+ * @return The segments, freed by the caller; NULL if there are none
+ */
+LogSegment* logArchiveList(LogArchiveLog log, const char* from, const char* to, int* count);
+
+/**
+ * Find the segment a log file became when it was rotated
+ *
+ * @param log The log
+ * @param device Device of the file while it was the live log
+ * @param inode Inode of the file while it was the live log
+ * @param segment Receives the segment
+ * @return false if the file is not in the archive; the newest segment if
+ *         the inode was reused
+ */
+bool logArchiveFindFile(LogArchiveLog log, uint64_t device, uint64_t inode, LogSegment* segment);
+
+/**
+ * Find a segment by id
+ *
+ * @param log The log
+ * @param id The segment id
+ * @param segment Receives the segment
+ * @return false if there is no such segment
+ */
+bool logArchiveFind(LogArchiveLog log, uint32_t id, LogSegment* segment);
+
+/**
+ * Open a segment for reading at arbitrary offsets
+ *
+ * @param segment The segment
+ * @return The reader, or NULL if the segment could not be opened
+ */
+LogSegmentReader* logSegmentOpen(const LogSegment* segment);
+
+/**
+ * Read the line starting at an offset of the uncompressed segment
+ *
+ * @param reader An open reader
+ * @param offset Where the line starts
+ * @param line Receives the line, NUL-terminated and without its newline
+ * @param size Room in `line`; longer lines are truncated
+ * @return false if the offset is past the end or the data is damaged
+ */
+bool logSegmentReadLine(LogSegmentReader* reader, uint64_t offset, char* line, size_t size);
+
+/**
+ * Read bytes at an offset of the uncompressed segment
+ *
+ * @param reader An open reader
+ * @param offset Where to start
+ * @param buffer Receives the bytes
+ * @param size Bytes wanted
+ * @return Bytes read; fewer than `size` at the end of the segment or if
+ *         the data is damaged
+ */
+size_t logSegmentRead(LogSegmentReader* reader, uint64_t offset, void* buffer, size_t size);
+
+/**
+ * Uncompressed size of an open segment
+ */
+uint64_t logSegmentSize(const LogSegmentReader* reader);
+
+void logSegmentClose(LogSegmentReader* reader);
+
+/**
+ * Call `fn` for each complete line of a segment from an offset on
+ *
+ * @param segment The segment
+ * @param start Offset of the first line to report
+ * @param fn The callback
+ * @param context Passed to `fn`
+ * @return false if the segment could not be read to the end
+ */
+bool logSegmentScan(const LogSegment* segment, uint64_t start, LogSegmentLineFn fn, void* context);
+
+/**
+ * Rotate a log now, however large it is
+ *
+ * @param log The log
+ * @return true if it was rotated or is empty
+ */
+bool logArchiveRotate(LogArchiveLog log);
+
+/**
+ * Rotate the logs that are due and compress segments past their grace period
+ * Run by the archiver thread once a second.
+ */
+void logArchiveCheck(void);
+
+/**
+ * Start the archiver thread and stop it at exit
+ *
+ * @return true if the thread is running
+ */
+bool logArchiveStart(void);
+
+/**
+ * Stop the archiver thread
+ */
+void logArchiveStop(void);
+
+#endif // LOG_ARCHIVE_H
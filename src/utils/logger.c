@@ -1,33 +1,581 @@
 #include "logger.h"
 #include "../common/paths.h"
-#include "../transaction/transaction_types.h"
+#include "../config/config_manager.h"
+#include "clock_utils.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
 #include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <sys/uio.h>
+
+// Configuration key selecting what a full queue does
+#define CONFIG_LOG_OVERFLOW_POLICY "log_overflow_policy"
+#define DEFAULT_LOG_OVERFLOW_POLICY "block"
+
+// Longest line a logging call writes
+#define LOG_LINE_MAX 1024
+
+// Text bytes one cell holds; a longer line takes consecutive cells
+#define LOG_CELL_TEXT 240
+
+#define LOG_QUEUE_MASK (LOG_QUEUE_CELLS - 1)
+
+// One slot of the queue. `sequence` equals the position the cell is free
+// for, position + 1 once the line written at that position is complete,
+// and position + LOG_QUEUE_CELLS when the flusher hands it back.
+typedef struct {
+    atomic_size_t sequence;
+    uint16_t stream;            // LogStream
+    uint8_t testing;            // 1 to write to the test-mode file
+    uint8_t cells;              // Cells of the line, in its first cell
+    uint32_t length;            // Text bytes in this cell
+    char text[LOG_CELL_TEXT];
+} LogCell;
+
+// Header of a line in the spill file; the text follows
+typedef struct {
+    uint16_t stream;
+    uint16_t testing;
+    uint32_t length;
+} SpillRecordHeader;
+
+// A piece of a line located during a flush
+typedef struct {
+    int stream;
+    int testing;
+    const char* text;
+    size_t length;
+} PendingLine;
+
+// Producers claim positions with a compare-and-swap on enqueuePos; the
+// consumer, whoever holds flushLock, advances dequeuePos
+static LogCell queue[LOG_QUEUE_CELLS];
+static struct {
+    atomic_size_t enqueuePos;
+    char pad[64 - sizeof(atomic_size_t)];
+} producers;
+static atomic_size_t dequeuePos = 0;
+static pthread_once_t queueOnce = PTHREAD_ONCE_INIT;
+
+static atomic_int overflowPolicy = LOG_OVERFLOW_BLOCK;
+static atomic_ulong droppedInfoLines = 0;
+
+// One flush at a time, by the flusher thread or a caller that needs it now.
+// Also guards the open descriptors and the flush buffer.
+static pthread_mutex_t flushLock = PTHREAD_MUTEX_INITIALIZER;
+static int streamFds[2][LOG_STREAM_COUNT] = { { -1, -1, -1 }, { -1, -1, -1 } };
+static PendingLine pendingLines[LOG_QUEUE_CELLS];
+
+// Spill file, guarded by spillLock; flock keeps other processes out
+static pthread_mutex_t spillLock = PTHREAD_MUTEX_INITIALIZER;
+static int spillFd = -1;
+static bool spillChecked = false;
+static atomic_bool spillPending = false;    // Spilled lines wait to be written
+
+// Flusher thread state, guarded by flusherLock
+static pthread_mutex_t flusherLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t flusherWake = PTHREAD_COND_INITIALIZER;
+static pthread_t flusher;
+static bool flusherStarted = false;
+static atomic_bool flusherRunning = false;
+static bool flusherStopping = false;
+
+static const char* streamPath(int stream, int testing) {
+    switch (stream) {
+        case LOG_STREAM_ERROR:
+            return testing ? TEST_ERROR_LOG_FILE : PROD_ERROR_LOG_FILE;
+        case LOG_STREAM_AUDIT:
+            return testing ? TEST_AUDIT_LOG_FILE : PROD_AUDIT_LOG_FILE;
+        default:
+            return testing ? TEST_WITHDRAWALS_LOG_FILE : PROD_WITHDRAWALS_LOG_FILE;
+    }
+}
+
+// The stream's descriptor, reopened if the file was deleted; needs flushLock
+static int streamFdLocked(int stream, int testing) {
+    int* fd = &streamFds[testing][stream];
+    struct stat st;
+    struct stat current;
+    // Reopen once the file has been rotated away or deleted
+    if (*fd >= 0 && (fstat(*fd, &st) != 0 || stat(streamPath(stream, testing), &current) != 0 ||
+                     st.st_ino != current.st_ino || st.st_dev != current.st_dev)) {
+        close(*fd);
+        *fd = -1;
+    }
+    if (*fd < 0) {
+        *fd = open(streamPath(stream, testing), O_WRONLY | O_APPEND | O_CREAT, 0644);
+    }
+    return *fd;
+}
+
+static bool writeAllVectors(int fd, struct iovec* iov, int count) {
+    while (count > 0) {
+        ssize_t written = writev(fd, iov, count);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        while (count > 0 && (size_t)written >= iov->iov_len) {
+            written -= (ssize_t)iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char*)iov->iov_base + written;
+            iov->iov_len -= (size_t)written;
+        }
+    }
+    return true;
+}
+
+// Write the lines of one file in order; needs flushLock
+static void writeStreamLocked(int stream, int testing, size_t lineCount) {
+    struct iovec iov[64];
+    int used = 0;
+    int fd = -1;
+    bool ok = true;
+
+    for (size_t i = 0; i <= lineCount; i++) {
+        bool last = i == lineCount;
+        if (!last && (pendingLines[i].stream != stream || pendingLines[i].testing != testing)) {
+            continue;
+        }
+        if (used == (int)(sizeof(iov) / sizeof(iov[0])) || (last && used > 0)) {
+            if (fd < 0) {
+                fd = streamFdLocked(stream, testing);
+            }
+            ok = fd >= 0 && writeAllVectors(fd, iov, used) && ok;
+            used = 0;
+        }
+        if (!last) {
+            iov[used].iov_base = (void*)pendingLines[i].text;
+            iov[used].iov_len = pendingLines[i].length;
+            used++;
+        }
+    }
+
+    if (!ok) {
+        fprintf(stderr, "Failed to write to %s\n", streamPath(stream, testing));
+    }
+}
+
+static void writePendingLocked(size_t lineCount) {
+    for (int testing = 0; testing < 2; testing++) {
+        for (int stream = 0; stream < LOG_STREAM_COUNT; stream++) {
+            writeStreamLocked(stream, testing, lineCount);
+        }
+    }
+}
+
+static void initQueue(void) {
+    for (size_t i = 0; i < LOG_QUEUE_CELLS; i++) {
+        atomic_store_explicit(&queue[i].sequence, i, memory_order_relaxed);
+    }
+    atomic_store(&producers.enqueuePos, 0);
+    atomic_store(&dequeuePos, 0);
+}
+
+// Claim and fill the cells of a line; false if the queue has no room for it
+static bool tryEnqueue(LogStream stream, int testing, const char* text, size_t length) {
+    size_t cells = (length + LOG_CELL_TEXT - 1) / LOG_CELL_TEXT;
+    size_t pos = atomic_load_explicit(&producers.enqueuePos, memory_order_relaxed);
+
+    for (;;) {
+        bool claimed = false;
+        size_t i = 0;
+        for (; i < cells; i++) {
+            size_t sequence = atomic_load_explicit(&queue[(pos + i) & LOG_QUEUE_MASK].sequence,
+                                                   memory_order_acquire);
+            intptr_t diff = (intptr_t)sequence - (intptr_t)(pos + i);
+            if (diff < 0) {
+                return false;       // Still holds a line from the previous lap
+            }
+            if (diff > 0) {
+                break;              // Another producer took the position
+            }
+        }
+        if (i == cells) {
+            claimed = atomic_compare_exchange_weak_explicit(&producers.enqueuePos, &pos, pos + cells,
+                                                            memory_order_relaxed, memory_order_relaxed);
+        } else {
+            pos = atomic_load_explicit(&producers.enqueuePos, memory_order_relaxed);
+        }
+        if (claimed) {
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < cells; i++) {
+        LogCell* cell = &queue[(pos + i) & LOG_QUEUE_MASK];
+        size_t offset = i * LOG_CELL_TEXT;
+        size_t piece = length - offset < LOG_CELL_TEXT ? length - offset : LOG_CELL_TEXT;
+        cell->stream = (uint16_t)stream;
+        cell->testing = (uint8_t)testing;
+        cell->cells = i == 0 ? (uint8_t)cells : 0;
+        cell->length = (uint32_t)piece;
+        memcpy(cell->text, text + offset, piece);
+        atomic_store_explicit(&cell->sequence, pos + i + 1, memory_order_release);
+    }
+
+    // Wake the flusher early when the queue passes the threshold
+    size_t queued = pos + cells - atomic_load_explicit(&dequeuePos, memory_order_relaxed);
+    if (queued >= LOG_FLUSH_THRESHOLD && queued - cells < LOG_FLUSH_THRESHOLD) {
+        pthread_cond_signal(&flusherWake);
+    }
+    return true;
+}
+
+// The spill file, opened on first use; needs spillLock
+static int spillFdLocked(bool create) {
+    if (spillFd < 0) {
+        spillFd = open(getLogSpillFilePath(), O_RDWR | O_APPEND | (create ? O_CREAT : 0), 0644);
+    }
+    return spillFd;
+}
+
+// Append a line to the spill file; written out by the next flush
+static bool spillLine(LogStream stream, int testing, const char* text, size_t length) {
+    SpillRecordHeader header = { (uint16_t)stream, (uint16_t)testing, (uint32_t)length };
+    struct iovec iov[2] = { { &header, sizeof(header) }, { (void*)text, length } };
+
+    pthread_mutex_lock(&spillLock);
+    int fd = spillFdLocked(true);
+    bool ok = fd >= 0 && flock(fd, LOCK_EX) == 0;
+    if (ok) {
+        ok = writeAllVectors(fd, iov, 2);
+        flock(fd, LOCK_UN);
+    }
+    if (ok) {
+        atomic_store(&spillPending, true);
+    }
+    pthread_mutex_unlock(&spillLock);
+    return ok;
+}
+
+// Take the spill file's contents and empty it; the caller frees the buffer
+static char* takeSpilledLines(size_t* size) {
+    char* data = NULL;
+    bool keep = false;
+    *size = 0;
+
+    pthread_mutex_lock(&spillLock);
+    int fd = spillFdLocked(false);
+    struct stat st;
+    if (fd >= 0 && flock(fd, LOCK_EX) == 0) {
+        if (fstat(fd, &st) == 0 && st.st_size > 0 && (data = (char*)malloc((size_t)st.st_size)) != NULL) {
+            ssize_t got = pread(fd, data, (size_t)st.st_size, 0);
+            *size = got > 0 ? (size_t)got : 0;
+            if (ftruncate(fd, 0) != 0) {
+                // Left for the next flush rather than written twice
+                *size = 0;
+                keep = true;
+            }
+        }
+        flock(fd, LOCK_UN);
+    }
+    atomic_store(&spillPending, keep);
+    pthread_mutex_unlock(&spillLock);
+    return data;
+}
+
+// Write the spilled lines after the queued ones; needs flushLock
+static void writeSpilledLocked(void) {
+    size_t size;
+    char* data = takeSpilledLines(&size);
+    size_t lineCount = 0;
+
+    // A record cut short by a crash ends the file and is dropped
+    for (size_t offset = 0; offset + sizeof(SpillRecordHeader) <= size;) {
+        SpillRecordHeader header;
+        memcpy(&header, data + offset, sizeof(header));
+        offset += sizeof(header);
+        if (header.length > size - offset || header.stream >= LOG_STREAM_COUNT) {
+            break;
+        }
+        pendingLines[lineCount].stream = header.stream;
+        pendingLines[lineCount].testing = header.testing ? 1 : 0;
+        pendingLines[lineCount].text = data + offset;
+        pendingLines[lineCount].length = header.length;
+        offset += header.length;
+        if (++lineCount == LOG_QUEUE_CELLS) {
+            writePendingLocked(lineCount);
+            lineCount = 0;
+        }
+    }
+    writePendingLocked(lineCount);
+    free(data);
+}
+
+// Record the INFO lines a full queue dropped; needs flushLock
+static void writeDroppedCountLocked(void) {
+    unsigned long dropped = atomic_exchange(&droppedInfoLines, 0);
+    if (dropped == 0) {
+        return;
+    }
+
+    char timestamp[CLOCK_TIMESTAMP_SIZE];
+    clockTimestamp(timestamp, sizeof(timestamp));
+    char line[128];
+    size_t length = (size_t)snprintf(line, sizeof(line), "[%s] [ERROR] Log queue full: %lu info lines dropped\n",
+                                     timestamp, dropped);
+
+    int testing = isTestingMode() ? 1 : 0;
+    int fd = streamFdLocked(LOG_STREAM_ERROR, testing);
+    struct iovec iov = { line, length };
+    if (fd < 0 || !writeAllVectors(fd, &iov, 1)) {
+        fprintf(stderr, "%s", line);
+    }
+}
+
+// Write every complete line in the queue, then any spilled ones; needs flushLock
+static void flushLocked(bool sync) {
+    pthread_once(&queueOnce, initQueue);
+
+    size_t start = atomic_load_explicit(&dequeuePos, memory_order_relaxed);
+    size_t pos = start;
+    size_t lineCount = 0;
+
+    // Stop at the first line still being written, so lines keep their order
+    while (pos - start < LOG_QUEUE_CELLS) {
+        LogCell* first = &queue[pos & LOG_QUEUE_MASK];
+        if (atomic_load_explicit(&first->sequence, memory_order_acquire) != pos + 1) {
+            break;
+        }
+        size_t cells = first->cells;
+        size_t ready = 1;
+        while (ready < cells &&
+               atomic_load_explicit(&queue[(pos + ready) & LOG_QUEUE_MASK].sequence,
+                                    memory_order_acquire) == pos + ready + 1) {
+            ready++;
+        }
+        if (ready < cells) {
+            break;
+        }
+
+        for (size_t i = 0; i < cells; i++) {
+            LogCell* cell = &queue[(pos + i) & LOG_QUEUE_MASK];
+            PendingLine* line = &pendingLines[lineCount++];
+            line->stream = cell->stream;
+            line->testing = cell->testing;
+            line->text = cell->text;
+            line->length = cell->length;
+        }
+        pos += cells;
+    }
+
+    writePendingLocked(lineCount);
+
+    // Hand the cells back to the producers
+    for (size_t i = start; i < pos; i++) {
+        atomic_store_explicit(&queue[i & LOG_QUEUE_MASK].sequence, i + LOG_QUEUE_CELLS, memory_order_release);
+    }
+    atomic_store_explicit(&dequeuePos, pos, memory_order_relaxed);
+
+    // Lines left by a process that stopped before writing its spill file are picked up once
+    if (!spillChecked) {
+        spillChecked = true;
+        atomic_store(&spillPending, true);
+    }
+    if (atomic_load(&spillPending)) {
+        writeSpilledLocked();
+    }
+    writeDroppedCountLocked();
+
+    if (sync) {
+        for (int testing = 0; testing < 2; testing++) {
+            for (int stream = 0; stream < LOG_STREAM_COUNT; stream++) {
+                if (streamFds[testing][stream] >= 0) {
+                    fdatasync(streamFds[testing][stream]);
+                }
+            }
+        }
+    }
+}
+
+static void flushNow(bool sync) {
+    pthread_mutex_lock(&flushLock);
+    flushLocked(sync);
+    pthread_mutex_unlock(&flushLock);
+}
+
+static void* flusherMain(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&flusherLock);
+    while (!flusherStopping) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += LOG_FLUSH_INTERVAL_MS * 1000000L;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+        pthread_cond_timedwait(&flusherWake, &flusherLock, &deadline);
+
+        pthread_mutex_unlock(&flusherLock);
+        flushNow(false);
+        pthread_mutex_lock(&flusherLock);
+    }
+    pthread_mutex_unlock(&flusherLock);
+    return NULL;
+}
+
+// Write what is left at exit; lines logged later are written by their caller
+static void stopFlusherAtExit(void) {
+    pthread_mutex_lock(&flusherLock);
+    bool running = atomic_load(&flusherRunning);
+    flusherStopping = true;
+    atomic_store(&flusherRunning, false);
+    pthread_cond_signal(&flusherWake);
+    pthread_mutex_unlock(&flusherLock);
+
+    if (running) {
+        pthread_join(flusher, NULL);
+    }
+    flushNow(true);
+}
+
+// A forked child keeps only its own thread and starts with an empty queue;
+// the parent writes the lines it had queued
+static void resetInChild(void) {
+    pthread_mutex_init(&flushLock, NULL);
+    pthread_mutex_init(&spillLock, NULL);
+    pthread_mutex_init(&flusherLock, NULL);
+    pthread_cond_init(&flusherWake, NULL);
+
+    initQueue();
+    atomic_store(&droppedInfoLines, 0);
+
+    // The inherited descriptor shares the parent's flock
+    if (spillFd >= 0) {
+        close(spillFd);
+        spillFd = -1;
+    }
+    atomic_store(&spillPending, false);
+    flusherStarted = false;
+    atomic_store(&flusherRunning, false);
+    flusherStopping = false;
+}
+
+static void initLogger(void) {
+    pthread_once(&queueOnce, initQueue);
+    pthread_atfork(NULL, NULL, resetInChild);
+    atexit(stopFlusherAtExit);
+}
+
+static void ensureFlusher(void) {
+    static pthread_once_t loggerOnce = PTHREAD_ONCE_INIT;
+    pthread_once(&loggerOnce, initLogger);
+
+    pthread_mutex_lock(&flusherLock);
+    if (!flusherStarted && !flusherStopping) {
+        // Started once per process; if it cannot start, callers write their own lines
+        flusherStarted = true;
+        if (pthread_create(&flusher, NULL, flusherMain, NULL) == 0) {
+            atomic_store(&flusherRunning, true);
+        }
+    }
+    pthread_mutex_unlock(&flusherLock);
+}
+
+// Queue a complete line; `info` lines may be dropped when the queue is full
+static void queueLine(LogStream stream, const char* text, size_t length, bool info) {
+    if (!atomic_load(&flusherRunning)) {
+        ensureFlusher();
+    }
+    int testing = isTestingMode() ? 1 : 0;
+    LogOverflowPolicy policy = (LogOverflowPolicy)atomic_load_explicit(&overflowPolicy, memory_order_relaxed);
+
+    if (length > LOG_LINE_MAX) {
+        if (!logWriteDirect(stream, text)) {
+            fprintf(stderr, "Failed to write log line: %s", text);
+        }
+        return;
+    }
+
+    // Once lines are spilled, later ones follow them until the flusher catches up
+    bool queued = !(policy == LOG_OVERFLOW_SPILL && atomic_load(&spillPending)) &&
+                  tryEnqueue(stream, testing, text, length);
+    while (!queued) {
+        if (policy == LOG_OVERFLOW_DROP_INFO && info) {
+            atomic_fetch_add(&droppedInfoLines, 1);
+            return;
+        }
+        if (policy == LOG_OVERFLOW_SPILL && spillLine(stream, testing, text, length)) {
+            return;
+        }
+        // Block: the caller empties the queue itself
+        flushNow(false);
+        queued = tryEnqueue(stream, testing, text, length);
+    }
+
+    if (!atomic_load(&flusherRunning)) {
+        flushNow(false);
+    }
+}
+
+bool logWriteDirect(LogStream stream, const char* line) {
+    size_t length = strlen(line);
+    int testing = isTestingMode() ? 1 : 0;
+
+    pthread_mutex_lock(&flushLock);
+    int fd = streamFdLocked(stream, testing);
+    struct iovec iov = { (void*)line, length };
+    bool ok = fd >= 0 && writeAllVectors(fd, &iov, 1);
+    pthread_mutex_unlock(&flushLock);
+    return ok;
+}
+
+void logSync(void) {
+    flushNow(true);
+}
+
+void logSetOverflowPolicy(LogOverflowPolicy policy) {
+    atomic_store(&overflowPolicy, (int)policy);
+}
+
+bool logSelectOverflowPolicy(const char* name) {
+    static const char* const names[] = { "block", "drop_info", "spill" };
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (name != NULL && strcmp(names[i], name) == 0) {
+            logSetOverflowPolicy((LogOverflowPolicy)i);
+            return true;
+        }
+    }
+
+    char errorMsg[100];
+    snprintf(errorMsg, sizeof(errorMsg), "Unknown log overflow policy '%s'", name != NULL ? name : "");
+    writeErrorLog(errorMsg);
+    return false;
+}
+
+bool logConfigure(void) {
+    return logSelectOverflowPolicy(getConfigValue(CONFIG_LOG_OVERFLOW_POLICY, DEFAULT_LOG_OVERFLOW_POLICY));
+}
 
 // Enhanced error logging with additional context
 void writeExtendedErrorLog(const char *file, int line, const char *function, const char *message) {
-    time_t now = time(NULL);
-    struct tm *tm_now = localtime(&now);
     char timestamp[30];
-    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", tm_now);
-    
+    clockTimestamp(timestamp, sizeof(timestamp));
+
     // Format for detailed error logs
-    char logEntry[512];
-    sprintf(logEntry, "[%s] [ERROR] [%s:%d in %s] %s\n", 
-            timestamp, file, line, function, message);
-    
-    // Write to error log file
-    const char* logPath = isTestingMode() ? TEST_ERROR_LOG_FILE : PROD_ERROR_LOG_FILE;
-    FILE *logFile = fopen(logPath, "a");
-    
-    if (logFile != NULL) {
-        fprintf(logFile, "%s", logEntry);
-        fclose(logFile);
-    } else {
-        // Fall back to stderr if log file cannot be opened
-        fprintf(stderr, "Failed to write to error log. Error was: %s\n", logEntry);
+    char logEntry[LOG_LINE_MAX];
+    int length = snprintf(logEntry, sizeof(logEntry), "[%s] [ERROR] [%s:%d in %s] %s\n",
+                          timestamp, file, line, function, message);
+    if (length >= (int)sizeof(logEntry)) {
+        logEntry[sizeof(logEntry) - 2] = '\n';
+        length = (int)sizeof(logEntry) - 1;
+    }
+
+    if (length > 0) {
+        queueLine(LOG_STREAM_ERROR, logEntry, (size_t)length, false);
     }
 }
 
@@ -41,95 +589,42 @@ void writeErrorLog(const char *message) {
 
 // Write info log messages
 void writeInfoLog(const char *message) {
-    time_t now = time(NULL);
-    struct tm *tm_now = localtime(&now);
     char timestamp[30];
-    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", tm_now);
-    
-    // Format for info logs
-    char logEntry[512];
-    sprintf(logEntry, "[%s] [INFO] %s\n", timestamp, message);
-    
-    // Write to the same log file as errors but with INFO tag
-    const char* logPath = isTestingMode() ? TEST_ERROR_LOG_FILE : PROD_ERROR_LOG_FILE;
-    FILE *logFile = fopen(logPath, "a");
-    
-    if (logFile != NULL) {
-        fprintf(logFile, "%s", logEntry);
-        fclose(logFile);
+    clockTimestamp(timestamp, sizeof(timestamp));
+
+    // Written to the same log file as errors but with INFO tag
+    char logEntry[LOG_LINE_MAX];
+    int length = snprintf(logEntry, sizeof(logEntry), "[%s] [INFO] %s\n", timestamp, message);
+    if (length >= (int)sizeof(logEntry)) {
+        logEntry[sizeof(logEntry) - 2] = '\n';
+        length = (int)sizeof(logEntry) - 1;
+    }
+
+    if (length > 0) {
+        queueLine(LOG_STREAM_ERROR, logEntry, (size_t)length, true);
     }
 }
 
 // Write audit log entries
 void writeAuditLog(const char *category, const char *message) {
-    time_t now = time(NULL);
-    struct tm *tm_now = localtime(&now);
     char timestamp[30];
-    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", tm_now);
-    
+    clockTimestamp(timestamp, sizeof(timestamp));
+
     // Format for audit logs
-    char logEntry[512];
-    sprintf(logEntry, "[%s] [%s] %s\n", timestamp, category, message);
-    
-    const char* auditPath = isTestingMode() ? TEST_AUDIT_LOG_FILE : PROD_AUDIT_LOG_FILE;
-    FILE *auditFile = fopen(auditPath, "a");
-    
-    if (auditFile != NULL) {
-        fprintf(auditFile, "%s", logEntry);
-        fclose(auditFile);
-    } else {
-        // If audit log cannot be opened, fall back to error log
-        writeErrorLog("Failed to write to audit log");
-    }
-}
-
-// Log transaction with success/failure status
-void writeTransactionLog(int cardNumber, const char* transactionType, float amount, int success) {
-    time_t now = time(NULL);
-    struct tm *tm_now = localtime(&now);
-    char timestamp[30];
-    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", tm_now);
-    
-    // Format for transaction logs
-    char logEntry[512];
-    sprintf(logEntry, "[%s] Card: %d, Type: %s, Amount: $%.2f, Status: %s\n", 
-            timestamp, cardNumber, transactionType, amount, success ? "Success" : "Failed");
-    
-    const char* transactionPath = isTestingMode() ? 
-        TEST_TRANSACTIONS_LOG_FILE : PROD_TRANSACTIONS_LOG_FILE;
-    FILE *transactionFile = fopen(transactionPath, "a");
-    
-    if (transactionFile != NULL) {
-        fprintf(transactionFile, "%s", logEntry);
-        fclose(transactionFile);
-    } else {
-        // If transaction log cannot be opened, fall back to error log
-        writeErrorLog("Failed to write to transaction log");
-    }
-}
-
-// Log withdrawal for daily limit tracking
-void logWithdrawal(int cardNumber, float amount) {
-    time_t now = time(NULL);
-    struct tm *tm_now = localtime(&now);
-    char timestamp[30];
-    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", tm_now);
-    char dateOnly[11];
-    strftime(dateOnly, sizeof(dateOnly), "%Y-%m-%d", tm_now);
-    
-    // Format for withdrawal logs
-    char logEntry[256];
-    sprintf(logEntry, "%d,%s,%.2f,%s\n", cardNumber, dateOnly, amount, timestamp);
-    
-    const char* withdrawalPath = isTestingMode() ? 
-        "testing/test_withdrawals.log" : "logs/withdrawals.log";
-    FILE *withdrawalFile = fopen(withdrawalPath, "a");
-    
-    if (withdrawalFile != NULL) {
-        fprintf(withdrawalFile, "%s", logEntry);
-        fclose(withdrawalFile);
-    } else {
-        // If withdrawal log cannot be opened, fall back to error log
-        writeErrorLog("Failed to write to withdrawal log");
-    }
-}
\ No newline at end of file
+    char logEntry[LOG_LINE_MAX];
+    int length = snprintf(logEntry, sizeof(logEntry), "[%s] [%s] %s\n", timestamp, category, message);
+    if (length >= (int)sizeof(logEntry)) {
+        logEntry[sizeof(logEntry) - 2] = '\n';
+        length = (int)sizeof(logEntry) - 1;
+    }
+
+    if (length > 0) {
+        queueLine(LOG_STREAM_AUDIT, logEntry, (size_t)length, false);
+    }
+}
+
+// Write an audit entry and wait until it is on disk
+void writeAuditLogSync(const char *category, const char *message) {
+    writeAuditLog(category, message);
+    logSync();
+}
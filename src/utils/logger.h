@@ -1,6 +1,45 @@
 #ifndef LOGGER_H
 #define LOGGER_H
 
+#include <stdbool.h>
+
+/**
+ * Buffered log streams
+ *
+ * Each log file is opened once and kept open. A logging call formats its
+ * line into a bounded lock-free queue shared by all threads and returns;
+ * a flusher thread, the only consumer, writes the queued lines with one
+ * writev per file every LOG_FLUSH_INTERVAL_MS, or sooner once
+ * LOG_FLUSH_THRESHOLD cells are queued. Lines are written in the order
+ * they entered the queue. What a call does when the queue is full is set
+ * by the log_overflow_policy configuration key. Queued lines are written
+ * at exit; a crash can lose up to one interval of them, so records that
+ * must survive it use writeAuditLogSync or logSync.
+ */
+
+// Longest time a logged line waits before it is written
+#define LOG_FLUSH_INTERVAL_MS 100
+
+// Cells in the log queue, a power of two; a cell holds 240 bytes of a line
+#define LOG_QUEUE_CELLS 4096
+
+// Queued cells that wake the flusher early
+#define LOG_FLUSH_THRESHOLD (LOG_QUEUE_CELLS / 4)
+
+// What a logging call does when the queue is full
+typedef enum {
+    LOG_OVERFLOW_BLOCK,           // Write queued lines itself until its line fits (default)
+    LOG_OVERFLOW_DROP_INFO,       // Drop info lines and count them; block for the rest
+    LOG_OVERFLOW_SPILL            // Append the line to the spill file, written by the next flush
+} LogOverflowPolicy;
+
+typedef enum {
+    LOG_STREAM_ERROR,             // Errors and info messages
+    LOG_STREAM_AUDIT,
+    LOG_STREAM_WITHDRAWALS,
+    LOG_STREAM_COUNT
+} LogStream;
+
 /**
  * Write a message to the error log
  * 
@@ -16,6 +55,15 @@ void writeErrorLog(const char *message);
  */
 void writeAuditLog(const char *category, const char *message);
 
+/**
+ * Write an audit entry and return once it is on disk
+ * For security-relevant events such as card blocks and PIN changes.
+ *
+ * @param category The category of the audit entry
+ * @param message The message to log
+ */
+void writeAuditLogSync(const char *category, const char *message);
+
 /**
  * Write an informational message to the log
  * 
@@ -24,14 +72,43 @@ void writeAuditLog(const char *category, const char *message);
 void writeInfoLog(const char *message);
 
 /**
- * Write a transaction to the transaction log
- * 
- * @param cardNumber The card number associated with the transaction
- * @param transactionType The type of transaction (e.g., "Deposit", "Withdrawal")
- * @param amount The transaction amount
- * @param success Whether the transaction was successful (1) or failed (0)
+ * Append a line to a stream's file immediately, on the caller's thread
+ *
+ * For logs that are read back right after they are written, such as
+ * withdrawals.log. Uses the stream's open descriptor.
+ *
+ * @param stream The log to append to
+ * @param line The complete line, including its newline
+ * @return true if the whole line was written
+ */
+bool logWriteDirect(LogStream stream, const char *line);
+
+/**
+ * Write every line queued so far and sync the log files to disk
+ */
+void logSync(void);
+
+/**
+ * Set what logging calls do when the queue is full
+ *
+ * @param policy The overflow policy
+ */
+void logSetOverflowPolicy(LogOverflowPolicy policy);
+
+/**
+ * Set the overflow policy by name: "block", "drop_info" or "spill"
+ *
+ * @param name The policy name
+ * @return true if the name was recognised
+ */
+bool logSelectOverflowPolicy(const char *name);
+
+/**
+ * Apply the log_overflow_policy configuration key
+ *
+ * @return true if the configured policy was recognised
  */
-void writeTransactionLog(int cardNumber, const char *transactionType, float amount, int success);
+bool logConfigure(void);
 
 /**
  * Log a withdrawal for daily limit tracking
@@ -0,0 +1,170 @@
+#include "lz_block.h"
+#include <stdint.h>
+#include <string.h>
+
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 65535
+#define LZ_HASH_BITS 13
+
+// Matches end this many bytes before the end of the block, which is always literals
+#define LZ_LAST_LITERALS 5
+
+static uint32_t read32(const uint8_t* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint32_t hash4(uint32_t value) {
+    return (value * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+// Write the bytes of a length beyond the 15 held in the token
+static uint8_t* writeLength(uint8_t* out, const uint8_t* end, size_t length) {
+    while (length >= 255) {
+        if (out == end) {
+            return NULL;
+        }
+        *out++ = 255;
+        length -= 255;
+    }
+    if (out == end) {
+        return NULL;
+    }
+    *out++ = (uint8_t)length;
+    return out;
+}
+
+// Append a sequence; `matchLength` is 0 for the final, literals-only one
+static uint8_t* writeSequence(uint8_t* out, const uint8_t* end, const uint8_t* literals, size_t literalCount,
+                              size_t offset, size_t matchLength) {
+    if (out == end) {
+        return NULL;
+    }
+    size_t matchCode = matchLength > 0 ? matchLength - LZ_MIN_MATCH : 0;
+    uint8_t* token = out++;
+    *token = (uint8_t)(((literalCount < 15 ? literalCount : 15) << 4) | (matchCode < 15 ? matchCode : 15));
+
+    if (literalCount >= 15 && (out = writeLength(out, end, literalCount - 15)) == NULL) {
+        return NULL;
+    }
+    if ((size_t)(end - out) < literalCount) {
+        return NULL;
+    }
+    memcpy(out, literals, literalCount);
+    out += literalCount;
+
+    if (matchLength == 0) {
+        return out;
+    }
+    if (end - out < 2) {
+        return NULL;
+    }
+    *out++ = (uint8_t)(offset & 0xff);
+    *out++ = (uint8_t)(offset >> 8);
+    if (matchCode >= 15) {
+        out = writeLength(out, end, matchCode - 15);
+    }
+    return out;
+}
+
+size_t lzCompressBlock(const void* src, size_t size, void* dst, size_t capacity) {
+    const uint8_t* in = (const uint8_t*)src;
+    uint8_t* out = (uint8_t*)dst;
+    const uint8_t* outEnd = out + capacity;
+    uint32_t table[1 << LZ_HASH_BITS];
+    memset(table, 0, sizeof(table));
+
+    size_t matchLimit = size > LZ_LAST_LITERALS + LZ_MIN_MATCH ? size - LZ_LAST_LITERALS : 0;
+    size_t anchor = 0;
+    size_t pos = 0;
+
+    while (pos + LZ_MIN_MATCH <= matchLimit) {
+        uint32_t value = read32(in + pos);
+        uint32_t hash = hash4(value);
+        size_t candidate = table[hash];
+        table[hash] = (uint32_t)pos;
+
+        if (candidate >= pos || pos - candidate > LZ_MAX_OFFSET || read32(in + candidate) != value) {
+            // Step faster through data that does not compress
+            pos += 1 + ((pos - anchor) >> 6);
+            continue;
+        }
+
+        size_t length = LZ_MIN_MATCH;
+        while (pos + length < matchLimit && in[candidate + length] == in[pos + length]) {
+            length++;
+        }
+        out = writeSequence(out, outEnd, in + anchor, pos - anchor, pos - candidate, length);
+        if (out == NULL) {
+            return 0;
+        }
+        pos += length;
+        anchor = pos;
+    }
+
+    out = writeSequence(out, outEnd, in + anchor, size - anchor, 0, 0);
+    return out != NULL ? (size_t)(out - (uint8_t*)dst) : 0;
+}
+
+// Read the bytes of a length beyond the 15 held in the token
+static const uint8_t* readLength(const uint8_t* in, const uint8_t* end, size_t* length) {
+    uint8_t byte;
+    do {
+        if (in == end) {
+            return NULL;
+        }
+        byte = *in++;
+        *length += byte;
+    } while (byte == 255);
+    return in;
+}
+
+bool lzDecompressBlock(const void* src, size_t size, void* dst, size_t expected) {
+    const uint8_t* in = (const uint8_t*)src;
+    const uint8_t* inEnd = in + size;
+    uint8_t* out = (uint8_t*)dst;
+    uint8_t* outStart = out;
+    uint8_t* outEnd = out + expected;
+
+    while (in < inEnd) {
+        uint8_t token = *in++;
+
+        size_t literalCount = token >> 4;
+        if (literalCount == 15 && (in = readLength(in, inEnd, &literalCount)) == NULL) {
+            return false;
+        }
+        if ((size_t)(inEnd - in) < literalCount || (size_t)(outEnd - out) < literalCount) {
+            return false;
+        }
+        memcpy(out, in, literalCount);
+        in += literalCount;
+        out += literalCount;
+
+        if (in == inEnd) {
+            break;      // The final sequence has no match
+        }
+
+        if (inEnd - in < 2) {
+            return false;
+        }
+        size_t offset = (size_t)in[0] | ((size_t)in[1] << 8);
+        in += 2;
+        size_t matchLength = token & 0x0f;
+        if (matchLength == 15 && (in = readLength(in, inEnd, &matchLength)) == NULL) {
+            return false;
+        }
+        matchLength += LZ_MIN_MATCH;
+        if (offset == 0 || offset > (size_t)(out - outStart) || (size_t)(outEnd - out) < matchLength) {
+            return false;
+        }
+
+        // Byte by byte: the match may overlap the bytes it produces
+        const uint8_t* match = out - offset;
+        for (size_t i = 0; i < matchLength; i++) {
+            out[i] = match[i];
+        }
+        out += matchLength;
+    }
+    return out == outEnd;
+}
@@ -0,0 +1,44 @@
+#ifndef LZ_BLOCK_H
+#define LZ_BLOCK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * LZ77 block compression
+ *
+ * Each block is compressed on its own, so any block of a file can be
+ * decompressed without the others. The format is a list of sequences: a
+ * token byte holding a literal count and a match length (4 bits each, 15
+ * meaning more bytes of 255 follow until a smaller one), the literals, a
+ * 16-bit little-endian match offset and any further match length bytes.
+ * The last sequence has literals only. Matches are found with a hash of
+ * the next four bytes and are at most 65535 bytes back.
+ */
+
+// Largest compressed size of `size` input bytes
+#define LZ_BLOCK_BOUND(size) ((size) + (size) / 255 + 16)
+
+/**
+ * Compress one block
+ *
+ * @param src The input
+ * @param size Input bytes
+ * @param dst Receives the compressed block
+ * @param capacity Room in `dst`; LZ_BLOCK_BOUND(size) always suffices
+ * @return Compressed size, or 0 if it did not fit in `capacity`
+ */
+size_t lzCompressBlock(const void* src, size_t size, void* dst, size_t capacity);
+
+/**
+ * Decompress one block
+ *
+ * @param src The compressed block
+ * @param size Its size
+ * @param dst Receives the original bytes
+ * @param expected The original size
+ * @return true if the block was well formed and decompressed to exactly `expected` bytes
+ */
+bool lzDecompressBlock(const void* src, size_t size, void* dst, size_t expected);
+
+#endif // LZ_BLOCK_H
@@ -1,13 +1,9 @@
 #include "memory_utils.h"
-#include "../common/error_handler.h"
 #include "../utils/logger.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-// Global error message buffer
-static char g_error_message[256] = {0};
-
 // Memory allocation tracking structure
 typedef struct MemoryAlloc {
     void* ptr;               // Pointer to allocated memory
@@ -30,66 +26,37 @@ static size_t current_memory_usage = 0;
 // Thread safety would require mutex/lock here in a multi-threaded environment
 
 // Safe memory allocation with error handling
-void* safe_malloc(size_t size) {
+void* safe_malloc(size_t size, const char* description) {
     void* ptr = malloc(size);
     if (ptr == NULL && size > 0) {
-        snprintf(g_error_message, sizeof(g_error_message), 
-                "Memory allocation failed for %zu bytes", size);
-        writeErrorLog(g_error_message);
+        char msg[256];
+        snprintf(msg, sizeof(msg), "Memory allocation failed for %zu bytes (%s)",
+                 size, description != NULL ? description : "unnamed");
+        writeErrorLog(msg);
     }
     return ptr;
 }
 
-// Set error message
-void error_set(const char* format, ...) {
-    va_list args;
-    va_start(args, format);
-    vsnprintf(g_error_message, sizeof(g_error_message), format, args);
-    va_end(args);
-    
-    // Log the error
-    writeErrorLog(g_error_message);
-}
-
-// Get last error message
-const char* error_get(void) {
-    return g_error_message;
-}
-
 // Safe memory reallocation
-void* safe_realloc(void* ptr, size_t size) {
+void* safe_realloc(void* ptr, size_t size, const char* description) {
     void* new_ptr = realloc(ptr, size);
     if (new_ptr == NULL && size > 0) {
-        snprintf(g_error_message, sizeof(g_error_message), 
-                "Memory reallocation failed for %zu bytes", size);
-        writeErrorLog(g_error_message);
+        char msg[256];
+        snprintf(msg, sizeof(msg), "Memory reallocation failed for %zu bytes (%s)",
+                 size, description != NULL ? description : "unnamed");
+        writeErrorLog(msg);
     }
     return new_ptr;
 }
 
-// Safe string duplication
-char* safe_strdup(const char* str) {
-    if (str == NULL) {
-        snprintf(g_error_message, sizeof(g_error_message), 
-                "Attempted to duplicate NULL string");
-        writeErrorLog(g_error_message);
-        return NULL;
-    }
-    
-    char* new_str = strdup(str);
-    if (new_str == NULL) {
-        snprintf(g_error_message, sizeof(g_error_message), 
-                "String duplication failed for %zu bytes", strlen(str) + 1);
-        writeErrorLog(g_error_message);
-    }
-    return new_str;
-}
-
-// Safe free - checks for NULL pointer
-void safe_free(void* ptr) {
-    if (ptr != NULL) {
-        free(ptr);
+// Safe free - checks for NULL pointer and clears it
+int safe_free(void** ptr) {
+    if (ptr == NULL || *ptr == NULL) {
+        return 0;
     }
+    free(*ptr);
+    *ptr = NULL;
+    return 1;
 }
 
 // Track memory allocation for debugging
@@ -0,0 +1,239 @@
+#include "table_reader.h"
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#if defined(__SSE2__) && defined(__GNUC__)
+#include <emmintrin.h>
+#define TABLE_READER_SSE2 1
+#endif
+
+// Powers of ten for the decimal parser
+static const double powersOfTen[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+    1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18
+};
+
+// Find the next delimiter or newline in [p, end), or end if there is none
+static const char* findBreak(const char* p, const char* end, char delimiter) {
+#ifdef TABLE_READER_SSE2
+    // Compare 16 bytes at a time against both separators
+    const __m128i delimiters = _mm_set1_epi8(delimiter);
+    const __m128i newlines = _mm_set1_epi8('\n');
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)p);
+        __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, delimiters), _mm_cmpeq_epi8(chunk, newlines));
+        int mask = _mm_movemask_epi8(hits);
+        if (mask != 0) {
+            return p + __builtin_ctz((unsigned int)mask);
+        }
+        p += 16;
+    }
+#endif
+    while (p < end && *p != delimiter && *p != '\n') {
+        p++;
+    }
+    return p;
+}
+
+static bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static FieldSlice trimmedSlice(const char* start, const char* end) {
+    while (start < end && isBlank(*start)) {
+        start++;
+    }
+    while (end > start && isBlank(end[-1])) {
+        end--;
+    }
+
+    FieldSlice slice = { start, (size_t)(end - start) };
+    return slice;
+}
+
+bool tableReaderOpen(TableReader* reader, const char* filePath, char delimiter) {
+    memset(reader, 0, sizeof(*reader));
+    reader->delimiter = delimiter;
+
+    int fd = open(filePath, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    if (!readFdSignature(fd, filePath, &reader->signature)) {
+        close(fd);
+        return false;
+    }
+
+    reader->size = (size_t)reader->signature.size;
+    if (reader->size > 0) {
+        void* mapping = mmap(NULL, reader->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            close(fd);
+            reader->size = 0;
+            return false;
+        }
+        reader->data = (const char*)mapping;
+    }
+
+    // The mapping keeps the file contents reachable after the descriptor is closed
+    close(fd);
+    return true;
+}
+
+bool tableReaderSkipLines(TableReader* reader, int count) {
+    for (int i = 0; i < count; i++) {
+        if (reader->pos >= reader->size) {
+            return false;
+        }
+        const char* newline = memchr(reader->data + reader->pos, '\n', reader->size - reader->pos);
+        reader->pos = newline != NULL ? (size_t)(newline - reader->data) + 1 : reader->size;
+    }
+    return true;
+}
+
+bool tableReaderNext(TableReader* reader, TableRow* row) {
+    const char* base = reader->data;
+    const char* end = base + reader->size;
+    const char* p = base + reader->pos;
+
+    while (p < end) {
+        const char* lineStart = p;
+        const char* fieldStart = p;
+        const char* lineEnd;
+
+        row->fieldCount = 0;
+        for (;;) {
+            const char* brk = findBreak(p, end, reader->delimiter);
+            if (row->fieldCount < TABLE_MAX_FIELDS) {
+                row->fields[row->fieldCount++] = trimmedSlice(fieldStart, brk);
+            }
+            if (brk == end || *brk == '\n') {
+                lineEnd = brk;
+                p = brk == end ? end : brk + 1;
+                break;
+            }
+            p = brk + 1;
+            fieldStart = p;
+        }
+
+        if (lineEnd > lineStart && lineEnd[-1] == '\r') {
+            lineEnd--;
+        }
+
+        // Skip blank lines, as the fgets/sscanf loops did
+        if (row->fieldCount == 1 && row->fields[0].len == 0) {
+            continue;
+        }
+
+        row->line = lineStart;
+        row->lineLen = (size_t)(lineEnd - lineStart);
+        row->offset = (long)(lineStart - base);
+        reader->pos = (size_t)(p - base);
+        return true;
+    }
+
+    reader->pos = reader->size;
+    return false;
+}
+
+bool tableSplitLine(const char* line, size_t len, char delimiter, TableRow* row) {
+    TableReader reader;
+    memset(&reader, 0, sizeof(reader));
+    reader.data = line;
+    reader.size = len;
+    reader.delimiter = delimiter;
+    return tableReaderNext(&reader, row);
+}
+
+void tableReaderClose(TableReader* reader) {
+    if (reader->data != NULL) {
+        munmap((void*)reader->data, reader->size);
+    }
+    reader->data = NULL;
+    reader->size = 0;
+    reader->pos = 0;
+}
+
+bool tableFieldEquals(const FieldSlice* field, const char* text) {
+    size_t len = strlen(text);
+    return field->len == len && memcmp(field->ptr, text, len) == 0;
+}
+
+void tableFieldCopy(const FieldSlice* field, char* dest, size_t destSize) {
+    if (destSize == 0) {
+        return;
+    }
+    size_t len = field->len < destSize - 1 ? field->len : destSize - 1;
+    memcpy(dest, field->ptr, len);
+    dest[len] = '\0';
+}
+
+bool tableFieldToLong(const FieldSlice* field, long* value) {
+    const char* p = field->ptr;
+    const char* end = p + field->len;
+    bool negative = false;
+
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+    if (p == end || end - p > 18) {
+        return false;
+    }
+
+    long result = 0;
+    for (; p < end; p++) {
+        unsigned int digit = (unsigned int)(*p - '0');
+        if (digit > 9) {
+            return false;
+        }
+        result = result * 10 + (long)digit;
+    }
+
+    *value = negative ? -result : result;
+    return true;
+}
+
+bool tableFieldToDouble(const FieldSlice* field, double* value) {
+    const char* p = field->ptr;
+    const char* end = p + field->len;
+    bool negative = false;
+
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+
+    // Accumulate all digits into one integer and scale once at the end
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int fractionDigits = 0;
+    bool seenPoint = false;
+
+    for (; p < end; p++) {
+        if (*p == '.' && !seenPoint) {
+            seenPoint = true;
+            continue;
+        }
+        unsigned int digit = (unsigned int)(*p - '0');
+        if (digit > 9 || digits >= 18) {
+            return false;
+        }
+        mantissa = mantissa * 10 + digit;
+        digits++;
+        if (seenPoint) {
+            fractionDigits++;
+        }
+    }
+    if (digits == 0) {
+        return false;
+    }
+
+    double result = (double)mantissa / powersOfTen[fractionDigits];
+    *value = negative ? -result : result;
+    return true;
+}
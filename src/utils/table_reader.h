@@ -0,0 +1,97 @@
+#ifndef TABLE_READER_H
+#define TABLE_READER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "file_utils.h"
+
+/**
+ * Zero-copy reader for the pipe-delimited data files
+ *
+ * The file is memory-mapped and each row is returned as an array of
+ * (pointer, length) slices into the mapping, trimmed of surrounding
+ * whitespace. Nothing is copied or allocated per row; slices stay valid
+ * until tableReaderClose.
+ */
+
+// Upper bound on the number of fields reported per row; extra fields are ignored
+#define TABLE_MAX_FIELDS 16
+
+// One field of a row; not NUL-terminated
+typedef struct {
+    const char* ptr;
+    size_t len;
+} FieldSlice;
+
+// One row of a table
+typedef struct {
+    FieldSlice fields[TABLE_MAX_FIELDS];
+    int fieldCount;
+    const char* line;     // Start of the row
+    size_t lineLen;       // Length without the line terminator
+    long offset;          // Byte offset of the row in the file
+} TableRow;
+
+typedef struct {
+    const char* data;
+    size_t size;
+    size_t pos;
+    char delimiter;
+    FileSignature signature;  // Signature of the file that was mapped
+} TableReader;
+
+/**
+ * Map a data file for reading
+ *
+ * @param reader Reader to initialise
+ * @param filePath File to map
+ * @param delimiter Field separator, '|' for the data files
+ * @return true on success (an empty file yields no rows)
+ */
+bool tableReaderOpen(TableReader* reader, const char* filePath, char delimiter);
+
+/**
+ * Skip whole lines, typically the two header lines
+ *
+ * @return true if that many lines were present
+ */
+bool tableReaderSkipLines(TableReader* reader, int count);
+
+/**
+ * Read the next row
+ *
+ * @param reader An open reader
+ * @param row Receives the row's field slices
+ * @return false at end of file
+ */
+bool tableReaderNext(TableReader* reader, TableRow* row);
+
+/**
+ * Split a single in-memory line into field slices, as tableReaderNext would
+ *
+ * @param line The line; need not be NUL-terminated
+ * @param len Length of the line
+ * @param delimiter Field separator
+ * @param row Receives slices pointing into `line`
+ * @return false if the line is blank
+ */
+bool tableSplitLine(const char* line, size_t len, char delimiter, TableRow* row);
+
+/**
+ * Unmap the file; all slices from this reader become invalid
+ */
+void tableReaderClose(TableReader* reader);
+
+// Compare a field with a NUL-terminated string
+bool tableFieldEquals(const FieldSlice* field, const char* text);
+
+// Copy a field into a buffer as a NUL-terminated string, truncating if needed
+void tableFieldCopy(const FieldSlice* field, char* dest, size_t destSize);
+
+// Parse a field as a signed integer; false if it is not entirely digits
+bool tableFieldToLong(const FieldSlice* field, long* value);
+
+// Parse a field as a signed decimal such as "25000.50"; false on any other format
+bool tableFieldToDouble(const FieldSlice* field, double* value);
+
+#endif // TABLE_READER_H
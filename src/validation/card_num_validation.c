@@ -2,6 +2,7 @@
 #include "../utils/logger.h"
 #include "../common/paths.h"
 #include "../common/constants.h"
+#include "../database/storage_engine.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -40,32 +41,7 @@ bool isValidCardFormat(long long cardNumber) {
 
 // Check if a card exists in our system
 bool cardExistsInSystem(int cardNumber) {
-    FILE *file = fopen(getCardFilePath(), "r");
-    if (file == NULL) {
-        writeErrorLog("Failed to open credentials file for card existence check");
-        return false;
-    }
-    
-    char line[256];
-    // Skip header lines
-    fgets(line, sizeof(line), file);
-    fgets(line, sizeof(line), file);
-    
-    int storedCardNumber;
-    int storedPIN;
-    char storedUsername[50], phoneNumber[15], storedStatus[10];
-    bool found = false;
-    
-    while (fscanf(file, "%49[^|] | %14[^|] | %d | %d | %9s", 
-                 storedUsername, phoneNumber, &storedCardNumber, &storedPIN, storedStatus) == 5) {
-        if (storedCardNumber == cardNumber) {
-            found = true;
-            break;
-        }
-    }
-    
-    fclose(file);
-    return found;
+    return storageEngine()->get_card(cardNumber, NULL);
 }
 
 // Function to validate both format and existence
@@ -211,7 +211,7 @@ int card_security_record_failed_attempt(const char* cardNumber, int isTestMode)
             char logMsg[256];
             sprintf(logMsg, "Card %s locked for %d minutes due to %d failed PIN attempts", 
                     cardNumber, lockoutMins, attempts);
-            writeAuditLog("SECURITY", logMsg);
+            writeAuditLogSync("SECURITY", logMsg);
         }
     } else {
         // Card doesn't exist in cache, add it
@@ -335,7 +335,7 @@ int card_security_lock_card(const char* cardNumber, const char* reason, int isTe
     
     char logMsg[256];
     sprintf(logMsg, "Card %s manually locked by admin: %s", cardNumber, reason ? reason : "No reason provided");
-    writeAuditLog("SECURITY", logMsg);
+    writeAuditLogSync("SECURITY", logMsg);
     
     return 1;
 }
@@ -349,7 +349,7 @@ int card_security_unlock_card(const char* cardNumber, const char* adminId, const
         char logMsg[256];
         sprintf(logMsg, "Card %s manually unlocked by admin %s: %s", 
                 cardNumber, adminId ? adminId : "unknown", reason ? reason : "No reason provided");
-        writeAuditLog("SECURITY", logMsg);
+        writeAuditLogSync("SECURITY", logMsg);
         
         // Remove the entry (fully unlock the card)
         removeCardFromCache(index);
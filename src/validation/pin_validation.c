@@ -9,16 +9,19 @@
 #include <string.h>
 #include <termios.h>
 #include <unistd.h>
+#include <pthread.h>
 
 #define MAX_PIN_ATTEMPTS 3
 #define TEMP_PIN_ATTEMPTS_FILE "data/temp/pin_attempts.txt"
 #define TEMP_TEST_PIN_ATTEMPTS_FILE "testing/test_pin_attempts.txt"
 
 /**
- * Get the path to the credentials file based on test mode
+ * Get the path to the credentials file holding a card based on test mode
  */
-static const char* getCredentialsPath(int isTestMode) {
-    if (isTestMode) {
+static const char* getCredentialsPath(const char* cardNumber, int isTestMode) {
+    if (getShardCount() > 0) {
+        return getCardFilePathFor(atoi(cardNumber));
+    } else if (isTestMode) {
         return TEST_CARD_FILE;
     } else {
         return PROD_CARD_FILE;
@@ -40,7 +43,7 @@ static const char* getPINAttemptsPath(int isTestMode) {
  * @return A newly allocated string with the hash (must be freed by caller), or NULL if not found
  */
 static char* getStoredPINHash(const char* cardNumber, int isTestMode) {
-    FILE* file = fopen(getCredentialsPath(isTestMode), "r");
+    FILE* file = fopen(getCredentialsPath(cardNumber, isTestMode), "r");
     if (!file) {
         writeErrorLog("Failed to open credentials file");
         return NULL;
@@ -137,7 +140,7 @@ int changePIN(const char* cardNumber, const char* oldPin, const char* newPin, in
     }
     
     // Update the credentials file
-    const char* credentialsPath = getCredentialsPath(isTestMode);
+    const char* credentialsPath = getCredentialsPath(cardNumber, isTestMode);
     FILE* originalFile = fopen(credentialsPath, "r");
     if (!originalFile) {
         writeErrorLog("Failed to open credentials file for reading");
@@ -224,123 +227,168 @@ int changePIN(const char* cardNumber, const char* oldPin, const char* newPin, in
     free(newHash);
     
     // Log successful PIN change
-    writeAuditLog("PIN", "PIN changed successfully for card");
+    writeAuditLogSync("PIN", "PIN changed successfully for card");
     return 1;
 }
 
-int trackPINAttempt(const char* cardNumber, int isTestMode) {
-    const char* attemptsPath = getPINAttemptsPath(isTestMode);
-    FILE* file = fopen(attemptsPath, "r");
-    int attempts = 0;
-    
-    // If file exists, look for this card's attempts
-    if (file) {
-        char line[256];
-        char tempPath[256];
-        snprintf(tempPath, sizeof(tempPath), "%s.tmp", attemptsPath);
-        FILE* tempFile = fopen(tempPath, "w");
-        
-        if (!tempFile) {
-            writeErrorLog("Failed to create temporary attempts file");
-            fclose(file);
-            return 1; // Continue allowing attempts
-        }
-        
-        int found = 0;
-        
-        while (fgets(line, sizeof(line), file)) {
-            char storedCardNumber[20];
-            int storedAttempts;
-            
-            // Remove newline if present
-            char* newline = strchr(line, '\n');
-            if (newline) *newline = '\0';
-            
-            if (sscanf(line, "%19[^,],%d", storedCardNumber, &storedAttempts) == 2) {
-                if (strcmp(storedCardNumber, cardNumber) == 0) {
-                    attempts = storedAttempts + 1;
-                    fprintf(tempFile, "%s,%d\n", cardNumber, attempts);
-                    found = 1;
-                } else {
-                    fprintf(tempFile, "%s,%d\n", storedCardNumber, storedAttempts);
-                }
-            }
-        }
-        
-        if (!found) {
-            attempts = 1;
-            fprintf(tempFile, "%s,%d\n", cardNumber, attempts);
-        }
-        
-        fclose(file);
-        fclose(tempFile);
-        
-        // Replace original file with updated one
-        remove(attemptsPath);
-        rename(tempPath, attemptsPath);
-    } else {
-        // Create new attempts file and add this card
-        file = fopen(attemptsPath, "w");
-        if (!file) {
-            writeErrorLog("Failed to create PIN attempts file");
-            return 1; // Continue allowing attempts
+/**
+ * Failed attempts per card, cached from the attempts file
+ *
+ * The file is still rewritten on every change; the cache only saves
+ * re-reading it and is reloaded whenever the file's signature changes.
+ */
+static pthread_mutex_t attemptLock = PTHREAD_MUTEX_INITIALIZER;
+static PinAttemptEntry* attemptCache = NULL;
+static size_t attemptCount = 0;
+static size_t attemptCapacity = 0;
+static const char* attemptCachePath = NULL;   // File the cache reflects
+static bool attemptFileExists = false;
+static FileSignature attemptSignature;
+
+static PinAttemptEntry* findAttempts(const char* cardNumber) {
+    for (size_t i = 0; i < attemptCount; i++) {
+        if (strcmp(attemptCache[i].cardNumber, cardNumber) == 0) {
+            return &attemptCache[i];
         }
-        
-        attempts = 1;
-        fprintf(file, "%s,%d\n", cardNumber, attempts);
-        fclose(file);
     }
-    
-    if (attempts >= MAX_PIN_ATTEMPTS) {
-        writeAuditLog("AUTH", "Card blocked due to too many incorrect PIN attempts");
-        return 0; // Card is now blocked
+    return NULL;
+}
+
+static PinAttemptEntry* addAttempts(const char* cardNumber, int attempts) {
+    if (attemptCount == attemptCapacity) {
+        size_t newCapacity = attemptCapacity == 0 ? 16 : attemptCapacity * 2;
+        PinAttemptEntry* grown = (PinAttemptEntry*)realloc(attemptCache, newCapacity * sizeof(PinAttemptEntry));
+        if (grown == NULL) {
+            return NULL;
+        }
+        attemptCache = grown;
+        attemptCapacity = newCapacity;
     }
-    
-    return 1; // Attempts still allowed
+
+    PinAttemptEntry* entry = &attemptCache[attemptCount++];
+    strncpy(entry->cardNumber, cardNumber, sizeof(entry->cardNumber) - 1);
+    entry->cardNumber[sizeof(entry->cardNumber) - 1] = '\0';
+    entry->attempts = attempts;
+    return entry;
 }
 
-void resetPINAttempts(const char* cardNumber, int isTestMode) {
-    const char* attemptsPath = getPINAttemptsPath(isTestMode);
-    FILE* file = fopen(attemptsPath, "r");
-    
-    if (!file) {
-        return; // No attempts file, nothing to reset
+// Make sure the cache reflects the attempts file at `path`
+static void refreshAttempts(const char* path) {
+    FileSignature current;
+    bool exists = readFileSignature(path, &current);
+
+    if (attemptCachePath == path && exists == attemptFileExists &&
+        (!exists || fileSignatureMatches(&current, &attemptSignature))) {
+        return;
     }
-    
-    char tempPath[256];
-    snprintf(tempPath, sizeof(tempPath), "%s.tmp", attemptsPath);
-    FILE* tempFile = fopen(tempPath, "w");
-    
-    if (!tempFile) {
-        writeErrorLog("Failed to create temporary attempts file during reset");
-        fclose(file);
+
+    attemptCount = 0;
+    attemptCachePath = path;
+    attemptFileExists = exists;
+    attemptSignature = current;
+
+    FILE* file = exists ? fopen(path, "r") : NULL;
+    if (!file) {
         return;
     }
-    
+
     char line[256];
-    
     while (fgets(line, sizeof(line), file)) {
         char storedCardNumber[20];
         int storedAttempts;
-        
-        // Remove newline if present
-        char* newline = strchr(line, '\n');
-        if (newline) *newline = '\0';
-        
+
+        // Format: cardNumber,attempts
         if (sscanf(line, "%19[^,],%d", storedCardNumber, &storedAttempts) == 2) {
-            if (strcmp(storedCardNumber, cardNumber) != 0) {
-                // Only keep non-matching cards
-                fprintf(tempFile, "%s,%d\n", storedCardNumber, storedAttempts);
+            if (findAttempts(storedCardNumber) == NULL && addAttempts(storedCardNumber, storedAttempts) == NULL) {
+                writeErrorLog("Out of memory while loading PIN attempts");
+                break;
             }
         }
     }
-    
     fclose(file);
-    fclose(tempFile);
+}
+
+// Replace the attempts file with the cache contents
+static bool saveAttempts(const char* path) {
+    char tempPath[256];
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+    FILE* tempFile = fopen(tempPath, "w");
+    if (!tempFile) {
+        writeErrorLog("Failed to create temporary attempts file");
+        return false;
+    }
+
+    for (size_t i = 0; i < attemptCount; i++) {
+        fprintf(tempFile, "%s,%d\n", attemptCache[i].cardNumber, attemptCache[i].attempts);
+    }
+
+    if (fclose(tempFile) != 0 || rename(tempPath, path) != 0) {
+        writeErrorLog("Failed to replace PIN attempts file");
+        remove(tempPath);
+        attemptCachePath = NULL;
+        return false;
+    }
+
+    // Adopt our own write so the next call does not reload
+    attemptFileExists = readFileSignature(path, &attemptSignature);
+    if (!attemptFileExists) {
+        attemptCachePath = NULL;
+    }
+    return true;
+}
+
+int trackPINAttempt(const char* cardNumber, int isTestMode) {
+    const char* attemptsPath = getPINAttemptsPath(isTestMode);
+    int attempts;
+
+    pthread_mutex_lock(&attemptLock);
+    refreshAttempts(attemptsPath);
+
+    PinAttemptEntry* entry = findAttempts(cardNumber);
+    if (entry == NULL) {
+        entry = addAttempts(cardNumber, 0);
+    }
+    if (entry == NULL) {
+        pthread_mutex_unlock(&attemptLock);
+        writeErrorLog("Failed to record PIN attempt");
+        return 1; // Continue allowing attempts
+    }
+    attempts = ++entry->attempts;
+    saveAttempts(attemptsPath);
+    pthread_mutex_unlock(&attemptLock);
+
+    if (attempts >= MAX_PIN_ATTEMPTS) {
+        writeAuditLog("AUTH", "Card blocked due to too many incorrect PIN attempts");
+        return 0; // Card is now blocked
+    }
     
-    // Replace original file with updated one
-    remove(attemptsPath);
-    rename(tempPath, attemptsPath);
+    return 1; // Attempts still allowed
+}
+
+void resetPINAttempts(const char* cardNumber, int isTestMode) {
+    const char* attemptsPath = getPINAttemptsPath(isTestMode);
+
+    pthread_mutex_lock(&attemptLock);
+    refreshAttempts(attemptsPath);
+
+    PinAttemptEntry* entry = findAttempts(cardNumber);
+    if (entry != NULL) {
+        size_t index = (size_t)(entry - attemptCache);
+        memmove(entry, entry + 1, (attemptCount - index - 1) * sizeof(PinAttemptEntry));
+        attemptCount--;
+        saveAttempts(attemptsPath);
+    }
+    pthread_mutex_unlock(&attemptLock);
+}
+
+// Failed attempts recorded for a card
+static int currentAttempts(const char* cardNumber, int isTestMode) {
+    pthread_mutex_lock(&attemptLock);
+    refreshAttempts(getPINAttemptsPath(isTestMode));
+    const PinAttemptEntry* entry = findAttempts(cardNumber);
+    int attempts = entry != NULL ? entry->attempts : 0;
+    pthread_mutex_unlock(&attemptLock);
+    return attempts;
 }
 
 /**
@@ -351,34 +399,7 @@ void resetPINAttempts(const char* cardNumber, int isTestMode) {
  * @return 1 if card is locked out, 0 otherwise
  */
 int isCardLockedOut(const char* cardNumber, int isTestMode) {
-    const char* attemptsPath = getPINAttemptsPath(isTestMode);
-    FILE* file = fopen(attemptsPath, "r");
-    
-    if (!file) {
-        return 0; // No attempts file, card is not locked
-    }
-    
-    char line[256];
-    int isLocked = 0;
-    
-    while (fgets(line, sizeof(line), file)) {
-        char storedCardNumber[20];
-        int storedAttempts;
-        
-        // Remove newline if present
-        char* newline = strchr(line, '\n');
-        if (newline) *newline = '\0';
-        
-        if (sscanf(line, "%19[^,],%d", storedCardNumber, &storedAttempts) == 2) {
-            if (strcmp(storedCardNumber, cardNumber) == 0) {
-                isLocked = (storedAttempts >= MAX_PIN_ATTEMPTS);
-                break;
-            }
-        }
-    }
-    
-    fclose(file);
-    return isLocked;
+    return currentAttempts(cardNumber, isTestMode) >= MAX_PIN_ATTEMPTS;
 }
 
 /**
@@ -389,34 +410,45 @@ int isCardLockedOut(const char* cardNumber, int isTestMode) {
  * @return Number of remaining attempts
  */
 int getRemainingPINAttempts(const char* cardNumber, int isTestMode) {
-    const char* attemptsPath = getPINAttemptsPath(isTestMode);
-    FILE* file = fopen(attemptsPath, "r");
-    
-    if (!file) {
-        return MAX_PIN_ATTEMPTS; // No attempts file, all attempts remaining
+    return MAX_PIN_ATTEMPTS - currentAttempts(cardNumber, isTestMode);
+}
+
+bool pinAttemptsExport(PinAttemptExportFn fn, void* context) {
+    pthread_mutex_lock(&attemptLock);
+    refreshAttempts(getPINAttemptsPath(isTestingMode()));
+    bool ok = fn(attemptCache, attemptCount, attemptFileExists ? &attemptSignature : NULL, context);
+    pthread_mutex_unlock(&attemptLock);
+    return ok;
+}
+
+bool pinAttemptsAdopt(const PinAttemptEntry* entries, size_t count, const FileSignature* savedSignature) {
+    const char* path = getPINAttemptsPath(isTestingMode());
+
+    // Only usable if the attempts file is exactly as it was when the table was saved
+    FileSignature current;
+    bool exists = readFileSignature(path, &current);
+    if (exists != (savedSignature != NULL)) {
+        return false;
     }
-    
-    char line[256];
-    int attempts = 0;
-    
-    while (fgets(line, sizeof(line), file)) {
-        char storedCardNumber[20];
-        int storedAttempts;
-        
-        // Remove newline if present
-        char* newline = strchr(line, '\n');
-        if (newline) *newline = '\0';
-        
-        if (sscanf(line, "%19[^,],%d", storedCardNumber, &storedAttempts) == 2) {
-            if (strcmp(storedCardNumber, cardNumber) == 0) {
-                attempts = storedAttempts;
-                break;
-            }
+    if (exists) {
+        FileSignature saved = *savedSignature;
+        saved.path = path;
+        if (!fileSignatureMatches(&saved, &current)) {
+            return false;
         }
     }
-    
-    fclose(file);
-    return MAX_PIN_ATTEMPTS - attempts;
+
+    pthread_mutex_lock(&attemptLock);
+    attemptCount = 0;
+    bool ok = true;
+    for (size_t i = 0; i < count && ok; i++) {
+        ok = addAttempts(entries[i].cardNumber, entries[i].attempts) != NULL;
+    }
+    attemptCachePath = ok ? path : NULL;
+    attemptFileExists = exists;
+    attemptSignature = current;
+    pthread_mutex_unlock(&attemptLock);
+    return ok;
 }
 
 char* hashPIN(const char* pin) {
@@ -2,6 +2,18 @@
 #define PIN_VALIDATION_H
 
 #include <stddef.h> // Added for size_t type
+#include <stdbool.h>
+#include "../utils/file_utils.h"
+
+// Failed PIN attempts recorded for one card
+typedef struct {
+    char cardNumber[20];
+    int attempts;
+} PinAttemptEntry;
+
+// Receives the attempt table and the attempts file signature (NULL if there is no file)
+typedef bool (*PinAttemptExportFn)(const PinAttemptEntry* entries, size_t count,
+                                   const FileSignature* signature, void* context);
 
 /**
  * Validates a PIN against the stored hash
@@ -59,6 +71,22 @@ int isCardLockedOut(const char* cardNumber, int isTestMode);
  */
 int getRemainingPINAttempts(const char* cardNumber, int isTestMode);
 
+/**
+ * Hand the cached attempt table to `fn` while it is locked
+ *
+ * @return The result of `fn`
+ */
+bool pinAttemptsExport(PinAttemptExportFn fn, void* context);
+
+/**
+ * Seed the attempt cache from a snapshot instead of reading the attempts file
+ *
+ * @param savedSignature Attempts file signature saved with the table, or NULL
+ *                       if there was no file; its path is ignored
+ * @return true if the file is unchanged since then and the table was adopted
+ */
+bool pinAttemptsAdopt(const PinAttemptEntry* entries, size_t count, const FileSignature* savedSignature);
+
 /**
  * Hash a PIN to store in the system
  * 
@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "../src/common/paths.h"
+#include "../src/database/customer_profile.h"
+
+// Rows in the generated card file and lookups per run unless given on the command line
+#define DEFAULT_ROWS 10000
+#define DEFAULT_LOOKUPS 200
+#define RUNS 5
+#define FIRST_CARD 4000000
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Write a card file with `rows` rows in the format of data/card.txt
+static int writeCardFile(const char* path, int rows) {
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        return 0;
+    }
+    fprintf(file, "Card ID | Account ID | Card Number      | Card Type | Expiry Date | Status  | PIN Hash\n");
+    fprintf(file, "--------|------------|-----------------|-----------|-------------|---------|------------------------------------------\n");
+    for (int i = 0; i < rows; i++) {
+        fprintf(file, "D%07d | A%07d   | %-15d | %-9s | 2027-08-31  | %-7s | %032x\n",
+                i + 10001, i + 10001, FIRST_CARD + i, i % 3 == 0 ? "Credit" : "Debit",
+                i % 50 == 0 ? "Blocked" : "Active", (unsigned int)i * 2654435761u);
+    }
+    return fclose(file) == 0;
+}
+
+// Trim whitespace in place
+static char* trimInPlace(char* str) {
+    while (isspace((unsigned char)*str)) {
+        str++;
+    }
+    char* end = str + strlen(str);
+    while (end > str && isspace((unsigned char)end[-1])) {
+        end--;
+    }
+    *end = '\0';
+    return str;
+}
+
+// The lookup customer_profile used before the table reader: every row goes through
+// sscanf, and the enum fields are strdup'd before they are compared
+static int findCardWithStdio(int cardNumber, Card* card) {
+    FILE* file = fopen(getCardFilePath(), "r");
+    if (file == NULL) {
+        return 0;
+    }
+
+    char line[512];
+    int found = 0;
+    if (fgets(line, sizeof(line), file) == NULL || fgets(line, sizeof(line), file) == NULL) {
+        fclose(file);
+        return 0;
+    }
+    while (!found && fgets(line, sizeof(line), file) != NULL) {
+        char cardId[11], accountId[11], expiryDate[11], status[20], pinHash[65], cardType[20];
+        int storedCardNumber;
+        if (sscanf(line, "%10[^|] | %10[^|] | %d | %19[^|] | %10[^|] | %19[^|] | %64s",
+                   cardId, accountId, &storedCardNumber, cardType, expiryDate, status, pinHash) != 7) {
+            continue;
+        }
+
+        Card candidate;
+        memset(&candidate, 0, sizeof(candidate));
+        strncpy(candidate.cardId, trimInPlace(cardId), sizeof(candidate.cardId) - 1);
+        strncpy(candidate.accountId, trimInPlace(accountId), sizeof(candidate.accountId) - 1);
+        candidate.cardNumber = storedCardNumber;
+        char* type = strdup(cardType);
+        candidate.cardType = strcasecmp(trimInPlace(type), "Credit") == 0 ? CARD_CREDIT : CARD_DEBIT;
+        free(type);
+        strncpy(candidate.expiryDate, trimInPlace(expiryDate), sizeof(candidate.expiryDate) - 1);
+        char* state = strdup(status);
+        candidate.status = strcasecmp(trimInPlace(state), "Active") == 0 ? CARD_ACTIVE : CARD_BLOCKED;
+        free(state);
+        strncpy(candidate.pinHash, trimInPlace(pinHash), sizeof(candidate.pinHash) - 1);
+
+        if (candidate.cardNumber == cardNumber) {
+            *card = candidate;
+            found = 1;
+        }
+    }
+    fclose(file);
+    return found;
+}
+
+static int findCardWithProfile(int cardNumber, Card* card) {
+    return loadCardByCardNumber(cardNumber, card);
+}
+
+// Look up `lookups` cards spread over the file and sum what was found
+static long runLookups(int (*find)(int, Card*), int rows, int lookups) {
+    long checksum = 0;
+    for (int i = 0; i < lookups; i++) {
+        Card card;
+        int cardNumber = FIRST_CARD + (int)((long)i * 7919 % rows);
+        if (find(cardNumber, &card)) {
+            checksum += card.cardNumber + card.status * 3 + card.cardType + card.accountId[7];
+        } else {
+            checksum -= 1;
+        }
+    }
+    return checksum;
+}
+
+// Best of RUNS
+static double timeLookups(int (*find)(int, Card*), int rows, int lookups, long* checksum) {
+    double best = 0;
+    for (int run = 0; run < RUNS; run++) {
+        double start = now();
+        *checksum = runLookups(find, rows, lookups);
+        double elapsed = now() - start;
+        if (run == 0 || elapsed < best) {
+            best = elapsed;
+        }
+    }
+    return best;
+}
+
+int main(int argc, char* argv[]) {
+    int rows = argc > 1 ? atoi(argv[1]) : DEFAULT_ROWS;
+    int lookups = argc > 2 ? atoi(argv[2]) : DEFAULT_LOOKUPS;
+    if (rows <= 0 || lookups <= 0) {
+        printf("Usage: %s [rows] [lookups]\n", argv[0]);
+        return 1;
+    }
+
+    // The testing paths are relative, so work in a scratch directory
+    char dir[] = "/tmp/bench_profile_XXXXXX";
+    if (mkdtemp(dir) == NULL || chdir(dir) != 0 || mkdir(TEST_DATA_DIR, 0755) != 0) {
+        printf("Failed to create a scratch data directory\n");
+        return 1;
+    }
+    setTestingMode(1);
+    if (!writeCardFile(getCardFilePath(), rows)) {
+        printf("Failed to write the card file\n");
+        return 1;
+    }
+
+    long stdioChecksum, profileChecksum;
+    double stdioTime = timeLookups(findCardWithStdio, rows, lookups, &stdioChecksum);
+    double profileTime = timeLookups(findCardWithProfile, rows, lookups, &profileChecksum);
+
+    unlink(getCardFilePath());
+    rmdir(TEST_DATA_DIR);
+    if (chdir("/") == 0) {
+        rmdir(dir);
+    }
+
+    printf("fgets + sscanf:        %d lookups over %d rows in %.3f s (%.1f us/lookup)\n",
+           lookups, rows, stdioTime, stdioTime * 1e6 / lookups);
+    printf("loadCardByCardNumber:  %d lookups over %d rows in %.3f s (%.1f us/lookup)\n",
+           lookups, rows, profileTime, profileTime * 1e6 / lookups);
+    if (stdioChecksum != profileChecksum) {
+        printf("customer_profile bench failed: the two lookups found different cards.\n");
+        return 1;
+    }
+    printf("customer_profile bench passed: %.1fx faster.\n", stdioTime / profileTime);
+    return 0;
+}
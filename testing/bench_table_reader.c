@@ -0,0 +1,159 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../src/utils/table_reader.h"
+
+// Rows in the generated card file unless a count is given on the command line
+#define DEFAULT_ROWS 1000000
+#define RUNS 5
+
+// What a card lookup keeps from each row
+typedef struct {
+    int cardNumber;
+    char cardID[20];
+    char accountID[20];
+    char status[20];
+    char expiryDate[30];
+    char pinHash[70];
+    long offset;
+} CardRow;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Write a card.txt with `rows` rows in the format of data/card.txt
+static int writeCardFile(const char* path, int rows) {
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        return 0;
+    }
+    fprintf(file, "Card ID | Account ID | Card Number      | Card Type | Expiry Date | Status  | PIN Hash\n");
+    fprintf(file, "--------|------------|-----------------|-----------|-------------|---------|------------------------------------------\n");
+    for (int i = 0; i < rows; i++) {
+        fprintf(file, "D%07d | A%07d   | %-15d | Debit     | 2027-08-31  | %-7s | %032x\n",
+                i + 10001, i + 10001, 4000000 + i, i % 50 == 0 ? "Blocked" : "Active", (unsigned int)i * 2654435761u);
+    }
+    return fclose(file) == 0;
+}
+
+// The per-row fgets and sscanf parsing the lookups used before the table reader
+static int scanWithStdio(const char* path, long* checksum) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        return -1;
+    }
+
+    char line[256];
+    char cardID[20], accountID[20], cardNumber[30], cardType[20], expiryDate[30], status[20], pinHash[70];
+    CardRow row;
+    int rows = 0;
+    *checksum = 0;
+    if (fgets(line, sizeof(line), file) == NULL || fgets(line, sizeof(line), file) == NULL) {
+        fclose(file);
+        return 0;
+    }
+    long offset = ftell(file);
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if (sscanf(line, "%19s | %19s | %29s | %19s | %29s | %19s | %69s",
+                   cardID, accountID, cardNumber, cardType, expiryDate, status, pinHash) >= 7) {
+            row.cardNumber = atoi(cardNumber);
+            snprintf(row.cardID, sizeof(row.cardID), "%s", cardID);
+            snprintf(row.accountID, sizeof(row.accountID), "%s", accountID);
+            snprintf(row.status, sizeof(row.status), "%s", status);
+            snprintf(row.expiryDate, sizeof(row.expiryDate), "%s", expiryDate);
+            snprintf(row.pinHash, sizeof(row.pinHash), "%s", pinHash);
+            row.offset = offset;
+            *checksum += row.cardNumber + row.status[0];
+            rows++;
+        }
+        offset = ftell(file);
+    }
+    fclose(file);
+    return rows;
+}
+
+static int scanWithTableReader(const char* path, long* checksum) {
+    TableReader reader;
+    if (!tableReaderOpen(&reader, path, '|')) {
+        return -1;
+    }
+    tableReaderSkipLines(&reader, 2);
+
+    TableRow tableRow;
+    CardRow row;
+    int rows = 0;
+    *checksum = 0;
+    while (tableReaderNext(&reader, &tableRow)) {
+        long cardNumber;
+        if (tableRow.fieldCount < 7 || !tableFieldToLong(&tableRow.fields[2], &cardNumber)) {
+            continue;
+        }
+        row.cardNumber = (int)cardNumber;
+        tableFieldCopy(&tableRow.fields[0], row.cardID, sizeof(row.cardID));
+        tableFieldCopy(&tableRow.fields[1], row.accountID, sizeof(row.accountID));
+        tableFieldCopy(&tableRow.fields[5], row.status, sizeof(row.status));
+        tableFieldCopy(&tableRow.fields[4], row.expiryDate, sizeof(row.expiryDate));
+        tableFieldCopy(&tableRow.fields[6], row.pinHash, sizeof(row.pinHash));
+        row.offset = tableRow.offset;
+        *checksum += row.cardNumber + row.status[0];
+        rows++;
+    }
+    tableReaderClose(&reader);
+    return rows;
+}
+
+// Best of RUNS full scans
+static double timeScan(int (*scan)(const char*, long*), const char* path, int* rows, long* checksum) {
+    double best = 0;
+    for (int run = 0; run < RUNS; run++) {
+        double start = now();
+        *rows = scan(path, checksum);
+        double elapsed = now() - start;
+        if (run == 0 || elapsed < best) {
+            best = elapsed;
+        }
+    }
+    return best;
+}
+
+int main(int argc, char* argv[]) {
+    int rows = argc > 1 ? atoi(argv[1]) : DEFAULT_ROWS;
+    if (rows <= 0) {
+        printf("Usage: %s [rows]\n", argv[0]);
+        return 1;
+    }
+
+    char path[] = "/tmp/bench_card_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        printf("Failed to create a temporary card file\n");
+        return 1;
+    }
+    close(fd);
+    if (!writeCardFile(path, rows)) {
+        printf("Failed to write the temporary card file\n");
+        unlink(path);
+        return 1;
+    }
+
+    int stdioRows, readerRows;
+    long stdioChecksum, readerChecksum;
+    double stdioTime = timeScan(scanWithStdio, path, &stdioRows, &stdioChecksum);
+    double readerTime = timeScan(scanWithTableReader, path, &readerRows, &readerChecksum);
+    unlink(path);
+
+    printf("fgets + sscanf: %d rows in %.3f s (%.0f ns/row)\n", stdioRows, stdioTime, stdioTime * 1e9 / stdioRows);
+    printf("table reader:   %d rows in %.3f s (%.0f ns/row)\n", readerRows, readerTime,
+           readerTime * 1e9 / readerRows);
+    if (stdioRows != readerRows || stdioChecksum != readerChecksum) {
+        printf("table_reader bench failed: the two scans read different rows.\n");
+        return 1;
+    }
+    printf("table_reader bench passed: %.1fx faster.\n", stdioTime / readerTime);
+    return 0;
+}
@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "../src/common/paths.h"
+#include "../src/config/config_manager.h"
+#include "../src/database/customer_index.h"
+#include "../src/database/journal.h"
+#include "../src/utils/logger.h"
+
+// Accounts A0000000 .. A0000012, all starting at 1000.00
+#define ACCOUNTS 13
+#define START_BALANCE 1000.0f
+
+// Long enough that only journalClose checkpoints during a test
+#define TEST_CONFIG_FILE "data/test_journal.conf"
+
+static int failures = 0;
+
+static void check(int passed, const char* name) {
+    if (passed) {
+        printf("%s test passed.\n", name);
+    } else {
+        printf("%s test failed.\n", name);
+        failures++;
+    }
+}
+
+static void accountID(int account, char* id, size_t idSize) {
+    snprintf(id, idSize, "A%07d", account);
+}
+
+static bool writeCustomerFile(void) {
+    FILE* file = fopen(getCustomerFilePath(), "w");
+    if (file == NULL) {
+        return false;
+    }
+    fprintf(file, "Customer ID | Account ID | Account Holder Name | Type | Status | Balance\n");
+    fprintf(file, "------------|------------|---------------------|------|--------|--------\n");
+    for (int i = 0; i < ACCOUNTS; i++) {
+        fprintf(file, "C%07d | A%07d | Holder %d | Savings | Active | %.2f\n", i, i, i, START_BALANCE);
+    }
+    fclose(file);
+    return convertCustomerFileToFixedWidth(getCustomerFilePath()) == ACCOUNTS;
+}
+
+static float balanceOf(int account) {
+    char id[20];
+    CustomerIndexEntry entry;
+    accountID(account, id, sizeof(id));
+    return customerIndexLookup(id, &entry) ? entry.balance : -1.0f;
+}
+
+// Run `step` in a child that exits without closing the journal, like a crash
+// after the commits returned
+static bool runCrashed(bool (*step)(void)) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        loadConfig(TEST_CONFIG_FILE);
+        bool ok = journalOpen() && step();
+        _exit(ok ? 0 : 1);
+    }
+    int status;
+    return pid > 0 && waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// Replay the journal in a child and checkpoint it into customer.txt, then
+// drop this process's index of the old file
+static bool reopenAndClose(void) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        loadConfig(TEST_CONFIG_FILE);
+        bool ok = journalOpen();
+        journalClose();
+        _exit(ok ? 0 : 1);
+    }
+    int status;
+    bool ok = pid > 0 && waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    customerIndexInvalidate();
+    return ok;
+}
+
+// A single-account commit to A0000000
+static bool commitSingle(void) {
+    JournalDelta delta = { "A0000000", 50.0f, START_BALANCE + 50.0f };
+    return journalCommit(&delta, 1);
+}
+
+// A batch crediting A0000001 .. A0000012, more changes than fit in one record
+static bool commitBatch(void) {
+    JournalDelta deltas[ACCOUNTS - 1];
+    for (int i = 1; i < ACCOUNTS; i++) {
+        accountID(i, deltas[i - 1].accountID, sizeof(deltas[i - 1].accountID));
+        deltas[i - 1].delta = 10.0f;
+        deltas[i - 1].newBalance = START_BALANCE + 10.0f;
+    }
+    return journalCommitBatch(deltas, ACCOUNTS - 1);
+}
+
+static bool commitSingleThenBatch(void) {
+    return commitSingle() && commitBatch();
+}
+
+static bool batchApplied(float expected) {
+    for (int i = 1; i < ACCOUNTS; i++) {
+        if (balanceOf(i) != expected) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Cut `bytes` off the end of the journal, as a crash mid-write would
+static bool tearJournal(off_t bytes) {
+    struct stat st;
+    return stat(getJournalFilePath(), &st) == 0 && st.st_size > bytes &&
+           truncate(getJournalFilePath(), st.st_size - bytes) == 0;
+}
+
+// A batch whose last record is torn is dropped whole; the record before it survives
+void test_tornBatchTail() {
+    int passed = runCrashed(commitSingleThenBatch) && tearJournal(5) && reopenAndClose() &&
+                 balanceOf(0) == START_BALANCE + 50.0f && batchApplied(START_BALANCE);
+    check(passed, "journal torn batch tail");
+}
+
+// The torn tail was cut off, so later records are appended after valid ones
+void test_appendAfterTornTail() {
+    int passed = runCrashed(commitBatch) && reopenAndClose() && batchApplied(START_BALANCE + 10.0f);
+    check(passed, "journal append after torn tail");
+}
+
+// A record that is only partly written is dropped without losing earlier ones
+void test_tornSingleRecord() {
+    writeCustomerFile();
+    int passed = runCrashed(commitBatch) && runCrashed(commitSingle) && tearJournal(1) && reopenAndClose() &&
+                 balanceOf(0) == START_BALANCE && batchApplied(START_BALANCE + 10.0f);
+    check(passed, "journal torn single record");
+}
+
+int main() {
+    // The data paths are relative, so work in a scratch directory
+    char dir[] = "/tmp/test_journal_XXXXXX";
+    if (mkdtemp(dir) == NULL || chdir(dir) != 0 || mkdir(PROD_DATA_DIR, 0755) != 0 ||
+        mkdir(PROD_JOURNAL_DIR, 0755) != 0 || mkdir("logs", 0755) != 0) {
+        printf("Failed to create a scratch data directory\n");
+        return 1;
+    }
+    FILE* config = fopen(TEST_CONFIG_FILE, "w");
+    if (config == NULL || !writeCustomerFile()) {
+        printf("Failed to write the test data files\n");
+        return 1;
+    }
+    fprintf(config, "journal_checkpoint_interval_ms = 600000\n");
+    fclose(config);
+
+    test_tornBatchTail();
+    test_appendAfterTornTail();
+    test_tornSingleRecord();
+
+    logSync();
+    if (failures > 0) {
+        printf("Test data left in %s\n", dir);
+        return 1;
+    }
+    char command[64];
+    snprintf(command, sizeof(command), "rm -rf %s", dir);
+    if (chdir("/") != 0 || system(command) != 0) {
+        printf("Failed to remove %s\n", dir);
+    }
+    return 0;
+}
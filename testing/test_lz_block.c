@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/utils/lz_block.h"
+
+#define BLOCK_SIZE 65536
+
+static unsigned char input[BLOCK_SIZE];
+static unsigned char compressed[LZ_BLOCK_BOUND(BLOCK_SIZE)];
+static unsigned char output[BLOCK_SIZE];
+
+static int failures = 0;
+
+// Compress and decompress `size` bytes of `input`; returns the compressed size, 0 on failure
+static size_t roundTrip(size_t size) {
+    size_t packed = lzCompressBlock(input, size, compressed, sizeof(compressed));
+    if (packed == 0 || packed > LZ_BLOCK_BOUND(size)) {
+        return 0;
+    }
+    memset(output, 0xA5, sizeof(output));
+    if (!lzDecompressBlock(compressed, packed, output, size) || memcmp(input, output, size) != 0) {
+        return 0;
+    }
+    return packed;
+}
+
+static void check(int passed, const char* name) {
+    if (passed) {
+        printf("%s test passed.\n", name);
+    } else {
+        printf("%s test failed.\n", name);
+        failures++;
+    }
+}
+
+// Every length around the token's 15-byte escape and the 4-byte match minimum
+void test_shortBlocks() {
+    int passed = 1;
+    srand(1);
+    for (size_t size = 0; size < 300 && passed; size++) {
+        for (size_t i = 0; i < size; i++) {
+            input[i] = (unsigned char)(rand() % 3);
+        }
+        passed = roundTrip(size) > 0;
+    }
+    check(passed, "lz_block short blocks");
+}
+
+// Log lines repeat heavily and must shrink
+void test_logText() {
+    size_t size = 0;
+    for (int i = 0; size + 128 < BLOCK_SIZE; i++) {
+        size += (size_t)snprintf((char*)input + size, BLOCK_SIZE - size,
+                                 "[2026-10-16 12:%02d:%02d] [INFO] Deposit of $%d.00 to card %d completed\n",
+                                 i / 60 % 60, i % 60, i % 500, 4000000 + i % 97);
+    }
+    size_t packed = roundTrip(size);
+    check(packed > 0 && packed < size / 2, "lz_block log text");
+}
+
+// Runs longer than a 16-bit offset window and matches that overlap their own output
+void test_longRuns() {
+    memset(input, 'x', BLOCK_SIZE);
+    size_t packed = roundTrip(BLOCK_SIZE);
+    check(packed > 0 && packed < 1024, "lz_block long runs");
+}
+
+// Random bytes do not compress but must still fit the bound
+void test_incompressible() {
+    srand(2);
+    for (size_t i = 0; i < BLOCK_SIZE; i++) {
+        input[i] = (unsigned char)rand();
+    }
+    check(roundTrip(BLOCK_SIZE) > 0, "lz_block incompressible data");
+}
+
+// Damaged blocks and wrong sizes are rejected rather than overrunning the output
+void test_corruptBlocks() {
+    memset(input, 'y', 4096);
+    memcpy(input + 100, "a distinct stretch of literals", 30);
+    size_t packed = lzCompressBlock(input, 4096, compressed, sizeof(compressed));
+    int passed = packed > 1 &&
+                 !lzDecompressBlock(compressed, packed, output, 4095) &&
+                 !lzDecompressBlock(compressed, packed, output, 4097) &&
+                 !lzDecompressBlock(compressed, packed - 1, output, 4096);
+    check(passed, "lz_block corrupt blocks");
+}
+
+// A destination smaller than the bound reports 0 instead of writing past it
+void test_smallCapacity() {
+    srand(3);
+    for (size_t i = 0; i < 1024; i++) {
+        input[i] = (unsigned char)rand();
+    }
+    check(lzCompressBlock(input, 1024, compressed, 512) == 0, "lz_block small capacity");
+}
+
+int main() {
+    test_shortBlocks();
+    test_logText();
+    test_longRuns();
+    test_incompressible();
+    test_corruptBlocks();
+    test_smallCapacity();
+    return failures == 0 ? 0 : 1;
+}